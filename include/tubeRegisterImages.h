@@ -178,6 +178,9 @@ public:
   tubeWrapSetMacro( UseEvolutionaryOptimization, bool, Filter );
   tubeWrapGetMacro( UseEvolutionaryOptimization, bool, Filter );
 
+  tubeWrapSetMacro( NumberOfEvolutionaryStarts, unsigned int, Filter );
+  tubeWrapGetMacro( NumberOfEvolutionaryStarts, unsigned int, Filter );
+
   tubeWrapSetMacro( ExpectedOffsetMagnitude, double, Filter );
   tubeWrapGetMacro( ExpectedOffsetMagnitude, double, Filter );
 
@@ -224,6 +227,9 @@ public:
   tubeWrapGetMacro( MinimizeMemory, bool, Filter );
   tubeWrapBooleanMacro( MinimizeMemory, Filter );
 
+  /** Coarse-to-fine levels of the rigid, affine and BSpline stages */
+  void SetPyramidNumberOfLevels( unsigned int numberOfLevels );
+
   // 
   // Loaded transform parameters
   //
@@ -123,6 +123,15 @@ RegisterImages< TImage >
     }
 }
 
+template< class TImage >
+void
+RegisterImages< TImage >
+::SetPyramidNumberOfLevels( unsigned int numberOfLevels )
+{
+  m_Filter->SetPyramidNumberOfLevels( numberOfLevels );
+  this->Modified();
+}
+
 template< class TImage >
 void
 RegisterImages< TImage >
@@ -31,6 +31,8 @@ limitations under the License.
 #include "itktubeTubeExtractor.h"
 #include "itktubeTubeExtractorIO.h"
 
+#include <sstream>
+
 namespace tube
 {
 /** \class SegmentTubes
@@ -161,9 +163,22 @@ public:
   tubeWrapSetMacro( SeedMaskStride, int, Filter );
   tubeWrapGetMacro( SeedMaskStride, int, Filter );
 
+  tubeWrapSetMacro( NumberOfWorkUnits, unsigned int, Filter );
+  tubeWrapGetMacro( NumberOfWorkUnits, unsigned int, Filter );
+
+  tubeWrapSetMacro( UseBlurredImageCache, bool, Filter );
+  tubeWrapGetMacro( UseBlurredImageCache, bool, Filter );
+
   void ProcessSeeds( void )
   { this->m_Filter->ProcessSeeds( m_Verbose ); };
 
+  /** Timers, counters and seed records of the last ProcessSeeds, as a
+   *  JSON object.  See itk::tube::TubeExtractorProfile. */
+  std::string GetProfileAsJSON( void ) const
+  { std::ostringstream json;
+    this->m_Filter->GetProfile().WriteJSON( json );
+    return json.str(); };
+
   /** Load parameters of tube extraction from a file */
   void LoadParameterFile( const std::string & filename )
   { ::itk::tube::TubeExtractorIO< ImageType > teReader;
@@ -30,7 +30,9 @@ itk_module( TubeTK
     ITKIOImageBase
     ITKIOTransformBase
     ITKMetaIO
+    ITKMetricsv4
     ITKOptimizers
+    ITKOptimizersv4
     ITKRegionGrowing
     ITKSmoothing
     ITKStatistics
@@ -113,39 +113,70 @@ int DoIt( int argc, char * argv[] )
   atlasBuilder->AdjustResampledImageOrigin( doImageOriginAdjustment );
 
   ImageDocumentListType::const_iterator it_imgDoc = imageObjects.begin();
-  tube::FmtInfoMessage( "Starting image addition..." );
-
-  /* Iteratively add the images to atlas summation method. This is done so that
-     only one image must be held in memory at a time. */
   DocumentToImageFilter::Pointer filter = DocumentToImageFilter::New();
 
-  while( it_imgDoc != imageObjects.end() )
+  if( streamImages )
     {
-    ImageDocumentType::Pointer doc
-      = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
-    tube::FmtInfoMessage( "Adding image: %s", doc->GetObjectName().c_str() );
-
-    filter->SetInput( doc );
-    filter->SetApplyTransforms( false );
-    filter->Update();
-    filter->GetComposedTransform();
-
-    if( filter->GetComposedTransformIsIdentity() )
+    /* The images are read a slab at a time, so they must share one grid
+       and have no transforms. */
+    std::vector< std::string > fileNames;
+    while( it_imgDoc != imageObjects.end() )
       {
-      tube::DebugMessage( "ComposedTransform is IDENTITY" );
-      atlasBuilder->AddImage( filter->GetOutput() );
+      ImageDocumentType::Pointer doc
+        = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
+
+      filter->SetInput( doc );
+      filter->GetComposedTransform();
+      if( !filter->GetComposedTransformIsIdentity() )
+        {
+        tube::FmtErrorMessage( "Image %s has a transform and cannot be "
+          "streamed!", doc->GetObjectName().c_str() );
+        delete reader;
+        delete atlasBuilder;
+        return EXIT_FAILURE;
+        }
+      fileNames.push_back( doc->GetObjectName() );
+      ++it_imgDoc;
       }
-    else
+
+    tube::InfoMessage( "Streaming the images..." );
+    atlasBuilder->StreamImageFiles( fileNames );
+    tube::InfoMessage( "Done!" );
+    }
+  else
+    {
+    tube::FmtInfoMessage( "Starting image addition..." );
+
+    /* Iteratively add the images to atlas summation method. This is done so
+       that only one image must be held in memory at a time. */
+    while( it_imgDoc != imageObjects.end() )
       {
-      atlasBuilder->AddImage( filter->GetOutput(),
-                              filter->GetComposedTransform().GetPointer() );
+      ImageDocumentType::Pointer doc
+        = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
+      tube::FmtInfoMessage( "Adding image: %s", doc->GetObjectName().c_str() );
+
+      filter->SetInput( doc );
+      filter->SetApplyTransforms( false );
+      filter->Update();
+      filter->GetComposedTransform();
+
+      if( filter->GetComposedTransformIsIdentity() )
+        {
+        tube::DebugMessage( "ComposedTransform is IDENTITY" );
+        atlasBuilder->AddImage( filter->GetOutput() );
+        }
+      else
+        {
+        atlasBuilder->AddImage( filter->GetOutput(),
+                                filter->GetComposedTransform().GetPointer() );
+        }
+      ++it_imgDoc;
       }
-    ++it_imgDoc;
-    }
 
-  tube::InfoMessage( "Finalizing the images..." );
-  atlasBuilder->Finalize();
-  tube::InfoMessage( "Done!" );
+    tube::InfoMessage( "Finalizing the images..." );
+    atlasBuilder->Finalize();
+    tube::InfoMessage( "Done!" );
+    }
 
   // Save output images.
   WriteImage( atlasBuilder->GetMeanImage(), outputMeanAtlas.c_str() );
@@ -27,6 +27,15 @@ limitations under the License.
 #include "itktubeMeanAndSigmaImageBuilder.h"
 #include "tubeMessage.h"
 
+#include <itkImageFileReader.h>
+#include <itkMultiThreaderBase.h>
+#include <itkRegionOfInterestImageFilter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
 namespace itk
 {
 
@@ -46,6 +55,12 @@ namespace tube
  * size many vary and the images will be updated to insure the largest region
  * of all images are collected.
  *
+ * Alternatively, the images can be given as files by AddImageFileName()
+ * and the outputs computed by StreamOutput().  The files are then read a
+ * slab at a time, so only the current slab of every image is in memory,
+ * and the trimmed mean ( or median ) and sigma of each voxel are computed
+ * from all of its values by several work units.
+ *
  * This class derives from \sa MeanAndSigmaImageBuilder
  */
 template< class TInputImageType, class TOutputMeanImageType,
@@ -66,6 +81,9 @@ public:
   itkNewMacro( Self );
   itkTypeMacro( RobustMeanAndSigmaImageBuilder, MeanAndSigmaImageBuilder );
 
+  itkStaticConstMacro( ImageDimension, unsigned int,
+                       TInputImageType::ImageDimension );
+
   typedef TInputImageType                              InputImageType;
   typedef TOutputMeanImageType                         OutputMeanImageType;
   typedef TOutputSigmaImageType                        OutputSigmaImageType;
@@ -82,6 +100,7 @@ public:
   typedef typename Superclass::SpacingType             SpacingType;
   typedef typename Superclass::PointType               PointType;
   typedef typename Superclass::SizeType                SizeType;
+  typedef typename InputImageType::DirectionType       DirectionType;
 
   /**
    * Add an image to the group being summed. No check is made to insure
@@ -131,6 +150,46 @@ public:
    */
   void UpdateOutputImageSize( SizeType );
 
+  /**
+   * Add the file of an image to the cohort processed by StreamOutput().
+   * All files must hold images of the same size, spacing, origin and
+   * direction.
+   */
+  void AddImageFileName( const std::string & fileName )
+    { m_ImageFileNames.push_back( fileName ); }
+
+  void ClearImageFileNames( void )
+    { m_ImageFileNames.clear(); }
+
+  const std::vector< std::string > & GetImageFileNames( void ) const
+    { return m_ImageFileNames; }
+
+  /**
+   * Number of slices, along the last dimension, read from every file at
+   * once by StreamOutput().  Zero ( the default ) chooses the slab so that
+   * the slabs of all the files hold about as many voxels as one image.
+   * Only files whose ImageIO can stream read are read a slab at a time;
+   * the others are read whole for every slab, so with them larger slabs
+   * save reading time at the cost of memory.
+   */
+  itkSetMacro( SlabSize, unsigned int );
+  itkGetConstMacro( SlabSize, unsigned int );
+
+  /**
+   * Number of work units used by StreamOutput().  Zero ( the default )
+   * uses the global default of the multithreader.
+   */
+  itkSetMacro( NumberOfWorkUnits, unsigned int );
+  itkGetConstMacro( NumberOfWorkUnits, unsigned int );
+
+  /**
+   * Compute the outputs from the image files, slab by slab.  The
+   * NumberOfOutlierImagesToRemove lowest and highest values of a voxel are
+   * removed before its mean and sigma are computed.  If UseMedianImage()
+   * was called, the mean image holds the median of the values instead.
+   */
+  void StreamOutput( void );
+
 
 protected:
 
@@ -221,6 +280,30 @@ protected:
    */
   OutputMeanImagePointer  GetMedianImage();
 
+  typedef ImageFileReader< InputImageType >             ReaderType;
+
+  struct StreamingThreadStruct
+    {
+    Self                                * Builder;
+    const std::vector< InputPixelType > * Values;
+    unsigned int                          NumberOfImages;
+    SizeValueType                         NumberOfVoxels;
+    OffsetValueType                       OutputOffset;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    StreamingThreaderCallback( void * arg );
+
+  /**
+   * Compute the outputs of voxels firstVoxel to lastVoxel of a slab.
+   * The values of image i are at values[ i * numberOfVoxels ], and the
+   * slab starts at outputOffset in the output buffers.
+   */
+  void ComputeRobustStatistics( const std::vector< InputPixelType > & values,
+    unsigned int numberOfImages, SizeValueType numberOfVoxels,
+    SizeValueType firstVoxel, SizeValueType lastVoxel,
+    OffsetValueType outputOffset );
+
 private:
 
   InputImageListType                      m_LowerOutlierImages;
@@ -229,6 +312,10 @@ private:
   unsigned int                            m_NumberOfOutlierImagesToRemove;
   unsigned int                            m_TotalNumberOfImages;
 
+  std::vector< std::string >              m_ImageFileNames;
+  unsigned int                            m_SlabSize;
+  unsigned int                            m_NumberOfWorkUnits;
+
 }; // End class RobustMeanAndSigmaImageBuilder
 
 #ifndef ITK_MANUAL_INSTANTIATION
@@ -32,7 +32,9 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
 ::RobustMeanAndSigmaImageBuilder( void )
 : m_NumberOfOutlierImagesToRemove( 0 ),
-  m_TotalNumberOfImages( 0 )
+  m_TotalNumberOfImages( 0 ),
+  m_SlabSize( 0 ),
+  m_NumberOfWorkUnits( 0 )
 {
 }
 
@@ -437,4 +439,278 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     }
 }
 
+template< class TInputImageType, class TOutputMeanImageType,
+  class TOutputSigmaImageType >
+void
+RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
+  TOutputSigmaImageType>
+::StreamOutput( void )
+{
+  const unsigned int numberOfImages = m_ImageFileNames.size();
+  if( numberOfImages == 0 )
+    {
+    ::tube::ErrorMessage( "Call AddImageFileName() before streaming!" );
+    return;
+    }
+
+  // Only the headers are read to define the output
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( m_ImageFileNames[0] );
+  reader->UpdateOutputInformation();
+  const RegionType region = reader->GetOutput()->GetLargestPossibleRegion();
+  const SpacingType spacing = reader->GetOutput()->GetSpacing();
+  const PointType origin = reader->GetOutput()->GetOrigin();
+  const DirectionType direction = reader->GetOutput()->GetDirection();
+  bool canStreamRead = reader->GetImageIO()->CanStreamRead();
+  for( unsigned int i = 1; i < numberOfImages; ++i )
+    {
+    typename ReaderType::Pointer imageReader = ReaderType::New();
+    imageReader->SetFileName( m_ImageFileNames[i] );
+    imageReader->UpdateOutputInformation();
+    if( imageReader->GetOutput()->GetLargestPossibleRegion() != region )
+      {
+      ::tube::FmtErrorMessage( "Image %s differs in size from %s!",
+        m_ImageFileNames[i].c_str(), m_ImageFileNames[0].c_str() );
+      return;
+      }
+    if( imageReader->GetOutput()->GetSpacing() != spacing
+      || imageReader->GetOutput()->GetOrigin() != origin
+      || imageReader->GetOutput()->GetDirection() != direction )
+      {
+      ::tube::FmtErrorMessage(
+        "Image %s differs in spacing, origin or direction from %s!",
+        m_ImageFileNames[i].c_str(), m_ImageFileNames[0].c_str() );
+      return;
+      }
+    canStreamRead = canStreamRead
+      && imageReader->GetImageIO()->CanStreamRead();
+    }
+  if( !canStreamRead )
+    {
+    ::tube::WarningMessage(
+      "Some images cannot be stream read and are read whole for every slab" );
+    }
+
+  OutputMeanImagePointer meanImage = OutputMeanImageType::New();
+  meanImage->SetRegions( region );
+  meanImage->SetSpacing( spacing );
+  meanImage->SetOrigin( origin );
+  meanImage->SetDirection( direction );
+  meanImage->Allocate();
+
+  OutputSigmaImagePointer sigmaImage = OutputSigmaImageType::New();
+  sigmaImage->SetRegions( region );
+  sigmaImage->SetSpacing( spacing );
+  sigmaImage->SetOrigin( origin );
+  sigmaImage->SetDirection( direction );
+  sigmaImage->Allocate();
+
+  CountImagePointer validImage = CountImageType::New();
+  validImage->SetRegions( region );
+  validImage->SetSpacing( spacing );
+  validImage->SetOrigin( origin );
+  validImage->SetDirection( direction );
+  validImage->Allocate();
+
+  this->SetOutputMeanImage( meanImage );
+  this->SetOutputSigmaImage( sigmaImage );
+  this->SetValidCountImage( validImage );
+  this->SetOutputSize( region.GetSize() );
+  this->SetOutputSpacing( spacing );
+  this->SetOutputOrigin( origin );
+
+  // Slabs are stacked along the last dimension, so each slab is
+  //   contiguous in the output buffers
+  const unsigned int slabDim = ImageDimension - 1;
+  const SizeValueType numberOfSlices = region.GetSize()[slabDim];
+  SizeValueType slabSize = m_SlabSize;
+  if( slabSize == 0 )
+    {
+    slabSize = std::max( numberOfSlices / numberOfImages,
+      static_cast< SizeValueType >( 1 ) );
+    }
+  slabSize = std::min( slabSize, numberOfSlices );
+
+  typedef RegionOfInterestImageFilter< InputImageType, InputImageType >
+    ROIFilterType;
+
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  if( m_NumberOfWorkUnits > 0 )
+    {
+    threader->SetNumberOfWorkUnits( m_NumberOfWorkUnits );
+    }
+
+  std::vector< InputPixelType > values;
+  for( SizeValueType slabStart = 0; slabStart < numberOfSlices;
+    slabStart += slabSize )
+    {
+    RegionType slabRegion = region;
+    slabRegion.SetIndex( slabDim, region.GetIndex()[slabDim] + slabStart );
+    slabRegion.SetSize( slabDim,
+      std::min( slabSize, numberOfSlices - slabStart ) );
+
+    const SizeValueType numberOfVoxels = slabRegion.GetNumberOfPixels();
+    values.resize( numberOfImages * numberOfVoxels );
+
+    ::tube::FmtInfoMessage( "Reading slices %d to %d",
+      static_cast< int >( slabStart ),
+      static_cast< int >( slabStart + slabRegion.GetSize()[slabDim] - 1 ) );
+
+    // Readers that support streaming read only the slab from disk
+    for( unsigned int i = 0; i < numberOfImages; ++i )
+      {
+      typename ReaderType::Pointer imageReader = ReaderType::New();
+      imageReader->SetFileName( m_ImageFileNames[i] );
+
+      typename ROIFilterType::Pointer roiFilter = ROIFilterType::New();
+      roiFilter->SetInput( imageReader->GetOutput() );
+      roiFilter->SetRegionOfInterest( slabRegion );
+      roiFilter->Update();
+
+      const InputPixelType * slab =
+        roiFilter->GetOutput()->GetBufferPointer();
+      std::copy( slab, slab + numberOfVoxels,
+        values.begin() + i * numberOfVoxels );
+      }
+
+    StreamingThreadStruct str;
+    str.Builder = this;
+    str.Values = &values;
+    str.NumberOfImages = numberOfImages;
+    str.NumberOfVoxels = numberOfVoxels;
+    str.OutputOffset = meanImage->ComputeOffset( slabRegion.GetIndex() );
+
+    threader->SetSingleMethod( this->StreamingThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    }
+
+  this->SetIsProcessing( false );
+}
+
+template< class TInputImageType, class TOutputMeanImageType,
+  class TOutputSigmaImageType >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
+  TOutputSigmaImageType>
+::StreamingThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  StreamingThreadStruct * str = ( StreamingThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  SizeValueType firstVoxel = ( str->NumberOfVoxels * threadId )
+    / threadCount;
+  SizeValueType lastVoxel = ( str->NumberOfVoxels * ( threadId + 1 ) )
+    / threadCount;
+  if( firstVoxel < lastVoxel )
+    {
+    str->Builder->ComputeRobustStatistics( *( str->Values ),
+      str->NumberOfImages, str->NumberOfVoxels, firstVoxel, lastVoxel,
+      str->OutputOffset );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template< class TInputImageType, class TOutputMeanImageType,
+  class TOutputSigmaImageType >
+void
+RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
+  TOutputSigmaImageType>
+::ComputeRobustStatistics( const std::vector< InputPixelType > & values,
+  unsigned int numberOfImages, SizeValueType numberOfVoxels,
+  SizeValueType firstVoxel, SizeValueType lastVoxel,
+  OffsetValueType outputOffset )
+{
+  OutputMeanPixelType * mean =
+    this->GetOutputMeanImage()->GetBufferPointer() + outputOffset;
+  OutputSigmaPixelType * sigma =
+    this->GetOutputSigmaImage()->GetBufferPointer() + outputOffset;
+  CountPixelType * valid =
+    this->GetValidCountImage()->GetBufferPointer() + outputOffset;
+
+  const bool threshold = this->GetThresholdInputImageBelowOn();
+  const InputPixelType thresholdValue = this->GetThresholdInputImageBelow();
+  const unsigned int countThreshold = this->GetImageCountThreshold();
+  const unsigned int outliers = this->GetNumberOfOutlierImagesToRemove();
+  const bool isStdDeviation = this->GetUseStandardDeviation();
+
+  std::vector< double > voxelValues;
+  voxelValues.reserve( numberOfImages );
+  for( SizeValueType v = firstVoxel; v < lastVoxel; ++v )
+    {
+    voxelValues.clear();
+    for( unsigned int i = 0; i < numberOfImages; ++i )
+      {
+      InputPixelType p = values[i * numberOfVoxels + v];
+      // Same validity test as MeanAndSigmaImageBuilder::AddImage()
+      if( !threshold || p > thresholdValue )
+        {
+        voxelValues.push_back( p );
+        }
+      }
+    std::sort( voxelValues.begin(), voxelValues.end() );
+
+    // Outliers are only removed if values remain
+    unsigned int first = 0;
+    unsigned int last = voxelValues.size();
+    if( last > 2 * outliers )
+      {
+      first = outliers;
+      last -= outliers;
+      }
+    const unsigned int number = last - first;
+
+    valid[v] = number;
+    if( number == 0 || number < countThreshold )
+      {
+      mean[v] = 0;
+      sigma[v] = 0;
+      continue;
+      }
+
+    double sum = 0;
+    double sumSqr = 0;
+    for( unsigned int i = first; i < last; ++i )
+      {
+      sum += voxelValues[i];
+      sumSqr += voxelValues[i] * voxelValues[i];
+      }
+
+    double variance = 0;
+    if( number > 1 )
+      {
+      variance = std::max( ( sumSqr - ( sum * sum ) / number )
+        / ( number - 1 ), 0.0 );
+      if( isStdDeviation )
+        {
+        variance = std::sqrt( variance );
+        }
+      }
+    sigma[v] = static_cast< OutputSigmaPixelType >( variance );
+
+    if( this->UseMedian() )
+      {
+      const unsigned int middle = voxelValues.size() / 2;
+      if( voxelValues.size() % 2 )
+        {
+        mean[v] = static_cast< OutputMeanPixelType >( voxelValues[middle] );
+        }
+      else
+        {
+        mean[v] = static_cast< OutputMeanPixelType >(
+          ( voxelValues[middle - 1] + voxelValues[middle] ) / 2 );
+        }
+      }
+    else
+      {
+      mean[v] = static_cast< OutputMeanPixelType >( sum / number );
+      }
+    }
+}
+
 #endif // End !defined( __itktubeRobustMeanAndSigmaImageBuilder_hxx )
@@ -232,6 +232,23 @@ void AtlasSummation
 }
 
 
+void AtlasSummation
+::StreamImageFiles( const std::vector< std::string > & fileNames )
+{
+  StreamingMeanBuilderType::Pointer builder =
+    StreamingMeanBuilderType::New();
+  for( unsigned int i = 0; i < fileNames.size(); ++i )
+    {
+    builder->AddImageFileName( fileNames[i] );
+    }
+  builder->StreamOutput();
+
+  m_MeanBuilder = builder.GetPointer();
+  m_ImageNumber = fileNames.size();
+  m_IsProcessing = false;
+}
+
+
 void AtlasSummation
 ::WriteImage( MeanImageType::Pointer image, const std::string & file )
 {
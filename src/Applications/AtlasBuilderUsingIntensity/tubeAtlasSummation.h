@@ -90,6 +90,9 @@ private:
   typedef itk::tube::MeanAndSigmaImageBuilder< InputImageType,
     MeanImageType, VarianceImageType >               RobustMeanBuilderType;
 
+  typedef itk::tube::RobustMeanAndSigmaImageBuilder< InputImageType,
+    MeanImageType, VarianceImageType >               StreamingMeanBuilderType;
+
 public:
 
   /** CTOR, DTOR */
@@ -109,6 +112,14 @@ public:
   /** Build Mean and variance image & end AddImage() addition abilities */
   void Finalize( void );
 
+  /**
+   * Build the mean and variance images from image files instead of
+   * AddImage() and Finalize().  The files are read a slab at a time, so
+   * they are never all in memory.  They must need no transform and have
+   * the same size, spacing, origin and direction; no resampling is done.
+   */
+  void StreamImageFiles( const std::vector< std::string > & fileNames );
+
   /**
    * Return final Summation products-Mean ( or median ) & Variance
    * ( or standard deviation & image count for # of valid images
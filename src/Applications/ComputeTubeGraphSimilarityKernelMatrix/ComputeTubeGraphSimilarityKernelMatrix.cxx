@@ -27,6 +27,7 @@ limitations under the License.
 #include <boost/filesystem.hpp>
 
 #include <itkMatrix.h>
+#include <itkMultiThreaderBase.h>
 
 #include "ComputeTubeGraphSimilarityKernelMatrixCLP.h"
 
@@ -273,6 +274,159 @@ tube::GraphKernel::GraphType loadGraph( std::string graphFile,
 }
 
 
+/** Graphs and parameters shared by the feature threads */
+struct FeatureThreadStruct
+{
+  const std::vector<tube::GraphKernel::GraphType>        * Graphs;
+  int                                                      KernelType;
+  const tube::WLSubtreeKernel::LabelMapVectorType        * LabelMap;
+  int                                                      SubtreeHeight;
+  std::vector<tube::ShortestPathKernel::FeatureVectorType> * SPFeatures;
+  std::vector<tube::WLSubtreeKernel::FeatureVectorType>    * WLFeatures;
+};
+
+/** Computes the feature vectors of every threadCount-th graph. */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION FeatureThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( itk::MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( itk::MultiThreaderBase::WorkUnitInfo * )(
+    arg ) )->NumberOfWorkUnits;
+
+  FeatureThreadStruct * str = ( FeatureThreadStruct * )(
+    ( ( itk::MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  for( unsigned int i = threadId; i < str->Graphs->size(); i += threadCount )
+    {
+    if( str->KernelType == GK_SPKernel )
+      {
+      ( *str->SPFeatures )[i] = tube::ShortestPathKernel::BuildFeatureVector(
+        ( *str->Graphs )[i] );
+      }
+    else
+      {
+      ( *str->WLFeatures )[i] = tube::WLSubtreeKernel::BuildFeatureVector(
+        ( *str->Graphs )[i], *str->LabelMap, str->SubtreeHeight );
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+/** Feature vectors and blocks of the kernel matrix shared by the threads */
+template< class TFeatureVector >
+struct KernelMatrixThreadStruct
+{
+  const std::vector<TFeatureVector> * FeaturesA;
+  const std::vector<TFeatureVector> * FeaturesB;
+  vnl_matrix<double>                * K;
+  bool                                IsSymmetric;
+  unsigned int                        BlockSize;
+  std::vector< std::pair<unsigned int, unsigned int> > Blocks;
+};
+
+/** Fills every threadCount-th block of the kernel matrix. */
+template< class TFeatureVector >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+KernelMatrixThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( itk::MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( itk::MultiThreaderBase::WorkUnitInfo * )(
+    arg ) )->NumberOfWorkUnits;
+
+  KernelMatrixThreadStruct<TFeatureVector> * str =
+    ( KernelMatrixThreadStruct<TFeatureVector> * )(
+    ( ( itk::MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  const unsigned int N = str->FeaturesA->size();
+  const unsigned int M = str->FeaturesB->size();
+  for( unsigned int b = threadId; b < str->Blocks.size(); b += threadCount )
+    {
+    const unsigned int rowStart = str->Blocks[b].first * str->BlockSize;
+    const unsigned int colStart = str->Blocks[b].second * str->BlockSize;
+    const unsigned int rowEnd = std::min( rowStart + str->BlockSize, N );
+    const unsigned int colEnd = std::min( colStart + str->BlockSize, M );
+    for( unsigned int i = rowStart; i < rowEnd; ++i )
+      {
+      // Below the diagonal, a symmetric matrix is mirrored afterwards
+      unsigned int j = colStart;
+      if( str->IsSymmetric && j < i )
+        {
+        j = i;
+        }
+      for( ; j < colEnd; ++j )
+        {
+        ( *str->K )[i][j] = tube::GraphKernel::SparseInnerProduct(
+          ( *str->FeaturesA )[i], ( *str->FeaturesB )[j] );
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/** Computes the kernel matrix K of two lists of graph feature vectors.
+ *
+ *  The matrix is split into square blocks computed by several threads.
+ *  If both lists are the same, only the blocks on and above the diagonal
+ *  are computed, and K is then made symmetric.
+ *
+ *  \param featuresA Feature vectors of the graphs of the rows of K.
+ *  \param featuresB Feature vectors of the graphs of the columns of K.
+ *  \param isSymmetric True if featuresA and featuresB are the same.
+ *  \param numberOfThreads Number of threads ( 0 for the default ).
+ *  \param K The kernel matrix, already sized.
+ */
+template< class TFeatureVector >
+void computeKernelMatrix( const std::vector<TFeatureVector> &featuresA,
+                          const std::vector<TFeatureVector> &featuresB,
+                          bool isSymmetric,
+                          unsigned int numberOfThreads,
+                          vnl_matrix<double> &K )
+{
+  KernelMatrixThreadStruct<TFeatureVector> str;
+  str.FeaturesA = &featuresA;
+  str.FeaturesB = &featuresB;
+  str.K = &K;
+  str.IsSymmetric = isSymmetric;
+  str.BlockSize = 64;
+
+  const unsigned int nRowBlocks = ( featuresA.size() + str.BlockSize - 1 )
+    / str.BlockSize;
+  const unsigned int nColBlocks = ( featuresB.size() + str.BlockSize - 1 )
+    / str.BlockSize;
+  for( unsigned int r = 0; r < nRowBlocks; ++r )
+    {
+    for( unsigned int c = ( isSymmetric ? r : 0 ); c < nColBlocks; ++c )
+      {
+      str.Blocks.push_back( std::make_pair( r, c ) );
+      }
+    }
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  if( numberOfThreads > 0 )
+    {
+    threader->SetNumberOfWorkUnits( numberOfThreads );
+    }
+  threader->SetSingleMethod(
+    KernelMatrixThreaderCallback<TFeatureVector>, &str );
+  threader->SingleMethodExecute();
+
+  if( isSymmetric )
+    {
+    for( unsigned int i = 0; i < K.rows(); ++i )
+      {
+      for( unsigned int j = 0; j < i; ++j )
+        {
+        K[i][j] = K[j][i];
+        }
+      }
+    }
+}
+
+
 int main( int argc, char * argv[] )
 {
   PARSE_ARGS;
@@ -358,46 +512,83 @@ int main( int argc, char * argv[] )
 
     /*
      * Next, we build the kernel matrix K, where the K_ij-th entry
-     * is the WL kernel value between the i-th graph of the first
+     * is the kernel value between the i-th graph of the first
      * ( i.e., 'listA' ) list and the j-th graph of the second list
      * ( i.e., 'listB' ).
+     *
+     * Both kernels are inner products of per-graph feature vectors
+     * ( shortest-path histograms or WL label counts ), so the features
+     * are computed once per graph and K is filled by sparse inner
+     * products. When both lists are the same, K is symmetric.
      */
 
-    for( int i = 0; i < N; ++i )
+    const bool isSymmetric = ( listA == listB );
+    const unsigned int numberOfThreads = argNumberOfThreads > 0 ?
+      static_cast<unsigned int>( argNumberOfThreads ) : 0;
+
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    if( numberOfThreads > 0 )
       {
-      tube::GraphKernel::GraphType f = loadGraph( listA[i],
-        defLabelType, argGlobalLabelFileName );
-      for( int j = 0; j < M; ++j )
+      threader->SetNumberOfWorkUnits( numberOfThreads );
+      }
+
+    std::vector<tube::ShortestPathKernel::FeatureVectorType> spFeaturesA;
+    std::vector<tube::ShortestPathKernel::FeatureVectorType> spFeaturesB;
+    std::vector<tube::WLSubtreeKernel::FeatureVectorType> wlFeaturesA;
+    std::vector<tube::WLSubtreeKernel::FeatureVectorType> wlFeaturesB;
+
+    for( int list = 0; list < ( isSymmetric ? 1 : 2 ); ++list )
+      {
+      const std::vector<std::string> & fileList = ( list == 0 ) ? listA
+        : listB;
+
+      std::vector<tube::GraphKernel::GraphType> graphs;
+      for( unsigned int i = 0; i < fileList.size(); ++i )
         {
-        tube::GraphKernel::GraphType g = loadGraph( listB[j],
-          defLabelType, argGlobalLabelFileName );
-
-        tube::FmtInfoMessage( "Running kernel on graphs ( %d,%d )",
-          i, j );
-
-        tube::GraphKernel *gk = 0;
-        switch( argGraphKernelType )
-          {
-          case GK_SPKernel:
-            {
-            gk = new tube::ShortestPathKernel( f, g );
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          case GK_WLKernel:
-            {
-            gk = new tube::WLSubtreeKernel( f,
-                                            g,
-                                            labelMap,
-                                            labelCount,
-                                            argSubtreeHeight );
-
-            K[i][j] = gk->Compute();
-            delete gk;
-            break;
-            }
-          }
+        graphs.push_back( loadGraph( fileList[i], defLabelType,
+          argGlobalLabelFileName ) );
+        }
+
+      tube::FmtInfoMessage( "Computing features of %d graphs",
+        static_cast<int>( graphs.size() ) );
+
+      FeatureThreadStruct str;
+      str.Graphs = &graphs;
+      str.KernelType = argGraphKernelType;
+      str.LabelMap = &labelMap;
+      str.SubtreeHeight = argSubtreeHeight;
+      str.SPFeatures = ( list == 0 ) ? &spFeaturesA : &spFeaturesB;
+      str.WLFeatures = ( list == 0 ) ? &wlFeaturesA : &wlFeaturesB;
+      if( argGraphKernelType == GK_SPKernel )
+        {
+        str.SPFeatures->resize( graphs.size() );
+        }
+      else
+        {
+        str.WLFeatures->resize( graphs.size() );
+        }
+
+      threader->SetSingleMethod( FeatureThreaderCallback, &str );
+      threader->SingleMethodExecute();
+      }
+
+    tube::FmtInfoMessage( "Computing kernel matrix ( %d x %d )", N, M );
+
+    switch( argGraphKernelType )
+      {
+      case GK_SPKernel:
+        {
+        computeKernelMatrix( spFeaturesA,
+          isSymmetric ? spFeaturesA : spFeaturesB, isSymmetric,
+          numberOfThreads, K );
+        break;
+        }
+      case GK_WLKernel:
+        {
+        computeKernelMatrix( wlFeaturesA,
+          isSymmetric ? wlFeaturesA : wlFeaturesB, isSymmetric,
+          numberOfThreads, K );
+        break;
         }
       }
 
@@ -39,6 +39,9 @@ limitations under the License.
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_real.hpp>
 
+#include <utility>
+#include <vector>
+
 namespace tube
 {
 
@@ -133,6 +136,40 @@ public:
   /** Compute kernel value among graphs G0,G1 */
   virtual double Compute( void ) { return 0.0; }
 
+  /**
+   * Inner product of two sparse feature vectors of ( key, count ) pairs,
+   * each sorted by key without repeated keys
+   */
+  template< class TKey >
+  static double SparseInnerProduct(
+    const std::vector< std::pair< TKey, double > > & a,
+    const std::vector< std::pair< TKey, double > > & b )
+    {
+    double value = 0.0;
+    typename std::vector< std::pair< TKey, double > >::const_iterator
+      aIt = a.begin();
+    typename std::vector< std::pair< TKey, double > >::const_iterator
+      bIt = b.begin();
+    while( aIt != a.end() && bIt != b.end() )
+      {
+      if( aIt->first < bIt->first )
+        {
+        ++aIt;
+        }
+      else if( bIt->first < aIt->first )
+        {
+        ++bIt;
+        }
+      else
+        {
+        value += aIt->second * bIt->second;
+        ++aIt;
+        ++bIt;
+        }
+      }
+    return value;
+    }
+
 
 protected:
 
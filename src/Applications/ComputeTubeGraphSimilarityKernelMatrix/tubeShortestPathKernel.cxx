@@ -83,6 +83,30 @@ ShortestPathKernel::FloydTransform( const GraphType &in )
 }
 
 
+//-----------------------------------------------------------------------------
+ShortestPathKernel::FeatureVectorType
+ShortestPathKernel::BuildFeatureVector( const GraphType & G )
+{
+  GraphType FG = FloydTransform( G );
+
+  EdgeWeightMapType wmFG = boost::get( boost::edge_weight, FG );
+
+  // Paths are compared as in Compute(), by end labels and equal length
+  std::map< PathType, double > histogram;
+  EdgeIteratorType aIt, aEnd;
+  for( tie( aIt, aEnd ) = edges( FG ); aIt != aEnd; ++aIt )
+    {
+    PathType path;
+    path.SourceLabel = FG[source( *aIt, FG )].type;
+    path.TargetLabel = FG[target( *aIt, FG )].type;
+    ensureOrder( path.SourceLabel, path.TargetLabel );
+    path.Length = wmFG[*aIt];
+    histogram[path] += 1.0;
+    }
+
+  return FeatureVectorType( histogram.begin(), histogram.end() );
+}
+
 //-----------------------------------------------------------------------------
 double ShortestPathKernel::Compute( void )
 {
@@ -27,6 +27,7 @@ limitations under the License.
 #include "GraphKernel.h"
 
 #include <algorithm>
+#include <map>
 
 namespace tube
 {
@@ -46,6 +47,30 @@ public:
   /** Edge kernel types */
   static const int EDGE_KERNEL_DEL = 0;
 
+  /** A shortest path, by the ordered labels of its ends and its length */
+  struct PathType
+    {
+    int    SourceLabel;
+    int    TargetLabel;
+    double Length;
+
+    bool operator<( const PathType & other ) const
+      {
+      if( SourceLabel != other.SourceLabel )
+        {
+        return SourceLabel < other.SourceLabel;
+        }
+      if( TargetLabel != other.TargetLabel )
+        {
+        return TargetLabel < other.TargetLabel;
+        }
+      return Length < other.Length;
+      }
+    }; // End struct PathType
+
+  /** Number of shortest paths of each type, sorted by type */
+  typedef std::vector< std::pair< PathType, double > > FeatureVectorType;
+
   /** CTOR - Consumer sets graphs */
   ShortestPathKernel( const GraphType & g0, const GraphType & g1 )
     : GraphKernel( g0, g1 ), m_EdgeKernelType( EDGE_KERNEL_DEL )
@@ -61,12 +86,19 @@ public:
   /** Computes the SP kernel value, see [1], Section 4.2 */
   double Compute( void );
 
+  /**
+   * Histogram of the shortest paths of a graph. With the delta edge
+   * kernel, the SP kernel value of two graphs is the inner product of
+   * their histograms, see GraphKernel::SparseInnerProduct()
+   */
+  static FeatureVectorType BuildFeatureVector( const GraphType & G );
+
 private:
 
   /** Computes a Floyd-transformed graph, see [1], Section 4.1 */
-  GraphType FloydTransform( const GraphType & in );
+  static GraphType FloydTransform( const GraphType & in );
 
-  void ensureOrder( int & first, int & second )
+  static void ensureOrder( int & first, int & second )
     {
     if( first > second )
       {
@@ -87,9 +87,10 @@ void WLSubtreeKernel::UpdateLabelCompression( GraphType & G,
     }
 }
 
-std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
+WLSubtreeKernel::FeatureVectorType WLSubtreeKernel::BuildFeatureVector(
+  GraphType G, const LabelMapVectorType & labelMap, int subtreeHeight )
 {
-  std::vector< int > phi( m_LabelCount, 0 );
+  std::map< int, double > phi;
   const int N = num_vertices( G );
 
   for( int i = 0; i < N; ++i )
@@ -97,28 +98,28 @@ std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
     const int height = 0;
     const int type = G[vertex( i, G )].type;
     LabelMapType::const_iterator it
-      = m_LabelMap[height].find( boost::lexical_cast< std::string >(
+      = labelMap[height].find( boost::lexical_cast< std::string >(
           type ) );
-    if( it != m_LabelMap[height].end() )
+    if( it != labelMap[height].end() )
       {
       const int cLab = it->second;
       G[vertex( i, G )].type = cLab;
-      ++phi[cLab];
+      phi[cLab] += 1.0;
       }
     }
 
-  for( int height = 1; height < m_SubtreeHeight; ++height )
+  for( int height = 1; height < subtreeHeight; ++height )
     {
     std::vector< int > relabel( N, -1 );
     for( int i = 0; i < N; ++i )
       {
       const std::string nbStr = BuildNeighborStr( G, i );
-      LabelMapType::const_iterator it = m_LabelMap[height].find( nbStr );
-      if( it != m_LabelMap[height].end() )
+      LabelMapType::const_iterator it = labelMap[height].find( nbStr );
+      if( it != labelMap[height].end() )
         {
         const int cLab = it->second;
         relabel[i] = cLab;
-        ++phi[cLab];
+        phi[cLab] += 1.0;
         }
       }
     for( int i = 0; i < N; ++i )
@@ -129,6 +130,20 @@ std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
         }
       }
     }
+  return FeatureVectorType( phi.begin(), phi.end() );
+}
+
+std::vector< int > WLSubtreeKernel::BuildPhi( GraphType & G )
+{
+  std::vector< int > phi( m_LabelCount, 0 );
+
+  const FeatureVectorType features = BuildFeatureVector( G, m_LabelMap,
+    m_SubtreeHeight );
+  for( FeatureVectorType::const_iterator it = features.begin();
+    it != features.end(); ++it )
+    {
+    phi[it->first] = static_cast< int >( it->second );
+    }
   return phi;
 }
 
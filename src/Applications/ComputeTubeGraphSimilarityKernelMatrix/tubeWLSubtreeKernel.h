@@ -61,6 +61,9 @@ public:
   typedef std::map<std::string, int>  LabelMapType;
   typedef std::vector<LabelMapType>   LabelMapVectorType;
 
+  /** Count of each compressed label, sorted by label */
+  typedef std::vector< std::pair< int, double > > FeatureVectorType;
+
   /** CTOR - Variant with no vertex label information */
   WLSubtreeKernel( const GraphType &G0,
                    const GraphType &G1,
@@ -88,6 +91,17 @@ public:
                              int & cLabCounter,
                              int subtreeHeight );
 
+  /**
+   * Take a graph 'G' and use the label map information to compute the
+   * counts of its compressed labels, i.e., the non-zero entries of the
+   * feature mapping phi, see [1]. The WL kernel value of two graphs is
+   * the inner product of their feature vectors, see
+   * GraphKernel::SparseInnerProduct()
+   */
+  static FeatureVectorType BuildFeatureVector( GraphType G,
+                             const LabelMapVectorType & labelMap,
+                             int subtreeHeight );
+
 private:
   /**
    * Take a graph 'G' and use the label map information and the number of
@@ -169,8 +169,9 @@ int DoIt( int argc, char * argv[] )
     {
     timeCollector.Start( "SaveBasisImages" );
 
-    unsigned int numBasis = basisGenerator->GetNumberOfFeatures();
-    for( unsigned int i = 0; i < numBasis; i++ )
+    typename BasisFeatureVectorGeneratorType::FeatureImageListType
+      basisImages = basisGenerator->GetFeatureImages();
+    for( unsigned int i = 0; i < basisImages.size(); i++ )
       {
       typename BasisImageWriterType::Pointer basisImageWriter =
         BasisImageWriterType::New();
@@ -180,7 +181,7 @@ int DoIt( int argc, char * argv[] )
       fname += std::string( c );
       basisImageWriter->SetUseCompression( true );
       basisImageWriter->SetFileName( fname.c_str() );
-      basisImageWriter->SetInput( basisGenerator->GetFeatureImage( i ) );
+      basisImageWriter->SetInput( basisImages[i] );
       basisImageWriter->Update();
       }
     timeCollector.Stop( "SaveBasisImages" );
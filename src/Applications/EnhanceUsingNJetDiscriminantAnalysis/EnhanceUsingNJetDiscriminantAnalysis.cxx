@@ -206,8 +206,9 @@ int DoIt( int argc, char * argv[] )
     {
     timeCollector.Start( "SaveBasisImages" );
 
-    unsigned int numBasis = basisGenerator->GetNumberOfFeatures();
-    for( unsigned int i = 0; i < numBasis; i++ )
+    typename BasisFeatureVectorGeneratorType::FeatureImageListType
+      basisImages = basisGenerator->GetFeatureImages();
+    for( unsigned int i = 0; i < basisImages.size(); i++ )
       {
       typename BasisImageWriterType::Pointer basisImageWriter =
         BasisImageWriterType::New();
@@ -217,7 +218,7 @@ int DoIt( int argc, char * argv[] )
       basename += std::string( c );
       basisImageWriter->SetUseCompression( true );
       basisImageWriter->SetFileName( basename.c_str() );
-      basisImageWriter->SetInput( basisGenerator->GetFeatureImage( i ) );
+      basisImageWriter->SetInput( basisImages[i] );
       basisImageWriter->Update();
       }
     timeCollector.Stop( "SaveBasisImages" );
@@ -245,10 +246,11 @@ int DoIt( int argc, char * argv[] )
 
   if( !saveFeatureImages.empty() )
     {
-    unsigned int numFeatures = fvGenerator->GetNumberOfFeatures();
-    for( unsigned int i = 0; i < numFeatures; i++ )
+    typename NJetFeatureVectorGeneratorType::FeatureImageListType
+      featureImages = fvGenerator->GetFeatureImages();
+    for( unsigned int i = 0; i < featureImages.size(); i++ )
       {
-      WriteBasis< BasisImageType >( fvGenerator->GetFeatureImage( i ),
+      WriteBasis< BasisImageType >( featureImages[i],
         saveFeatureImages, ".f%02d.mha", i );
       }
     }
@@ -522,6 +522,17 @@ int DoIt( MetaCommand & command )
         command.GetValueAsFloat( *it, "numScales" ) );
       }
 
+    // vesselsRecursive
+    else if( ( *it ).name == "vesselsRecursive" )
+      {
+      std::cout << "Vessel Enhancement using recursive Gaussians"
+        << std::endl;
+      imFilters.EnhanceVessels(
+        command.GetValueAsFloat( *it, "scaleMin" ),
+        command.GetValueAsFloat( *it, "scaleMax" ),
+        command.GetValueAsFloat( *it, "numScales" ), true );
+      }
+
     // CorrectionSlice
     else if( ( *it ).name == "CorrectionSlice" )
       {
@@ -876,6 +887,15 @@ int main( int argc, char * argv[] )
   command.AddOptionField( "vessels", "scaleMax", MetaCommand::INT, true );
   command.AddOptionField( "vessels", "numScales", MetaCommand::INT, true );
 
+  command.SetOption( "vesselsRecursive", "V", false,
+    "Compute ridgness/vesselness using recursive Gaussian derivatives" );
+  command.AddOptionField( "vesselsRecursive", "scaleMin",
+    MetaCommand::FLOAT, true );
+  command.AddOptionField( "vesselsRecursive", "scaleMax",
+    MetaCommand::FLOAT, true );
+  command.AddOptionField( "vesselsRecursive", "numScales",
+    MetaCommand::INT, true );
+
   command.SetOption( "Voronoi", "Z", false,
     "Run centroid voronoi tessellation on the image" );
   command.AddOptionField( "Voronoi", "numCentroids",
@@ -290,6 +290,22 @@ int DoIt( int argc, char * argv[] )
                                        ::MATTES_MI_METRIC );
     }
 
+  if( optimizationBackend == "ITKv4" )
+    {
+    reger->SetOptimizationBackend( RegistrationType
+      ::OptimizedRegistrationMethodType::ITKV4_BACKEND );
+    }
+  else // if( optimizationBackend == "ITKv3" )
+    {
+    reger->SetOptimizationBackend( RegistrationType
+      ::OptimizedRegistrationMethodType::ITKV3_BACKEND );
+    }
+  if( verbosity >= STANDARD )
+    {
+    std::cout << "###OptimizationBackend: " << optimizationBackend
+      << std::endl;
+    }
+
   reger->SetSampleFromOverlap( sampleFromOverlap );
   if( verbosity >= STANDARD )
     {
@@ -377,6 +393,19 @@ int DoIt( int argc, char * argv[] )
     std::cout << "###MinimizeMemory: " << minimizeMemory << std::endl;
     }
 
+  reger->SetPyramidNumberOfLevels( pyramidLevels );
+  if( verbosity >= STANDARD )
+    {
+    std::cout << "###PyramidLevels: " << pyramidLevels << std::endl;
+    }
+
+  reger->SetNumberOfEvolutionaryStarts( evolutionaryStarts );
+  if( verbosity >= STANDARD )
+    {
+    std::cout << "###EvolutionaryStarts: " << evolutionaryStarts
+      << std::endl;
+    }
+
   reger->SetRandomNumberSeed( randomNumberSeed );
 
   reger->SetRigidMaxIterations( rigidMaxIterations );
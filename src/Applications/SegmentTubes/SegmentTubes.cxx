@@ -35,6 +35,7 @@ limitations under the License.
 
 #include "SegmentTubesCLP.h"
 
+#include <fstream>
 #include <sstream>
 
 #define PARSE_ARGS_FLOAT_ONLY
@@ -291,6 +292,8 @@ int DoIt( int argc, char * argv[] )
     }
 
   segmentTubesFilter->SetBorderInIndexSpace( border );
+  segmentTubesFilter->SetNumberOfWorkUnits( numberOfWorkUnits );
+  segmentTubesFilter->SetUseBlurredImageCache( useBlurredImageCache );
 
   timeCollector.Start( "Ridge Extractor" );
 
@@ -298,6 +301,19 @@ int DoIt( int argc, char * argv[] )
 
   timeCollector.Stop( "Ridge Extractor" );
 
+  if( !outputProfileFile.empty() )
+    {
+    std::ofstream profileFile( outputProfileFile.c_str() );
+    if( !profileFile.is_open() )
+      {
+      tube::ErrorMessage( "Unable to write profile: " + outputProfileFile );
+      }
+    else
+      {
+      profileFile << segmentTubesFilter->GetProfileAsJSON();
+      }
+    }
+
   if( segmentTubesFilter->GetTubeGroup()->GetNumberOfChildren() ==
     numberOfPriorChildren )
     {
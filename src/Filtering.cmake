@@ -43,7 +43,9 @@ set( TubeTK_Filtering_H_Files
   Filtering/itktubeGaussianDerivativeImageSource.h
   Filtering/itktubeInverseIntensityImageFilter.h
   Filtering/itktubeMinimumSpanningTreeVesselConnectivityFilter.h
+  Filtering/itktubeNJetVesselEnhancementImageFilter.h
   Filtering/itktubePadImageFilter.h
+  Filtering/itktubeRecursiveGaussianDerivativeFilter.h
   Filtering/itktubeRegionFromReferenceImageFilter.h
   Filtering/itktubeReResampleImageFilter.h
   Filtering/itktubeSheetnessMeasureImageFilter.h
@@ -85,7 +87,9 @@ set( TubeTK_Filtering_HXX_Files
   Filtering/itktubeGaussianDerivativeImageSource.hxx
   Filtering/itktubeInverseIntensityImageFilter.hxx
   Filtering/itktubeMinimumSpanningTreeVesselConnectivityFilter.hxx
+  Filtering/itktubeNJetVesselEnhancementImageFilter.hxx
   Filtering/itktubePadImageFilter.hxx
+  Filtering/itktubeRecursiveGaussianDerivativeFilter.hxx
   Filtering/itktubeRegionFromReferenceImageFilter.hxx
   Filtering/itktubeReResampleImageFilter.hxx
   Filtering/itktubeSheetnessMeasureImageFilter.hxx
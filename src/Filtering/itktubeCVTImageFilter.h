@@ -133,12 +133,39 @@ protected:
                       const PointArrayType & centroids,
                       unsigned int * nearest );
 
+  /** Bin the centroids into a uniform grid used by FindClosestCentroid.
+   *  Must be called again whenever the centroids move. */
+  void BuildCentroidGrid( const PointArrayType & centroids );
+
+  /** Index of the centroid closest to x; ties go to the lowest index.
+   *  Uses the grid built by BuildCentroidGrid. */
+  unsigned int FindClosestCentroid( const ContinuousIndexType & x,
+                                    const PointArrayType & centroids ) const;
+
   void ComputeAdjacencyMatrix( void );
 
 private:
   CVTImageFilter( const Self& );
   void operator=( const Self& );
 
+  /** Sums accumulated by one work unit during an iteration. */
+  struct CentroidSumsType
+    {
+    std::vector< double > Sums;
+    std::vector< double > Count;
+    double                Energy;
+    };
+
+  struct ComputeIterationThreadStruct
+    {
+    Self                            * Filter;
+    const PointArrayType            * Batch;
+    std::vector< CentroidSumsType > * CentroidSums;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ComputeIterationThreaderCallback( void * arg );
+
   typename OutputImageType::Pointer            m_OutputImage;
 
   typename InputImageType::ConstPointer        m_InputImage;
@@ -164,6 +191,15 @@ private:
 
   VariableSizeMatrix< double >  m_AdjacencyMatrix;
 
+  /** Uniform grid over the centroids, in index space.  The centroids of
+   *  cell c are m_CentroidGridIds[m_CentroidGridStart[c]] to
+   *  m_CentroidGridIds[m_CentroidGridStart[c+1]-1]. */
+  ContinuousIndexType           m_CentroidGridOrigin;
+  double                        m_CentroidGridCellSize;
+  int                           m_CentroidGridSize[ImageDimension];
+  std::vector< unsigned int >   m_CentroidGridStart;
+  std::vector< unsigned int >   m_CentroidGridIds;
+
 }; // End class CVTImageFilter
 
 } // End namespace tube
@@ -29,6 +29,9 @@ limitations under the License.
 #include <itkDanielssonDistanceMapImageFilter.h>
 #include <itkMersenneTwisterRandomVariateGenerator.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk
 {
 
@@ -60,6 +63,13 @@ CVTImageFilter( void )
   m_BatchSamplingMethod = CVT_RANDOM;
   m_NumberOfIterationsPerBatch = 10;
   m_NumberOfSamplesPerBatch = 5000;
+
+  m_CentroidGridOrigin.Fill( 0 );
+  m_CentroidGridCellSize = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_CentroidGridSize[i] = 1;
+    }
 }
 
 
@@ -264,7 +274,6 @@ ComputeIteration( double & energyDiff )
 {
   int i;
   int j;
-  int j2;
 
   //  Take each generator as the first sample point for its region.
   //  This can slightly slow the convergence, but it simplifies the
@@ -274,7 +283,6 @@ ComputeIteration( double & energyDiff )
 
   PointArrayType centroids2( m_NumberOfCentroids );
   double * count = new double[m_NumberOfCentroids];
-  unsigned int * nearest = new unsigned int[m_NumberOfSamplesPerBatch];
   PointArrayType batch( m_NumberOfSamplesPerBatch );
 
   for( j = 0; j < ( int )m_NumberOfCentroids; j++ )
@@ -287,12 +295,35 @@ ComputeIteration( double & energyDiff )
     {
     std::cout << " computing iteration..." << std::endl;
     }
+
+  // The centroids do not move during an iteration, so one grid serves
+  //   every batch.
+  this->BuildCentroidGrid( m_Centroids );
+
+  // Each work unit accumulates its samples into its own sums.  Sample
+  //   coordinates are whole numbers, so the sums do not depend on the
+  //   number of work units.
+  unsigned int numWorkUnits = this->GetNumberOfWorkUnits();
+  numWorkUnits = std::max( std::min( numWorkUnits,
+    m_NumberOfSamplesPerBatch ), 1u );
+  std::vector< CentroidSumsType > centroidSums( numWorkUnits );
+  for( unsigned int w = 0; w < numWorkUnits; w++ )
+    {
+    centroidSums[w].Sums.assign( m_NumberOfCentroids * ImageDimension, 0 );
+    centroidSums[w].Count.assign( m_NumberOfCentroids, 0 );
+    centroidSums[w].Energy = 0;
+    }
+
+  ComputeIterationThreadStruct str;
+  str.Filter = this;
+  str.Batch = &batch;
+  str.CentroidSums = &centroidSums;
+
   //
   //  Generate the sampling points S.
   //
   int get;
   int have = 0;
-  double dist;
   while( have < ( int )m_NumberOfSamples )
     {
     if( this->GetDebug() )
@@ -312,25 +343,27 @@ ComputeIteration( double & energyDiff )
       {
       std::cout << " computing iteration get = " << get << std::endl;
       }
+    // Sampling stays serial so that a seeded run draws the same samples
     ComputeSample( &batch, get, m_BatchSamplingMethod );
     have = have + get;
 
-    ComputeClosest( batch, m_Centroids, nearest );
+    this->GetMultiThreader()->SetNumberOfWorkUnits( numWorkUnits );
+    this->GetMultiThreader()->SetSingleMethod(
+      this->ComputeIterationThreaderCallback, &str );
+    this->GetMultiThreader()->SingleMethodExecute();
+    }
 
-    for( j = 0; j < get; j++ )
+  for( unsigned int w = 0; w < numWorkUnits; w++ )
+    {
+    for( j = 0; j < ( int )m_NumberOfCentroids; j++ )
       {
-      j2 = nearest[j];
-
-      dist = 0;
       for( i = 0; i < ( int )ImageDimension; i++ )
         {
-        centroids2[j2][i] = centroids2[j2][i] + batch[j][i];
-        dist = ( m_Centroids[j2][i] - batch[j][i] )
-          * ( m_Centroids[j2][i] - batch[j][i] );
+        centroids2[j][i] += centroidSums[w].Sums[j * ImageDimension + i];
         }
-      energy = energy + std::sqrt( dist );
-      count[j2] = count[j2] + 1;
+      count[j] += centroidSums[w].Count[j];
       }
+    energy += centroidSums[w].Energy;
     }
 
   for( j = 0; j < ( int )m_NumberOfCentroids; j++ )
@@ -357,12 +390,52 @@ ComputeIteration( double & energyDiff )
   energy = energy / m_NumberOfSamples;
 
   delete [] count;
-  delete [] nearest;
 
   return energy;
 }
 
 
+/** ComputeIterationThreaderCallback */
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+CVTImageFilter< TInputImage, TOutputImage >::
+ComputeIterationThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ComputeIterationThreadStruct * str = ( ComputeIterationThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  const Self * filter = str->Filter;
+  const PointArrayType & batch = *( str->Batch );
+  CentroidSumsType & sums = ( *str->CentroidSums )[threadId];
+
+  const size_t numSamples = batch.size();
+  const size_t sampleStart = numSamples * threadId / threadCount;
+  const size_t sampleEnd = numSamples * ( threadId + 1 ) / threadCount;
+  for( size_t js = sampleStart; js < sampleEnd; js++ )
+    {
+    unsigned int jc = filter->FindClosestCentroid( batch[js],
+      filter->m_Centroids );
+
+    double dist = 0;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      sums.Sums[jc * ImageDimension + i] += batch[js][i];
+      dist += ( filter->m_Centroids[jc][i] - batch[js][i] )
+        * ( filter->m_Centroids[jc][i] - batch[js][i] );
+      }
+    sums.Energy += std::sqrt( dist );
+    sums.Count[jc] += 1;
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
 /** ComputeSample */
 template< class TInputImage, class TOutputImage >
 void
@@ -481,35 +554,195 @@ ComputeClosest( const PointArrayType & sample,
     std::cout << "    computing closest" << std::endl;
     }
 
-  unsigned int numberOfSamples = sample.size();
-
-  unsigned int numberOfCentroids = centroids.size();
+  this->BuildCentroidGrid( centroids );
 
+  unsigned int numberOfSamples = sample.size();
   for( unsigned int js = 0; js < numberOfSamples; js++ )
     {
-    double distMin = 1e20;
-    nearest[js] = 0;
+    nearest[js] = this->FindClosestCentroid( sample[js], centroids );
+    }
+  if( this->GetDebug() )
+    {
+    std::cout << "    computing closest done" << std::endl;
+    }
+}
+
+
+/** BuildCentroidGrid */
+template< class TInputImage, class TOutputImage >
+void
+CVTImageFilter< TInputImage, TOutputImage >::
+BuildCentroidGrid( const PointArrayType & centroids )
+{
+  const unsigned int numberOfCentroids = centroids.size();
 
-    for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+  // Cells are cubes sized to hold about one centroid each
+  ContinuousIndexType maxIndx;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_CentroidGridOrigin[i] = 0;
+    maxIndx[i] = 0;
+    }
+  for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+    {
+    for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-      double dist = 0.0;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+      if( jc == 0 || centroids[jc][i] < m_CentroidGridOrigin[i] )
         {
-        dist += ( sample[js][i] - centroids[jc][i] )
-          * ( sample[js][i] - centroids[jc][i] );
+        m_CentroidGridOrigin[i] = centroids[jc][i];
         }
-
-      if( jc == 0 || dist < distMin )
+      if( jc == 0 || centroids[jc][i] > maxIndx[i] )
         {
-        distMin = dist;
-        nearest[js] = jc;
+        maxIndx[i] = centroids[jc][i];
         }
       }
     }
-  if( this->GetDebug() )
+  double volume = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
     {
-    std::cout << "    computing closest done" << std::endl;
+    volume *= std::max( maxIndx[i] - m_CentroidGridOrigin[i], 1.0 );
+    }
+  m_CentroidGridCellSize = std::pow( volume
+    / std::max( numberOfCentroids, 1u ), 1.0 / ImageDimension );
+  m_CentroidGridCellSize = std::max( m_CentroidGridCellSize, 1e-6 );
+
+  unsigned int numberOfCells = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_CentroidGridSize[i] = static_cast< int >( ( maxIndx[i]
+      - m_CentroidGridOrigin[i] ) / m_CentroidGridCellSize ) + 1;
+    numberOfCells *= m_CentroidGridSize[i];
     }
+
+  // Counting sort of the centroids by cell; ids stay in increasing order
+  //   within a cell.
+  std::vector< unsigned int > centroidCell( numberOfCentroids );
+  m_CentroidGridStart.assign( numberOfCells + 1, 0 );
+  for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+    {
+    unsigned int cell = 0;
+    for( int i = ( int )ImageDimension - 1; i >= 0; --i )
+      {
+      int c = static_cast< int >( ( centroids[jc][i]
+        - m_CentroidGridOrigin[i] ) / m_CentroidGridCellSize );
+      c = std::min( std::max( c, 0 ), m_CentroidGridSize[i] - 1 );
+      cell = cell * m_CentroidGridSize[i] + c;
+      }
+    centroidCell[jc] = cell;
+    m_CentroidGridStart[cell + 1]++;
+    }
+  for( unsigned int cell = 0; cell < numberOfCells; cell++ )
+    {
+    m_CentroidGridStart[cell + 1] += m_CentroidGridStart[cell];
+    }
+  std::vector< unsigned int > next( m_CentroidGridStart.begin(),
+    m_CentroidGridStart.end() - 1 );
+  m_CentroidGridIds.resize( numberOfCentroids );
+  for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+    {
+    m_CentroidGridIds[next[centroidCell[jc]]++] = jc;
+    }
+}
+
+
+/** FindClosestCentroid */
+template< class TInputImage, class TOutputImage >
+unsigned int
+CVTImageFilter< TInputImage, TOutputImage >::
+FindClosestCentroid( const ContinuousIndexType & x,
+  const PointArrayType & centroids ) const
+{
+  int center[ImageDimension];
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    int c = static_cast< int >( std::floor( ( x[i]
+      - m_CentroidGridOrigin[i] ) / m_CentroidGridCellSize ) );
+    center[i] = std::min( std::max( c, 0 ), m_CentroidGridSize[i] - 1 );
+    }
+
+  // Visit shells of cells at increasing distance from the cell of x until
+  //   no unvisited cell can hold a closer centroid.
+  bool found = false;
+  double distMin = 0;
+  unsigned int nearest = 0;
+  int cellMin[ImageDimension];
+  int cellMax[ImageDimension];
+  int cell[ImageDimension];
+  for( int r = 0; ; r++ )
+    {
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      cellMin[i] = std::max( center[i] - r, 0 );
+      cellMax[i] = std::min( center[i] + r, m_CentroidGridSize[i] - 1 );
+      cell[i] = cellMin[i];
+      }
+    bool done = false;
+    while( !done )
+      {
+      int shell = 0;
+      unsigned int cellId = 0;
+      for( int i = ( int )ImageDimension - 1; i >= 0; --i )
+        {
+        shell = std::max( shell, std::abs( cell[i] - center[i] ) );
+        cellId = cellId * m_CentroidGridSize[i] + cell[i];
+        }
+      if( shell == r )
+        {
+        for( unsigned int k = m_CentroidGridStart[cellId];
+          k < m_CentroidGridStart[cellId + 1]; k++ )
+          {
+          unsigned int jc = m_CentroidGridIds[k];
+          double dist = 0.0;
+          for( unsigned int i = 0; i < ImageDimension; i++ )
+            {
+            dist += ( x[i] - centroids[jc][i] )
+              * ( x[i] - centroids[jc][i] );
+            }
+          if( !found || dist < distMin
+            || ( dist == distMin && jc < nearest ) )
+            {
+            found = true;
+            distMin = dist;
+            nearest = jc;
+            }
+          }
+        }
+      unsigned int i = 0;
+      while( i < ImageDimension && ++cell[i] > cellMax[i] )
+        {
+        cell[i] = cellMin[i];
+        i++;
+        }
+      done = ( i == ImageDimension );
+      }
+
+    // Distance from x to the nearest cell outside the visited box
+    bool covered = true;
+    double gap = 0;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      if( center[i] - r > 0 )
+        {
+        double g = x[i] - ( m_CentroidGridOrigin[i]
+          + ( center[i] - r ) * m_CentroidGridCellSize );
+        gap = covered ? g : std::min( gap, g );
+        covered = false;
+        }
+      if( center[i] + r < m_CentroidGridSize[i] - 1 )
+        {
+        double g = ( m_CentroidGridOrigin[i]
+          + ( center[i] + r + 1 ) * m_CentroidGridCellSize ) - x[i];
+        gap = covered ? g : std::min( gap, g );
+        covered = false;
+        }
+      }
+    if( covered || ( found && gap > 0 && distMin < gap * gap ) )
+      {
+      break;
+      }
+    }
+
+  return nearest;
 }
 
 template< class TInputImage, class TOutputImage >
@@ -145,6 +145,60 @@ private:
   typedef std::unordered_map< TubeIdType, TubePointerType >
   TubeIdToPointerMapType;
 
+  typedef typename TubeType::TubePointListType  TubePointListType;
+  typedef typename TubeType::PointType          PositionType;
+
+  /** An end point of a tube that can be the target of an edge. */
+  struct TubeEndPointType
+    {
+    PositionType position;
+    unsigned int tubeIndex;
+    int pointId;
+    };
+
+  typedef std::vector< TubeEndPointType >       TubeEndPointListType;
+
+  struct EndPointAxisLessType
+    {
+    explicit EndPointAxisLessType( unsigned int axis ) : m_Axis( axis ) {}
+
+    bool operator()( const TubeEndPointType & a,
+      const TubeEndPointType & b ) const
+      {
+      return a.position[m_Axis] < b.position[m_Axis];
+      }
+
+    unsigned int m_Axis;
+    };
+
+  /** Arrange endPoints[begin, end) as an implicit k-d tree: the median
+   * along axis is stored at the middle of the range, with the lower and
+   * upper halves on either side. */
+  static void BuildEndPointTree( TubeEndPointListType & endPoints,
+    size_t begin, size_t end, unsigned int axis );
+
+  /** Append the indices of the end points within radius of center. */
+  static void FindEndPointsInRadius( const TubeEndPointListType & endPoints,
+    size_t begin, size_t end, unsigned int axis, const PositionType & center,
+    double radius, std::vector< size_t > & found );
+
+  /** Compute the best edge from one source tube to each other tube. */
+  void ComputeSourceTubeEdges( unsigned int sourceTubeIndex,
+    const std::vector< TubePointerType > & tubes,
+    const TubeEndPointListType & endPoints,
+    GraphEdgeListType & edges ) const;
+
+  struct BuildTubeGraphThreadStruct
+    {
+    const Self                           * Filter;
+    const std::vector< TubePointerType > * Tubes;
+    const TubeEndPointListType           * EndPoints;
+    std::vector< GraphEdgeListType >     * SourceTubeEdges;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    BuildTubeGraphThreaderCallback( void * arg );
+
   struct TubePQElementType
     {
     TubeIdType tubeId;
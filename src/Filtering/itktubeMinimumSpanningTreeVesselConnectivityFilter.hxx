@@ -120,186 +120,318 @@ MinimumSpanningTreeVesselConnectivityFilter< VDimension >
 template< unsigned int VDimension >
 void
 MinimumSpanningTreeVesselConnectivityFilter< VDimension >
-::BuildTubeGraph( void )
+::BuildEndPointTree( TubeEndPointListType & endPoints, size_t begin,
+  size_t end, unsigned int axis )
 {
-  const TubeGroupType * inputTubeGroup = this->GetInput();
-
-  // build a map between tube id and tube object
-  tubeDebugMacro( << "Computing Tube ID to Object Map" );
+  while( end - begin > 1 )
+    {
+    const size_t mid = begin + ( end - begin ) / 2;
+    std::nth_element( endPoints.begin() + begin, endPoints.begin() + mid,
+      endPoints.begin() + end, EndPointAxisLessType( axis ) );
+    const unsigned int nextAxis = ( axis + 1 ) % VDimension;
+    BuildEndPointTree( endPoints, begin, mid, nextAxis );
+    begin = mid + 1;
+    axis = nextAxis;
+    }
+}
 
-  typedef typename TubeGroupType::ChildrenListPointer TubeListPointerType;
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::FindEndPointsInRadius( const TubeEndPointListType & endPoints,
+  size_t begin, size_t end, unsigned int axis, const PositionType & center,
+  double radius, std::vector< size_t > & found )
+{
+  while( end > begin )
+    {
+    const size_t mid = begin + ( end - begin ) / 2;
+    const PositionType & pos = endPoints[mid].position;
+    if( pos.SquaredEuclideanDistanceTo( center ) <= radius * radius )
+      {
+      found.push_back( mid );
+      }
+    const double diff = center[axis] - pos[axis];
+    const unsigned int nextAxis = ( axis + 1 ) % VDimension;
+    if( diff <= radius )
+      {
+      if( diff >= -radius )
+        {
+        FindEndPointsInRadius( endPoints, begin, mid, nextAxis, center,
+          radius, found );
+        begin = mid + 1;
+        }
+      else
+        {
+        end = mid;
+        }
+      }
+    else
+      {
+      begin = mid + 1;
+      }
+    axis = nextAxis;
+    }
+}
 
-  char tubeName[] = "Tube";
-  TubeListPointerType pTubeList
-    = inputTubeGroup->GetChildren(
-    inputTubeGroup->GetMaximumDepth(), tubeName );
+template< unsigned int VDimension >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::BuildTubeGraphThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
 
-  m_TubeIdToObjectMap.clear();
+  BuildTubeGraphThreadStruct * str = ( BuildTubeGraphThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
 
-  for( typename TubeGroupType::ChildrenListType::iterator
-    itTubes = pTubeList->begin();
-    itTubes != pTubeList->end(); ++itTubes )
+  // Tubes are dealt out in turn since their lengths vary widely
+  for( size_t t = threadId; t < str->Tubes->size(); t += threadCount )
     {
-    m_TubeIdToObjectMap[( *itTubes )->GetId()]
-      = dynamic_cast< TubeType * >( itTubes->GetPointer() );
+    str->Filter->ComputeSourceTubeEdges( t, *( str->Tubes ),
+      *( str->EndPoints ), ( *str->SourceTubeEdges )[t] );
     }
 
-  // build graph
-  tubeDebugMacro( << "Building tube graph" );
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
 
-  typedef typename TubeType::TubePointListType TubePointListType;
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::ComputeSourceTubeEdges( unsigned int sourceTubeIndex,
+  const std::vector< TubePointerType > & tubes,
+  const TubeEndPointListType & endPoints,
+  GraphEdgeListType & edges ) const
+{
   typedef typename TubeType::TubePointType     TubePointType;
-  typedef typename TubeType::PointType         PositionType;
   typedef typename PositionType::VectorType    PositionVectorType;
 
-  m_TubeGraph.clear();
+  TubePointerType pCurSourceTube = tubes[sourceTubeIndex];
+  TubeIdType curSourceTubeId = pCurSourceTube->GetId();
+  const TubePointListType & sourcePointList = pCurSourceTube->GetPoints();
 
-  for( typename TubeGroupType::ChildrenListType::iterator
-    itSourceTubes = pTubeList->begin();
-    itSourceTubes != pTubeList->end(); ++itSourceTubes )
-    {
-    TubePointerType pCurSourceTube
-      = dynamic_cast< TubeType * >( itSourceTubes->GetPointer() );
-    TubeIdType curSourceTubeId = pCurSourceTube->GetId();
-    TubePointListType sourcePointList = pCurSourceTube->GetPoints();
+  edges.clear();
 
-    m_TubeGraph[curSourceTubeId].clear();
+  // The best connection to each target tube from the current source point
+  std::map< unsigned int, ConnectionPointType > bestConnPoint;
+  std::vector< size_t > found;
 
-    int curSourceTubePointId = 0;
-    for( typename TubePointListType::const_iterator
-      itSourcePoints = sourcePointList.begin();
-      itSourcePoints != sourcePointList.end(); ++itSourcePoints )
+  int curSourceTubePointId = 0;
+  for( typename TubePointListType::const_iterator
+    itSourcePoints = sourcePointList.begin();
+    itSourcePoints != sourcePointList.end(); ++itSourcePoints )
+    {
+    const TubePointType & ptSource = *itSourcePoints;
+    PositionVectorType ptSourcePos
+      = ptSource.GetPositionInObjectSpace().GetVectorFromOrigin();
+    const double maxDist = m_MaxTubeDistanceToRadiusRatio
+      * ptSource.GetRadiusInObjectSpace();
+
+    // The search radius is padded so that rounding cannot drop a point
+    //   that passes the exact distance test below.
+    found.clear();
+    FindEndPointsInRadius( endPoints, 0, endPoints.size(), 0,
+      ptSource.GetPositionInObjectSpace(), maxDist * ( 1 + 1e-9 ) + 1e-12,
+      found );
+
+    bestConnPoint.clear();
+    for( size_t f = 0; f < found.size(); ++f )
       {
-      TubePointType ptSource = *itSourcePoints;
-      PositionVectorType ptSourcePos
-        = ptSource.GetPositionInObjectSpace().GetVectorFromOrigin();
+      const TubeEndPointType & endPoint = endPoints[found[f]];
+      const TubePointerType & curTargetTube = tubes[endPoint.tubeIndex];
+      if( curTargetTube->GetId() == curSourceTubeId )
+        {
+        continue;
+        }
+
+      const TubePointListType & targetPointList = curTargetTube->GetPoints();
+      int curPtId = endPoint.pointId;
+
+      PositionVectorType ptCurPos
+        = endPoint.position.GetVectorFromOrigin();
 
-      for( typename TubeGroupType::ChildrenListType::iterator
-        itTargetTubes = pTubeList->begin();
-        itTargetTubes != pTubeList->end(); ++itTargetTubes )
+      PositionVectorType vecToCurPt = ptCurPos - ptSourcePos;
+
+      // compute and check distance
+      double curDist = vecToCurPt.GetNorm();
+
+      if( curDist > maxDist )
         {
-        TubePointerType curTargetTube
-          = dynamic_cast< TubeType * >( itTargetTubes->GetPointer() );
-        TubeIdType curTargetTubeId = curTargetTube->GetId();
+        continue;
+        }
 
-        if( curSourceTubeId == curTargetTubeId )
-          {
-          continue;
-          }
+      // compute and check angular continuity
+      PositionVectorType ptNextPos;
 
-        TubePointListType targetPointList = curTargetTube->GetPoints();
+      if( curPtId == 0 )
+        {
+        ptNextPos = targetPointList[ curPtId + 1 ].GetPositionInObjectSpace()
+          .GetVectorFromOrigin();
+        }
+      else
+        {
+        ptNextPos = targetPointList[ curPtId - 1 ].GetPositionInObjectSpace()
+          .GetVectorFromOrigin();
+        }
 
-        if( targetPointList.size() <= 1 )
-          {
-          continue;
-          }
+      PositionVectorType curVecToNextPt = ptNextPos - ptCurPos;
 
-        int ptCandidateIdList[] = {0, ( int ) targetPointList.size() - 1};
+      vecToCurPt.Normalize();
+      curVecToNextPt.Normalize();
 
-        std::priority_queue< ConnectionPointType,
-          std::vector< ConnectionPointType >,
-          std::greater< ConnectionPointType > >
-        minpqConnPoint;
-        ConnectionPointType ePtConn;
+      double curAngle = std::acos( vecToCurPt * curVecToNextPt );
+      curAngle *= 180.0 / itk::Math::pi;
 
-        for( unsigned int i = 0; i < 2; i++ )
-          {
-          int curPtId = ptCandidateIdList[i];
-          TubePointType ptCur = targetPointList[curPtId];
-
-          PositionVectorType ptCurPos
-            = ptCur.GetPositionInObjectSpace().GetVectorFromOrigin();
-
-          PositionVectorType vecToCurPt = ptCurPos - ptSourcePos;
-
-          // compute and check distance
-          double curDist = vecToCurPt.GetNorm();
-
-          if( curDist > m_MaxTubeDistanceToRadiusRatio
-            * ptSource.GetRadiusInObjectSpace() )
-            {
-            continue;
-            }
-
-          // compute and check angular continuity
-          PositionVectorType ptNextPos;
-
-          if( curPtId == 0 )
-            {
-            ptNextPos = targetPointList[ curPtId + 1 ].GetPositionInObjectSpace()
-              .GetVectorFromOrigin();
-            }
-            else
-            {
-            ptNextPos = targetPointList[ curPtId - 1 ].GetPositionInObjectSpace()
-              .GetVectorFromOrigin();
-            }
-
-          PositionVectorType curVecToNextPt = ptNextPos - ptCurPos;
-
-          vecToCurPt.Normalize();
-          curVecToNextPt.Normalize();
-
-          double curAngle = std::acos( vecToCurPt * curVecToNextPt );
-          curAngle *= 180.0 / itk::Math::pi;
-
-          if( curAngle > m_MaxContinuityAngleError )
-            {
-            continue;
-            }
-
-          // add to queue
-          ePtConn.dist = curDist;
-          ePtConn.angle = curAngle;
-          ePtConn.pointId = curPtId;
-          minpqConnPoint.push( ePtConn );
-          }
+      if( curAngle > m_MaxContinuityAngleError )
+        {
+        continue;
+        }
 
-        if( minpqConnPoint.empty() )
-          {
-          continue;
-          }
+      ConnectionPointType ePtConn;
+      ePtConn.dist = curDist;
+      ePtConn.angle = curAngle;
+      ePtConn.pointId = curPtId;
 
-        ePtConn = minpqConnPoint.top();
+      // Of two equally good end points the first one is kept
+      typename std::map< unsigned int, ConnectionPointType >::iterator
+        itBest = bestConnPoint.find( endPoint.tubeIndex );
+      if( itBest == bestConnPoint.end() )
+        {
+        bestConnPoint[endPoint.tubeIndex] = ePtConn;
+        }
+      else if( itBest->second > ePtConn || ( !( ePtConn > itBest->second )
+        && ePtConn.pointId < itBest->second.pointId ) )
+        {
+        itBest->second = ePtConn;
+        }
+      }
 
-        while( !minpqConnPoint.empty() )
+    for( typename std::map< unsigned int, ConnectionPointType >::const_iterator
+      itBest = bestConnPoint.begin(); itBest != bestConnPoint.end();
+      ++itBest )
+      {
+      const ConnectionPointType & ePtConn = itBest->second;
+      const TubePointerType & curTargetTube = tubes[itBest->first];
+      TubeIdType curTargetTubeId = curTargetTube->GetId();
+
+      GraphEdgeType e;
+      e.sourceTube       = pCurSourceTube;
+      e.sourceTubeId      = curSourceTubeId;
+      e.sourceTubePointId = curSourceTubePointId;
+
+      e.targetTube       = curTargetTube;
+      e.targetTubeId      = curTargetTubeId;
+      e.targetTubePointId = ePtConn.pointId;
+
+      e.weight = ePtConn.dist;
+      e.distToRadRatio = ePtConn.dist / ptSource.GetRadiusInObjectSpace();
+      e.continuityAngleError = ePtConn.angle;
+
+      // if edge to current target is present then update it, else add it
+      typename GraphEdgeListType::iterator itEdge
+        = edges.find( curTargetTubeId );
+      if( itEdge != edges.end() )
+        {
+        // add only if current weight is better
+        if( e.weight < itEdge->second.weight )
           {
-          minpqConnPoint.pop();
+          itEdge->second = e;
           }
+        }
+      else
+        {
+        edges[curTargetTubeId] = e;
+        }
+      }
 
-        GraphEdgeType e;
-        e.sourceTube       = pCurSourceTube;
-        e.sourceTubeId      = curSourceTubeId;
-        e.sourceTubePointId = curSourceTubePointId;
+    ++curSourceTubePointId;
+    }
+}
 
-        e.targetTube       = curTargetTube;
-        e.targetTubeId      = curTargetTubeId;
-        e.targetTubePointId = ePtConn.pointId;
+template< unsigned int VDimension >
+void
+MinimumSpanningTreeVesselConnectivityFilter< VDimension >
+::BuildTubeGraph( void )
+{
+  const TubeGroupType * inputTubeGroup = this->GetInput();
 
-        e.weight = ePtConn.dist;
-        e.distToRadRatio = ePtConn.dist / ptSource.GetRadiusInObjectSpace();
-        e.continuityAngleError = ePtConn.angle;
+  // build a map between tube id and tube object
+  tubeDebugMacro( << "Computing Tube ID to Object Map" );
 
-        // if edge to current target is present then update it, else add it
-        if( m_TubeGraph[curSourceTubeId].find( curTargetTubeId )
-          != m_TubeGraph[curSourceTubeId].end() )
-          {
-          GraphEdgeType eOld = m_TubeGraph[curSourceTubeId][curTargetTubeId];
+  typedef typename TubeGroupType::ChildrenListPointer TubeListPointerType;
 
-          // add only if current weight is better
-          if( e.weight < eOld.weight )
-            {
-            m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
-            }
-          }
-        else
-          {
-          m_TubeGraph[curSourceTubeId][curTargetTubeId] = e;
-          }
+  char tubeName[] = "Tube";
+  TubeListPointerType pTubeList
+    = inputTubeGroup->GetChildren(
+    inputTubeGroup->GetMaximumDepth(), tubeName );
 
-        }
-      ++curSourceTubePointId;
+  m_TubeIdToObjectMap.clear();
+
+  for( typename TubeGroupType::ChildrenListType::iterator
+    itTubes = pTubeList->begin();
+    itTubes != pTubeList->end(); ++itTubes )
+    {
+    m_TubeIdToObjectMap[( *itTubes )->GetId()]
+      = dynamic_cast< TubeType * >( itTubes->GetPointer() );
+    }
+
+  // build graph
+  tubeDebugMacro( << "Building tube graph" );
+
+  std::vector< TubePointerType > tubes;
+  tubes.reserve( pTubeList->size() );
+  for( typename TubeGroupType::ChildrenListType::iterator
+    itTubes = pTubeList->begin();
+    itTubes != pTubeList->end(); ++itTubes )
+    {
+    tubes.push_back( dynamic_cast< TubeType * >( itTubes->GetPointer() ) );
+    }
+
+  // Edges only ever end at the first or last point of a target tube, so
+  //   those are indexed to limit each source point to nearby targets.
+  TubeEndPointListType endPoints;
+  endPoints.reserve( 2 * tubes.size() );
+  for( unsigned int t = 0; t < tubes.size(); ++t )
+    {
+    const TubePointListType & targetPointList = tubes[t]->GetPoints();
+    if( targetPointList.size() <= 1 )
+      {
+      continue;
       }
+    TubeEndPointType endPoint;
+    endPoint.tubeIndex = t;
+    endPoint.pointId = 0;
+    endPoint.position = targetPointList.front().GetPositionInObjectSpace();
+    endPoints.push_back( endPoint );
+    endPoint.pointId = ( int ) targetPointList.size() - 1;
+    endPoint.position = targetPointList.back().GetPositionInObjectSpace();
+    endPoints.push_back( endPoint );
+    }
+  BuildEndPointTree( endPoints, 0, endPoints.size(), 0 );
+
+  std::vector< GraphEdgeListType > sourceTubeEdges( tubes.size() );
+
+  BuildTubeGraphThreadStruct str;
+  str.Filter = this;
+  str.Tubes = &tubes;
+  str.EndPoints = &endPoints;
+  str.SourceTubeEdges = &sourceTubeEdges;
+
+  ThreadIdType numWorkUnits = this->GetNumberOfWorkUnits();
+  if( numWorkUnits > tubes.size() )
+    {
+    numWorkUnits = std::max( tubes.size(), ( size_t ) 1 );
+    }
+  this->GetMultiThreader()->SetNumberOfWorkUnits( numWorkUnits );
+  this->GetMultiThreader()->SetSingleMethod(
+    this->BuildTubeGraphThreaderCallback, &str );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  m_TubeGraph.clear();
+  for( unsigned int t = 0; t < tubes.size(); ++t )
+    {
+    m_TubeGraph[tubes[t]->GetId()] = sourceTubeEdges[t];
     }
 
   // print graph
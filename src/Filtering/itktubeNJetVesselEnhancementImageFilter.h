@@ -0,0 +1,181 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeNJetVesselEnhancementImageFilter_h
+#define __itktubeNJetVesselEnhancementImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include "itktubeGaussianDerivativeFilter.h"
+#include "itktubeNJetImageFunction.h"
+
+namespace itk
+{
+namespace tube
+{
+
+/** \class NJetVesselEnhancementImageFilter
+ * \brief Multiscale ridgeness times intensity, as in
+ *        ImageMathFilters::EnhanceVessels.
+ *
+ * The output is the maximum over the scales of the ridgeness times the
+ * blurred intensity.  By default each voxel is evaluated by
+ * NJetImageFunction, as EnhanceVessels did, with the voxels split across
+ * work units.
+ *
+ * With UseRecursiveGaussian on, the jet at each scale is instead computed
+ * for the whole image by RecursiveGaussianDerivativeFilter, and converted
+ * to the normalized jet of NJetImageFunction.  This is much faster at
+ * large scales, but the jets differ by a few percent, and the ridgeness
+ * is discontinuous where an eigenvalue of the Hessian changes sign, so a
+ * few voxels differ by much more.  Near the image boundary the difference
+ * is larger, since NJetImageFunction clamps its kernel to the image.
+ *
+ * The scales are log-spaced from ScaleMin to ScaleMax; a single scale is
+ * ScaleMin.  An IterationEvent is invoked as each scale starts.
+ *
+ * \sa NJetImageFunction
+ */
+template< typename TInputImage >
+class NJetVesselEnhancementImageFilter :
+  public ImageToImageFilter< TInputImage, Image< float,
+    TInputImage::ImageDimension > >
+{
+public:
+
+  typedef TInputImage                                       InputImageType;
+
+  typedef Image< float, TInputImage::ImageDimension >       OutputImageType;
+
+  typedef NJetVesselEnhancementImageFilter                   Self;
+  typedef ImageToImageFilter< TInputImage, OutputImageType > Superclass;
+  typedef SmartPointer< Self >                               Pointer;
+  typedef SmartPointer< const Self >                         ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( NJetVesselEnhancementImageFilter, ImageToImageFilter );
+
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TInputImage::ImageDimension );
+
+  itkSetMacro( ScaleMin, double );
+  itkGetMacro( ScaleMin, double );
+
+  itkSetMacro( ScaleMax, double );
+  itkGetMacro( ScaleMax, double );
+
+  itkSetMacro( NumberOfScales, unsigned int );
+  itkGetMacro( NumberOfScales, unsigned int );
+
+  /** Compute the jets with recursive Gaussian derivatives.  Off by
+   * default. */
+  itkSetMacro( UseRecursiveGaussian, bool );
+  itkGetMacro( UseRecursiveGaussian, bool );
+  itkBooleanMacro( UseRecursiveGaussian );
+
+  /** With UseRecursiveGaussian on, compute the jets in slabs of this many
+   * slices along the last dimension, as RidgeFFTFilter does.  Zero ( the
+   * default ) processes the whole volume. */
+  itkSetMacro( SlabSize, unsigned int );
+  itkGetMacro( SlabSize, unsigned int );
+
+  /** The scale of index scaleNumber, from zero to NumberOfScales-1 */
+  double GetScale( unsigned int scaleNumber ) const;
+
+  /** The scale being processed */
+  itkGetConstMacro( CurrentScale, double );
+
+protected:
+  NJetVesselEnhancementImageFilter( void );
+  virtual ~NJetVesselEnhancementImageFilter( void ) {}
+
+  void GenerateInputRequestedRegion() override;
+
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+
+  void GenerateData() override;
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+  // Purposely not implemented
+  NJetVesselEnhancementImageFilter( const Self & );
+  void operator = ( const Self & );
+
+  typedef GaussianDerivativeFilter< InputImageType, OutputImageType >
+    DerivativeFilterType;
+  typedef NJetImageFunction< InputImageType >           NJetFunctionType;
+
+  typedef typename OutputImageType::RegionType          RegionType;
+  typedef std::vector< typename OutputImageType::Pointer >
+    DerivativeImageListType;
+
+  /** NJetFunction is set when the jets are not precomputed. */
+  struct VesselnessThreadStruct
+    {
+    Self                          * Filter;
+    const NJetFunctionType        * NJetFunction;
+    const OutputImageType         * Intensity;
+    const DerivativeImageListType * Dx;
+    const DerivativeImageListType * Ddx;
+    RegionType                      DerivativeRegion;
+    RegionType                      OutputRegion;
+    double                          Scale;
+    bool                            FirstScale;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ComputeVesselnessThreaderCallback( void * arg );
+
+  /** Combine the vesselness of the voxels of outputRegion at scale with
+   * the output, from the jet in the matching derivativeRegion. */
+  void ComputeVesselness( const OutputImageType * intensity,
+    const DerivativeImageListType & dx, const DerivativeImageListType & ddx,
+    const RegionType & derivativeRegion, const RegionType & outputRegion,
+    double scale, bool firstScale );
+
+  /** Combine the vesselness of the voxels of outputRegion at scale with
+   * the output, evaluating the jet of each voxel by njetFunction. */
+  void ComputeVesselness( const NJetFunctionType * njetFunction,
+    const RegionType & outputRegion, double scale, bool firstScale );
+
+  double                                                m_ScaleMin;
+  double                                                m_ScaleMax;
+  unsigned int                                          m_NumberOfScales;
+  unsigned int                                          m_SlabSize;
+  bool                                                  m_UseRecursiveGaussian;
+  double                                                m_CurrentScale;
+};
+
+
+// End class NJetVesselEnhancementImageFilter
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeNJetVesselEnhancementImageFilter.hxx"
+#endif
+
+#endif
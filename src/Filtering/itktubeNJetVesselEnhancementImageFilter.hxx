@@ -0,0 +1,407 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeNJetVesselEnhancementImageFilter_hxx
+#define __itktubeNJetVesselEnhancementImageFilter_hxx
+
+#include "itktubeNJetVesselEnhancementImageFilter.h"
+#include "itktubeRecursiveGaussianDerivativeFilter.h"
+
+#include "tubeMatrixMath.h"
+
+#include "itkImageRegionSplitter.h"
+
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkRegionOfInterestImageFilter.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk {
+
+namespace tube {
+//----------------------------------------------------------------------------
+template< typename TInputImage >
+NJetVesselEnhancementImageFilter< TInputImage >
+::NJetVesselEnhancementImageFilter()
+{
+  m_ScaleMin = 1;
+  m_ScaleMax = 1;
+  m_NumberOfScales = 1;
+  m_SlabSize = 0;
+  m_UseRecursiveGaussian = false;
+  m_CurrentScale = 0;
+}
+
+
+template< typename TInputImage >
+double
+NJetVesselEnhancementImageFilter< TInputImage >
+::GetScale( unsigned int scaleNumber ) const
+{
+  if( m_NumberOfScales < 2 )
+    {
+    return m_ScaleMin;
+    }
+  double logScaleStep = ( std::log( m_ScaleMax ) - std::log( m_ScaleMin ) )
+    / ( m_NumberOfScales - 1 );
+  return std::exp( std::log( m_ScaleMin ) + scaleNumber * logScaleStep );
+}
+
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  InputImageType * input = const_cast< InputImageType * >(
+    this->GetInput() );
+  if( input )
+    {
+    input->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::GenerateData()
+{
+  typename InputImageType::ConstPointer input = this->GetInput();
+  const RegionType region = input->GetLargestPossibleRegion();
+
+  typename OutputImageType::Pointer output = this->GetOutput();
+  output->SetBufferedRegion( output->GetRequestedRegion() );
+  output->Allocate();
+
+  // Slabs are stacked along the last dimension
+  const unsigned int slabDim = ImageDimension - 1;
+  const IndexValueType regionStart = region.GetIndex()[slabDim];
+  const IndexValueType regionEnd = regionStart
+    + static_cast< IndexValueType >( region.GetSize()[slabDim] );
+  const bool useSlabs = ( m_SlabSize > 0
+    && m_SlabSize < region.GetSize()[slabDim] );
+  const IndexValueType slabSize = useSlabs ? m_SlabSize
+    : region.GetSize()[slabDim];
+
+  int ddxSize = 0;
+  for( unsigned int i=1; i<=ImageDimension; ++i )
+    {
+    ddxSize += i;
+    }
+
+  typename NJetFunctionType::Pointer njetFunction;
+  if( !m_UseRecursiveGaussian )
+    {
+    njetFunction = NJetFunctionType::New();
+    njetFunction->SetInputImage( input );
+    }
+
+  const unsigned int numberOfScales = std::max( m_NumberOfScales, 1u );
+  for( unsigned int scaleNumber = 0; scaleNumber < numberOfScales;
+    ++scaleNumber )
+    {
+    const double scale = this->GetScale( scaleNumber );
+
+    m_CurrentScale = scale;
+    this->UpdateProgress( static_cast< float >( scaleNumber )
+      / numberOfScales );
+    this->InvokeEvent( IterationEvent() );
+
+    if( !m_UseRecursiveGaussian )
+      {
+      VesselnessThreadStruct str;
+      str.Filter = this;
+      str.NJetFunction = njetFunction;
+      str.Intensity = NULL;
+      str.Dx = NULL;
+      str.Ddx = NULL;
+      str.DerivativeRegion = region;
+      str.OutputRegion = region;
+      str.Scale = scale;
+      str.FirstScale = ( scaleNumber == 0 );
+
+      this->GetMultiThreader()->SetNumberOfWorkUnits(
+        this->GetNumberOfWorkUnits() );
+      this->GetMultiThreader()->SetSingleMethod(
+        this->ComputeVesselnessThreaderCallback, &str );
+      this->GetMultiThreader()->SingleMethodExecute();
+      continue;
+      }
+
+    typename DerivativeFilterType::SigmasType sigmas;
+    sigmas.Fill( scale );
+
+    // Slices beyond four sigmas contribute little to a slab
+    const IndexValueType overlap = static_cast< IndexValueType >(
+      std::ceil( 4 * scale / input->GetSpacing()[slabDim] ) ) + 1;
+
+    for( IndexValueType slabStart = regionStart; slabStart < regionEnd;
+      slabStart += slabSize )
+      {
+      RegionType outputRegion = region;
+      outputRegion.SetIndex( slabDim, slabStart );
+      outputRegion.SetSize( slabDim,
+        std::min( slabSize, regionEnd - slabStart ) );
+
+      typename DerivativeFilterType::Pointer derivativeFilter =
+        RecursiveGaussianDerivativeFilter< InputImageType,
+        OutputImageType >::New();
+      derivativeFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+
+      RegionType derivativeRegion = outputRegion;
+      if( useSlabs )
+        {
+        RegionType paddedRegion = outputRegion;
+        const IndexValueType paddedStart = std::max( slabStart - overlap,
+          regionStart );
+        const IndexValueType paddedEnd = std::min( slabStart
+          + static_cast< IndexValueType >( outputRegion.GetSize()[slabDim] )
+          + overlap, regionEnd );
+        paddedRegion.SetIndex( slabDim, paddedStart );
+        paddedRegion.SetSize( slabDim, paddedEnd - paddedStart );
+
+        // The slab starts at index zero, as a whole volume would
+        typedef RegionOfInterestImageFilter< InputImageType, InputImageType >
+          ROIFilterType;
+        typename ROIFilterType::Pointer roiFilter = ROIFilterType::New();
+        roiFilter->SetInput( input );
+        roiFilter->SetRegionOfInterest( paddedRegion );
+        roiFilter->Update();
+
+        derivativeFilter->SetInput( roiFilter->GetOutput() );
+
+        for( unsigned int i=0; i<ImageDimension; ++i )
+          {
+          derivativeRegion.SetIndex( i, outputRegion.GetIndex()[i]
+            - paddedRegion.GetIndex()[i] );
+          }
+        }
+      else
+        {
+        derivativeFilter->SetInput( input );
+        }
+      derivativeFilter->SetSigmas( sigmas );
+
+      typename OutputImageType::Pointer intensity;
+      DerivativeImageListType dx( ImageDimension );
+      DerivativeImageListType ddx( ddxSize );
+      derivativeFilter->GenerateNJet( intensity, dx, ddx );
+
+      VesselnessThreadStruct str;
+      str.Filter = this;
+      str.NJetFunction = NULL;
+      str.Intensity = intensity;
+      str.Dx = &dx;
+      str.Ddx = &ddx;
+      str.DerivativeRegion = derivativeRegion;
+      str.OutputRegion = outputRegion;
+      str.Scale = scale;
+      str.FirstScale = ( scaleNumber == 0 );
+
+      this->GetMultiThreader()->SetNumberOfWorkUnits(
+        this->GetNumberOfWorkUnits() );
+      this->GetMultiThreader()->SetSingleMethod(
+        this->ComputeVesselnessThreaderCallback, &str );
+      this->GetMultiThreader()->SingleMethodExecute();
+      }
+    }
+
+  this->UpdateProgress( 1.0 );
+}
+
+
+template< typename TInputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+NJetVesselEnhancementImageFilter< TInputImage >
+::ComputeVesselnessThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  VesselnessThreadStruct * str = ( VesselnessThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  typedef itk::ImageRegionSplitter< ImageDimension > SplitterType;
+  typename SplitterType::Pointer splitter = SplitterType::New();
+
+  int total = splitter->GetNumberOfSplits( str->DerivativeRegion,
+    threadCount );
+  if( ( int )threadId < total )
+    {
+    RegionType derivativeRegion = splitter->GetSplit( threadId, total,
+      str->DerivativeRegion );
+    RegionType outputRegion = derivativeRegion;
+    outputRegion.SetIndex( str->OutputRegion.GetIndex()
+      + ( derivativeRegion.GetIndex()
+      - str->DerivativeRegion.GetIndex() ) );
+    if( str->NJetFunction != NULL )
+      {
+      str->Filter->ComputeVesselness( str->NJetFunction, outputRegion,
+        str->Scale, str->FirstScale );
+      }
+    else
+      {
+      str->Filter->ComputeVesselness( str->Intensity, *( str->Dx ),
+        *( str->Ddx ), derivativeRegion, outputRegion, str->Scale,
+        str->FirstScale );
+      }
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::ComputeVesselness( const OutputImageType * intensity,
+  const DerivativeImageListType & dx, const DerivativeImageListType & ddx,
+  const RegionType & derivativeRegion, const RegionType & outputRegion,
+  double scale, bool firstScale )
+{
+  ImageRegionConstIterator< OutputImageType > iterIntensity( intensity,
+    derivativeRegion );
+  std::vector< ImageRegionConstIterator< OutputImageType > > iterDx(
+    ImageDimension );
+  std::vector< ImageRegionConstIterator< OutputImageType > > iterDdx(
+    ddx.size() );
+
+  unsigned int count = 0;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    iterDx[i] = ImageRegionConstIterator< OutputImageType >( dx[i],
+      derivativeRegion );
+    for( unsigned int j=i; j<ImageDimension; ++j )
+      {
+      iterDdx[count] = ImageRegionConstIterator< OutputImageType >(
+        ddx[count], derivativeRegion );
+      ++count;
+      }
+    }
+
+  ImageRegionIterator< OutputImageType > iterOutput( this->GetOutput(),
+    outputRegion );
+
+  double ridgeness = 0;
+  double roundness = 0;
+  double curvature = 0;
+  double levelness = 0;
+  typename NJetFunctionType::MatrixType H;
+  typename NJetFunctionType::VectorType D;
+  typename NJetFunctionType::MatrixType HEVect;
+  typename NJetFunctionType::VectorType HEVal;
+  while( !iterOutput.IsAtEnd() )
+    {
+    count = 0;
+    for( unsigned int i=0; i<ImageDimension; ++i )
+      {
+      D[i] = iterDx[i].Get();
+      ++iterDx[i];
+      for( unsigned int j=i; j<ImageDimension; ++j )
+        {
+        H( i, j ) = iterDdx[count].Get();
+        H( j, i ) = H( i, j );
+        ++iterDdx[count];
+        ++count;
+        }
+      }
+    NJetFunctionType::GaussianDerivativesToJet( scale, D, H );
+    ::tube::ComputeRidgeness< double, ImageDimension >( H, D, NULL,
+      ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+
+    const double val = ridgeness * iterIntensity.Get();
+    if( firstScale || val > iterOutput.Get() )
+      {
+      iterOutput.Set( val );
+      }
+    ++iterIntensity;
+    ++iterOutput;
+    }
+}
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::ComputeVesselness( const NJetFunctionType * njetFunction,
+  const RegionType & outputRegion, double scale, bool firstScale )
+{
+  ImageRegionIteratorWithIndex< OutputImageType > iterOutput(
+    this->GetOutput(), outputRegion );
+
+  typename NJetFunctionType::ContinuousIndexType cIndx;
+  double intensity = 0;
+  while( !iterOutput.IsAtEnd() )
+    {
+    for( unsigned int i=0; i<ImageDimension; ++i )
+      {
+      cIndx[i] = iterOutput.GetIndex()[i];
+      }
+    const double ridgeness = njetFunction->ComputeRidgenessAtContinuousIndex(
+      cIndx, scale, intensity );
+
+    const double val = ridgeness * intensity;
+    if( firstScale || val > iterOutput.Get() )
+      {
+      iterOutput.Set( val );
+      }
+    ++iterOutput;
+    }
+}
+
+template< typename TInputImage >
+void
+NJetVesselEnhancementImageFilter< TInputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  this->Superclass::PrintSelf( os, indent );
+
+  os << indent << "ScaleMin       : " << m_ScaleMin << std::endl;
+  os << indent << "ScaleMax       : " << m_ScaleMax << std::endl;
+  os << indent << "NumberOfScales : " << m_NumberOfScales << std::endl;
+  os << indent << "SlabSize       : " << m_SlabSize << std::endl;
+  os << indent << "UseRecursiveGaussian : " << m_UseRecursiveGaussian
+    << std::endl;
+  os << indent << "CurrentScale   : " << m_CurrentScale << std::endl;
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif
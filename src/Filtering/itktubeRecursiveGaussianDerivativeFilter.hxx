@@ -0,0 +1,229 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeRecursiveGaussianDerivativeFilter_hxx
+#define __itktubeRecursiveGaussianDerivativeFilter_hxx
+
+#include "itktubeRecursiveGaussianDerivativeFilter.h"
+
+#include <itkCastImageFilter.h>
+
+namespace itk {
+
+namespace tube {
+//----------------------------------------------------------------------------
+template< typename TInputImage, typename TOutputImage >
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::RecursiveGaussianDerivativeFilter()
+{
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::RealImagePointerType
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::Blur( RealImageType * image, unsigned int direction, int order,
+  double sigma ) const
+{
+  if( order == 0 && sigma <= 0 )
+    {
+    return image;
+    }
+
+  typename BlurFilterType::Pointer filter = BlurFilterType::New();
+  filter->SetInput( image );
+  filter->SetNormalizeAcrossScale( false );
+  filter->SetSigma( sigma );
+  filter->SetDirection( direction );
+  switch( order )
+    {
+    case 0:
+      filter->SetOrder( GaussianOrderEnum::ZeroOrder );
+      break;
+    case 1:
+      filter->SetOrder( GaussianOrderEnum::FirstOrder );
+      break;
+    case 2:
+      filter->SetOrder( GaussianOrderEnum::SecondOrder );
+      break;
+    default:
+      itkExceptionMacro( << "Derivative order " << order
+        << " is not supported." );
+    }
+  filter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  filter->Update();
+
+  RealImagePointerType output = filter->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::RealImagePointerType
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::GetRealInput( void ) const
+{
+  typedef CastImageFilter< InputImageType, RealImageType > CastFilterType;
+  typename CastFilterType::Pointer castFilter = CastFilterType::New();
+  castFilter->SetInput( this->GetInput() );
+  castFilter->Update();
+
+  RealImagePointerType image = castFilter->GetOutput();
+  image->DisconnectPipeline();
+  return image;
+}
+
+template< typename TInputImage, typename TOutputImage >
+typename TOutputImage::Pointer
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::ConvertToOutput( RealImageType * image ) const
+{
+  typedef CastImageFilter< RealImageType, OutputImageType > CastFilterType;
+  typename CastFilterType::Pointer castFilter = CastFilterType::New();
+  castFilter->SetInput( image );
+  castFilter->Update();
+
+  typename OutputImageType::Pointer output = castFilter->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::GenerateData()
+{
+  RealImagePointerType image = this->GetRealInput();
+  for( unsigned int i = 0; i<ImageDimension; ++i )
+    {
+    image = this->Blur( image, i, this->m_Orders[i], this->m_Sigmas[i] );
+    }
+
+  this->SetNthOutput( 0, this->ConvertToOutput( image ) );
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::ComputeJetDerivatives( RealImageType * image, unsigned int dimension,
+  OrdersType & orders, int maxOrder,
+  typename TOutputImage::Pointer & D,
+  std::vector< typename TOutputImage::Pointer > & dX,
+  std::vector< typename TOutputImage::Pointer > & dXX ) const
+{
+  for( int order = 0; order <= maxOrder; ++order )
+    {
+    orders[dimension] = order;
+    RealImagePointerType blurred = this->Blur( image, dimension, order,
+      this->m_Sigmas[dimension] );
+    if( dimension > 0 )
+      {
+      this->ComputeJetDerivatives( blurred, dimension - 1, orders,
+        maxOrder - order, D, dX, dXX );
+      continue;
+      }
+
+    // All orders are now set; store the derivative in the order used by
+    //   FFTGaussianDerivativeIFFTFilter::GenerateNJet.
+    int first = -1;
+    int second = -1;
+    for( unsigned int i = 0; i<ImageDimension; ++i )
+      {
+      for( int j = 0; j<orders[i]; ++j )
+        {
+        if( first < 0 )
+          {
+          first = i;
+          }
+        else
+          {
+          second = i;
+          }
+        }
+      }
+    if( first < 0 )
+      {
+      D = this->ConvertToOutput( blurred );
+      }
+    else if( second < 0 )
+      {
+      dX[first] = this->ConvertToOutput( blurred );
+      }
+    else
+      {
+      unsigned int count = 0;
+      for( int i = 0; i<first; ++i )
+        {
+        count += ImageDimension - i;
+        }
+      count += second - first;
+      dXX[count] = this->ConvertToOutput( blurred );
+      }
+    }
+  orders[dimension] = 0;
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::GenerateNJet( typename TOutputImage::Pointer & D,
+  std::vector< typename TOutputImage::Pointer > & dX,
+  std::vector< typename TOutputImage::Pointer > & dXX )
+{
+  if( dX.size() != ImageDimension )
+    {
+    dX.resize( ImageDimension );
+    }
+
+  unsigned int ddxSize = 0;
+  for( unsigned int i = 1; i<=ImageDimension; ++i )
+    {
+    ddxSize += i;
+    }
+  if( dXX.size() != ddxSize )
+    {
+    dXX.resize( ddxSize );
+    }
+
+  OrdersType orders;
+  orders.Fill( 0 );
+  RealImagePointerType image = this->GetRealInput();
+  this->ComputeJetDerivatives( image, ImageDimension - 1, orders, 2,
+    D, dX, dXX );
+
+  this->SetNthOutput( 0, D );
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+RecursiveGaussianDerivativeFilter<TInputImage, TOutputImage>
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  this->Superclass::PrintSelf( os, indent );
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif
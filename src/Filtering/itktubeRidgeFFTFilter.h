@@ -56,6 +56,31 @@ public:
   itkSetMacro( UseIntensityOnly, bool );
   itkGetMacro( UseIntensityOnly, bool );
 
+  /** Process the volume in slabs of this many slices along its last
+   * dimension.  Each slab is filtered with enough neighboring slices to
+   * cover the Gaussian kernels, so only a few slabs of derivatives are in
+   * memory at once.  Zero ( the default ) processes the whole volume. */
+  itkSetMacro( SlabSize, unsigned int );
+  itkGetMacro( SlabSize, unsigned int );
+
+  /** Select which ridge measures are computed; the others are left NULL.
+   * All are computed by default. */
+  itkSetMacro( GenerateRidgeness, bool );
+  itkGetMacro( GenerateRidgeness, bool );
+  itkBooleanMacro( GenerateRidgeness );
+
+  itkSetMacro( GenerateRoundness, bool );
+  itkGetMacro( GenerateRoundness, bool );
+  itkBooleanMacro( GenerateRoundness );
+
+  itkSetMacro( GenerateCurvature, bool );
+  itkGetMacro( GenerateCurvature, bool );
+  itkBooleanMacro( GenerateCurvature );
+
+  itkSetMacro( GenerateLevelness, bool );
+  itkGetMacro( GenerateLevelness, bool );
+  itkBooleanMacro( GenerateLevelness );
+
   itkGetConstReferenceMacro( Intensity, typename OutputImageType::Pointer );
   itkGetConstReferenceMacro( Ridgeness, typename OutputImageType::Pointer );
   itkGetConstReferenceMacro( Curvature, typename OutputImageType::Pointer );
@@ -78,6 +103,30 @@ private:
   typedef GaussianDerivativeFilter< InputImageType, OutputImageType >
     DerivativeFilterType;
 
+  typedef typename OutputImageType::RegionType          RegionType;
+  typedef std::vector< typename OutputImageType::Pointer >
+    DerivativeImageListType;
+
+  struct RidgeThreadStruct
+    {
+    Self                          * Filter;
+    const DerivativeImageListType * Dx;
+    const DerivativeImageListType * Ddx;
+    RegionType                      DerivativeRegion;
+    RegionType                      OutputRegion;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ComputeRidgeMeasuresThreaderCallback( void * arg );
+
+  /** Compute the requested measures of the voxels of outputRegion from the
+   * derivatives in the matching derivativeRegion. */
+  void ComputeRidgeMeasures( const DerivativeImageListType & dx,
+    const DerivativeImageListType & ddx, const RegionType & derivativeRegion,
+    const RegionType & outputRegion );
+
+  typename OutputImageType::Pointer NewOutputImage( void ) const;
+
   typename DerivativeFilterType::Pointer                m_DerivativeFilter;
 
   typename OutputImageType::Pointer                     m_Intensity;
@@ -88,6 +137,12 @@ private:
 
   double                                                m_Scale;
   bool                                                  m_UseIntensityOnly;
+  unsigned int                                          m_SlabSize;
+
+  bool                                                  m_GenerateRidgeness;
+  bool                                                  m_GenerateRoundness;
+  bool                                                  m_GenerateCurvature;
+  bool                                                  m_GenerateLevelness;
 };
 
 
@@ -26,6 +26,14 @@
 
 #include "tubeMatrixMath.h"
 
+#include "itkImageRegionSplitter.h"
+
+#include <itkImageRegionIterator.h>
+#include <itkRegionOfInterestImageFilter.h>
+
+#include <algorithm>
+#include <cmath>
+
 
 namespace itk {
 
@@ -43,142 +51,322 @@ RidgeFFTFilter< TInputImage >
 
   m_Scale = 1;
   m_UseIntensityOnly = false;
+  m_SlabSize = 0;
+
+  m_GenerateRidgeness = true;
+  m_GenerateRoundness = true;
+  m_GenerateCurvature = true;
+  m_GenerateLevelness = true;
 
   m_DerivativeFilter = FFTGaussianDerivativeIFFTFilter< InputImageType,
     OutputImageType >::New();
 }
 
 
+template< typename TInputImage >
+typename RidgeFFTFilter< TInputImage >::OutputImageType::Pointer
+RidgeFFTFilter< TInputImage >
+::NewOutputImage( void ) const
+{
+  typename OutputImageType::Pointer image = OutputImageType::New();
+  image->CopyInformation( this->GetInput() );
+  image->SetRegions( this->GetInput()->GetLargestPossibleRegion() );
+  image->Allocate();
+  return image;
+}
+
+
 template< typename TInputImage >
 void
 RidgeFFTFilter< TInputImage >
 ::GenerateData()
 {
-  //itk::TimeProbesCollectorBase timeCollector;
-
-  //timeCollector.Start( "RidgeFFT GenerateData" );
-  m_DerivativeFilter->SetInput( this->GetInput() );
+  typename InputImageType::ConstPointer input = this->GetInput();
+  const RegionType region = input->GetLargestPossibleRegion();
 
   typename DerivativeFilterType::OrdersType orders;
   typename DerivativeFilterType::SigmasType sigmas;
-
   sigmas.Fill( m_Scale );
-  m_DerivativeFilter->SetSigmas( sigmas );
 
-  // Intensity
-  //timeCollector.Start( "RidgeFFT Intensity" );
-  orders.Fill( 0 );
-  m_DerivativeFilter->SetOrders( orders );
-  m_DerivativeFilter->Update();
-  m_Intensity = m_DerivativeFilter->GetOutput();
-  //timeCollector.Stop( "RidgeFFT Intensity" );
+  // Slabs are stacked along the last dimension
+  const unsigned int slabDim = ImageDimension - 1;
+  const IndexValueType regionStart = region.GetIndex()[slabDim];
+  const IndexValueType regionEnd = regionStart
+    + static_cast< IndexValueType >( region.GetSize()[slabDim] );
+  const bool useSlabs = ( m_SlabSize > 0
+    && m_SlabSize < region.GetSize()[slabDim] );
+  const IndexValueType slabSize = useSlabs ? m_SlabSize
+    : region.GetSize()[slabDim];
+
+  // Slices beyond four sigmas contribute little to a slab
+  const IndexValueType overlap = static_cast< IndexValueType >( std::ceil(
+    4 * m_Scale / input->GetSpacing()[slabDim] ) ) + 1;
 
+  m_Intensity = NULL;
+  m_Ridgeness = NULL;
+  m_Roundness = NULL;
+  m_Curvature = NULL;
+  m_Levelness = NULL;
+  if( useSlabs )
+    {
+    m_Intensity = this->NewOutputImage();
+    }
   if( !m_UseIntensityOnly )
     {
-    m_Ridgeness = OutputImageType::New();
-    m_Ridgeness->CopyInformation( m_Intensity );
-    m_Ridgeness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
-    m_Ridgeness->Allocate();
+    if( m_GenerateRidgeness )
+      {
+      m_Ridgeness = this->NewOutputImage();
+      }
+    if( m_GenerateRoundness )
+      {
+      m_Roundness = this->NewOutputImage();
+      }
+    if( m_GenerateCurvature )
+      {
+      m_Curvature = this->NewOutputImage();
+      }
+    if( m_GenerateLevelness )
+      {
+      m_Levelness = this->NewOutputImage();
+      }
+    }
 
-    m_Roundness = OutputImageType::New();
-    m_Roundness->CopyInformation( m_Intensity );
-    m_Roundness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
-    m_Roundness->Allocate();
+  int ddxSize = 0;
+  for( unsigned int i=1; i<=ImageDimension; ++i )
+    {
+    ddxSize += i;
+    }
 
-    m_Curvature = OutputImageType::New();
-    m_Curvature->CopyInformation( m_Intensity );
-    m_Curvature->SetRegions( m_Intensity->GetLargestPossibleRegion() );
-    m_Curvature->Allocate();
+  for( IndexValueType slabStart = regionStart; slabStart < regionEnd;
+    slabStart += slabSize )
+    {
+    RegionType outputRegion = region;
+    outputRegion.SetIndex( slabDim, slabStart );
+    outputRegion.SetSize( slabDim,
+      std::min( slabSize, regionEnd - slabStart ) );
+
+    typename DerivativeFilterType::Pointer derivativeFilter;
+    RegionType derivativeRegion = outputRegion;
+    if( useSlabs )
+      {
+      RegionType paddedRegion = outputRegion;
+      const IndexValueType paddedStart = std::max( slabStart - overlap,
+        regionStart );
+      const IndexValueType paddedEnd = std::min( slabStart
+        + static_cast< IndexValueType >( outputRegion.GetSize()[slabDim] )
+        + overlap, regionEnd );
+      paddedRegion.SetIndex( slabDim, paddedStart );
+      paddedRegion.SetSize( slabDim, paddedEnd - paddedStart );
+
+      // The slab starts at index zero, as a whole volume would
+      typedef RegionOfInterestImageFilter< InputImageType, InputImageType >
+        ROIFilterType;
+      typename ROIFilterType::Pointer roiFilter = ROIFilterType::New();
+      roiFilter->SetInput( input );
+      roiFilter->SetRegionOfInterest( paddedRegion );
+      roiFilter->Update();
+
+      // A new filter per slab, since the derivative filter recognizes a
+      //   new input only by its address.
+      derivativeFilter = FFTGaussianDerivativeIFFTFilter< InputImageType,
+        OutputImageType >::New();
+      derivativeFilter->SetInput( roiFilter->GetOutput() );
 
-    m_Levelness = OutputImageType::New();
-    m_Levelness->CopyInformation( m_Intensity );
-    m_Levelness->SetRegions( m_Intensity->GetLargestPossibleRegion() );
-    m_Levelness->Allocate();
+      for( unsigned int i=0; i<ImageDimension; ++i )
+        {
+        derivativeRegion.SetIndex( i, outputRegion.GetIndex()[i]
+          - paddedRegion.GetIndex()[i] );
+        }
+      }
+    else
+      {
+      derivativeFilter = m_DerivativeFilter;
+      derivativeFilter->SetInput( input );
+      }
+    derivativeFilter->SetSigmas( sigmas );
 
-    std::vector< typename OutputImageType::Pointer > dx( ImageDimension );
+    typename OutputImageType::Pointer intensity;
+    DerivativeImageListType dx( ImageDimension );
+    DerivativeImageListType ddx( ddxSize );
+    if( m_UseIntensityOnly )
+      {
+      orders.Fill( 0 );
+      derivativeFilter->SetOrders( orders );
+      derivativeFilter->Update();
+      intensity = derivativeFilter->GetOutput();
+      }
+    else
+      {
+      // The jet includes the intensity
+      derivativeFilter->GenerateNJet( intensity, dx, ddx );
+
+      RidgeThreadStruct str;
+      str.Filter = this;
+      str.Dx = &dx;
+      str.Ddx = &ddx;
+      str.DerivativeRegion = derivativeRegion;
+      str.OutputRegion = outputRegion;
+
+      this->GetMultiThreader()->SetNumberOfWorkUnits(
+        this->GetNumberOfWorkUnits() );
+      this->GetMultiThreader()->SetSingleMethod(
+        this->ComputeRidgeMeasuresThreaderCallback, &str );
+      this->GetMultiThreader()->SingleMethodExecute();
+      }
 
-    int ddxSize = 0;
-    for( unsigned int i=1; i<=ImageDimension; ++i )
+    if( useSlabs )
       {
-      ddxSize += i;
+      ImageRegionConstIterator< OutputImageType > iterSlab( intensity,
+        derivativeRegion );
+      ImageRegionIterator< OutputImageType > iterIntensity( m_Intensity,
+        outputRegion );
+      while( !iterSlab.IsAtEnd() )
+        {
+        iterIntensity.Set( iterSlab.Get() );
+        ++iterSlab;
+        ++iterIntensity;
+        }
       }
-    std::vector< typename OutputImageType::Pointer > ddx( ddxSize );
+    else
+      {
+      m_Intensity = intensity;
+      }
+    }
 
-    //timeCollector.Start( "RidgeFFT GenereateNJet" );
-    m_DerivativeFilter->GenerateNJet( m_Intensity, dx, ddx );
-    //timeCollector.Stop( "RidgeFFT GenereateNJet" );
+  this->SetNthOutput( 0, m_Intensity );
+}
 
-    ImageRegionIterator< OutputImageType > iterRidge( m_Ridgeness,
-      m_Ridgeness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterRound( m_Roundness,
-      m_Roundness->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterCurve( m_Curvature,
-      m_Curvature->GetLargestPossibleRegion() );
-    ImageRegionIterator< OutputImageType > iterLevel( m_Levelness,
-      m_Levelness->GetLargestPossibleRegion() );
 
-    std::vector< ImageRegionIterator< OutputImageType > > iterDx(
-      ImageDimension );
+template< typename TInputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+RidgeFFTFilter< TInputImage >
+::ComputeRidgeMeasuresThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  RidgeThreadStruct * str = ( RidgeThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  typedef itk::ImageRegionSplitter< ImageDimension > SplitterType;
+  typename SplitterType::Pointer splitter = SplitterType::New();
+
+  int total = splitter->GetNumberOfSplits( str->DerivativeRegion,
+    threadCount );
+  if( ( int )threadId < total )
+    {
+    RegionType derivativeRegion = splitter->GetSplit( threadId, total,
+      str->DerivativeRegion );
+    RegionType outputRegion = derivativeRegion;
+    outputRegion.SetIndex( str->OutputRegion.GetIndex()
+      + ( derivativeRegion.GetIndex()
+      - str->DerivativeRegion.GetIndex() ) );
+    str->Filter->ComputeRidgeMeasures( *( str->Dx ), *( str->Ddx ),
+      derivativeRegion, outputRegion );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+template< typename TInputImage >
+void
+RidgeFFTFilter< TInputImage >
+::ComputeRidgeMeasures( const DerivativeImageListType & dx,
+  const DerivativeImageListType & ddx, const RegionType & derivativeRegion,
+  const RegionType & outputRegion )
+{
+  std::vector< ImageRegionConstIterator< OutputImageType > > iterDx(
+    ImageDimension );
+  std::vector< ImageRegionConstIterator< OutputImageType > > iterDdx(
+    ddx.size() );
 
-    std::vector< ImageRegionIterator< OutputImageType > > iterDdx(
-      ddxSize );
+  unsigned int count = 0;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    iterDx[i] = ImageRegionConstIterator< OutputImageType >( dx[i],
+      derivativeRegion );
+    for( unsigned int j=i; j<ImageDimension; ++j )
+      {
+      iterDdx[count] = ImageRegionConstIterator< OutputImageType >(
+        ddx[count], derivativeRegion );
+      ++count;
+      }
+    }
 
-    unsigned int count = 0;
+  ImageRegionIterator< OutputImageType > iterRidge;
+  ImageRegionIterator< OutputImageType > iterRound;
+  ImageRegionIterator< OutputImageType > iterCurve;
+  ImageRegionIterator< OutputImageType > iterLevel;
+  if( m_Ridgeness.IsNotNull() )
+    {
+    iterRidge = ImageRegionIterator< OutputImageType >( m_Ridgeness,
+      outputRegion );
+    }
+  if( m_Roundness.IsNotNull() )
+    {
+    iterRound = ImageRegionIterator< OutputImageType >( m_Roundness,
+      outputRegion );
+    }
+  if( m_Curvature.IsNotNull() )
+    {
+    iterCurve = ImageRegionIterator< OutputImageType >( m_Curvature,
+      outputRegion );
+    }
+  if( m_Levelness.IsNotNull() )
+    {
+    iterLevel = ImageRegionIterator< OutputImageType >( m_Levelness,
+      outputRegion );
+    }
+
+  double ridgeness = 0;
+  double roundness = 0;
+  double curvature = 0;
+  double levelness = 0;
+  Matrix< double, ImageDimension, ImageDimension > H;
+  Vector< double, ImageDimension > D;
+  Matrix< double, ImageDimension, ImageDimension > HEVect;
+  Vector< double, ImageDimension > HEVal;
+  while( !iterDx[0].IsAtEnd() )
+    {
+    count = 0;
     for( unsigned int i=0; i<ImageDimension; ++i )
       {
-      iterDx[i] = ImageRegionIterator< OutputImageType >( dx[i],
-        dx[i]->GetLargestPossibleRegion() );
+      D[i] = iterDx[i].Get();
+      ++iterDx[i];
       for( unsigned int j=i; j<ImageDimension; ++j )
         {
-        iterDdx[count] = ImageRegionIterator< OutputImageType >( ddx[count],
-          ddx[count]->GetLargestPossibleRegion() );
+        H( i, j ) = iterDdx[count].Get();
+        H( j, i ) = H( i, j );
+        ++iterDdx[count];
         ++count;
         }
       }
-
-    double ridgeness = 0;
-    double roundness = 0;
-    double curvature = 0;
-    double levelness = 0;
-    vnl_matrix<double> H( ImageDimension, ImageDimension );
-    vnl_vector<double> D( ImageDimension );
-    vnl_matrix<double> HEVect( ImageDimension, ImageDimension );
-    vnl_vector<double> HEVal( ImageDimension );
-    //timeCollector.Start( "RidgeFFT Compute" );
-    while( !iterRidge.IsAtEnd() )
+    ::tube::ComputeRidgeness< double, ImageDimension >( H, D, NULL,
+      ridgeness, roundness, curvature, levelness, HEVect, HEVal );
+    if( m_Ridgeness.IsNotNull() )
       {
-      count = 0;
-      for( unsigned int i=0; i<ImageDimension; ++i )
-        {
-        D[i] = iterDx[i].Get();
-        ++iterDx[i];
-        for( unsigned int j=i; j<ImageDimension; ++j )
-          {
-          H[i][j] = iterDdx[count].Get();
-          H[j][i] = H[i][j];
-          ++iterDdx[count];
-          ++count;
-          }
-        }
-      vnl_vector<double> prevTangent;
-      ::tube::ComputeRidgeness( H, D, prevTangent, ridgeness, roundness,
-        curvature, levelness, HEVect, HEVal );
       iterRidge.Set( ridgeness );
-      iterRound.Set( roundness );
-      iterCurve.Set( curvature );
-      iterLevel.Set( levelness );
-
       ++iterRidge;
+      }
+    if( m_Roundness.IsNotNull() )
+      {
+      iterRound.Set( roundness );
       ++iterRound;
+      }
+    if( m_Curvature.IsNotNull() )
+      {
+      iterCurve.Set( curvature );
       ++iterCurve;
+      }
+    if( m_Levelness.IsNotNull() )
+      {
+      iterLevel.Set( levelness );
       ++iterLevel;
       }
-    //timeCollector.Stop( "RidgeFFT Compute" );
     }
-
-  this->SetNthOutput( 0, m_Intensity );
-  //timeCollector.Stop( "RidgeFFT GenerateData" );
-  //timeCollector.Report();
 }
 
 template< typename TInputImage >
@@ -235,6 +423,11 @@ RidgeFFTFilter< TInputImage >
 
   os << indent << "Scale             : " << m_Scale << std::endl;
   os << indent << "UseIntensityOnly  : " << m_UseIntensityOnly << std::endl;
+  os << indent << "SlabSize          : " << m_SlabSize << std::endl;
+  os << indent << "GenerateRidgeness : " << m_GenerateRidgeness << std::endl;
+  os << indent << "GenerateRoundness : " << m_GenerateRoundness << std::endl;
+  os << indent << "GenerateCurvature : " << m_GenerateCurvature << std::endl;
+  os << indent << "GenerateLevelness : " << m_GenerateLevelness << std::endl;
 }
 
 } // End namespace tube
@@ -152,9 +152,11 @@ public:
   /** Extract a single slice from the image. */
   void ExtractSlice( unsigned int dimension, unsigned int slice );
 
-  /** Compute ridgness/vesselness for specified scales. */
+  /** Compute ridgness/vesselness for specified scales.  The jets are
+   * evaluated at each voxel by NJetImageFunction, or, faster but only
+   * approximately, by recursive Gaussian derivatives. */
   void EnhanceVessels( double scaleMin, double scaleMax,
-    double numScales );
+    double numScales, bool useRecursiveGaussian = false );
 
   /** Segment using ( inclusive ) threshold connected components. */
   void SegmentUsingConnectedThreshold( float threshLow,
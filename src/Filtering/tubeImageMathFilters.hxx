@@ -26,6 +26,7 @@ limitations under the License.
 
 #include <itkBinaryBallStructuringElement.h>
 #include <itkCastImageFilter.h>
+#include <itkCommand.h>
 #include <itkBinaryDilateImageFilter.h>
 #include <itkBinaryErodeImageFilter.h>
 #include <itkExtractImageFilter.h>
@@ -42,11 +43,45 @@ limitations under the License.
 #include <itkMedianImageFilter.h>
 
 #include "itktubeCVTImageFilter.h"
-#include "itktubeNJetImageFunction.h"
+#include "itktubeNJetVesselEnhancementImageFilter.h"
 
 namespace tube
 {
 
+/** Reports each scale as NJetVesselEnhancementImageFilter starts it. */
+template< class TFilter >
+class VesselEnhancementScaleWatcher : public itk::Command
+{
+public:
+  typedef VesselEnhancementScaleWatcher Self;
+  typedef itk::Command                  Superclass;
+  typedef itk::SmartPointer< Self >     Pointer;
+
+  itkTypeMacro( VesselEnhancementScaleWatcher, itk::Command );
+
+  itkNewMacro( Self );
+
+  void Execute( itk::Object * caller, const itk::EventObject & event )
+    override
+    {
+    this->Execute( ( const itk::Object * )caller, event );
+    }
+
+  void Execute( const itk::Object * caller, const itk::EventObject & event )
+    override
+    {
+    const TFilter * filter = dynamic_cast< const TFilter * >( caller );
+    if( filter != NULL && itk::IterationEvent().CheckEvent( &event ) )
+      {
+      std::cout << "   Processing scale " << filter->GetCurrentScale()
+        << std::endl;
+      }
+    }
+
+protected:
+  VesselEnhancementScaleWatcher( void ) {}
+};
+
 template< unsigned int VDimension >
 ImageMathFilters<VDimension>::
 ImageMathFilters()
@@ -997,78 +1032,25 @@ ImageMathFilters<VDimension>
 template< unsigned int VDimension >
 void
 ImageMathFilters<VDimension>
-::EnhanceVessels( double scaleMin, double scaleMax, double numScales )
+::EnhanceVessels( double scaleMin, double scaleMax, double numScales,
+  bool useRecursiveGaussian )
 {
-  double logScaleStep = ( std::log( scaleMax ) - std::log( scaleMin ) )
-    / ( numScales-1 );
-
-  typedef itk::tube::NJetImageFunction< ImageType > ImageFunctionType;
-  typename ImageFunctionType::Pointer imFunc = ImageFunctionType::New();
-  imFunc->SetInputImage( m_Input );
-
-  typename ImageType::Pointer input2 = ImageType::New();
-  input2->SetRegions( m_Input->GetLargestPossibleRegion() );
-  input2->SetOrigin( m_Input->GetOrigin() );
-  input2->SetSpacing( m_Input->GetSpacing() );
-  input2->CopyInformation( m_Input );
-  input2->Allocate();
-
-  itk::ImageRegionIteratorWithIndex< ImageType > it1( m_Input,
-        m_Input->GetLargestPossibleRegion() );
-  itk::ImageRegionIterator< ImageType > it2( input2,
-        input2->GetLargestPossibleRegion() );
+  typedef itk::tube::NJetVesselEnhancementImageFilter< ImageType >
+    FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( m_Input );
+  filter->SetScaleMin( scaleMin );
+  filter->SetScaleMax( scaleMax );
+  filter->SetNumberOfScales( static_cast< unsigned int >( numScales ) );
+  filter->SetUseRecursiveGaussian( useRecursiveGaussian );
+  filter->SetSlabSize( 64 );
+
+  typedef VesselEnhancementScaleWatcher< FilterType > WatcherType;
+  typename WatcherType::Pointer watcher = WatcherType::New();
+  filter->AddObserver( itk::IterationEvent(), watcher );
+  filter->Update();
 
-  double ridgeness = 0;
-  double intensity = 0;
-  double scale = scaleMin;
-  std::cout << "   Processing scale " << scale << std::endl;
-  it1.GoToBegin();
-  it2.GoToBegin();
-  typename ImageFunctionType::ContinuousIndexType cIndx;
-  while( !it1.IsAtEnd() )
-    {
-    for( unsigned int d=0; d<ImageType::ImageDimension; ++d )
-      {
-      cIndx[d] = it1.GetIndex()[d];
-      }
-    ridgeness = imFunc->RidgenessAtContinuousIndex( cIndx, scale );
-    intensity = imFunc->GetMostRecentIntensity();
-    double val = ridgeness * intensity;
-    it2.Set( ( PixelType )val );
-    ++it1;
-    ++it2;
-    }
-  for( unsigned int i=1; i<numScales; i++ )
-    {
-    scale = std::exp( std::log( scaleMin ) + i * logScaleStep );
-    std::cout << "   Processing scale " << scale << std::endl;
-    it1.GoToBegin();
-    it2.GoToBegin();
-    while( !it1.IsAtEnd() )
-      {
-      for( unsigned int d=0; d<ImageType::ImageDimension; ++d )
-        {
-        cIndx[d] = it1.GetIndex()[d];
-        }
-      ridgeness = imFunc->RidgenessAtContinuousIndex( cIndx, scale );
-      intensity = imFunc->GetMostRecentIntensity();
-      double val = ridgeness * intensity;
-      if( val > it2.Get() )
-        {
-        it2.Set( ( PixelType )val );
-        }
-      ++it1;
-      ++it2;
-      }
-    }
-  it1.GoToBegin();
-  it2.GoToBegin();
-  while( !it1.IsAtEnd() )
-    {
-    it1.Set( it2.Get() );
-    ++it1;
-    ++it2;
-    }
+  m_Input = filter->GetOutput();
 }
 
 template< unsigned int VDimension >
@@ -84,6 +84,14 @@ public:
 
 protected:
 
+  /** Sparse class PDFs are stored as a MetaIO header followed by the
+   *   bin keys and then the bin densities, in the byte order of the
+   *   writing system. */
+  bool ReadSparsePDF( const char * _fileName, unsigned int _classNum );
+
+  bool WriteSparsePDF( const char * _fileName,
+    unsigned int _classNum ) const;
+
   typename PDFSegmenterType::Pointer  m_PDFSegmenter;
 
 }; // End class PDFSegmenterParzenIO
@@ -276,6 +276,10 @@ Read( const char * _headerName )
   MET_InitReadField( mF, "ForceClassification", MET_STRING, true );
   metaFields.push_back( mF );
 
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "SparsePDF", MET_STRING, false );
+  metaFields.push_back( mF );
+
   mF = new MET_FieldRecordType;
   MET_InitReadField( mF, "ObjectPDFFile", MET_STRING, true );
   metaFields.push_back( mF );
@@ -436,6 +440,15 @@ Read( const char * _headerName )
     m_PDFSegmenter->SetForceClassification( false );
     }
 
+  bool sparsePDF = false;
+  mF = MET_GetFieldRecord( "SparsePDF", &metaFields );
+  if( mF && mF->defined && ( ( ( char * )( mF->value ) )[0] == 'T'
+    || ( ( char * )( mF->value ) )[0] == 't' ) )
+    {
+    sparsePDF = true;
+    }
+  m_PDFSegmenter->SetUseSparsePDFs( sparsePDF );
+
   mF = MET_GetFieldRecord( "ObjectPDFFile", &metaFields );
   std::string str = ( char * )( mF->value );
   std::vector< std::string > fileName;
@@ -462,6 +475,20 @@ Read( const char * _headerName )
     MET_GetFilePath( _headerName, filePath );
     std::string fullFileName = filePath + fileName[i];
 
+    if( sparsePDF )
+      {
+      if( !this->ReadSparsePDF( fullFileName.c_str(), i ) )
+        {
+        for( unsigned int f=0; f<metaFields.size(); ++f )
+          {
+          delete metaFields[f];
+          }
+        metaFields.clear();
+        return false;
+        }
+      continue;
+      }
+
     MetaClassPDF pdfClassReader( fullFileName.c_str() );
 
     typename pdfImageType::Pointer img = pdfImageType::New();
@@ -685,6 +712,26 @@ Write( const char * _headerName )
     strlen( tmpC ), tmpC );
   metaFields.push_back( mF );
 
+  bool sparsePDF = m_PDFSegmenter->GetUseSparsePDFs();
+  if( sparsePDF )
+    {
+    strcpy( tmpC, "True" );
+    }
+  else
+    {
+    strcpy( tmpC, "False" );
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "SparsePDF", MET_STRING,
+    strlen( tmpC ), tmpC );
+  metaFields.push_back( mF );
+
+  std::string pdfFileSuffix = ".mha";
+  if( sparsePDF )
+    {
+    pdfFileSuffix = ".spdf";
+    }
+
   std::string filePath;
   MET_GetFilePath( _headerName, filePath );
   int skip = strlen( filePath.c_str() );
@@ -702,7 +749,7 @@ Write( const char * _headerName )
     std::string objectFileName;
     std::ostringstream zeroPadNum;
     zeroPadNum << std::setw(2) << std::setfill( '0' ) << i;
-    objectFileName  = shortFileName + zeroPadNum.str() + ".mha";
+    objectFileName  = shortFileName + zeroPadNum.str() + pdfFileSuffix;
     tmpString = tmpString + objectFileName;
     if( i < nObjects-1 )
       {
@@ -735,7 +782,23 @@ Write( const char * _headerName )
     return false;
     }
 
-  for( unsigned int i = 0; i < nObjects; ++i )
+  for( unsigned int i = 0; sparsePDF && i < nObjects; ++i )
+    {
+    std::ostringstream oss;
+    oss << fullFileName << std::setw(2) << std::setfill('0') << i
+      << pdfFileSuffix;
+    if( !this->WriteSparsePDF( oss.str().c_str(), i ) )
+      {
+      for( unsigned int f=0; f<metaFields.size(); ++f )
+        {
+        delete metaFields[f];
+        }
+      metaFields.clear();
+      return false;
+      }
+    }
+
+  for( unsigned int i = 0; !sparsePDF && i < nObjects; ++i )
     {
     MetaClassPDF pdfClassWriter( m_PDFSegmenter->GetNumberOfFeatures(),
       m_PDFSegmenter->GetNumberOfBinsPerFeature(),
@@ -785,6 +848,222 @@ Write( const char * _headerName )
   return true;
 }
 
+template< class TImage, class TLabelMap >
+bool PDFSegmenterParzenIO< TImage, TLabelMap >::
+ReadSparsePDF( const char * _fileName, unsigned int _classNum )
+{
+  typedef typename PDFSegmenterType::SparsePDFType    SparsePDFType;
+  typedef typename PDFSegmenterType::SparsePDFKeyType SparsePDFKeyType;
+  typedef typename PDFSegmenterType::PDFPixelType     PDFPixelType;
+
+  std::vector< MET_FieldRecordType * > metaFields;
+
+  MET_FieldRecordType * mF;
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "NFeatures", MET_INT, true );
+  metaFields.push_back( mF );
+  int nFeaturesRec = MET_GetFieldRecordNumber( "NFeatures", &metaFields );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "BinsPerFeature", MET_INT_ARRAY, true,
+    nFeaturesRec );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "BinaryDataByteOrderMSB", MET_STRING, true );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "NBins", MET_INT, true );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitReadField( mF, "ElementDataFile", MET_STRING, true );
+  mF->terminateRead = true;
+  metaFields.push_back( mF );
+
+  std::ifstream readStream;
+  readStream.open( _fileName, std::ios::binary | std::ios::in );
+
+  bool result = readStream.rdbuf()->is_open();
+  if( !result )
+    {
+    std::cerr << "PDFSegmenterParzenIO: Could not open " << _fileName
+      << std::endl;
+    }
+  else if( !MET_Read( readStream, &metaFields ) )
+    {
+    std::cerr << "PDFSegmenterParzenIO: ReadSparsePDF: MET_Read Failed"
+      << std::endl;
+    result = false;
+    }
+
+  unsigned int numFeatures = m_PDFSegmenter->GetNumberOfFeatures();
+  if( result )
+    {
+    mF = MET_GetFieldRecord( "NFeatures", &metaFields );
+    if( static_cast< unsigned int >( mF->value[0] ) != numFeatures )
+      {
+      std::cout << "ERROR: Number of features mismatch" << std::endl;
+      result = false;
+      }
+    }
+  if( result )
+    {
+    mF = MET_GetFieldRecord( "BinsPerFeature", &metaFields );
+    for( unsigned int j = 0; j < numFeatures; ++j )
+      {
+      if( static_cast< unsigned int >( mF->value[j] ) !=
+        m_PDFSegmenter->GetNumberOfBinsPerFeature()[j] )
+        {
+        std::cout << "ERROR: Number of bins mismatch" << std::endl;
+        result = false;
+        break;
+        }
+      }
+    }
+  if( result )
+    {
+    mF = MET_GetFieldRecord( "BinaryDataByteOrderMSB", &metaFields );
+    bool fileMSB = ( ( ( char * )( mF->value ) )[0] == 'T'
+      || ( ( char * )( mF->value ) )[0] == 't' );
+    if( fileMSB != MET_SystemByteOrderMSB() )
+      {
+      std::cout << "ERROR: Sparse PDF byte order does not match this system"
+        << std::endl;
+      result = false;
+      }
+    }
+
+  if( result )
+    {
+    mF = MET_GetFieldRecord( "NBins", &metaFields );
+    const size_t nBins = static_cast< size_t >( mF->value[0] );
+
+    std::vector< SparsePDFKeyType > keys( nBins );
+    std::vector< PDFPixelType > values( nBins );
+    readStream.read( reinterpret_cast< char * >( keys.data() ),
+      nBins * sizeof( SparsePDFKeyType ) );
+    readStream.read( reinterpret_cast< char * >( values.data() ),
+      nBins * sizeof( PDFPixelType ) );
+    if( !readStream )
+      {
+      std::cout << "ERROR: Sparse PDF data is truncated" << std::endl;
+      result = false;
+      }
+    else
+      {
+      SparsePDFType pdf;
+      pdf.reserve( nBins );
+      for( size_t b = 0; b < nBins; ++b )
+        {
+        pdf[ keys[b] ] = values[b];
+        }
+      m_PDFSegmenter->SetClassSparsePDF( _classNum, pdf );
+      }
+    }
+
+  for( unsigned int i=0; i<metaFields.size(); ++i )
+    {
+    delete metaFields[i];
+    }
+  metaFields.clear();
+
+  return result;
+}
+
+template< class TImage, class TLabelMap >
+bool PDFSegmenterParzenIO< TImage, TLabelMap >::
+WriteSparsePDF( const char * _fileName, unsigned int _classNum ) const
+{
+  typedef typename PDFSegmenterType::SparsePDFType    SparsePDFType;
+  typedef typename PDFSegmenterType::SparsePDFKeyType SparsePDFKeyType;
+  typedef typename PDFSegmenterType::PDFPixelType     PDFPixelType;
+
+  const SparsePDFType & pdf = m_PDFSegmenter->GetClassSparsePDF(
+    _classNum );
+
+  std::vector< MET_FieldRecordType * > metaFields;
+
+  unsigned int numFeatures = m_PDFSegmenter->GetNumberOfFeatures();
+
+  MET_FieldRecordType * mF = new MET_FieldRecordType;
+  MET_InitWriteField( mF, "NFeatures", MET_INT, numFeatures );
+  metaFields.push_back( mF );
+
+  int tmpI[4096];
+  for( unsigned int i = 0; i < numFeatures; ++i )
+    {
+    tmpI[i] = m_PDFSegmenter->GetNumberOfBinsPerFeature()[i];
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< int >( mF, "BinsPerFeature", MET_INT_ARRAY,
+    numFeatures, tmpI );
+  metaFields.push_back( mF );
+
+  char tmpC[4096];
+  if( MET_SystemByteOrderMSB() )
+    {
+    strcpy( tmpC, "True" );
+    }
+  else
+    {
+    strcpy( tmpC, "False" );
+    }
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "BinaryDataByteOrderMSB",
+    MET_STRING, strlen( tmpC ), tmpC );
+  metaFields.push_back( mF );
+
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField( mF, "NBins", MET_INT, pdf.size() );
+  metaFields.push_back( mF );
+
+  strcpy( tmpC, "LOCAL" );
+  mF = new MET_FieldRecordType;
+  MET_InitWriteField< const char >( mF, "ElementDataFile", MET_STRING,
+    strlen( tmpC ), tmpC );
+  metaFields.push_back( mF );
+
+  std::ofstream writeStream;
+  writeStream.open( _fileName, std::ios::binary | std::ios::out );
+
+  bool result = MET_Write( writeStream, & metaFields );
+  if( !result )
+    {
+    std::cerr << "PDFSegmenterParzenIO: WriteSparsePDF: MET_Write Failed"
+      << std::endl;
+    }
+  else
+    {
+    std::vector< SparsePDFKeyType > keys;
+    std::vector< PDFPixelType > values;
+    keys.reserve( pdf.size() );
+    values.reserve( pdf.size() );
+    typename SparsePDFType::const_iterator pdfIt = pdf.begin();
+    while( pdfIt != pdf.end() )
+      {
+      keys.push_back( pdfIt->first );
+      values.push_back( pdfIt->second );
+      ++pdfIt;
+      }
+    writeStream.write( reinterpret_cast< const char * >( keys.data() ),
+      keys.size() * sizeof( SparsePDFKeyType ) );
+    writeStream.write( reinterpret_cast< const char * >( values.data() ),
+      values.size() * sizeof( PDFPixelType ) );
+    result = static_cast< bool >( writeStream );
+    }
+
+  for( unsigned int i=0; i<metaFields.size(); ++i )
+    {
+    delete metaFields[i];
+    }
+  metaFields.clear();
+
+  return result;
+}
+
 } // End namespace tube
 
 } // End namespace itk
@@ -62,6 +62,7 @@ public:
     TImage::ImageDimension );
 
   typedef typename Superclass::IndexType         IndexType;
+  typedef typename Superclass::RegionType        RegionType;
 
   typedef typename Superclass::FeatureValueType  FeatureValueType;
   typedef typename Superclass::FeatureVectorType FeatureVectorType;
@@ -125,6 +126,12 @@ public:
   virtual typename FeatureImageType::Pointer GetFeatureImage(
     unsigned int fNum ) const override;
 
+  typedef typename Superclass::FeatureImageListType FeatureImageListType;
+
+  /** Compute the images of every basis at once, evaluating the input
+   *   features of each block once for all the bases. */
+  virtual FeatureImageListType GetFeatureImages( void ) const override;
+
   void   SetInputWhitenMeans( const ValueListType & means );
   const  ValueListType & GetInputWhitenMeans( void ) const;
   void   SetInputWhitenStdDevs( const ValueListType & stdDevs );
@@ -145,6 +152,9 @@ public:
   virtual FeatureValueType  GetFeatureVectorValue( const IndexType & indx,
     unsigned int fNum ) const override;
 
+  virtual void FillFeatureBlock( const RegionType & region,
+    FeatureValueType * out ) const override;
+
 protected:
 
   BasisFeatureVectorGenerator( void );
@@ -152,8 +162,31 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  void WhitenStatisticsModified( void ) override;
+
 private:
 
+  /** Basis fNum with the output whitening folded in, so that
+   *   weights.x + offset is the whitened feature value.  The weights are
+   *   returned from the whitened basis matrix when it is up to date, and
+   *   are otherwise computed into weights. */
+  const ValueType * GetWhitenedBasis( unsigned int fNum,
+    VectorType & weights, ValueType & offset ) const;
+
+  /** Fold the output whitening into the basis, one row per feature.
+   *   Called whenever the basis, the number of features or the
+   *   whitening statistics change. */
+  void UpdateWhitenedBasis( void );
+
+  /** Zero the voxels of image whose label is not one of the object ids */
+  void MaskFeatureImage( FeatureImageType * image ) const;
+
+  /** Project a feature-major block of input features onto basis fNum and
+   *   whiten the result. */
+  void ProjectFeatureBlock( const FeatureValueType * inputBlock,
+    SizeValueType numVoxels, unsigned int fNum,
+    FeatureValueType * out ) const;
+
   // Purposely not implemented
   BasisFeatureVectorGenerator( const Self & );
   void operator = ( const Self & );      // Purposely not implemented
@@ -175,6 +208,9 @@ private:
 
   MatrixType                      m_BasisMatrix;
   VectorType                      m_BasisValues;
+
+  MatrixType                      m_WhitenedBasisMatrix;
+  VectorType                      m_WhitenedBasisOffsets;
 }; // End class BasisFeatureVectorGenerator
 
 } // End namespace tube
@@ -30,9 +30,11 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 
@@ -64,6 +66,9 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 
   m_BasisValues.set_size( 0 );
   m_BasisMatrix.set_size( 0, 0 );
+
+  m_WhitenedBasisMatrix.set_size( 0, 0 );
+  m_WhitenedBasisOffsets.set_size( 0 );
 }
 
 template< class TImage, class TLabelMap >
@@ -81,6 +86,7 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 ::SetInputFeatureVectorGenerator( FeatureVectorGeneratorType * fGen )
 {
   m_InputFeatureVectorGenerator = fGen;
+  this->UpdateWhitenedBasis();
 }
 
 template< class TImage, class TLabelMap >
@@ -288,6 +294,7 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 ::SetBasisMatrix( const MatrixType & mat )
 {
   m_BasisMatrix = mat;
+  this->UpdateWhitenedBasis();
 }
 
 template< class TImage, class TLabelMap >
@@ -298,6 +305,7 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
   if( basisNum < m_InputFeatureVectorGenerator->GetNumberOfFeatures() )
     {
     m_BasisMatrix.set_column( basisNum, vec );
+    this->UpdateWhitenedBasis();
     }
   else
     {
@@ -333,58 +341,36 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     featureImage->CopyInformation( this->m_InputImageList[0] );
     featureImage->Allocate();
 
-    ImageIteratorType itBasisIm( featureImage,
-      featureImage->GetLargestPossibleRegion() );
+    const unsigned int numInputFeatures =
+      m_InputFeatureVectorGenerator->GetNumberOfFeatures();
 
-    if( m_LabelMap.IsNotNull() )
+    std::vector< RegionType > blocks = Superclass::SplitRegionIntoBlocks(
+      region, 1 << 16 );
+    std::vector< FeatureValueType > inputBlock;
+    std::vector< FeatureValueType > featureBlock;
+    for( size_t b = 0; b < blocks.size(); ++b )
       {
-      const unsigned int numClasses = this->GetNumberOfObjectIds();
-      typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
-        ConstLabelMapIteratorType;
-      ConstLabelMapIteratorType itInMask( m_LabelMap,
-        m_LabelMap->GetLargestPossibleRegion() );
-      bool found = false;
-      ObjectIdType previousMaskValue =
-        static_cast<ObjectIdType>( itInMask.Get() ) + 1;
+      const SizeValueType numVoxels = blocks[b].GetNumberOfPixels();
+      inputBlock.resize( numInputFeatures * numVoxels );
+      featureBlock.resize( numVoxels );
+      m_InputFeatureVectorGenerator->FillFeatureBlock( blocks[b],
+        inputBlock.data() );
+      this->ProjectFeatureBlock( inputBlock.data(), numVoxels, featureNum,
+        featureBlock.data() );
+
+      ImageIteratorType itBasisIm( featureImage, blocks[b] );
+      typename std::vector< FeatureValueType >::const_iterator itFeature =
+        featureBlock.begin();
       while( !itBasisIm.IsAtEnd() )
         {
-        ObjectIdType maskVal = static_cast<ObjectIdType>( itInMask.Get() );
-        if( maskVal != previousMaskValue )
-          {
-          found = false;
-          previousMaskValue = maskVal;
-          for( unsigned int c = 0; c < numClasses; c++ )
-            {
-            if( maskVal == m_ObjectIdList[c] )
-              {
-              found = true;
-              break;
-              }
-            }
-          }
-        if( !found )
-          {
-          itBasisIm.Set( 0 );
-          }
-        else
-          {
-          IndexType indx = itBasisIm.GetIndex();
-          itBasisIm.Set( this->GetFeatureVectorValue( indx, featureNum ) );
-          }
-        ++itBasisIm;
-        ++itInMask;
-        }
-      }
-    else
-      {
-      while( !itBasisIm.IsAtEnd() )
-        {
-        IndexType indx = itBasisIm.GetIndex();
-        itBasisIm.Set( this->GetFeatureVectorValue( indx, featureNum ) );
+        itBasisIm.Set( *itFeature );
         ++itBasisIm;
+        ++itFeature;
         }
       }
 
+    this->MaskFeatureImage( featureImage );
+
     return featureImage;
     }
   else
@@ -393,6 +379,67 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+typename BasisFeatureVectorGenerator< TImage, TLabelMap >
+::FeatureImageListType
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::GetFeatureImages( void ) const
+{
+  FeatureImageListType featureImages = Superclass::GetFeatureImages();
+  for( unsigned int i = 0; i < featureImages.size(); ++i )
+    {
+    this->MaskFeatureImage( featureImages[i] );
+    }
+  return featureImages;
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::MaskFeatureImage( FeatureImageType * image ) const
+{
+  if( m_LabelMap.IsNull() )
+    {
+    return;
+    }
+
+  const unsigned int numClasses = this->GetNumberOfObjectIds();
+
+  typedef itk::ImageRegionConstIterator< LabelMapType >
+    ConstLabelMapIteratorType;
+  typedef itk::ImageRegionIterator< FeatureImageType > ImageIteratorType;
+
+  ImageIteratorType itBasisIm( image, image->GetLargestPossibleRegion() );
+  ConstLabelMapIteratorType itInMask( m_LabelMap,
+    image->GetLargestPossibleRegion() );
+  bool found = false;
+  ObjectIdType previousMaskValue =
+    static_cast<ObjectIdType>( itInMask.Get() ) + 1;
+  while( !itBasisIm.IsAtEnd() )
+    {
+    ObjectIdType maskVal = static_cast<ObjectIdType>( itInMask.Get() );
+    if( maskVal != previousMaskValue )
+      {
+      found = false;
+      previousMaskValue = maskVal;
+      for( unsigned int c = 0; c < numClasses; c++ )
+        {
+        if( maskVal == m_ObjectIdList[c] )
+          {
+          found = true;
+          break;
+          }
+        }
+      }
+    if( !found )
+      {
+      itBasisIm.Set( 0 );
+      }
+    ++itBasisIm;
+    ++itInMask;
+    }
+}
+
 template< class TImage, class TLabelMap >
 void
 BasisFeatureVectorGenerator< TImage, TLabelMap >
@@ -724,6 +771,8 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     ++basisNum;
     }
 
+  this->UpdateWhitenedBasis();
+
   if( this->GetUpdateWhitenStatisticsOnUpdate() )
     {
     this->UpdateWhitenStatistics();
@@ -736,6 +785,7 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 ::SetNumberOfLDABasisToUseAsFeatures( unsigned int numBasisUsed )
 {
   m_NumberOfLDABasisToUseAsFeatures = numBasisUsed;
+  this->UpdateWhitenedBasis();
 }
 
 template< class TImage, class TLabelMap >
@@ -744,6 +794,7 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
 ::SetNumberOfPCABasisToUseAsFeatures( unsigned int numBasisUsed )
 {
   m_NumberOfPCABasisToUseAsFeatures = numBasisUsed;
+  this->UpdateWhitenedBasis();
 }
 
 template< class TImage, class TLabelMap >
@@ -784,23 +835,21 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
   FeatureVectorType featureVector;
   featureVector.set_size( numFeatures );
 
-  VectorType vBasis;
-  FeatureVectorType vInput;
+  // The input features are shared by every basis, so evaluate them once
+  FeatureVectorType vInput =
+    m_InputFeatureVectorGenerator->GetFeatureVector( indx );
 
+  VectorType weights;
+  ValueType offset;
   for( unsigned int i = 0; i < numFeatures; ++i )
     {
-    vBasis = this->GetBasisVector( i );
-    vInput = m_InputFeatureVectorGenerator->GetFeatureVector( indx );
-    featureVector[i] = 0;
+    const ValueType * w = this->GetWhitenedBasis( i, weights, offset );
+    ValueType featureValue = offset;
     for( unsigned int j = 0; j < numInputFeatures; j++ )
       {
-      featureVector[i] += vBasis[j] * vInput[j];
-      }
-    if( this->GetWhitenStdDev( i ) > 0 )
-      {
-      featureVector[i] = ( featureVector[i] - this->GetWhitenMean( i ) )
-        / this->GetWhitenStdDev( i );
+      featureValue += w[j] * vInput[j];
       }
+    featureVector[i] = static_cast< FeatureValueType >( featureValue );
     }
   return featureVector;
 }
@@ -814,25 +863,22 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
   const unsigned int numInputFeatures =
     m_InputFeatureVectorGenerator->GetNumberOfFeatures();
 
-  VectorType vBasis;
-  FeatureVectorType vInput;
-
   if( featureNum < this->GetNumberOfFeatures() )
     {
-    vBasis = this->GetBasisVector( featureNum );
-    vInput = m_InputFeatureVectorGenerator->GetFeatureVector( indx );
+    VectorType weights;
+    ValueType offset;
+    const ValueType * w = this->GetWhitenedBasis( featureNum, weights,
+      offset );
 
-    FeatureValueType featureValue = 0;
+    FeatureVectorType vInput =
+      m_InputFeatureVectorGenerator->GetFeatureVector( indx );
+
+    ValueType featureValue = offset;
     for( unsigned int j = 0; j < numInputFeatures; j++ )
       {
-      featureValue += vBasis[j] * vInput[j];
-      }
-    if( this->GetWhitenStdDev( featureNum ) > 0 )
-      {
-      featureValue = ( featureValue - this->GetWhitenMean( featureNum ) )
-        / this->GetWhitenStdDev( featureNum );
+      featureValue += w[j] * vInput[j];
       }
-    return featureValue;
+    return static_cast< FeatureValueType >( featureValue );
     }
   else
     {
@@ -843,6 +889,147 @@ BasisFeatureVectorGenerator< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+const typename BasisFeatureVectorGenerator< TImage, TLabelMap >::ValueType *
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::GetWhitenedBasis( unsigned int fNum, VectorType & weights,
+  ValueType & offset ) const
+{
+  const unsigned int numInputFeatures =
+    m_InputFeatureVectorGenerator->GetNumberOfFeatures();
+
+  if( fNum < m_WhitenedBasisMatrix.rows()
+    && m_WhitenedBasisMatrix.rows() == this->GetNumberOfFeatures()
+    && m_WhitenedBasisMatrix.cols() == numInputFeatures )
+    {
+    offset = m_WhitenedBasisOffsets[fNum];
+    return m_WhitenedBasisMatrix[fNum];
+    }
+
+  weights.set_size( numInputFeatures );
+  for( unsigned int j = 0; j < numInputFeatures; j++ )
+    {
+    weights[j] = m_BasisMatrix[j][fNum];
+    }
+  offset = 0;
+
+  // ( b.x - mean ) / stdDev == ( b / stdDev ).x - mean / stdDev
+  const ValueType stdDev = this->GetWhitenStdDev( fNum );
+  if( stdDev > 0 )
+    {
+    weights /= stdDev;
+    offset = -this->GetWhitenMean( fNum ) / stdDev;
+    }
+  return weights.data_block();
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::UpdateWhitenedBasis( void )
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  if( m_InputFeatureVectorGenerator.IsNull()
+    || m_BasisMatrix.cols() < numFeatures
+    || m_BasisMatrix.rows()
+      != m_InputFeatureVectorGenerator->GetNumberOfFeatures() )
+    {
+    m_WhitenedBasisMatrix.set_size( 0, 0 );
+    m_WhitenedBasisOffsets.set_size( 0 );
+    return;
+    }
+
+  const unsigned int numInputFeatures = m_BasisMatrix.rows();
+  m_WhitenedBasisMatrix.set_size( numFeatures, numInputFeatures );
+  m_WhitenedBasisOffsets.set_size( numFeatures );
+  m_WhitenedBasisOffsets.fill( 0 );
+  for( unsigned int f = 0; f < numFeatures; ++f )
+    {
+    const ValueType stdDev = this->GetWhitenStdDev( f );
+    for( unsigned int j = 0; j < numInputFeatures; j++ )
+      {
+      m_WhitenedBasisMatrix[f][j] = m_BasisMatrix[j][f];
+      if( stdDev > 0 )
+        {
+        m_WhitenedBasisMatrix[f][j] /= stdDev;
+        }
+      }
+    if( stdDev > 0 )
+      {
+      m_WhitenedBasisOffsets[f] = -this->GetWhitenMean( f ) / stdDev;
+      }
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::WhitenStatisticsModified( void )
+{
+  this->UpdateWhitenedBasis();
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::ProjectFeatureBlock( const FeatureValueType * inputBlock,
+  SizeValueType numVoxels, unsigned int fNum, FeatureValueType * out ) const
+{
+  if( fNum >= this->GetNumberOfFeatures() )
+    {
+    std::cerr << "Basis feature " << fNum << " does not exist."
+      << std::endl;
+    std::fill( out, out + numVoxels, 0 );
+    return;
+    }
+
+  const unsigned int numInputFeatures =
+    m_InputFeatureVectorGenerator->GetNumberOfFeatures();
+
+  VectorType weights;
+  ValueType offset;
+  const ValueType * w = this->GetWhitenedBasis( fNum, weights, offset );
+
+  std::vector< ValueType > featureSum( numVoxels, offset );
+  for( unsigned int j = 0; j < numInputFeatures; j++ )
+    {
+    const ValueType weight = w[j];
+    const FeatureValueType * inputF = inputBlock + j * numVoxels;
+    for( SizeValueType v = 0; v < numVoxels; v++ )
+      {
+      featureSum[v] += weight * inputF[v];
+      }
+    }
+
+  for( SizeValueType v = 0; v < numVoxels; v++ )
+    {
+    out[v] = static_cast< FeatureValueType >( featureSum[v] );
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+BasisFeatureVectorGenerator< TImage, TLabelMap >
+::FillFeatureBlock( const RegionType & region, FeatureValueType * out ) const
+{
+  const unsigned int numInputFeatures =
+    m_InputFeatureVectorGenerator->GetNumberOfFeatures();
+
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  const SizeValueType numVoxels = region.GetNumberOfPixels();
+
+  std::vector< FeatureValueType > inputBlock( numInputFeatures * numVoxels );
+  m_InputFeatureVectorGenerator->FillFeatureBlock( region,
+    inputBlock.data() );
+
+  for( unsigned int i = 0; i < numFeatures; ++i )
+    {
+    this->ProjectFeatureBlock( inputBlock.data(), numVoxels, i,
+      out + i * numVoxels );
+    }
+}
+
 template< class TImage, class TLabelMap >
 void
 BasisFeatureVectorGenerator< TImage, TLabelMap >
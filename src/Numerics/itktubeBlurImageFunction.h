@@ -105,6 +105,14 @@ public:
    * Get the Extent */
   itkGetMacro( Extent, double );
 
+  /**
+   * Limit the kernel to the sphere of radius Scale*Extent (default).  When
+   * off, EvaluateAtContinuousIndex uses the full separable kernel box,
+   * which reduces to one weighted sum per image row. */
+  itkSetMacro( UseSphericalKernel, bool );
+  itkGetMacro( UseSphericalKernel, bool );
+  itkBooleanMacro( UseSphericalKernel );
+
   /**
    * Get the Spacing */
   itkGetMacro( Spacing, SpacingType );
@@ -140,6 +148,7 @@ private:
   SpacingType             m_OriginalSpacing;
   double                  m_Scale;
   double                  m_Extent;
+  bool                    m_UseSphericalKernel;
   KernelWeightsListType   m_KernelWeights;
   KernelXListType         m_KernelX;
   IndexType               m_KernelMin;
@@ -32,6 +32,7 @@ limitations under the License.
 
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 namespace itk
 {
@@ -53,6 +54,7 @@ BlurImageFunction<TInputImage>
 
   m_Scale = 1;
   m_Extent = 3.1;
+  m_UseSphericalKernel = true;
 
   m_KernelTotal = 0;
   m_KernelMin.Fill( 0 );
@@ -139,6 +141,8 @@ BlurImageFunction<TInputImage>
   os << indent << "OriginalSpacing = " << m_OriginalSpacing << std::endl;
   os << indent << "Scale = " << m_Scale << std::endl;
   os << indent << "Extent = " << m_Extent << std::endl;
+  os << indent << "UseSphericalKernel = " << m_UseSphericalKernel
+    << std::endl;
 
   os << indent << "KernelWeights.size = " << m_KernelWeights.size()
     << std::endl;
@@ -420,134 +424,143 @@ BlurImageFunction<TInputImage>
     return 0.0;
     }
 
-  double w;
-  double res = 0;
-  double wTotal = 0;
   double gfact = -0.5/( m_Scale*m_Scale );
   double kernrad = m_Scale*m_Extent*m_Scale*m_Extent;
 
-  IndexType kernelX;
-
+  // Clip the kernel box to the image.  Interior points are not clipped.
+  IndexType minX;
+  IndexType maxX;
   bool boundary = false;
   for( unsigned int i=0; i<ImageDimension; i++ )
     {
-    if( ( int )( point[i] )+m_KernelMin[i]<m_ImageIndexMin[i]
-      || ( int )( point[i] )+m_KernelMax[i]>m_ImageIndexMax[i] )
+    minX[i] = ( int )( point[i] )+m_KernelMin[i];
+    maxX[i] = ( int )( point[i] )+m_KernelMax[i];
+    if( minX[i] < m_ImageIndexMin[i] )
       {
+      minX[i] = m_ImageIndexMin[i];
       boundary = true;
-      break;
       }
-    }
-
-  if( !boundary )
-    {
-    if( ImageDimension == 3 )
+    if( maxX[i] > m_ImageIndexMax[i] )
       {
-      for( int z = m_KernelMin[2]; z<=m_KernelMax[2]; z++ )
-        {
-        kernelX[2] = ( int )( point[2] )+z;
-        double distZ = ( kernelX[2]-point[2] )*m_Spacing[2];
-        distZ = distZ * distZ;
-        for( int y = m_KernelMin[1]; y<=m_KernelMax[1]; y++ )
-          {
-          kernelX[1] = ( int )( point[1] )+y;
-          double distY = ( kernelX[1]-point[1] )*m_Spacing[1];
-          distY = distY * distY + distZ;
-          for( int x = m_KernelMin[0]; x<=m_KernelMax[0]; x++ )
-            {
-            kernelX[0] = ( int )( point[0] )+x;
-            double distX = ( kernelX[0]-point[0] )*m_Spacing[0];
-            double dist = distX * distX + distY;
-            if( dist <= kernrad )
-              {
-              w = std::exp( gfact*dist );
-              wTotal += w;
-              res += this->m_Image->GetPixel( kernelX ) * w;
-              }
-            }
-          }
-        }
+      maxX[i] = m_ImageIndexMax[i];
+      boundary = true;
       }
-    else if( ImageDimension == 2 )
+    if( minX[i] > maxX[i] )
       {
-      for( int y = m_KernelMin[1]; y<=m_KernelMax[1]; y++ )
-        {
-        kernelX[1] = ( int )( point[1] )+y;
-        double distY = ( kernelX[1]-point[1] )*m_Spacing[1];
-        distY = distY * distY;
-        for( int x = m_KernelMin[0]; x<=m_KernelMax[0]; x++ )
-          {
-          kernelX[0] = ( int )( point[0] )+x;
-          double distX = ( kernelX[0]-point[0] )*m_Spacing[0];
-          double dist = distX * distX + distY;
-          if( dist <= kernrad )
-            {
-            w = std::exp( gfact*dist );
-            wTotal += w;
-            res += this->m_Image->GetPixel( kernelX ) * w;
-            }
-          }
-        }
+      return 0;
       }
     }
-  else
+  if( boundary && this->GetDebug() )
     {
-    if( this->GetDebug() )
+    std::cout << "  Boundary point" << std::endl;
+    }
+
+  // The Gaussian separates into per-axis factors, so the 1D weights and
+  //   squared distances are computed once per call rather than calling
+  //   std::exp for every voxel of the kernel box.  They are held on the
+  //   stack unless the clipped box is unusually large, so evaluation does
+  //   not allocate and stays reentrant.
+  unsigned int axisStart[ImageDimension];
+  unsigned int axisLength[ImageDimension];
+  unsigned int bufferLength = 0;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    axisStart[i] = bufferLength;
+    axisLength[i] = maxX[i] - minX[i] + 1;
+    bufferLength += axisLength[i];
+    }
+  const unsigned int maxStackBufferLength = 256;
+  double stackBuffer[2*maxStackBufferLength];
+  std::vector< double > heapBuffer;
+  double * axisWeight = stackBuffer;
+  if( bufferLength > maxStackBufferLength )
+    {
+    heapBuffer.resize( 2*bufferLength );
+    axisWeight = &( heapBuffer[0] );
+    }
+  double * axisDist = axisWeight + bufferLength;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    double * w = &( axisWeight[axisStart[i]] );
+    double * d = &( axisDist[axisStart[i]] );
+    for( unsigned int k=0; k<axisLength[i]; k++ )
       {
-      std::cout << "  Boundary point" << std::endl;
+      double dist = ( minX[i]+( int )k-point[i] )*m_Spacing[i];
+      d[k] = dist * dist;
+      w[k] = std::exp( gfact*d[k] );
       }
-    IndexType minX;
-    IndexType maxX;
-    for( unsigned int i=0; i<ImageDimension; i++ )
+    }
+
+  const double * wX = &( axisWeight[axisStart[0]] );
+  const double * dX = &( axisDist[axisStart[0]] );
+  const unsigned int lenX = axisLength[0];
+  double wXTotal = 0;
+  for( unsigned int k=0; k<lenX; k++ )
+    {
+    wXTotal += wX[k];
+    }
+
+  const typename InputImageType::PixelType * buffer =
+    this->m_Image->GetBufferPointer();
+
+  // Walk the rows (lines along x) of the clipped kernel box; each row is
+  //   contiguous in the image buffer.
+  double res = 0;
+  double wTotal = 0;
+  IndexType rowX = minX;
+  bool done = false;
+  while( !done )
+    {
+    double rowWeight = 1;
+    double rowDist = 0;
+    for( unsigned int i=1; i<ImageDimension; i++ )
       {
-      minX[i] = std::max( ( int )( ( int )( point[i] )+m_KernelMin[i] ),
-        ( int )( m_ImageIndexMin[i] ) );
-      maxX[i] = std::min( ( int )( ( int )( point[i] )+m_KernelMax[i] ),
-        ( int )( m_ImageIndexMax[i] ) );
+      unsigned int k = rowX[i] - minX[i];
+      rowWeight *= axisWeight[axisStart[i]+k];
+      rowDist += axisDist[axisStart[i]+k];
       }
 
-    if( ImageDimension == 3 )
+    const typename InputImageType::PixelType * row = buffer
+      + this->m_Image->ComputeOffset( rowX );
+    if( m_UseSphericalKernel )
       {
-      for( kernelX[2] = minX[2]; kernelX[2]<=maxX[2]; kernelX[2]++ )
+      if( rowDist <= kernrad )
         {
-        double distZ = ( kernelX[2]-point[2] )*m_Spacing[2];
-        distZ = distZ * distZ;
-        for( kernelX[1] = minX[1]; kernelX[1]<=maxX[1]; kernelX[1]++ )
+        double rowRes = 0;
+        double rowW = 0;
+        for( unsigned int k=0; k<lenX; k++ )
           {
-          double distY = ( kernelX[1]-point[1] )*m_Spacing[1];
-          distY = distY * distY + distZ;
-          for( kernelX[0] = minX[0]; kernelX[0]<=maxX[0]; kernelX[0]++ )
+          if( dX[k] + rowDist <= kernrad )
             {
-            double distX = ( kernelX[0]-point[0] )*m_Spacing[0];
-            double dist = distX * distX + distY;
-            if( dist <= kernrad )
-              {
-              w = std::exp( gfact*( dist ) );
-              wTotal += w;
-              res += this->m_Image->GetPixel( kernelX ) * w;
-              }
+            rowRes += row[k] * wX[k];
+            rowW += wX[k];
             }
           }
+        res += rowRes * rowWeight;
+        wTotal += rowW * rowWeight;
         }
       }
-    else if( ImageDimension == 2 )
+    else
       {
-      for( kernelX[1] = minX[1]; kernelX[1]<=maxX[1]; kernelX[1]++ )
+      double rowRes = 0;
+      for( unsigned int k=0; k<lenX; k++ )
         {
-        double distY = ( kernelX[1]-point[1] )*m_Spacing[1];
-        distY = distY * distY;
-        for( kernelX[0] = minX[0]; kernelX[0]<=maxX[0]; kernelX[0]++ )
-          {
-          double distX = ( kernelX[0]-point[0] )*m_Spacing[0];
-          double dist = distX * distX + distY;
-          if( dist <= kernrad )
-            {
-            w = std::exp( gfact*( dist ) );
-            wTotal += w;
-            res += this->m_Image->GetPixel( kernelX ) * w;
-            }
-          }
+        rowRes += row[k] * wX[k];
+        }
+      res += rowRes * rowWeight;
+      wTotal += wXTotal * rowWeight;
+      }
+
+    done = true;
+    for( unsigned int i=1; i<ImageDimension; i++ )
+      {
+      if( rowX[i] < maxX[i] )
+        {
+        ++rowX[i];
+        done = false;
+        break;
         }
+      rowX[i] = minX[i];
       }
     }
 
@@ -56,6 +56,7 @@ public:
   typedef std::vector< typename ImageType::ConstPointer >    ImageListType;
 
   typedef typename TImage::IndexType                    IndexType;
+  typedef typename TImage::RegionType                   RegionType;
 
   itkStaticConstMacro( ImageDimension, unsigned int,
     TImage::ImageDimension );
@@ -100,9 +101,32 @@ public:
   virtual FeatureValueType GetFeatureVectorValue(
     const IndexType & indx, unsigned int fNum ) const;
 
+  /** Compute the feature vectors of every voxel in region at once.
+   *   Values are written feature-major: feature f of the v-th voxel of
+   *   region (in raster order) is stored at out[ f * numVoxels + v ].
+   *   out must hold GetNumberOfFeatures() * numVoxels values.  Derived
+   *   classes that redefine GetFeatureVector must also redefine this
+   *   method. */
+  virtual void FillFeatureBlock( const RegionType & region,
+    FeatureValueType * out ) const;
+
+  /** Split region into sub-regions along its slowest dimension so that
+   *   each holds at most approximately maxVoxelsPerBlock voxels.  Used
+   *   to bound the memory of FillFeatureBlock buffers. */
+  static std::vector< RegionType > SplitRegionIntoBlocks(
+    const RegionType & region, SizeValueType maxVoxelsPerBlock );
+
   virtual typename FeatureImageType::Pointer GetFeatureImage(
     unsigned int num ) const;
 
+  typedef std::vector< typename FeatureImageType::Pointer >
+    FeatureImageListType;
+
+  /** Compute the images of every feature at once.  Each block of the
+   *   image is passed to FillFeatureBlock once, instead of once per
+   *   feature as when GetFeatureImage() is called for each feature. */
+  virtual FeatureImageListType GetFeatureImages( void ) const;
+
   virtual void Update( void );
 
 protected:
@@ -114,6 +138,10 @@ protected:
 
   void UpdateWhitenStatistics( void );
 
+  /** Called when the whitening statistics change, so that derived
+   *   classes can refresh values computed from them. */
+  virtual void WhitenStatisticsModified( void ) {}
+
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
 private:
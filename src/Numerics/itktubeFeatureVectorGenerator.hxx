@@ -32,9 +32,12 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
+#include <algorithm>
 #include <limits>
 #include <iostream>
 
@@ -73,6 +76,8 @@ FeatureVectorGenerator< TImage >
   m_WhitenStdDev.push_back( 1 );
   m_InputImageList.clear();
   m_InputImageList.push_back( img );
+  this->WhitenStatisticsModified();
+  this->Modified();
 }
 
 template< class TImage >
@@ -83,6 +88,8 @@ FeatureVectorGenerator< TImage >
   m_WhitenMean[id] = 0;
   m_WhitenStdDev[id] = 1;
   m_InputImageList[id] = img;
+  this->WhitenStatisticsModified();
+  this->Modified();
 }
 
 template< class TImage >
@@ -93,6 +100,8 @@ FeatureVectorGenerator< TImage >
   m_InputImageList.push_back( img );
   m_WhitenMean.push_back( 0 );
   m_WhitenStdDev.push_back( 1 );
+  this->WhitenStatisticsModified();
+  this->Modified();
 }
 
 template< class TImage >
@@ -134,6 +143,7 @@ FeatureVectorGenerator< TImage >
 ::SetWhitenMeans( const ValueListType & means )
 {
   m_WhitenMean = means;
+  this->WhitenStatisticsModified();
 }
 
 template< class TImage >
@@ -150,6 +160,7 @@ FeatureVectorGenerator< TImage >
 ::SetWhitenStdDevs( const ValueListType & stdDevs )
 {
   m_WhitenStdDev = stdDevs;
+  this->WhitenStatisticsModified();
 }
 
 template< class TImage >
@@ -168,6 +179,7 @@ FeatureVectorGenerator< TImage >
   if( num < m_WhitenMean.size() )
     {
     m_WhitenMean[num] = mean;
+    this->WhitenStatisticsModified();
     }
 }
 
@@ -194,6 +206,7 @@ FeatureVectorGenerator< TImage >
   if( num < m_WhitenStdDev.size() )
     {
     m_WhitenStdDev[num] = stdDev;
+    this->WhitenStatisticsModified();
     }
 }
 
@@ -256,6 +269,68 @@ FeatureVectorGenerator< TImage >
     }
 }
 
+template< class TImage >
+void
+FeatureVectorGenerator< TImage >
+::FillFeatureBlock( const RegionType & region, FeatureValueType * out ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  const SizeValueType numVoxels = region.GetNumberOfPixels();
+
+  typedef itk::ImageRegionConstIterator< TImage > ImageConstIteratorType;
+  for( unsigned int f = 0; f < numFeatures; f++ )
+    {
+    double mean = 0;
+    double stdDev = 1;
+    if( m_WhitenStdDev.size() > 0 && m_WhitenStdDev[f] > 0 )
+      {
+      mean = m_WhitenMean[f];
+      stdDev = m_WhitenStdDev[f];
+      }
+    FeatureValueType * outF = out + f * numVoxels;
+    ImageConstIteratorType itIm( m_InputImageList[f], region );
+    while( !itIm.IsAtEnd() )
+      {
+      *outF = static_cast< FeatureValueType >( ( itIm.Get() - mean )
+        / stdDev );
+      ++outF;
+      ++itIm;
+      }
+    }
+}
+
+template< class TImage >
+std::vector< typename FeatureVectorGenerator< TImage >::RegionType >
+FeatureVectorGenerator< TImage >
+::SplitRegionIntoBlocks( const RegionType & region,
+  SizeValueType maxVoxelsPerBlock )
+{
+  std::vector< RegionType > blocks;
+
+  const unsigned int slowDim = ImageDimension - 1;
+  SizeValueType voxelsPerSlice = 1;
+  for( unsigned int i = 0; i < slowDim; i++ )
+    {
+    voxelsPerSlice *= region.GetSize()[i];
+    }
+  SizeValueType slicesPerBlock = 1;
+  if( voxelsPerSlice > 0 && maxVoxelsPerBlock > voxelsPerSlice )
+    {
+    slicesPerBlock = maxVoxelsPerBlock / voxelsPerSlice;
+    }
+
+  const SizeValueType numSlices = region.GetSize()[slowDim];
+  for( SizeValueType slice = 0; slice < numSlices; slice += slicesPerBlock )
+    {
+    RegionType block = region;
+    block.SetIndex( slowDim, region.GetIndex()[slowDim] + slice );
+    block.SetSize( slowDim, std::min( slicesPerBlock, numSlices - slice ) );
+    blocks.push_back( block );
+    }
+
+  return blocks;
+}
+
 template< class TImage >
 typename FeatureVectorGenerator< TImage >::FeatureImageType::Pointer
 FeatureVectorGenerator< TImage >
@@ -300,6 +375,51 @@ FeatureVectorGenerator< TImage >
 }
 
 
+template< class TImage >
+typename FeatureVectorGenerator< TImage >::FeatureImageListType
+FeatureVectorGenerator< TImage >
+::GetFeatureImages( void ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  typename FeatureImageType::RegionType region;
+  region = m_InputImageList[ 0 ]->GetLargestPossibleRegion();
+
+  FeatureImageListType featureImages( numFeatures );
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    featureImages[i] = FeatureImageType::New();
+    featureImages[i]->SetRegions( region );
+    featureImages[i]->CopyInformation( m_InputImageList[ 0 ] );
+    featureImages[i]->Allocate();
+    }
+
+  std::vector< RegionType > blocks = Self::SplitRegionIntoBlocks( region,
+    1 << 16 );
+  std::vector< FeatureValueType > block;
+  for( size_t b = 0; b < blocks.size(); b++ )
+    {
+    const SizeValueType numVoxels = blocks[b].GetNumberOfPixels();
+    block.resize( numFeatures * numVoxels );
+    this->FillFeatureBlock( blocks[b], block.data() );
+    for( unsigned int i = 0; i < numFeatures; i++ )
+      {
+      const FeatureValueType * blockF = block.data() + i * numVoxels;
+      ImageRegionIterator< FeatureImageType > itFeatureIm(
+        featureImages[i], blocks[b] );
+      while( !itFeatureIm.IsAtEnd() )
+        {
+        itFeatureIm.Set( *blockF );
+        ++blockF;
+        ++itFeatureIm;
+        }
+      }
+    }
+
+  return featureImages;
+}
+
+
 template< class TImage >
 void
 FeatureVectorGenerator< TImage >::
@@ -334,29 +454,32 @@ UpdateWhitenStatistics( void )
     imMean[i] = 0;
     imStdDev[i] = 0;
     }
+  this->WhitenStatisticsModified();
   unsigned int imCount = 0;
 
-  typedef itk::ImageRegionConstIteratorWithIndex< TImage >
-    ImageConstIteratorType;
-  ImageConstIteratorType itIm( m_InputImageList[0],
-    m_InputImageList[0]->GetLargestPossibleRegion() );
-
-  IndexType indx;
+  std::vector< RegionType > blocks = Self::SplitRegionIntoBlocks(
+    m_InputImageList[0]->GetLargestPossibleRegion(), 1 << 16 );
+  std::vector< FeatureValueType > block;
   double imVal;
-  FeatureVectorType fv;
-  while( !itIm.IsAtEnd() )
+  for( size_t b = 0; b < blocks.size(); b++ )
     {
-    indx = itIm.GetIndex();
-    fv = this->GetFeatureVector( indx );
-    ++imCount;
+    const SizeValueType numVoxels = blocks[b].GetNumberOfPixels();
+    block.resize( numFeatures * numVoxels );
+    this->FillFeatureBlock( blocks[b], block.data() );
     for( unsigned int i = 0; i < numFeatures; i++ )
       {
-      imVal = fv[i];
-      delta[i] = imVal - imMean[i];
-      imMean[i] += delta[i] / imCount;
-      imStdDev[i] += delta[i] * ( imVal - imMean[i] );
+      unsigned int count = imCount;
+      const FeatureValueType * blockF = block.data() + i * numVoxels;
+      for( SizeValueType v = 0; v < numVoxels; v++ )
+        {
+        ++count;
+        imVal = blockF[v];
+        delta[i] = imVal - imMean[i];
+        imMean[i] += delta[i] / count;
+        imStdDev[i] += delta[i] * ( imVal - imMean[i] );
+        }
       }
-    ++itIm;
+    imCount += numVoxels;
     }
   if( imCount > 1 )
     {
@@ -378,6 +501,7 @@ UpdateWhitenStatistics( void )
     m_WhitenMean[i] = imMean[i];
     m_WhitenStdDev[i] = imStdDev[i];
     }
+  this->WhitenStatisticsModified();
 }
 
 template< class TImage >
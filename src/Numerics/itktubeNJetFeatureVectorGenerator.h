@@ -25,12 +25,17 @@ limitations under the License.
 #define __itktubeNJetFeatureVectorGenerator_h
 
 #include "itktubeFeatureVectorGenerator.h"
+#include "itktubeNJetImageFunction.h"
 
 #include <itkImage.h>
 
 #include <vnl/vnl_matrix.h>
 #include <vnl/vnl_vector.h>
 
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace itk
@@ -66,6 +71,10 @@ public:
 
   typedef typename Superclass::IndexType          IndexType;
 
+  typedef typename Superclass::RegionType         RegionType;
+
+  typedef typename ImageType::SizeType            SizeType;
+
   typedef std::vector< double >                   NJetScalesType;
 
   virtual unsigned int GetNumberOfFeatures( void ) const override;
@@ -86,6 +95,37 @@ public:
   virtual FeatureValueType  GetFeatureVectorValue( const IndexType & indx,
     unsigned int fNum ) const override;
 
+  virtual void FillFeatureBlock( const RegionType & region,
+    FeatureValueType * out ) const override;
+
+  /** Compute features over whole regions instead of voxel by voxel.
+   *   The NJet kernels are products of per-axis kernels, so each region
+   *   is filtered with one 1D pass per axis and derivative order.  The
+   *   kernels then cover the box around the sphere of radius
+   *   Extent * scale used by NJetImageFunction, and each derivative is
+   *   divided by its absolute kernel weight over that box rather than
+   *   over the sphere.  Intensities and derivatives therefore differ from
+   *   the per-voxel values by up to the fraction of kernel weight in the
+   *   corners of the box times the local intensity range.  Second
+   *   derivatives can also differ by a similar fraction of the local
+   *   intensity level.  For the default Extent of 5, these fractions are
+   *   below 2e-4.  Ridge measures are computed from those derivatives and
+   *   are not bounded this way.  Point queries are answered from a cache
+   *   of tiles.  Off by default. */
+  itkSetMacro( UseTiledEvaluation, bool );
+  itkGetConstMacro( UseTiledEvaluation, bool );
+
+  /** Edge length, in voxels, of the tiles used for point queries.
+   *   0 computes the whole image as one tile. */
+  itkSetMacro( TileSize, unsigned int );
+  itkGetConstMacro( TileSize, unsigned int );
+
+  /** Maximum number of tiles kept for point queries.  The least recently
+   *   used tile is dropped first.  0 keeps one slab of tiles, which is
+   *   enough for a raster sweep of the image. */
+  itkSetMacro( MaximumNumberOfCachedTiles, unsigned int );
+  itkGetConstMacro( MaximumNumberOfCachedTiles, unsigned int );
+
 protected:
 
   NJetFeatureVectorGenerator( void );
@@ -95,6 +135,46 @@ protected:
 
 private:
 
+  typedef NJetImageFunction< ImageType >          NJetFunctionType;
+
+  /** Compute the un-whitened features of the image currently set in njet
+   *   at indx.  Feature i is written to out[ i * stride ].  Returns the
+   *   number of features written. */
+  unsigned int ComputeImageFeatures( NJetFunctionType * njet,
+    const IndexType & indx, FeatureValueType * out,
+    SizeValueType stride ) const;
+
+  typedef std::vector< FeatureValueType >         TileFeaturesType;
+  typedef std::shared_ptr< const TileFeaturesType >
+                                                  TileFeaturesPointer;
+
+  /** Compute the un-whitened features of image over region using
+   *   separable kernels.  Feature i of the voxel at raster offset v is
+   *   written to out[ i * region.GetNumberOfPixels() + v ].  Returns the
+   *   number of features written per voxel. */
+  unsigned int ComputeRegionFeatures( const ImageType * image,
+    const RegionType & region, FeatureValueType * out ) const;
+
+  /** Compute the normalized jet of image over region at one scale.
+   *   Slot 0 is the value, slots 1 to D the first derivatives, slots
+   *   D+1 to 2D the second derivatives and the remaining slots the mixed
+   *   derivatives, in the order used by NJetImageFunction.  Only slots
+   *   flagged in needed are computed. */
+  void ComputeRegionJet( const ImageType * image, const RegionType & region,
+    double scale, const std::vector< bool > & needed,
+    std::vector< std::vector< double > > & jet ) const;
+
+  /** Correlate a buffer of size inSize with kernel along axis.  The
+   *   output is shorter by kernel.size() - 1 along that axis. */
+  static void CorrelateAlongAxis( const std::vector< double > & in,
+    const SizeType & inSize, unsigned int axis,
+    const std::vector< double > & kernel, std::vector< double > & out );
+
+  /** Return the cached features of the tile that contains indx,
+   *   computing them if needed. */
+  TileFeaturesPointer GetTileFeatures( const IndexType & indx,
+    RegionType & tileRegion ) const;
+
   // Purposely not implemented
   NJetFeatureVectorGenerator( const Self & );
   void operator = ( const Self & );
@@ -104,6 +184,23 @@ private:
   NJetScalesType m_SecondScales;
   NJetScalesType m_RidgeScales;
 
+  bool           m_UseTiledEvaluation;
+  unsigned int   m_TileSize;
+  unsigned int   m_MaximumNumberOfCachedTiles;
+
+  typedef std::list< SizeValueType >              TileCacheOrderType;
+
+  struct TileCacheEntryType
+    {
+    TileFeaturesPointer                    Features;
+    typename TileCacheOrderType::iterator  Use;
+    };
+
+  mutable std::mutex                                     m_TileCacheLock;
+  mutable std::map< SizeValueType, TileCacheEntryType >  m_TileCache;
+  mutable TileCacheOrderType                             m_TileCacheOrder;
+  mutable ModifiedTimeType                               m_TileCacheTime;
+
 }; // End class NJetFeatureVectorGenerator
 
 }  // End namespace tube
@@ -29,8 +29,11 @@ limitations under the License.
 #include "tubeMatrixMath.h"
 
 #include <itkImage.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkTimeProbesCollectorBase.h>
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 
 namespace itk
@@ -47,6 +50,11 @@ NJetFeatureVectorGenerator< TImage >
   m_FirstScales.clear();
   m_SecondScales.clear();
   m_RidgeScales.clear();
+
+  m_UseTiledEvaluation = false;
+  m_TileSize = 32;
+  m_MaximumNumberOfCachedTiles = 0;
+  m_TileCacheTime = 0;
 }
 
 template< class TImage >
@@ -76,65 +84,97 @@ NJetFeatureVectorGenerator< TImage >
 }
 
 template< class TImage >
-typename NJetFeatureVectorGenerator< TImage >::FeatureVectorType
+unsigned int
 NJetFeatureVectorGenerator< TImage >
-::GetFeatureVector( const IndexType & indx ) const
+::ComputeImageFeatures( NJetFunctionType * njet, const IndexType & indx,
+  FeatureValueType * out, SizeValueType stride ) const
 {
-  const unsigned int numFeatures = this->GetNumberOfFeatures();
-
-  const unsigned int numInputImages = this->GetNumberOfInputImages();
-
-  typedef NJetImageFunction< ImageType > NJetFunctionType;
-  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
   typename NJetFunctionType::VectorType v;
   typename NJetFunctionType::MatrixType m;
 
   double val = 0.0;
-  FeatureVectorType featureVector;
-  featureVector.set_size( numFeatures );
   unsigned int featureCount = 0;
-  for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
-    inputImageNum++ )
+  for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
     {
-    njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+    out[ stride * featureCount++ ] = njet->EvaluateAtIndex( indx,
+      this->m_ZeroScales[s] );
+    }
 
-    for( unsigned int s = 0; s < m_ZeroScales.size(); s++ )
+  for( unsigned int s = 0; s < m_FirstScales.size(); s++ )
+    {
+    val = 0.0;
+    njet->DerivativeAtIndex( indx, m_FirstScales[s], v );
+    for( unsigned int d = 0; d < ImageDimension; d++ )
       {
-      featureVector[featureCount++] = njet->EvaluateAtIndex( indx,
-        this->m_ZeroScales[s] );
+      out[ stride * featureCount++ ] = v[d];
+      val += v[d] * v[d];
       }
+    out[ stride * featureCount++ ] = std::sqrt( val );
+    }
 
-    for( unsigned int s = 0; s < m_FirstScales.size(); s++ )
+  for( unsigned int s = 0; s < m_SecondScales.size(); s++ )
+    {
+    val = 0.0;
+    njet->HessianAtIndex( indx, m_SecondScales[s], m );
+    for( unsigned int d = 0; d < ImageDimension; d++ )
       {
-      val = 0.0;
-      njet->DerivativeAtIndex( indx, m_FirstScales[s], v );
-      for( unsigned int d = 0; d < ImageDimension; d++ )
-        {
-        featureVector[featureCount++] = v[d];
-        val += v[d] * v[d];
-        }
-      featureVector[featureCount++] = std::sqrt( val );
+      out[ stride * featureCount++ ] = m[d][d];
+      val += m[d][d]*m[d][d];
       }
+    out[ stride * featureCount++ ] = std::sqrt( val );
+    }
+
+  for( unsigned int s = 0; s < m_RidgeScales.size(); s++ )
+    {
+    out[ stride * featureCount++ ] = njet->RidgenessAtIndex( indx,
+      m_RidgeScales[s] );
+    out[ stride * featureCount++ ] = njet->GetMostRecentRidgeRoundness();
+    out[ stride * featureCount++ ] = njet->GetMostRecentRidgeCurvature();
+    out[ stride * featureCount++ ] = njet->GetMostRecentRidgeLevelness();
+    }
 
-    for( unsigned int s = 0; s < m_SecondScales.size(); s++ )
+  return featureCount;
+}
+
+template< class TImage >
+typename NJetFeatureVectorGenerator< TImage >::FeatureVectorType
+NJetFeatureVectorGenerator< TImage >
+::GetFeatureVector( const IndexType & indx ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  const unsigned int numInputImages = this->GetNumberOfInputImages();
+
+  FeatureVectorType featureVector;
+  featureVector.set_size( numFeatures );
+  unsigned int featureCount = 0;
+  if( m_UseTiledEvaluation )
+    {
+    RegionType tileRegion;
+    TileFeaturesPointer tile = this->GetTileFeatures( indx, tileRegion );
+    const SizeValueType tileVoxels = tileRegion.GetNumberOfPixels();
+    SizeValueType offset = 0;
+    for( int i = ImageDimension - 1; i >= 0; --i )
       {
-      val = 0.0;
-      njet->HessianAtIndex( indx, m_SecondScales[s], m );
-      for( unsigned int d = 0; d < ImageDimension; d++ )
-        {
-        featureVector[featureCount++] = m[d][d];
-        val += m[d][d]*m[d][d];
-        }
-      featureVector[featureCount++] = std::sqrt( val );
+      offset = offset * tileRegion.GetSize()[i]
+        + ( indx[i] - tileRegion.GetIndex()[i] );
       }
-
-    for( unsigned int s = 0; s < m_RidgeScales.size(); s++ )
+    for( ; featureCount < numFeatures; ++featureCount )
+      {
+      featureVector[featureCount] =
+        ( *tile )[ featureCount * tileVoxels + offset ];
+      }
+    }
+  else
+    {
+    typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
+    for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
+      inputImageNum++ )
       {
-      featureVector[featureCount++] = njet->RidgenessAtIndex( indx,
-        m_RidgeScales[s] );
-      featureVector[featureCount++] = njet->GetMostRecentRidgeRoundness();
-      featureVector[featureCount++] = njet->GetMostRecentRidgeCurvature();
-      featureVector[featureCount++] = njet->GetMostRecentRidgeLevelness();
+      njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+
+      featureCount += this->ComputeImageFeatures( njet, indx,
+        featureVector.data_block() + featureCount, 1 );
       }
     }
 
@@ -156,6 +196,74 @@ NJetFeatureVectorGenerator< TImage >
   return featureVector;
 }
 
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::FillFeatureBlock( const RegionType & region, FeatureValueType * out ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  const unsigned int numInputImages = this->GetNumberOfInputImages();
+
+  const SizeValueType numVoxels = region.GetNumberOfPixels();
+
+  unsigned int featureCount = 0;
+  if( m_UseTiledEvaluation )
+    {
+    for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
+      inputImageNum++ )
+      {
+      featureCount += this->ComputeRegionFeatures(
+        this->m_InputImageList[inputImageNum], region,
+        out + featureCount * numVoxels );
+      }
+    }
+  else
+    {
+    typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
+
+    typedef ImageRegionConstIteratorWithIndex< ImageType > IteratorType;
+
+    unsigned int imageFeatureCount = 0;
+    for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
+      inputImageNum++ )
+      {
+      njet->SetInputImage( this->m_InputImageList[inputImageNum] );
+
+      FeatureValueType * outV = out + featureCount * numVoxels;
+      IteratorType it( this->m_InputImageList[inputImageNum], region );
+      while( !it.IsAtEnd() )
+        {
+        imageFeatureCount = this->ComputeImageFeatures( njet, it.GetIndex(),
+          outV, numVoxels );
+        ++outV;
+        ++it;
+        }
+      featureCount += imageFeatureCount;
+      }
+    }
+
+  if( numVoxels > 0 && numFeatures != featureCount )
+    {
+    std::cerr << "BUG: featureCount != Expected number of features"
+      << std::endl;
+    }
+
+  for( unsigned int i=0; i<numFeatures; ++i )
+    {
+    const double stdDev = this->GetWhitenStdDev( i );
+    if( stdDev > 0 )
+      {
+      const double mean = this->GetWhitenMean( i );
+      FeatureValueType * outF = out + i * numVoxels;
+      for( SizeValueType v=0; v<numVoxels; ++v )
+        {
+        outF[v] = ( outF[v] - mean ) / stdDev;
+        }
+      }
+    }
+}
+
 template< class TImage >
 typename NJetFeatureVectorGenerator< TImage >::FeatureValueType
 NJetFeatureVectorGenerator< TImage >
@@ -175,6 +283,25 @@ NJetFeatureVectorGenerator< TImage >
     fNumMean = 0;
     fNumStdDev = 1;
     }
+
+  if( m_UseTiledEvaluation )
+    {
+    if( fNum >= this->GetNumberOfFeatures() )
+      {
+      itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
+      }
+    RegionType tileRegion;
+    TileFeaturesPointer tile = this->GetTileFeatures( indx, tileRegion );
+    SizeValueType offset = 0;
+    for( int i = ImageDimension - 1; i >= 0; --i )
+      {
+      offset = offset * tileRegion.GetSize()[i]
+        + ( indx[i] - tileRegion.GetIndex()[i] );
+      }
+    return ( ( *tile )[ fNum * tileRegion.GetNumberOfPixels() + offset ]
+      - fNumMean ) / fNumStdDev;
+    }
+
   double val = 0.0;
   unsigned int featureCount = 0;
   for( unsigned int inputImageNum = 0; inputImageNum < numInputImages;
@@ -285,12 +412,470 @@ NJetFeatureVectorGenerator< TImage >
   itkExceptionMacro( << "Requested non-existent FeatureVectorValue." );
 }
 
+template< class TImage >
+unsigned int
+NJetFeatureVectorGenerator< TImage >
+::ComputeRegionFeatures( const ImageType * image, const RegionType & region,
+  FeatureValueType * out ) const
+{
+  const SizeValueType numVoxels = region.GetNumberOfPixels();
+
+  const unsigned int numMixed = ImageDimension * ( ImageDimension - 1 ) / 2;
+  const unsigned int numSlots = 1 + 2 * ImageDimension + numMixed;
+
+  const unsigned int firstOffset = m_ZeroScales.size();
+  const unsigned int secondOffset = firstOffset
+    + m_FirstScales.size() * ( ImageDimension + 1 );
+  const unsigned int ridgeOffset = secondOffset
+    + m_SecondScales.size() * ( ImageDimension + 1 );
+  const unsigned int featureCount = ridgeOffset + m_RidgeScales.size() * 4;
+
+  NJetScalesType scales( m_ZeroScales );
+  scales.insert( scales.end(), m_FirstScales.begin(), m_FirstScales.end() );
+  scales.insert( scales.end(), m_SecondScales.begin(), m_SecondScales.end() );
+  scales.insert( scales.end(), m_RidgeScales.begin(), m_RidgeScales.end() );
+  std::sort( scales.begin(), scales.end() );
+  scales.erase( std::unique( scales.begin(), scales.end() ), scales.end() );
+
+  std::vector< bool > needed( numSlots );
+  std::vector< std::vector< double > > jet;
+  Matrix< double, ImageDimension, ImageDimension > h;
+  Vector< double, ImageDimension > d;
+  Matrix< double, ImageDimension, ImageDimension > eVect;
+  Vector< double, ImageDimension > eVal;
+  for( unsigned int sNum = 0; sNum < scales.size(); ++sNum )
+    {
+    const double scale = scales[sNum];
+    const bool useZero = std::find( m_ZeroScales.begin(),
+      m_ZeroScales.end(), scale ) != m_ZeroScales.end();
+    const bool useFirst = std::find( m_FirstScales.begin(),
+      m_FirstScales.end(), scale ) != m_FirstScales.end();
+    const bool useSecond = std::find( m_SecondScales.begin(),
+      m_SecondScales.end(), scale ) != m_SecondScales.end();
+    const bool useRidge = std::find( m_RidgeScales.begin(),
+      m_RidgeScales.end(), scale ) != m_RidgeScales.end();
+    for( unsigned int slot = 0; slot < numSlots; ++slot )
+      {
+      if( slot == 0 )
+        {
+        needed[slot] = useZero;
+        }
+      else if( slot <= ImageDimension )
+        {
+        needed[slot] = useFirst || useRidge;
+        }
+      else if( slot <= 2 * ImageDimension )
+        {
+        needed[slot] = useSecond || useRidge;
+        }
+      else
+        {
+        needed[slot] = useRidge;
+        }
+      }
+    this->ComputeRegionJet( image, region, scale, needed, jet );
+
+    for( unsigned int s = 0; s < m_ZeroScales.size(); ++s )
+      {
+      if( m_ZeroScales[s] == scale )
+        {
+        FeatureValueType * outF = out + s * numVoxels;
+        for( SizeValueType v = 0; v < numVoxels; ++v )
+          {
+          outF[v] = jet[0][v];
+          }
+        }
+      }
+
+    for( unsigned int s = 0; s < m_FirstScales.size(); ++s )
+      {
+      if( m_FirstScales[s] == scale )
+        {
+        FeatureValueType * outF = out + ( firstOffset
+          + s * ( ImageDimension + 1 ) ) * numVoxels;
+        for( SizeValueType v = 0; v < numVoxels; ++v )
+          {
+          double val = 0;
+          for( unsigned int i = 0; i < ImageDimension; ++i )
+            {
+            outF[ i * numVoxels + v ] = jet[1 + i][v];
+            val += jet[1 + i][v] * jet[1 + i][v];
+            }
+          outF[ ImageDimension * numVoxels + v ] = std::sqrt( val );
+          }
+        }
+      }
+
+    for( unsigned int s = 0; s < m_SecondScales.size(); ++s )
+      {
+      if( m_SecondScales[s] == scale )
+        {
+        FeatureValueType * outF = out + ( secondOffset
+          + s * ( ImageDimension + 1 ) ) * numVoxels;
+        for( SizeValueType v = 0; v < numVoxels; ++v )
+          {
+          double val = 0;
+          for( unsigned int i = 0; i < ImageDimension; ++i )
+            {
+            const double hii = jet[1 + ImageDimension + i][v];
+            outF[ i * numVoxels + v ] = hii;
+            val += hii * hii;
+            }
+          outF[ ImageDimension * numVoxels + v ] = std::sqrt( val );
+          }
+        }
+      }
+
+    for( unsigned int s = 0; s < m_RidgeScales.size(); ++s )
+      {
+      if( m_RidgeScales[s] == scale )
+        {
+        FeatureValueType * outF = out + ( ridgeOffset + s * 4 )
+          * numVoxels;
+        for( SizeValueType v = 0; v < numVoxels; ++v )
+          {
+          unsigned int mixedSlot = 1 + 2 * ImageDimension;
+          for( unsigned int i = 0; i < ImageDimension; ++i )
+            {
+            d[i] = jet[1 + i][v];
+            h( i, i ) = jet[1 + ImageDimension + i][v];
+            for( unsigned int j = i + 1; j < ImageDimension; ++j )
+              {
+              h( i, j ) = jet[mixedSlot++][v];
+              h( j, i ) = h( i, j );
+              }
+            }
+          double ridgeness = 0;
+          double roundness = 0;
+          double curvature = 0;
+          double levelness = 0;
+          ::tube::ComputeRidgeness< double, ImageDimension >( h, d, NULL,
+            ridgeness, roundness, curvature, levelness, eVect, eVal );
+          outF[v] = ridgeness;
+          outF[ numVoxels + v ] = roundness;
+          outF[ 2 * numVoxels + v ] = curvature;
+          outF[ 3 * numVoxels + v ] = levelness;
+          }
+        }
+      }
+    }
+
+  return featureCount;
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::ComputeRegionJet( const ImageType * image, const RegionType & region,
+  double scale, const std::vector< bool > & needed,
+  std::vector< std::vector< double > > & jet ) const
+{
+  typedef FixedArray< unsigned int, ImageDimension > OrderType;
+
+  typename NJetFunctionType::Pointer njet = NJetFunctionType::New();
+  const double extent = njet->GetExtent();
+
+  const typename ImageType::SpacingType spacing = image->GetSpacing();
+  const RegionType imageRegion = image->GetLargestPossibleRegion();
+  const IndexType imageMinX = imageRegion.GetIndex();
+  IndexType imageMaxX;
+
+  // Per-axis kernels of NJetImageFunction::JetAtContinuousIndex: order 0
+  //   is the gaussian, order 1 the first derivative weight and order 2
+  //   the second derivative weight.  Each derivative is normalized by
+  //   the sum of its absolute weights, which is the product of the
+  //   per-axis sums.
+  std::vector< double > kernel[ImageDimension][3];
+  double kernelNorm[ImageDimension][3];
+  SizeType radius;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    imageMaxX[i] = imageMinX[i] + imageRegion.GetSize()[i] - 1;
+    radius[i] = static_cast< SizeValueType >( std::floor( scale * extent
+      / spacing[i] ) );
+    for( unsigned int o = 0; o < 3; ++o )
+      {
+      kernel[i][o].resize( 2 * radius[i] + 1 );
+      kernelNorm[i][o] = 0;
+      }
+    for( int u = -static_cast< int >( radius[i] );
+      u <= static_cast< int >( radius[i] ); ++u )
+      {
+      const double dist = u * spacing[i];
+      const double g = std::exp( -dist * dist / ( 2 * scale * scale ) );
+      const double w[3] = { g, -dist * g,
+        ( ( dist * dist ) / ( scale * scale ) - 1.0 ) * g };
+      for( unsigned int o = 0; o < 3; ++o )
+        {
+        kernel[i][o][ u + radius[i] ] = w[o];
+        kernelNorm[i][o] += std::fabs( w[o] );
+        }
+      }
+    }
+
+  const unsigned int numSlots = needed.size();
+  std::vector< OrderType > slotOrder( numSlots );
+  unsigned int slot = 0;
+  slotOrder[slot++].Fill( 0 );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    slotOrder[slot].Fill( 0 );
+    slotOrder[slot++][i] = 1;
+    }
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    slotOrder[slot].Fill( 0 );
+    slotOrder[slot++][i] = 2;
+    }
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    for( unsigned int j = i + 1; j < ImageDimension; ++j )
+      {
+      slotOrder[slot].Fill( 0 );
+      slotOrder[slot][i] = 1;
+      slotOrder[slot++][j] = 1;
+      }
+    }
+
+  // Read the region padded by the kernel radius, replicating the image
+  //   edge as NJetImageFunction does.
+  SizeType size;
+  SizeValueType numPadded = 1;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    size[i] = region.GetSize()[i] + 2 * radius[i];
+    numPadded *= size[i];
+    }
+  std::vector< double > padded( numPadded );
+  IndexType indx;
+  for( SizeValueType p = 0; p < numPadded; ++p )
+    {
+    SizeValueType rem = p;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      indx[i] = region.GetIndex()[i] - static_cast< IndexValueType >(
+        radius[i] ) + static_cast< IndexValueType >( rem % size[i] );
+      rem /= size[i];
+      indx[i] = std::max( imageMinX[i], std::min( imageMaxX[i], indx[i] ) );
+      }
+    padded[p] = image->GetPixel( indx );
+    }
+
+  // Filter the thinnest axes first: they shrink the buffers the most.
+  std::vector< unsigned int > axes( ImageDimension );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    axes[i] = i;
+    }
+  std::stable_sort( axes.begin(), axes.end(),
+    [ &region ]( unsigned int a, unsigned int b )
+    { return region.GetSize()[a] < region.GetSize()[b]; } );
+
+  std::vector< OrderType > partialOrder( 1 );
+  partialOrder[0].Fill( 0 );
+  std::vector< std::vector< double > > partial( 1 );
+  partial[0].swap( padded );
+  std::vector< bool > done( ImageDimension, false );
+  for( unsigned int a = 0; a < ImageDimension; ++a )
+    {
+    const unsigned int axis = axes[a];
+    std::vector< OrderType > nextOrder;
+    std::vector< std::vector< double > > next;
+    for( unsigned int p = 0; p < partial.size(); ++p )
+      {
+      for( unsigned int o = 0; o < 3; ++o )
+        {
+        bool use = false;
+        for( slot = 0; slot < numSlots && !use; ++slot )
+          {
+          if( needed[slot] && slotOrder[slot][axis] == o )
+            {
+            use = true;
+            for( unsigned int i = 0; i < ImageDimension; ++i )
+              {
+              if( done[i] && slotOrder[slot][i] != partialOrder[p][i] )
+                {
+                use = false;
+                }
+              }
+            }
+          }
+        if( use )
+          {
+          nextOrder.push_back( partialOrder[p] );
+          nextOrder.back()[axis] = o;
+          next.push_back( std::vector< double >() );
+          Self::CorrelateAlongAxis( partial[p], size, axis,
+            kernel[axis][o], next.back() );
+          }
+        }
+      }
+    partialOrder.swap( nextOrder );
+    partial.swap( next );
+    size[axis] = region.GetSize()[axis];
+    done[axis] = true;
+    }
+
+  jet.resize( numSlots );
+  for( slot = 0; slot < numSlots; ++slot )
+    {
+    jet[slot].clear();
+    }
+  for( unsigned int p = 0; p < partial.size(); ++p )
+    {
+    for( slot = 0; slot < numSlots; ++slot )
+      {
+      if( needed[slot] && slotOrder[slot] == partialOrder[p] )
+        {
+        double norm = 1;
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          norm *= kernelNorm[i][ partialOrder[p][i] ];
+          }
+        jet[slot].swap( partial[p] );
+        if( norm != 0 )
+          {
+          for( SizeValueType v = 0; v < jet[slot].size(); ++v )
+            {
+            jet[slot][v] /= norm;
+            }
+          }
+        break;
+        }
+      }
+    }
+}
+
+template< class TImage >
+void
+NJetFeatureVectorGenerator< TImage >
+::CorrelateAlongAxis( const std::vector< double > & in,
+  const SizeType & inSize, unsigned int axis,
+  const std::vector< double > & kernel, std::vector< double > & out )
+{
+  SizeValueType inner = 1;
+  for( unsigned int i = 0; i < axis; ++i )
+    {
+    inner *= inSize[i];
+    }
+  SizeValueType outer = 1;
+  for( unsigned int i = axis + 1; i < ImageDimension; ++i )
+    {
+    outer *= inSize[i];
+    }
+  const SizeValueType inLength = inSize[axis];
+  const SizeValueType outLength = inLength - kernel.size() + 1;
+
+  out.assign( outer * outLength * inner, 0 );
+  for( SizeValueType o = 0; o < outer; ++o )
+    {
+    for( SizeValueType x = 0; x < outLength; ++x )
+      {
+      double * dst = out.data() + ( o * outLength + x ) * inner;
+      for( SizeValueType u = 0; u < kernel.size(); ++u )
+        {
+        const double w = kernel[u];
+        const double * src = in.data() + ( o * inLength + x + u ) * inner;
+        for( SizeValueType i = 0; i < inner; ++i )
+          {
+          dst[i] += w * src[i];
+          }
+        }
+      }
+    }
+}
+
+template< class TImage >
+typename NJetFeatureVectorGenerator< TImage >::TileFeaturesPointer
+NJetFeatureVectorGenerator< TImage >
+::GetTileFeatures( const IndexType & indx, RegionType & tileRegion ) const
+{
+  const RegionType imageRegion =
+    this->m_InputImageList[0]->GetLargestPossibleRegion();
+
+  IndexType tileIndex;
+  SizeType tileSize;
+  SizeValueType tileNum = 0;
+  SizeValueType tilesPerSlab = 1;
+  for( int i = ImageDimension - 1; i >= 0; --i )
+    {
+    const SizeValueType imageSize = imageRegion.GetSize()[i];
+    const SizeValueType edge = ( m_TileSize > 0 ) ? m_TileSize : imageSize;
+    const SizeValueType numTiles = ( imageSize + edge - 1 ) / edge;
+    const SizeValueType t = ( indx[i] - imageRegion.GetIndex()[i] ) / edge;
+    tileIndex[i] = imageRegion.GetIndex()[i] + t * edge;
+    tileSize[i] = std::min( edge, imageSize - t * edge );
+    tileNum = tileNum * numTiles + t;
+    if( i < static_cast< int >( ImageDimension ) - 1 )
+      {
+      tilesPerSlab *= numTiles;
+      }
+    }
+  tileRegion.SetIndex( tileIndex );
+  tileRegion.SetSize( tileSize );
+
+  ModifiedTimeType cacheTime = this->GetMTime();
+  for( unsigned int i = 0; i < this->GetNumberOfInputImages(); ++i )
+    {
+    cacheTime = std::max( cacheTime, this->m_InputImageList[i]->GetMTime() );
+    }
+
+    {
+    std::lock_guard< std::mutex > lock( m_TileCacheLock );
+    if( cacheTime != m_TileCacheTime )
+      {
+      m_TileCache.clear();
+      m_TileCacheOrder.clear();
+      m_TileCacheTime = cacheTime;
+      }
+    typename std::map< SizeValueType, TileCacheEntryType >::const_iterator
+      iter = m_TileCache.find( tileNum );
+    if( iter != m_TileCache.end() )
+      {
+      m_TileCacheOrder.splice( m_TileCacheOrder.end(), m_TileCacheOrder,
+        iter->second.Use );
+      return iter->second.Features;
+      }
+    }
+
+  // Computed outside of the lock so that threads working on different
+  //   tiles do not wait for each other.
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+  const SizeValueType tileVoxels = tileRegion.GetNumberOfPixels();
+  std::shared_ptr< TileFeaturesType > tile =
+    std::make_shared< TileFeaturesType >( numFeatures * tileVoxels );
+  unsigned int featureCount = 0;
+  for( unsigned int i = 0; i < this->GetNumberOfInputImages(); ++i )
+    {
+    featureCount += this->ComputeRegionFeatures( this->m_InputImageList[i],
+      tileRegion, tile->data() + featureCount * tileVoxels );
+    }
+
+  std::lock_guard< std::mutex > lock( m_TileCacheLock );
+  if( cacheTime == m_TileCacheTime
+    && m_TileCache.find( tileNum ) == m_TileCache.end() )
+    {
+    TileCacheEntryType & entry = m_TileCache[tileNum];
+    entry.Features = tile;
+    entry.Use = m_TileCacheOrder.insert( m_TileCacheOrder.end(), tileNum );
+    const SizeValueType maxTiles = ( m_MaximumNumberOfCachedTiles > 0 )
+      ? m_MaximumNumberOfCachedTiles : tilesPerSlab;
+    while( m_TileCache.size() > maxTiles )
+      {
+      m_TileCache.erase( m_TileCacheOrder.front() );
+      m_TileCacheOrder.pop_front();
+      }
+    }
+  return tile;
+}
+
 template< class TImage >
 void
 NJetFeatureVectorGenerator< TImage >
 ::SetZeroScales( const NJetScalesType & scales )
 {
   m_ZeroScales = scales;
+  this->Modified();
 }
 
 template< class TImage >
@@ -299,6 +884,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetFirstScales( const NJetScalesType & scales )
 {
   m_FirstScales = scales;
+  this->Modified();
 }
 
 template< class TImage >
@@ -307,6 +893,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetSecondScales( const NJetScalesType & scales )
 {
   m_SecondScales = scales;
+  this->Modified();
 }
 
 template< class TImage >
@@ -315,6 +902,7 @@ NJetFeatureVectorGenerator< TImage >
 ::SetRidgeScales( const NJetScalesType & scales )
 {
   m_RidgeScales = scales;
+  this->Modified();
 }
 
 template< class TImage >
@@ -364,6 +952,11 @@ NJetFeatureVectorGenerator< TImage >
     << std::endl;
   os << indent << "RidgeScales.size() = " << m_RidgeScales.size()
     << std::endl;
+  os << indent << "UseTiledEvaluation = " << m_UseTiledEvaluation
+    << std::endl;
+  os << indent << "TileSize = " << m_TileSize << std::endl;
+  os << indent << "MaximumNumberOfCachedTiles = "
+    << m_MaximumNumberOfCachedTiles << std::endl;
 }
 
 } // End namespace tube
@@ -253,6 +253,28 @@ public:
                        const VectorType & v1, const VectorType & v2,
                        double scale=1 ) const;
 
+  /**
+   * Thread-safe evaluation.  These do not update the most recent values,
+   *   so one function may be shared by several threads once its input
+   *   image is set.
+   */
+  double  ComputeJetAtContinuousIndex( const ContinuousIndexType & cIndex,
+                       VectorType & d, MatrixType & h,
+                       double scale=1 ) const;
+
+  double  ComputeRidgenessAtContinuousIndex(
+                       const ContinuousIndexType & cIndex, double scale,
+                       double & intensity ) const;
+
+  /**
+   * Convert the first and second Gaussian derivatives at scale, in
+   *   physical units, into the normalized derivatives returned by
+   *   JetAtContinuousIndex.  Used to evaluate ridgeness from derivatives
+   *   computed by separable filters.
+   */
+  static void GaussianDerivativesToJet( double scale, VectorType & d,
+                       MatrixType & h );
+
   InputImagePointer ScaleSubsample( double factor );
 
   /**
@@ -1462,6 +1462,21 @@ double
 NJetImageFunction<TInputImage>::
 JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
   MatrixType & h, double scale ) const
+{
+  double v = ComputeJetAtContinuousIndex( cIndex, d, h, scale );
+
+  m_MostRecentIntensity = v;
+  m_MostRecentDerivative = d;
+  m_MostRecentHessian = h;
+
+  return v;
+}
+
+template< class TInputImage >
+double
+NJetImageFunction<TInputImage>::
+ComputeJetAtContinuousIndex( const ContinuousIndexType & cIndex,
+  VectorType & d, MatrixType & h, double scale ) const
 {
   // JET
   double physGaussFactor = -1.0 / ( 2 * scale * scale );
@@ -1633,8 +1648,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
     {
     v = 0;
     }
-  m_MostRecentIntensity = v;
-
   for( unsigned int i = 0; i < ImageDimension; i++ )
     {
     if( dTotal[i] != 0 )
@@ -1645,7 +1658,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
       {
       d[i] = 0;
       }
-    m_MostRecentDerivative[i] = d[i];
 
     if( hTotal[i][i] != 0 )
       {
@@ -1655,7 +1667,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
       {
       h[i][i] = 0;
       }
-    m_MostRecentHessian[i][i] = h[i][i];
     for( unsigned int j=i+1; j<ImageDimension; j++ )
       {
       if( hTotal[i][j] != 0 )
@@ -1668,8 +1679,6 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
         h[i][j] = 0;
         h[j][i] = 0;
         }
-      m_MostRecentHessian[i][j] = h[i][j];
-      m_MostRecentHessian[j][i] = h[j][i];
       }
     }
 
@@ -1821,23 +1830,75 @@ RidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
   double roundness = 0;
   double curvature = 0;
   double levelness = 0;
-  vnl_matrix<double> eVect( ImageDimension, ImageDimension );
-  vnl_vector<double> eVal( ImageDimension );
-  vnl_vector<double> prevTangent;
-  ::tube::ComputeRidgeness<double>( h.GetVnlMatrix().as_ref(), d.GetVnlVector(),
-    prevTangent, ridgeness, roundness, curvature, levelness, eVect, eVal );
+  MatrixType eVect;
+  VectorType eVal;
+  ::tube::ComputeRidgeness< double, ImageDimension >( h, d, NULL,
+    ridgeness, roundness, curvature, levelness, eVect, eVal );
 
   m_MostRecentIntensity = intensity;
   m_MostRecentRidgeness = ridgeness;
   m_MostRecentRidgeRoundness = roundness;
   m_MostRecentRidgeCurvature = curvature;
   m_MostRecentRidgeLevelness = levelness;
-  m_MostRecentRidgeTangent.SetVnlVector( eVect.get_column(
-    ImageDimension-1 ) );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_MostRecentRidgeTangent[i] = eVect( i, ImageDimension-1 );
+    }
 
   return m_MostRecentRidgeness;
 }
 
+template< class TInputImage >
+double
+NJetImageFunction<TInputImage>::
+ComputeRidgenessAtContinuousIndex( const ContinuousIndexType & cIndex,
+  double scale, double & intensity ) const
+{
+  VectorType d;
+  MatrixType h;
+
+  intensity = ComputeJetAtContinuousIndex( cIndex, d, h, scale );
+
+  double ridgeness = 0;
+  double roundness = 0;
+  double curvature = 0;
+  double levelness = 0;
+  MatrixType eVect;
+  VectorType eVal;
+  ::tube::ComputeRidgeness< double, ImageDimension >( h, d, NULL,
+    ridgeness, roundness, curvature, levelness, eVect, eVal );
+
+  return ridgeness;
+}
+
+template< class TInputImage >
+void
+NJetImageFunction<TInputImage>::
+GaussianDerivativesToJet( double scale, VectorType & d, MatrixType & h )
+{
+  // JetAtContinuousIndex divides each kernel sum by the sum of the
+  //   magnitudes of its kernel.  For a Gaussian of standard deviation
+  //   scale, those sums are, relative to the sum of the Gaussian,
+  //   E|x| = scale * sqrt( 2 / pi ), E|x^2/scale^2 - 1| = 4 * exp( -1/2 )
+  //   / sqrt( 2 pi ), and E|x y| = scale^2 * 2 / pi.  Its first derivative
+  //   kernel is -x times the Gaussian, hence the sign of dFactor.
+  const double dFactor = -scale * std::sqrt( vnl_math::pi / 2 );
+  const double hiiFactor = scale * scale
+    / ( 4 * std::exp( -0.5 ) / std::sqrt( 2 * vnl_math::pi ) );
+  const double hijFactor = scale * scale * vnl_math::pi / 2;
+
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    d[i] *= dFactor;
+    h[i][i] *= hiiFactor;
+    for( unsigned int j=i+1; j<ImageDimension; j++ )
+      {
+      h[i][j] *= hijFactor;
+      h[j][i] = h[i][j];
+      }
+    }
+}
+
 template< class TInputImage >
 double
 NJetImageFunction<TInputImage>::
@@ -71,6 +71,8 @@ public:
 
   typedef typename Superclass::IndexType             IndexType;
 
+  typedef typename Superclass::RegionType            RegionType;
+
   typedef std::vector< double >                      RidgeScalesType;
 
   typedef std::vector< typename FeatureImageType::Pointer >
@@ -88,6 +90,9 @@ public:
   virtual FeatureValueType GetFeatureVectorValue( const IndexType & indx,
     unsigned int fNum ) const override;
 
+  virtual void FillFeatureBlock( const RegionType & region,
+    FeatureValueType * out ) const override;
+
   virtual typename FeatureImageType::Pointer GetFeatureImage(
     unsigned int fNum ) const override;
 
@@ -29,6 +29,7 @@ limitations under the License.
 #include "tubeMatrixMath.h"
 
 #include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkProgressReporter.h>
 
 #include <limits>
@@ -340,6 +341,26 @@ RidgeFFTFeatureVectorGenerator< TImage >
   return this->m_FeatureImageList[ fNum ]->GetPixel( indx );
 }
 
+template< class TImage >
+void
+RidgeFFTFeatureVectorGenerator< TImage >
+::FillFeatureBlock( const RegionType & region, FeatureValueType * out ) const
+{
+  const unsigned int numFeatures = this->GetNumberOfFeatures();
+
+  typedef ImageRegionConstIterator< FeatureImageType >  IterType;
+  for( unsigned int f=0; f<numFeatures; ++f )
+    {
+    IterType iter( m_FeatureImageList[f], region );
+    while( !iter.IsAtEnd() )
+      {
+      *out = iter.Get();
+      ++out;
+      ++iter;
+      }
+    }
+}
+
 template< class TImage >
 typename RidgeFFTFeatureVectorGenerator< TImage >::FeatureImageType::Pointer
 RidgeFFTFeatureVectorGenerator< TImage >
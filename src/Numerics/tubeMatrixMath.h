@@ -25,8 +25,9 @@ limitations under the License.
 
 #include "tubeMacro.h"
 
-#include <itkVector.h>
 #include <itkCovariantVector.h>
+#include <itkMatrix.h>
+#include <itkVector.h>
 
 #include <vnl/vnl_math.h>
 #include <vnl/vnl_vector_ref.h>
@@ -95,11 +96,31 @@ ComputeRidgeness( const vnl_matrix<T> & H,
   double & linearity,
   vnl_matrix<T> & HEVect, vnl_vector<T> & HEVal );
 
+/** Compute Ridgeness measures for a Hessian of compile-time dimension.
+ *  Gives the same results as the vnl version without allocating; pass a
+ *  null prevTangent when there is no previous tangent. */
+template< class T, unsigned int VDimension >
+void
+ComputeRidgeness( const itk::Matrix<T, VDimension, VDimension> & H,
+  const itk::Vector<T, VDimension> & D,
+  const itk::Vector<T, VDimension> * prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & linearity,
+  itk::Matrix<T, VDimension, VDimension> & HEVect,
+  itk::Vector<T, VDimension> & HEVal );
+
 /** Compute eigenvalues and vectors  */
 template< class T >
 void
 FixMatrixSymmetry( vnl_matrix<T> & mat );
 
+/** Ensure a fixed-size matrix is symmetric */
+template< class T, unsigned int VDimension >
+void
+FixMatrixSymmetry( itk::Matrix<T, VDimension, VDimension> & mat );
+
 /** Compute eigenvalues and vectors  */
 template< class T >
 void
@@ -114,6 +135,17 @@ void
 ComputeEigen( vnl_matrix<T> const & mat, vnl_matrix<T> &eVects,
   vnl_vector<T> &eVals, bool orderByAbs = false, bool minToMax = true );
 
+/** Compute eigenvalues and vectors of a symmetric matrix of compile-time
+ *  dimension.  Only the upper triangle is read.  2D and 3D use the same
+ *  tridiagonal QL solver as the vnl version; other dimensions use cyclic
+ *  Jacobi rotations.  No heap memory is allocated. */
+template< class T, unsigned int VDimension >
+void
+ComputeEigen( const itk::Matrix<T, VDimension, VDimension> & mat,
+  itk::Matrix<T, VDimension, VDimension> & eVects,
+  itk::Vector<T, VDimension> & eVals, bool orderByAbs = false,
+  bool minToMax = true );
+
 } // End namespace tube
 
 
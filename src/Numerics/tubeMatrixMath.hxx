@@ -381,6 +381,134 @@ ComputeRidgeness( const vnl_matrix<T> & H,
     }
 }
 
+template< class T, unsigned int VDimension >
+void
+ComputeRidgeness( const itk::Matrix<T, VDimension, VDimension> & H,
+  const itk::Vector<T, VDimension> & D,
+  const itk::Vector<T, VDimension> * prevTangent,
+  double & ridgeness,
+  double & roundness,
+  double & curvature,
+  double & levelness,
+  itk::Matrix<T, VDimension, VDimension> & HEVect,
+  itk::Vector<T, VDimension> & HEVal )
+{
+  const unsigned int ImageDimension = VDimension;
+
+  itk::Matrix<T, VDimension, VDimension> HSym( H );
+  ::tube::FixMatrixSymmetry( HSym );
+  ::tube::ComputeEigen( HSym, HEVect, HEVal, true, false );
+
+  itk::Vector<T, VDimension> Dv;
+  double DvMag = 0;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    DvMag += D[i] * D[i];
+    }
+  if( DvMag > 0 )
+    {
+    const double scale = 1 / std::sqrt( DvMag );
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      Dv[i] = static_cast< T >( scale * D[i] );
+      }
+    }
+  else
+    {
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      Dv[i] = HEVect( i, ImageDimension-1 );
+      }
+    }
+
+  if( prevTangent != NULL )
+    {
+    // Keep the eigenvector closest to the previous tangent in the last
+    // column.  As in the vnl version, its sign is left unchanged.
+    unsigned int closestV = 0;
+    double closestVDProd = 0;
+    for( unsigned int i=0; i<ImageDimension; i++ )
+      {
+      double dProd = 0;
+      for( unsigned int j=0; j<ImageDimension; j++ )
+        {
+        dProd += ( *prevTangent )[j] * HEVect( j, i );
+        }
+      dProd = std::fabs( dProd );
+      if( dProd > closestVDProd )
+        {
+        closestV = i;
+        closestVDProd = dProd;
+        }
+      }
+    if( closestV != ImageDimension-1 )
+      {
+      T tf = HEVal[closestV];
+      HEVal[closestV] = HEVal[ImageDimension-1];
+      HEVal[ImageDimension-1] = tf;
+      for( unsigned int j=0; j<ImageDimension; j++ )
+        {
+        tf = HEVect( j, closestV );
+        HEVect( j, closestV ) = HEVect( j, ImageDimension-1 );
+        HEVect( j, ImageDimension-1 ) = tf;
+        }
+      }
+    }
+
+  double sump = 0;
+  double sumv = 0;
+  int ridge = 1;
+  for( unsigned int i=0; i<ImageDimension-1; i++ )
+    {
+    double dProd = 0;
+    for( unsigned int j=0; j<ImageDimension; j++ )
+      {
+      dProd += Dv[j] * HEVect( j, i );
+      }
+    sump += dProd * dProd;
+
+    double tf = HEVal[i];
+    sumv += tf * tf;
+    if( tf >= 0 )
+      {
+      ridge = -1;
+      }
+    }
+  double avgp = sump / ( ImageDimension - 1 );
+  double avgv = sumv / ( ImageDimension - 1 );
+
+  ridgeness = 0;
+  curvature = 0;
+  roundness = 0;
+  levelness = 0;
+  if( ridge > 0 )
+    {
+    ridgeness = ( 1 - avgp );
+
+    if( ImageDimension > 2 )
+      {
+      roundness = std::sqrt(
+        ( HEVal[ ImageDimension-2 ] * HEVal[ ImageDimension-2] ) / avgv );
+      }
+    else
+      {
+      roundness = 1;
+      }
+
+    if( avgv != 0 )
+      {
+      curvature = std::sqrt( avgv );
+      }
+
+    double denom =
+       sumv + ( HEVal[ ImageDimension-1 ] * HEVal[ ImageDimension-1] );
+    if( denom != 0 )
+      {
+      levelness = sumv / denom;
+      }
+    }
+}
+
 /**
  * Compute eigenvalues and vectors from ( W.inv() * B ) */
 template< class T >
@@ -417,6 +545,22 @@ FixMatrixSymmetry( vnl_matrix<T> & mat )
     }
 }
 
+/**
+ * Ensure the fixed-size matrix is symmetric  */
+template< class T, unsigned int VDimension >
+void
+FixMatrixSymmetry( itk::Matrix<T, VDimension, VDimension> & mat )
+{
+  for( unsigned int r=0; r<VDimension; ++r )
+    {
+    for( unsigned int c=r+1; c<VDimension; ++c )
+      {
+      mat( r, c ) = ( mat( r, c ) + mat( c, r ) ) / 2;
+      mat( c, r ) = mat( r, c );
+      }
+    }
+}
+
 /**
  * Perform trilinear diagonalization in 2D */
 template< class T >
@@ -722,6 +866,332 @@ ComputeEigen( vnl_matrix<T> const & mat,
     }
 }
 
+/**
+ * No closed-form tridiagonalization for this dimension */
+template< class T, unsigned int VDimension >
+bool
+ComputeTriDiag( itk::Matrix<T, VDimension, VDimension> &
+  itkNotUsed( mat ), itk::Vector<T, VDimension> & itkNotUsed( diag ),
+  itk::Vector<T, VDimension> & itkNotUsed( subD ) )
+{
+  return false;
+}
+
+/**
+ * Perform trilinear diagonalization of a fixed-size 2D matrix */
+template< class T >
+bool
+ComputeTriDiag( itk::Matrix<T, 2, 2> &mat,
+  itk::Vector<T, 2> &diag, itk::Vector<T, 2> &subD )
+{
+  diag[0] = mat( 0, 0 );
+  diag[1] = mat( 1, 1 );
+  subD[0] = mat( 0, 1 );
+  subD[1] = 0;
+
+  mat.SetIdentity();
+
+  return true;
+}
+
+/**
+ * Perform trilinear diagonalization of a fixed-size 3D matrix */
+template< class T >
+bool
+ComputeTriDiag( itk::Matrix<T, 3, 3> &mat,
+  itk::Vector<T, 3> &diag, itk::Vector<T, 3> &subD )
+{
+  double a = mat( 0, 0 );
+  double b = mat( 0, 1 );
+  double c = mat( 0, 2 );
+  double d = mat( 1, 1 );
+  double e = mat( 1, 2 );
+  double f = mat( 2, 2 );
+
+  diag[0] = static_cast< T >( a );
+  subD[2] = 0;
+  mat.SetIdentity();
+  if( c != 0 )
+    {
+    const double s = std::sqrt( b*b+c*c );
+    b /= s;
+    c /= s;
+    const double q = 2*b*e+c*( f-d );
+    diag[1] = static_cast< T >( d+c*q );
+    diag[2] = static_cast< T >( f-c*q );
+    subD[0] = static_cast< T >( s );
+    subD[1] = static_cast< T >( e-b*q );
+
+    mat( 1, 1 ) = static_cast< T >( b );
+    mat( 1, 2 ) = static_cast< T >( c );
+    mat( 2, 1 ) = static_cast< T >( c );
+    mat( 2, 2 ) = static_cast< T >( -b );
+    }
+  else
+    {
+    diag[1] = static_cast< T >( d );
+    diag[2] = static_cast< T >( f );
+    subD[0] = static_cast< T >( b );
+    subD[1] = static_cast< T >( e );
+    }
+
+  return true;
+}
+
+/**
+ * QL iterations on a fixed-size tridiagonal matrix, as ComputeTqli */
+template< class T, unsigned int VDimension >
+void
+ComputeTqli( itk::Vector<T, VDimension> &diag,
+  itk::Vector<T, VDimension> &subD,
+  itk::Matrix<T, VDimension, VDimension> &mat )
+{
+  int iter;
+  int i;
+  int k;
+  int l;
+  int m;
+
+  double dd;
+  double g;
+  double r;
+  double f;
+  double s;
+  double c;
+  double p;
+  double b;
+
+  const int n = VDimension;
+
+  for( l=0; l<n; l++ )
+    {
+    for( iter = 0; iter < EIGEN_MAX_ITERATIONS; iter++ )
+      {
+      for( m=l; m<n; m++ )
+        {
+        if( m!=( n-1 ) )
+          {
+          dd = std::fabs( diag[m] )+std::fabs( diag[m+1] );
+          }
+        else
+          {
+          dd = std::fabs( diag[m] );
+          }
+
+        if( std::fabs( subD[m] )+dd == dd )
+          {
+          break;
+          }
+        }
+      if( m == l )
+        {
+        break;
+        }
+      g = ( diag[l+1]-diag[l] )/( 2*subD[l] );
+      r = std::sqrt( g*g+1 );
+      if( g<0 )
+        {
+        g = diag[m]-diag[l]+subD[l]/( g-r );
+        }
+      else
+        {
+        g = diag[m]-diag[l]+subD[l]/( g+r );
+        }
+      s = 1;
+      c = 1;
+      p = 0;
+      for( i=m-1; i>=l; i-- )
+        {
+        f = s*subD[i];
+        b = c*subD[i];
+        if( std::fabs( f )>=std::fabs( g ) )
+          {
+          c = g/f;
+          r = std::sqrt( c*c+1 );
+          subD[i+1] = static_cast< T >( f*r );
+          c *= ( s = 1/r );
+          }
+        else
+          {
+          s = f/g;
+          r = std::sqrt( s*s+1 );
+          subD[i+1] = static_cast< T >( g*r );
+          s *= ( c = 1/r );
+          }
+        g = diag[i+1]-p;
+        r = ( diag[i]-g )*s+2*b*c;
+        p = s*r;
+        diag[i+1] = static_cast< T >( g+p );
+        g = c*r-b;
+
+        for( k=0; k<n; k++ )
+          {
+          f = mat( k, i+1 );
+          mat( k, i+1 ) = static_cast< T >( s*mat( k, i )+c*f );
+          mat( k, i ) = static_cast< T >( c*mat( k, i )-s*f );
+          }
+        }
+      diag[l] -= static_cast< T >( p );
+      subD[l] = static_cast< T >( g );
+      subD[m] = 0;
+      }
+    if( iter == EIGEN_MAX_ITERATIONS )
+      {
+      throw( "NR_tqli - exceeded maximum iterations\n" );
+      }
+    }
+}
+
+/**
+ * Cyclic Jacobi rotations on a fixed-size symmetric matrix.  On entry
+ * mat holds the matrix ( upper triangle ); on exit it holds the
+ * eigenvectors as columns. */
+template< class T, unsigned int VDimension >
+void
+ComputeJacobi( itk::Matrix<T, VDimension, VDimension> &mat,
+  itk::Vector<T, VDimension> &eVals )
+{
+  const unsigned int n = VDimension;
+
+  double a[VDimension][VDimension];
+  for( unsigned int r=0; r<n; ++r )
+    {
+    for( unsigned int c=r; c<n; ++c )
+      {
+      a[r][c] = mat( r, c );
+      a[c][r] = a[r][c];
+      }
+    }
+  mat.SetIdentity();
+
+  int sweep;
+  for( sweep = 0; sweep < EIGEN_MAX_ITERATIONS; sweep++ )
+    {
+    double off = 0;
+    for( unsigned int p=0; p<n-1; ++p )
+      {
+      for( unsigned int q=p+1; q<n; ++q )
+        {
+        off += std::fabs( a[p][q] );
+        }
+      }
+    if( off == 0 )
+      {
+      break;
+      }
+    for( unsigned int p=0; p<n-1; ++p )
+      {
+      for( unsigned int q=p+1; q<n; ++q )
+        {
+        const double g = 100 * std::fabs( a[p][q] );
+        if( sweep > 3 && std::fabs( a[p][p] ) + g == std::fabs( a[p][p] )
+          && std::fabs( a[q][q] ) + g == std::fabs( a[q][q] ) )
+          {
+          a[p][q] = 0;
+          a[q][p] = 0;
+          continue;
+          }
+        if( a[p][q] == 0 )
+          {
+          continue;
+          }
+        const double theta = ( a[q][q] - a[p][p] ) / ( 2 * a[p][q] );
+        double t = 1 / ( std::fabs( theta ) + std::sqrt( theta*theta+1 ) );
+        if( theta < 0 )
+          {
+          t = -t;
+          }
+        const double c = 1 / std::sqrt( t*t+1 );
+        const double s = t * c;
+        for( unsigned int k=0; k<n; ++k )
+          {
+          const double akp = a[k][p];
+          const double akq = a[k][q];
+          a[k][p] = c*akp - s*akq;
+          a[k][q] = s*akp + c*akq;
+          }
+        for( unsigned int k=0; k<n; ++k )
+          {
+          const double apk = a[p][k];
+          const double aqk = a[q][k];
+          a[p][k] = c*apk - s*aqk;
+          a[q][k] = s*apk + c*aqk;
+          }
+        for( unsigned int k=0; k<n; ++k )
+          {
+          const double vkp = mat( k, p );
+          const double vkq = mat( k, q );
+          mat( k, p ) = static_cast< T >( c*vkp - s*vkq );
+          mat( k, q ) = static_cast< T >( s*vkp + c*vkq );
+          }
+        }
+      }
+    }
+  if( sweep == EIGEN_MAX_ITERATIONS )
+    {
+    throw( "NR_jacobi - exceeded maximum iterations\n" );
+    }
+
+  for( unsigned int d=0; d<n; ++d )
+    {
+    eVals[d] = static_cast< T >( a[d][d] );
+    }
+}
+
+/**
+ * Compute eigenvalues and vectors of a fixed-size symmetric matrix */
+template< class T, unsigned int VDimension >
+void
+ComputeEigen( const itk::Matrix<T, VDimension, VDimension> & mat,
+  itk::Matrix<T, VDimension, VDimension> &eVects,
+  itk::Vector<T, VDimension> &eVals,
+  bool orderByAbs, bool minToMax )
+{
+  const unsigned int n = VDimension;
+
+  itk::Vector<T, VDimension> subD;
+
+  eVects = mat;
+  if( ComputeTriDiag( eVects, eVals, subD ) )
+    {
+    ComputeTqli( eVals, subD, eVects );
+    }
+  else
+    {
+    ComputeJacobi( eVects, eVals );
+    }
+
+  for( unsigned int i=0; i<n-1; i++ )
+    {
+    for( unsigned int j=i+1; j<n; j++ )
+      {
+      bool swap;
+      if( orderByAbs )
+        {
+        swap = ( std::fabs( eVals[j] )>std::fabs( eVals[i] ) && !minToMax )
+          || ( std::fabs( eVals[j] )<std::fabs( eVals[i] ) && minToMax );
+        }
+      else
+        {
+        swap = ( eVals[j]>eVals[i] && !minToMax )
+          || ( eVals[j]<eVals[i] && minToMax );
+        }
+      if( swap )
+        {
+        T tf = eVals[j];
+        eVals[j] = eVals[i];
+        eVals[i] = tf;
+        for( unsigned int r=0; r<n; r++ )
+          {
+          tf = eVects( r, j );
+          eVects( r, j ) = eVects( r, i );
+          eVects( r, i ) = tf;
+          }
+        }
+      }
+    }
+}
+
 } // End namespace tube
 
 #endif // End !defined( __tubeMatrixMath_hxx )
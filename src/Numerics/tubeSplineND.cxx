@@ -25,6 +25,8 @@ limitations under the License.
 
 #include <itkImageRegionIterator.h>
 
+#include <algorithm>
+
 namespace tube
 {
 
@@ -127,6 +129,10 @@ SplineND
   m_OptimizerND = NULL;
   m_Spline1D = NULL;
 
+  m_CellCacheSize = 8;
+  m_NumberOfCellRefills = 0;
+  m_NumberOfCellCacheHits = 0;
+
   this->Use( 0, NULL, NULL, NULL );
 }
 
@@ -156,6 +162,10 @@ SplineND
   m_OptimizerND = NULL;
   m_Spline1D = NULL;
 
+  m_CellCacheSize = 8;
+  m_NumberOfCellRefills = 0;
+  m_NumberOfCellCacheHits = 0;
+
   this->Use( dimension, funcVal, spline1D, optimizer1D );
 }
 
@@ -246,6 +256,8 @@ SplineND
   m_FuncVal = funcVal;
   m_Spline1D = spline1D;
 
+  m_CellCache.clear();
+
   if( optimizer1D != NULL )
     {
     m_OptimizerND = new OptimizerND( m_Dimension,
@@ -271,6 +283,8 @@ SplineND
 
   m_OptimizerND->SetXMin( t );
   m_XMin = xMin;
+
+  m_CellCache.clear();
 }
 
 
@@ -287,6 +301,78 @@ SplineND
 
   m_OptimizerND->SetXMax( t );
   m_XMax = xMax;
+
+  m_CellCache.clear();
+}
+
+
+void
+SplineND
+::SetCellCacheSize( unsigned int cellCacheSize )
+{
+  m_CellCacheSize = cellCacheSize;
+  while( m_CellCache.size() > m_CellCacheSize )
+    {
+    m_CellCache.pop_back();
+    }
+}
+
+
+void
+SplineND
+::m_CacheCurrentCell( void )
+{
+  if( m_CellCacheSize == 0 )
+    {
+    return;
+    }
+
+  const double * data = m_Data->GetBufferPointer();
+  const size_t dataSize = m_Data->GetBufferedRegion().GetNumberOfPixels();
+
+  CellCacheType::iterator iter = m_CellCache.begin();
+  while( iter != m_CellCache.end() )
+    {
+    if( iter->xi == m_Xi )
+      {
+      m_CellCache.splice( m_CellCache.begin(), m_CellCache, iter );
+      return;
+      }
+    ++iter;
+    }
+
+  if( m_CellCache.size() >= m_CellCacheSize )
+    {
+    // Recycle the least recently used entry's storage
+    m_CellCache.splice( m_CellCache.begin(), m_CellCache,
+      --m_CellCache.end() );
+    }
+  else
+    {
+    m_CellCache.push_front( CellCacheEntryType() );
+    }
+  m_CellCache.front().xi = m_Xi;
+  m_CellCache.front().data.assign( data, data + dataSize );
+}
+
+
+bool
+SplineND
+::m_RestoreCachedCell( const IntVectorType & xi )
+{
+  CellCacheType::iterator iter = m_CellCache.begin();
+  while( iter != m_CellCache.end() )
+    {
+    if( iter->xi == xi )
+      {
+      std::copy( iter->data.begin(), iter->data.end(),
+        m_Data->GetBufferPointer() );
+      m_CellCache.splice( m_CellCache.begin(), m_CellCache, iter );
+      return true;
+      }
+    ++iter;
+    }
+  return false;
 }
 
 
@@ -311,6 +397,8 @@ SplineND
     if( m_NewData )
       {
       m_NewData = false;
+      m_CellCache.clear();
+      ++m_NumberOfCellRefills;
       for( unsigned int i=0; i<m_Dimension; i++ )
         {
         m_Xi( i ) = ( int )x( i );
@@ -374,6 +462,21 @@ SplineND
       }
     else
       {
+      this->m_CacheCurrentCell();
+
+      IntVectorType xiNew( m_Dimension );
+      for( unsigned int i=0; i<m_Dimension; i++ )
+        {
+        xiNew( i ) = ( int )x( i );
+        }
+      if( this->m_RestoreCachedCell( xiNew ) )
+        {
+        m_Xi = xiNew;
+        ++m_NumberOfCellCacheHits;
+        return;
+        }
+      ++m_NumberOfCellRefills;
+
       IntVectorType p( m_Dimension );
       IntVectorType pOld( m_Dimension );
       IntVectorType xiOffset( m_Dimension );
@@ -393,6 +496,8 @@ SplineND
         m_DataWS->GetLargestPossibleRegion() );
       it.GoToBegin();
 
+      const double * dataBuffer = m_Data->GetBufferPointer();
+
       xiOffset = -1;
       bool done = false;
       while( !done )
@@ -443,13 +548,13 @@ SplineND
           }
         if( reuse )
           {
-          ImageType::IndexType indx;
-          indx.Fill( 0 );
-          for( unsigned int i=0; i<m_Dimension; i++ )
+          // Control points are stored with a stride of 4 per dimension
+          size_t offset = 0;
+          for( int i=m_Dimension-1; i>=0; i-- )
             {
-            indx[i] = pOld[i];
+            offset = offset * 4 + pOld[i];
             }
-          it.Set( m_Data->GetPixel( indx ) );
+          it.Set( dataBuffer[offset] );
           }
         else
           {
@@ -967,6 +1072,12 @@ SplineND
   os << indent << "OptimizerNDDeriv: " << m_OptimizerNDDeriv << std::endl;
   os << indent << "OptimizerND:      " << m_OptimizerND << std::endl;
   os << indent << "Spline1D:         " << m_Spline1D << std::endl;
+  os << indent << "CellCacheSize:    " << m_CellCacheSize << std::endl;
+  os << indent << "CellCache.size:   " << m_CellCache.size() << std::endl;
+  os << indent << "NumberOfCellRefills:   " << m_NumberOfCellRefills
+    << std::endl;
+  os << indent << "NumberOfCellCacheHits: " << m_NumberOfCellCacheHits
+    << std::endl;
 }
 
 } // End namespace tube
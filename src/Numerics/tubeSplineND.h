@@ -32,6 +32,9 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkVectorContainer.h>
 
+#include <list>
+#include <vector>
+
 namespace tube
 {
 
@@ -135,6 +138,20 @@ public:
 
   tubeBooleanMacro( NewData );
 
+  /** Number of recently visited cells whose control point values are
+   * kept for reuse when the evaluation point returns to them.  Moving by
+   * one cell along an axis always reuses the overlapping control points
+   * of the current cell.  Zero disables the cell cache.  Default is 8.
+   */
+  tubeGetMacro( CellCacheSize, unsigned int );
+  virtual void SetCellCacheSize( unsigned int cellCacheSize );
+
+  /** Number of times the control points had to be (partially or fully)
+   * refetched through the UserFunction, and number of cell changes that
+   * were served from the cell cache. */
+  tubeGetMacro( NumberOfCellRefills, unsigned long );
+  tubeGetMacro( NumberOfCellCacheHits, unsigned long );
+
   /** Calculates the local extreme using the supplied instance of a
    * derivation of OptimizerND.  Function returns true on successful local
    * extreme finding, false otherwise.
@@ -258,6 +275,18 @@ protected:
 
   void m_GetData( const VectorType & x );
 
+  /** Control point values of a previously visited cell */
+  struct CellCacheEntryType
+    {
+    IntVectorType          xi;
+    std::vector< double >  data;
+    };
+  typedef std::list< CellCacheEntryType >   CellCacheType;
+
+  void m_CacheCurrentCell( void );
+
+  bool m_RestoreCachedCell( const IntVectorType & xi );
+
   unsigned int                              m_Dimension;
   bool                                      m_Clip;
   IntVectorType                             m_XMin;
@@ -278,6 +307,11 @@ protected:
   OptimizerND::Pointer                      m_OptimizerND;
   Spline1D::Pointer                         m_Spline1D;
 
+  unsigned int                              m_CellCacheSize;
+  CellCacheType                             m_CellCache;
+  unsigned long                             m_NumberOfCellRefills;
+  unsigned long                             m_NumberOfCellCacheHits;
+
 private:
 
   // Copy constructor not implemented.
@@ -146,6 +146,12 @@ void
 BSplineImageToImageRegistrationMethod<TImage>
 ::GenerateData( void )
 {
+  if( this->GetOptimizationBackendEnum() == Superclass::ITKV4_BACKEND )
+    {
+    itkExceptionMacro( << "The ITKv4 optimization backend does not support "
+      << "BSpline transforms; use ITKV3_BACKEND." );
+    }
+
   typename TransformType::Pointer tmpTrans = TransformType::New();
   this->SetTransform( tmpTrans );
 
@@ -30,6 +30,8 @@
 #include "itkScaleSkewVersor3DImageToImageRegistrationMethod.h"
 #include "itkBSplineImageToImageRegistrationMethod.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -97,6 +99,9 @@ public:
   typedef typename OptimizedRegistrationMethodType::InterpolationMethodEnumType
   InterpolationMethodEnumType;
 
+  typedef typename OptimizedRegistrationMethodType::OptimizationBackendEnumType
+  OptimizationBackendEnumType;
+
   enum InitialMethodEnumType { INIT_WITH_NONE,
                                INIT_WITH_CURRENT_RESULTS,
                                INIT_WITH_IMAGE_CENTERS,
@@ -144,6 +149,10 @@ public:
   typedef typename BSplineRegistrationMethodType::TransformType
   BSplineTransformType;
 
+  /** Shrink factors, or maximum iterations, of the levels of a stage,
+   * from the coarsest level to the finest. */
+  typedef std::vector< unsigned int > PyramidScheduleType;
+
   //
   // Custom Methods
   //
@@ -307,12 +316,20 @@ public:
   void SetRegistration( RegistrationMethodEnumType reg );
   void SetInterpolation( InterpolationMethodEnumType interp );
   void SetMetric( MetricMethodEnumType metric );
+  /** Set the optimization backend of the rigid and affine stages.  The
+   * BSpline stage only supports ITKV3_BACKEND. */
+  void SetOptimizationBackend( OptimizationBackendEnumType backend );
 
   // **************
   // Specify the optimizer
   // **************
   itkSetMacro( UseEvolutionaryOptimization, bool );
   itkGetMacro( UseEvolutionaryOptimization, bool );
+
+  /** Number of evolutionary chains run in parallel by the stages that
+   * use evolutionary optimization. */
+  itkSetMacro( NumberOfEvolutionaryStarts, unsigned int );
+  itkGetMacro( NumberOfEvolutionaryStarts, unsigned int );
   // **************
   // Specify the expected magnitudes within the transform.  Used to
   //   guide the operating space of the optimizers
@@ -372,6 +389,20 @@ public:
   itkGetMacro( MinimizeMemory, bool );
   itkBooleanMacro( MinimizeMemory );
 
+  // **************
+  //  Coarse-to-fine registration.  Each stage can be run on a pyramid of
+  //  levels, from the coarsest to the finest.  A level registers the fixed
+  //  and moving images smoothed and shrunk by its shrink factor, starting
+  //  from the transform of the previous level; the moving image is not
+  //  resampled between levels.  The number of samples of a level is its
+  //  stage's sampling ratio times the number of pixels of the shrunk fixed
+  //  image.  Only the first level of a stage may use evolutionary
+  //  optimization.  An empty schedule runs the stage at full resolution.
+  // **************
+  /** Use numberOfLevels levels, shrunk by 2^(numberOfLevels-1), ..., 2, 1,
+   * in every stage.  One level disables the pyramid. */
+  void SetPyramidNumberOfLevels( unsigned int numberOfLevels );
+
   //
   // Loaded transforms parameters
   //
@@ -418,6 +449,26 @@ public:
   itkGetConstMacro( RigidInterpolationMethodEnum,
     InterpolationMethodEnumType );
 
+  itkSetMacro( RigidOptimizationBackendEnum, OptimizationBackendEnumType );
+  itkGetConstMacro( RigidOptimizationBackendEnum,
+    OptimizationBackendEnumType );
+
+  /** Shrink factors of the rigid levels.  If not empty, the maximum
+   * iterations of each level are given by RigidPyramidMaxIterations, or
+   * are RigidMaxIterations. */
+  void SetRigidPyramidShrinkFactors( const PyramidScheduleType & factors );
+  const PyramidScheduleType & GetRigidPyramidShrinkFactors( void ) const
+    {
+    return m_RigidPyramidShrinkFactors;
+    }
+
+  void SetRigidPyramidMaxIterations(
+    const PyramidScheduleType & iterations );
+  const PyramidScheduleType & GetRigidPyramidMaxIterations( void ) const
+    {
+    return m_RigidPyramidMaxIterations;
+    }
+
   itkGetConstObjectMacro( RigidTransform, RigidTransformType );
   itkGetMacro( RigidMetricValue, double );
 
@@ -440,6 +491,26 @@ public:
   itkGetConstMacro( AffineInterpolationMethodEnum,
     InterpolationMethodEnumType );
 
+  itkSetMacro( AffineOptimizationBackendEnum, OptimizationBackendEnumType );
+  itkGetConstMacro( AffineOptimizationBackendEnum,
+    OptimizationBackendEnumType );
+
+  /** Shrink factors of the affine levels.  If not empty, the maximum
+   * iterations of each level are given by AffinePyramidMaxIterations, or
+   * are AffineMaxIterations. */
+  void SetAffinePyramidShrinkFactors( const PyramidScheduleType & factors );
+  const PyramidScheduleType & GetAffinePyramidShrinkFactors( void ) const
+    {
+    return m_AffinePyramidShrinkFactors;
+    }
+
+  void SetAffinePyramidMaxIterations(
+    const PyramidScheduleType & iterations );
+  const PyramidScheduleType & GetAffinePyramidMaxIterations( void ) const
+    {
+    return m_AffinePyramidMaxIterations;
+    }
+
   itkGetConstObjectMacro( AffineTransform, AffineTransformType );
   itkGetMacro( AffineMetricValue, double );
 
@@ -466,6 +537,28 @@ public:
   itkGetConstMacro( BSplineInterpolationMethodEnum,
     InterpolationMethodEnumType );
 
+  /** Only ITKV3_BACKEND is supported; the BSpline stage throws with
+   * ITKV4_BACKEND. */
+  itkSetMacro( BSplineOptimizationBackendEnum, OptimizationBackendEnumType );
+  itkGetConstMacro( BSplineOptimizationBackendEnum,
+    OptimizationBackendEnumType );
+
+  /** Shrink factors of the bspline levels.  If not empty, the maximum
+   * iterations of each level are given by BSplinePyramidMaxIterations, or
+   * are BSplineMaxIterations. */
+  void SetBSplinePyramidShrinkFactors( const PyramidScheduleType & factors );
+  const PyramidScheduleType & GetBSplinePyramidShrinkFactors( void ) const
+    {
+    return m_BSplinePyramidShrinkFactors;
+    }
+
+  void SetBSplinePyramidMaxIterations(
+    const PyramidScheduleType & iterations );
+  const PyramidScheduleType & GetBSplinePyramidMaxIterations( void ) const
+    {
+    return m_BSplinePyramidMaxIterations;
+    }
+
   itkGetConstObjectMacro( BSplineTransform, BSplineTransformType );
   itkGetMacro( BSplineMetricValue, double );
 protected:
@@ -475,19 +568,61 @@ protected:
 
   void PrintSelfHelper( std::ostream & os, Indent indent,
     const std::string & basename, MetricMethodEnumType metric,
-    InterpolationMethodEnumType interpolation ) const;
+    InterpolationMethodEnumType interpolation,
+    OptimizationBackendEnumType backend ) const;
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
 private:
 
   template< int tmpImageDimension >
-  void AffineRegND() 
-   { typename Image< double, tmpImageDimension >::Pointer t; AffineRegND( t ); }
-
-  void AffineRegND( Image< double, 2 > * t );
-
-  void AffineRegND( Image< double, 3 > * t );
+  void AffineRegND( const TImage * fixedImage, const TImage * movingImage,
+    unsigned int maxIterations, bool firstLevel )
+    {
+    typename Image< double, tmpImageDimension >::Pointer t;
+    AffineRegND( t, fixedImage, movingImage, maxIterations, firstLevel );
+    }
+
+  void AffineRegND( Image< double, 2 > * t, const TImage * fixedImage,
+    const TImage * movingImage, unsigned int maxIterations,
+    bool firstLevel );
+
+  void AffineRegND( Image< double, 3 > * t, const TImage * fixedImage,
+    const TImage * movingImage, unsigned int maxIterations,
+    bool firstLevel );
+
+  void RigidReg( const TImage * fixedImage, const TImage * movingImage,
+    unsigned int maxIterations, bool firstLevel );
+
+  void BSplineReg( const TImage * fixedImage, const TImage * movingImage,
+    unsigned int maxIterations, bool firstLevel );
+
+  /** The image smoothed and shrunk by shrinkFactor; the image itself if
+   * shrinkFactor is one.  Unless MinimizeMemory is set, results are kept
+   * until Initialize(), or until their source image is replaced. */
+  typename TImage::ConstPointer GetPyramidImage( const TImage * image,
+    unsigned int shrinkFactor );
+
+  /** Release the pyramid images whose source is neither the fixed image
+   * nor the current moving image, e.g. the moving image replaced by its
+   * resampling before the BSpline stage. */
+  void ReleaseStalePyramidImages( void );
+
+  /** The shrink factor and maximum iterations of each level of a stage */
+  void GetPyramidSchedule( const PyramidScheduleType & shrinkFactors,
+    const PyramidScheduleType & maxIterations,
+    unsigned int defaultMaxIterations, PyramidScheduleType & levelFactors,
+    PyramidScheduleType & levelIterations ) const;
+
+  void PrintPyramidSchedule( std::ostream & os, Indent indent,
+    const std::string & name, const PyramidScheduleType & schedule ) const;
+
+  struct PyramidImageType
+    {
+    typename TImage::ConstPointer Source;
+    unsigned int                  ShrinkFactor;
+    typename TImage::ConstPointer Image;
+    };
 
   typedef typename InitialRegistrationMethodType::LandmarkPointType
   LandmarkPointType;
@@ -561,9 +696,13 @@ private:
 
   bool m_MinimizeMemory;
 
+  std::vector< PyramidImageType > m_PyramidImages;
+
   //  Optimizer
   bool m_UseEvolutionaryOptimization;
 
+  unsigned int m_NumberOfEvolutionaryStarts;
+
   //  Loaded Tansform
   typename MatrixTransformType::Pointer   m_LoadedMatrixTransform;
   typename BSplineTransformType::Pointer  m_LoadedBSplineTransform;
@@ -583,9 +722,13 @@ private:
   typename RigidTransformType::Pointer    m_RigidTransform;
   MetricMethodEnumType                    m_RigidMetricMethodEnum;
   InterpolationMethodEnumType             m_RigidInterpolationMethodEnum;
+  OptimizationBackendEnumType             m_RigidOptimizationBackendEnum;
 
   double m_RigidMetricValue;
 
+  PyramidScheduleType m_RigidPyramidShrinkFactors;
+  PyramidScheduleType m_RigidPyramidMaxIterations;
+
   //  Affine Parameters
   double       m_AffineSamplingRatio;
   double       m_AffineTargetError;
@@ -594,9 +737,16 @@ private:
   typename AffineTransformType::Pointer   m_AffineTransform;
   MetricMethodEnumType                    m_AffineMetricMethodEnum;
   InterpolationMethodEnumType             m_AffineInterpolationMethodEnum;
+  OptimizationBackendEnumType             m_AffineOptimizationBackendEnum;
 
   double m_AffineMetricValue;
 
+  PyramidScheduleType m_AffinePyramidShrinkFactors;
+  PyramidScheduleType m_AffinePyramidMaxIterations;
+
+  // Parameters of the typed transform of the last affine level
+  typename AffineTransformType::ParametersType m_AffineLevelParameters;
+
   //  BSpline Parameters
   double       m_BSplineSamplingRatio;
   double       m_BSplineTargetError;
@@ -606,9 +756,13 @@ private:
   typename BSplineTransformType::Pointer  m_BSplineTransform;
   MetricMethodEnumType                    m_BSplineMetricMethodEnum;
   InterpolationMethodEnumType             m_BSplineInterpolationMethodEnum;
+  OptimizationBackendEnumType             m_BSplineOptimizationBackendEnum;
 
   double m_BSplineMetricValue;
 
+  PyramidScheduleType m_BSplinePyramidShrinkFactors;
+  PyramidScheduleType m_BSplinePyramidMaxIterations;
+
 };
 
 }
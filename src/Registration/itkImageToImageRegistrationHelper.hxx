@@ -33,9 +33,13 @@
 #include "itkTransformFactory.h"
 #include "itkSubtractImageFilter.h"
 #include "itkMinimumMaximumImageCalculator.h"
+#include "itkShrinkImageFilter.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
 #include "itkVector.h"
 #include "itkAffineTransform.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -108,6 +112,7 @@ ImageToImageRegistrationHelper<TImage>
   m_MinimizeMemory = false;
   // Optimizer
   m_UseEvolutionaryOptimization = true ;
+  m_NumberOfEvolutionaryStarts = 1;
   // Loaded
   m_LoadedMatrixTransform = NULL;
   m_LoadedBSplineTransform = NULL;
@@ -123,6 +128,8 @@ ImageToImageRegistrationHelper<TImage>
   m_RigidTransform = NULL;
   m_RigidMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
+  m_RigidOptimizationBackendEnum =
+    OptimizedRegistrationMethodType::ITKV3_BACKEND;
   m_RigidInterpolationMethodEnum =
     OptimizedRegistrationMethodType::LINEAR_INTERPOLATION;
   m_RigidMetricValue = 0.0;
@@ -134,6 +141,8 @@ ImageToImageRegistrationHelper<TImage>
   m_AffineTransform = NULL;
   m_AffineMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
+  m_AffineOptimizationBackendEnum =
+    OptimizedRegistrationMethodType::ITKV3_BACKEND;
   m_AffineInterpolationMethodEnum =
     OptimizedRegistrationMethodType::LINEAR_INTERPOLATION;
   m_AffineMetricValue = 0.0;
@@ -146,6 +155,8 @@ ImageToImageRegistrationHelper<TImage>
   m_BSplineTransform = NULL;
   m_BSplineMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
+  m_BSplineOptimizationBackendEnum =
+    OptimizedRegistrationMethodType::ITKV3_BACKEND;
   m_BSplineInterpolationMethodEnum =
     OptimizedRegistrationMethodType::BSPLINE_INTERPOLATION;
   m_BSplineMetricValue = 0.0;
@@ -353,6 +364,15 @@ ImageToImageRegistrationHelper<TImage>
   this->SetBSplineMetricMethodEnum( metric );
 }
 
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetOptimizationBackend( OptimizationBackendEnumType backend )
+{
+  this->SetRigidOptimizationBackendEnum( backend );
+  this->SetAffineOptimizationBackendEnum( backend );
+}
+
 template <class TImage>
 void
 ImageToImageRegistrationHelper<TImage>
@@ -392,28 +412,231 @@ ImageToImageRegistrationHelper<TImage>
   m_LoadedTransformResampledImage = 0;
   m_MatrixTransformResampledImage = 0;
   m_BSplineTransformResampledImage = 0;
+
+  m_PyramidImages.clear();
+  m_AffineLevelParameters.set_size( 0 );
 }
 
 template <class TImage>
 void
 ImageToImageRegistrationHelper<TImage>
-::AffineRegND( Image< double, 2 > * itkNotUsed( tmpImage ) )
+::SetPyramidNumberOfLevels( unsigned int numberOfLevels )
 {
-  if( this->GetReportProgress() )
+  PyramidScheduleType factors;
+  if( numberOfLevels > 1 )
+    {
+    for( unsigned int level = 0; level < numberOfLevels; ++level )
+      {
+      factors.push_back( 1u << ( numberOfLevels - 1 - level ) );
+      }
+    }
+
+  this->SetRigidPyramidShrinkFactors( factors );
+  this->SetAffinePyramidShrinkFactors( factors );
+  this->SetBSplinePyramidShrinkFactors( factors );
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetRigidPyramidShrinkFactors( const PyramidScheduleType & factors )
+{
+  if( m_RigidPyramidShrinkFactors != factors )
+    {
+    m_RigidPyramidShrinkFactors = factors;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetRigidPyramidMaxIterations( const PyramidScheduleType & iterations )
+{
+  if( m_RigidPyramidMaxIterations != iterations )
+    {
+    m_RigidPyramidMaxIterations = iterations;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetAffinePyramidShrinkFactors( const PyramidScheduleType & factors )
+{
+  if( m_AffinePyramidShrinkFactors != factors )
+    {
+    m_AffinePyramidShrinkFactors = factors;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetAffinePyramidMaxIterations( const PyramidScheduleType & iterations )
+{
+  if( m_AffinePyramidMaxIterations != iterations )
+    {
+    m_AffinePyramidMaxIterations = iterations;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetBSplinePyramidShrinkFactors( const PyramidScheduleType & factors )
+{
+  if( m_BSplinePyramidShrinkFactors != factors )
+    {
+    m_BSplinePyramidShrinkFactors = factors;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::SetBSplinePyramidMaxIterations( const PyramidScheduleType & iterations )
+{
+  if( m_BSplinePyramidMaxIterations != iterations )
+    {
+    m_BSplinePyramidMaxIterations = iterations;
+    this->Modified();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::GetPyramidSchedule( const PyramidScheduleType & shrinkFactors,
+  const PyramidScheduleType & maxIterations,
+  unsigned int defaultMaxIterations, PyramidScheduleType & levelFactors,
+  PyramidScheduleType & levelIterations ) const
+{
+  levelFactors.clear();
+  levelIterations.clear();
+
+  if( shrinkFactors.empty() )
+    {
+    levelFactors.push_back( 1 );
+    levelIterations.push_back( defaultMaxIterations );
+    return;
+    }
+
+  for( unsigned int level = 0; level < shrinkFactors.size(); ++level )
+    {
+    levelFactors.push_back( std::max( shrinkFactors[level], 1u ) );
+    if( level < maxIterations.size() )
+      {
+      levelIterations.push_back( maxIterations[level] );
+      }
+    else
+      {
+      levelIterations.push_back( defaultMaxIterations );
+      }
+    }
+}
+
+template <class TImage>
+typename TImage::ConstPointer
+ImageToImageRegistrationHelper<TImage>
+::GetPyramidImage( const TImage * image, unsigned int shrinkFactor )
+{
+  this->ReleaseStalePyramidImages();
+
+  if( shrinkFactor <= 1 )
+    {
+    return image;
+    }
+
+  for( unsigned int i = 0; i < m_PyramidImages.size(); ++i )
+    {
+    if( m_PyramidImages[i].Source.GetPointer() == image
+      && m_PyramidImages[i].ShrinkFactor == shrinkFactor )
+      {
+      return m_PyramidImages[i].Image;
+      }
+    }
+
+  // Smooth before shrinking, to avoid aliasing
+  typedef SmoothingRecursiveGaussianImageFilter< TImage, TImage >
+    SmoothFilterType;
+  typename SmoothFilterType::Pointer smoothFilter = SmoothFilterType::New();
+  smoothFilter->SetInput( image );
+  typename SmoothFilterType::SigmaArrayType sigmas;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    sigmas[i] = 0.5 * shrinkFactor * image->GetSpacing()[i];
+    }
+  smoothFilter->SetSigmaArray( sigmas );
+
+  typedef ShrinkImageFilter< TImage, TImage > ShrinkFilterType;
+  typename ShrinkFilterType::Pointer shrinkFilter = ShrinkFilterType::New();
+  shrinkFilter->SetInput( smoothFilter->GetOutput() );
+  shrinkFilter->SetShrinkFactors( shrinkFactor );
+  shrinkFilter->Update();
+
+  typename TImage::Pointer shrunkImage = shrinkFilter->GetOutput();
+  shrunkImage->DisconnectPipeline();
+
+  if( !m_MinimizeMemory )
+    {
+    PyramidImageType pyramidImage;
+    pyramidImage.Source = image;
+    pyramidImage.ShrinkFactor = shrinkFactor;
+    pyramidImage.Image = shrunkImage.GetPointer();
+    m_PyramidImages.push_back( pyramidImage );
+    }
+
+  return shrunkImage.GetPointer();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::ReleaseStalePyramidImages( void )
+{
+  typename std::vector< PyramidImageType >::iterator it =
+    m_PyramidImages.begin();
+  while( it != m_PyramidImages.end() )
+    {
+    if( it->Source.GetPointer() != m_FixedImage.GetPointer()
+      && it->Source.GetPointer() != m_CurrentMovingImage.GetPointer() )
+      {
+      it = m_PyramidImages.erase( it );
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::AffineRegND( Image< double, 2 > * itkNotUsed( tmpImage ),
+  const TImage * fixedImage, const TImage * movingImage,
+  unsigned int maxIterations, bool firstLevel )
+{
+  if( this->GetReportProgress() && firstLevel )
     {
     std::cout << "*** AFFINE REGISTRATION ***" << std::endl;
     }
 
   std::cout << "Start affine" << std::endl;
-  unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
+  unsigned long fixedImageNumPixels = fixedImage->GetLargestPossibleRegion()
     .GetNumberOfPixels();
 
   typename Affine2DRegistrationMethodType::Pointer regAff
     = Affine2DRegistrationMethodType::New();
   regAff->SetRandomNumberSeed( m_RandomNumberSeed );
   regAff->SetReportProgress( m_ReportProgress );
-  regAff->SetMovingImage( m_CurrentMovingImage );
-  regAff->SetFixedImage( m_FixedImage );
+  regAff->SetMovingImage( movingImage );
+  regAff->SetFixedImage( fixedImage );
   regAff->SetNumberOfSamples( (unsigned int)(m_AffineSamplingRatio
     * fixedImageNumPixels) );
   if( m_UseRegionOfInterest )
@@ -423,9 +646,10 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetSampleFromOverlap( m_SampleFromOverlap );
   regAff->SetMinimizeMemory( m_MinimizeMemory );
-  regAff->SetMaxIterations( m_AffineMaxIterations );
+  regAff->SetMaxIterations( maxIterations );
   regAff->SetTargetError( m_AffineTargetError );
-  if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization )
+  if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization
+    || !firstLevel )
     {
     regAff->SetUseEvolutionaryOptimization( false );
     }
@@ -448,7 +672,7 @@ ImageToImageRegistrationHelper<TImage>
     {
     typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
     typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-    calc->SetImage( m_FixedImage );
+    calc->SetImage( fixedImage );
     calc->Compute();
     PixelType fixedImageMax = calc->GetMaximum();
     PixelType fixedImageMin = calc->GetMinimum();
@@ -459,6 +683,8 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
   regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
+  regAff->SetOptimizationBackendEnum( m_AffineOptimizationBackendEnum );
+  regAff->SetNumberOfEvolutionaryStarts( m_NumberOfEvolutionaryStarts );
   typename AffineTransformType::ParametersType scales;
   scales.set_size( 7 );
   unsigned int scaleNum = 0;
@@ -471,7 +697,18 @@ ImageToImageRegistrationHelper<TImage>
   scales[scaleNum++] = 1.0 / ( m_ExpectedSkewMagnitude );
   regAff->SetTransformParametersScales( scales );
 
-  if( m_CurrentMatrixTransform.IsNotNull() )
+  if( !firstLevel && m_AffineLevelParameters.size()
+    == regAff->GetTypedTransform()->GetNumberOfParameters() )
+    {
+    // Continue from the previous level; its scales and skews are not
+    //   recoverable from m_CurrentMatrixTransform
+    regAff->GetTypedTransform()->SetCenter(
+      m_CurrentMatrixTransform->GetCenter() );
+    regAff->SetInitialTransformParameters( m_AffineLevelParameters );
+    regAff->SetInitialTransformFixedParameters(
+      regAff->GetTypedTransform()->GetFixedParameters() );
+    }
+  else if( m_CurrentMatrixTransform.IsNotNull() )
     {
     regAff->GetTypedTransform()->SetCenter(
       m_CurrentMatrixTransform->GetCenter() );
@@ -487,6 +724,7 @@ ImageToImageRegistrationHelper<TImage>
 
   regAff->Update();
 
+  m_AffineLevelParameters = regAff->GetTypedTransform()->GetParameters();
   m_AffineTransform = regAff->GetAffineTransform();
   m_CurrentMatrixTransform = m_AffineTransform;
   m_CurrentBSplineTransform = 0;
@@ -501,22 +739,24 @@ ImageToImageRegistrationHelper<TImage>
 template <class TImage>
 void
 ImageToImageRegistrationHelper<TImage>
-::AffineRegND( Image< double, 3 > * itkNotUsed( tmpImage ) )
+::AffineRegND( Image< double, 3 > * itkNotUsed( tmpImage ),
+  const TImage * fixedImage, const TImage * movingImage,
+  unsigned int maxIterations, bool firstLevel )
 {
-  if( this->GetReportProgress() )
+  if( this->GetReportProgress() && firstLevel )
     {
     std::cout << "*** AFFINE REGISTRATION ***" << std::endl;
     }
 
-  unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
+  unsigned long fixedImageNumPixels = fixedImage->GetLargestPossibleRegion()
     .GetNumberOfPixels();
 
   typename Affine3DRegistrationMethodType::Pointer regAff =
     Affine3DRegistrationMethodType::New();
   regAff->SetRandomNumberSeed( m_RandomNumberSeed );
   regAff->SetReportProgress( m_ReportProgress );
-  regAff->SetMovingImage( m_CurrentMovingImage );
-  regAff->SetFixedImage( m_FixedImage );
+  regAff->SetMovingImage( movingImage );
+  regAff->SetFixedImage( fixedImage );
   regAff->SetNumberOfSamples( (unsigned int)(m_AffineSamplingRatio
     * fixedImageNumPixels) );
   if( m_UseRegionOfInterest )
@@ -526,9 +766,10 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetSampleFromOverlap( m_SampleFromOverlap );
   regAff->SetMinimizeMemory( m_MinimizeMemory );
-  regAff->SetMaxIterations( m_AffineMaxIterations );
+  regAff->SetMaxIterations( maxIterations );
   regAff->SetTargetError( m_AffineTargetError );
-  if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization )
+  if( m_EnableRigidRegistration || !m_UseEvolutionaryOptimization
+    || !firstLevel )
     {
     regAff->SetUseEvolutionaryOptimization( false );
     }
@@ -551,7 +792,7 @@ ImageToImageRegistrationHelper<TImage>
     {
     typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
     typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-    calc->SetImage( m_FixedImage );
+    calc->SetImage( fixedImage );
     calc->Compute();
     PixelType fixedImageMax = calc->GetMaximum();
     PixelType fixedImageMin = calc->GetMinimum();
@@ -562,6 +803,8 @@ ImageToImageRegistrationHelper<TImage>
     }
   regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
   regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
+  regAff->SetOptimizationBackendEnum( m_AffineOptimizationBackendEnum );
+  regAff->SetNumberOfEvolutionaryStarts( m_NumberOfEvolutionaryStarts );
   typename AffineTransformType::ParametersType scales;
 
   scales.set_size( 12 );
@@ -580,7 +823,18 @@ ImageToImageRegistrationHelper<TImage>
   scales[scaleNum++] = 1.0 / ( m_ExpectedSkewMagnitude );
   regAff->SetTransformParametersScales( scales );
 
-  if( m_CurrentMatrixTransform.IsNotNull() )
+  if( !firstLevel && m_AffineLevelParameters.size()
+    == regAff->GetTypedTransform()->GetNumberOfParameters() )
+    {
+    // Continue from the previous level; its scales and skews are not
+    //   recoverable from m_CurrentMatrixTransform
+    regAff->GetTypedTransform()->SetCenter(
+      m_CurrentMatrixTransform->GetCenter() );
+    regAff->SetInitialTransformParameters( m_AffineLevelParameters );
+    regAff->SetInitialTransformFixedParameters(
+      regAff->GetTypedTransform()->GetFixedParameters() );
+    }
+  else if( m_CurrentMatrixTransform.IsNotNull() )
     {
     regAff->GetTypedTransform()->SetCenter(
       m_CurrentMatrixTransform->GetCenter() );
@@ -596,6 +850,7 @@ ImageToImageRegistrationHelper<TImage>
 
   regAff->Update();
 
+  m_AffineLevelParameters = regAff->GetTypedTransform()->GetParameters();
   m_AffineTransform = regAff->GetAffineTransform();
   m_CurrentMatrixTransform = m_AffineTransform;
   m_CurrentBSplineTransform = 0;
@@ -607,6 +862,221 @@ ImageToImageRegistrationHelper<TImage>
   m_CompletedResampling = false;
 }
 
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::RigidReg( const TImage * fixedImage, const TImage * movingImage,
+  unsigned int maxIterations, bool firstLevel )
+{
+  unsigned long fixedImageNumPixels = fixedImage->GetLargestPossibleRegion()
+    .GetNumberOfPixels();
+
+  typename RigidRegistrationMethodType::Pointer regRigid;
+  regRigid = RigidRegistrationMethodType::New();
+  regRigid->SetRandomNumberSeed( m_RandomNumberSeed );
+  if( !m_UseEvolutionaryOptimization || !firstLevel )
+    {
+    regRigid->SetUseEvolutionaryOptimization( false );
+    }
+  regRigid->SetReportProgress( m_ReportProgress );
+  regRigid->SetMovingImage( movingImage );
+  regRigid->SetFixedImage( fixedImage );
+  regRigid->SetNumberOfSamples( (unsigned int)( m_RigidSamplingRatio
+                                                * fixedImageNumPixels ) );
+  regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
+  regRigid->SetMinimizeMemory( m_MinimizeMemory );
+  regRigid->SetMaxIterations( maxIterations );
+  regRigid->SetTargetError( m_RigidTargetError );
+  if( m_UseFixedImageMaskObject )
+    {
+    if( m_FixedImageMaskObject.IsNotNull() )
+      {
+      regRigid->SetFixedImageMaskObject( m_FixedImageMaskObject );
+      }
+    }
+  if( m_UseMovingImageMaskObject )
+    {
+    if( m_MovingImageMaskObject.IsNotNull() )
+      {
+      regRigid->SetMovingImageMaskObject( m_MovingImageMaskObject );
+      }
+    }
+  if( m_SampleIntensityPortion > 0 )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( fixedImage );
+    calc->Compute();
+    PixelType fixedImageMax = calc->GetMaximum();
+    PixelType fixedImageMin = calc->GetMinimum();
+
+    regRigid->SetFixedImageSamplesIntensityThreshold(
+      static_cast<PixelType>( ( m_SampleIntensityPortion *
+      (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+    }
+  if( m_UseRegionOfInterest )
+    {
+    regRigid->SetRegionOfInterest( m_RegionOfInterestPoint1,
+      m_RegionOfInterestPoint2 );
+    }
+  regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
+  regRigid->SetMetricMethodEnum( m_RigidMetricMethodEnum );
+  regRigid->SetInterpolationMethodEnum( m_RigidInterpolationMethodEnum );
+  regRigid->SetOptimizationBackendEnum( m_RigidOptimizationBackendEnum );
+  regRigid->SetNumberOfEvolutionaryStarts( m_NumberOfEvolutionaryStarts );
+  typename RigidTransformType::ParametersType scales;
+  if( ImageDimension == 2 )
+    {
+    scales.set_size( 3 );
+    scales[0] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[1] = 1.0 / m_ExpectedOffsetMagnitude;
+    scales[2] = 1.0 / m_ExpectedOffsetMagnitude;
+    }
+  else if( ImageDimension == 3 )
+    {
+    scales.set_size( 6 );
+    scales[0] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[1] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[2] = 1.0 / m_ExpectedRotationMagnitude;
+    scales[3] = 1.0 / m_ExpectedOffsetMagnitude;
+    scales[4] = 1.0 / m_ExpectedOffsetMagnitude;
+    scales[5] = 1.0 / m_ExpectedOffsetMagnitude;
+    }
+  else
+    {
+    std::cerr
+      << "ERROR: Only 2 and 3 dimensional images are supported."
+      << std::endl;
+    }
+  regRigid->SetTransformParametersScales( scales );
+
+  if( m_CurrentMatrixTransform.IsNotNull() )
+    {
+    regRigid->GetTypedTransform()->SetCenter(
+      m_CurrentMatrixTransform->GetCenter() );
+    regRigid->GetTypedTransform()->SetMatrix(
+      m_CurrentMatrixTransform->GetMatrix() );
+    regRigid->GetTypedTransform()->SetOffset(
+      m_CurrentMatrixTransform->GetOffset() );
+    regRigid->SetInitialTransformParameters(
+      regRigid->GetTypedTransform()->GetParameters() );
+    regRigid->SetInitialTransformFixedParameters(
+      regRigid->GetTypedTransform()->GetFixedParameters() );
+    }
+
+  regRigid->Update();
+
+  m_RigidTransform = RigidTransformType::New();
+  m_RigidTransform->SetFixedParameters(
+    regRigid->GetTypedTransform()->GetFixedParameters() );
+  // must call GetAffineTransform here because the typed transform
+  // is a versor and has only 6 parameters (in this code the type
+  // RigidTransform is a 12 parameter transform)
+  m_RigidTransform->SetParametersByValue(
+    regRigid->GetAffineTransform()->GetParameters() );
+  m_CurrentMatrixTransform = regRigid->GetAffineTransform();
+  m_CurrentBSplineTransform = 0;
+
+  m_FinalMetricValue = regRigid->GetFinalMetricValue();
+  m_RigidMetricValue = m_FinalMetricValue;
+
+  m_CompletedStage = RIGID_STAGE;
+  m_CompletedResampling = false;
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::BSplineReg( const TImage * fixedImage, const TImage * movingImage,
+  unsigned int maxIterations, bool firstLevel )
+{
+  typename TImage::SizeType fixedImageSize;
+  fixedImageSize = m_FixedImage->GetLargestPossibleRegion().GetSize();
+  unsigned long fixedImageNumPixels = fixedImage->GetLargestPossibleRegion()
+    .GetNumberOfPixels();
+
+  typename BSplineRegistrationMethodType::Pointer regBspline =
+    BSplineRegistrationMethodType::New();
+  if( m_EnableAffineRegistration || !m_UseEvolutionaryOptimization
+    || !firstLevel )
+    {
+    regBspline->SetUseEvolutionaryOptimization( false );
+    }
+  regBspline->SetRandomNumberSeed( m_RandomNumberSeed );
+  regBspline->SetReportProgress( m_ReportProgress );
+  regBspline->SetFixedImage( fixedImage );
+  regBspline->SetMovingImage( movingImage );
+  regBspline->SetNumberOfSamples( (unsigned int)(
+      m_BSplineSamplingRatio * fixedImageNumPixels) );
+  if( m_UseRegionOfInterest )
+    {
+    regBspline->SetRegionOfInterest( m_RegionOfInterestPoint1,
+      m_RegionOfInterestPoint2 );
+    }
+  regBspline->SetSampleFromOverlap( m_SampleFromOverlap );
+  regBspline->SetMinimizeMemory( m_MinimizeMemory );
+  regBspline->SetMaxIterations( maxIterations );
+  regBspline->SetExpectedDeformationMagnitude( m_ExpectedDeformationMagnitude );
+  regBspline->SetTargetError( m_BSplineTargetError );
+  if( m_UseFixedImageMaskObject )
+    {
+    if( m_FixedImageMaskObject.IsNotNull() )
+      {
+      regBspline->SetFixedImageMaskObject( m_FixedImageMaskObject );
+      }
+    }
+  if( m_UseMovingImageMaskObject )
+    {
+    if( m_MovingImageMaskObject.IsNotNull() )
+      {
+      regBspline->SetMovingImageMaskObject( m_MovingImageMaskObject );
+      }
+    }
+  if( m_SampleIntensityPortion > 0 )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( fixedImage );
+    calc->Compute();
+    PixelType fixedImageMax = calc->GetMaximum();
+    PixelType fixedImageMin = calc->GetMinimum();
+
+    regBspline->SetFixedImageSamplesIntensityThreshold(
+      static_cast<PixelType>( ( m_SampleIntensityPortion
+      * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+    }
+  regBspline->SetMetricMethodEnum( m_BSplineMetricMethodEnum );
+  regBspline->SetInterpolationMethodEnum(
+    m_BSplineInterpolationMethodEnum );
+  regBspline->SetOptimizationBackendEnum( m_BSplineOptimizationBackendEnum );
+  regBspline->SetNumberOfEvolutionaryStarts( m_NumberOfEvolutionaryStarts );
+  // The grid depends on the full resolution image, so that every level
+  //   has the same parameters
+  regBspline->SetNumberOfControlPoints( (int)(fixedImageSize[0] /
+    m_BSplineControlPointPixelSpacing) );
+  if( !firstLevel && m_BSplineTransform.IsNotNull() )
+    {
+    regBspline->SetInitialTransformParameters(
+      m_BSplineTransform->GetParameters() );
+    }
+
+  regBspline->Update();
+
+  m_BSplineTransform = regBspline->GetBSplineTransform();
+  m_CurrentBSplineTransform = m_BSplineTransform;
+
+  m_FinalMetricValue = regBspline->GetFinalMetricValue();
+  m_BSplineMetricValue = m_FinalMetricValue;
+
+  m_CompletedStage = BSPLINE_STAGE;
+  m_CompletedResampling = false;
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "BSpline results stored" << std::endl;
+    }
+}
+
 /** This class provides an Update() method to fit the appearance of a
  * ProcessObject API, but it is not a ProcessObject.  */
 template <class TImage>
@@ -733,10 +1203,8 @@ ImageToImageRegistrationHelper<TImage>
   m_CompletedStage = INIT_STAGE;
   m_CompletedResampling = false;
 
-  typename TImage::SizeType fixedImageSize;
-  fixedImageSize = m_FixedImage->GetLargestPossibleRegion().GetSize();
-  unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
-    .GetNumberOfPixels();
+  PyramidScheduleType levelFactors;
+  PyramidScheduleType levelIterations;
 
   if( m_EnableRigidRegistration )
     {
@@ -745,120 +1213,48 @@ ImageToImageRegistrationHelper<TImage>
       std::cout << "*** RIGID REGISTRATION ***" << std::endl;
       }
 
-    typename RigidRegistrationMethodType::Pointer regRigid;
-    regRigid = RigidRegistrationMethodType::New();
-    regRigid->SetRandomNumberSeed( m_RandomNumberSeed );
-    if( !m_UseEvolutionaryOptimization )
-      {
-      regRigid->SetUseEvolutionaryOptimization( false );
-      }
-    regRigid->SetReportProgress( m_ReportProgress );
-    regRigid->SetMovingImage( m_CurrentMovingImage );
-    regRigid->SetFixedImage( m_FixedImage );
-    regRigid->SetNumberOfSamples( (unsigned int)( m_RigidSamplingRatio
-                                                  * fixedImageNumPixels ) );
-    regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
-    regRigid->SetMinimizeMemory( m_MinimizeMemory );
-    regRigid->SetMaxIterations( m_RigidMaxIterations );
-    regRigid->SetTargetError( m_RigidTargetError );
-    if( m_UseFixedImageMaskObject )
-      {
-      if( m_FixedImageMaskObject.IsNotNull() )
-        {
-        regRigid->SetFixedImageMaskObject( m_FixedImageMaskObject );
-        }
-      }
-    if( m_UseMovingImageMaskObject )
+    this->GetPyramidSchedule( m_RigidPyramidShrinkFactors,
+      m_RigidPyramidMaxIterations, m_RigidMaxIterations, levelFactors,
+      levelIterations );
+    for( unsigned int level = 0; level < levelFactors.size(); ++level )
       {
-      if( m_MovingImageMaskObject.IsNotNull() )
+      if( this->GetReportProgress() && levelFactors.size() > 1 )
         {
-        regRigid->SetMovingImageMaskObject( m_MovingImageMaskObject );
+        std::cout << "  Level " << level + 1 << " of "
+          << levelFactors.size() << ", shrink factor = "
+          << levelFactors[level] << std::endl;
         }
+      typename TImage::ConstPointer fixedLevelImage =
+        this->GetPyramidImage( m_FixedImage, levelFactors[level] );
+      typename TImage::ConstPointer movingLevelImage =
+        this->GetPyramidImage( m_CurrentMovingImage, levelFactors[level] );
+      this->RigidReg( fixedLevelImage, movingLevelImage,
+        levelIterations[level], level == 0 );
       }
-    if( m_SampleIntensityPortion > 0 )
-      {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
-      regRigid->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion *
-        (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
-      }
-    if( m_UseRegionOfInterest )
-      {
-      regRigid->SetRegionOfInterest( m_RegionOfInterestPoint1,
-        m_RegionOfInterestPoint2 );
-      }
-    regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
-    regRigid->SetMetricMethodEnum( m_RigidMetricMethodEnum );
-    regRigid->SetInterpolationMethodEnum( m_RigidInterpolationMethodEnum );
-    typename RigidTransformType::ParametersType scales;
-    if( ImageDimension == 2 )
-      {
-      scales.set_size( 3 );
-      scales[0] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[1] = 1.0 / m_ExpectedOffsetMagnitude;
-      scales[2] = 1.0 / m_ExpectedOffsetMagnitude;
-      }
-    else if( ImageDimension == 3 )
-      {
-      scales.set_size( 6 );
-      scales[0] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[1] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[2] = 1.0 / m_ExpectedRotationMagnitude;
-      scales[3] = 1.0 / m_ExpectedOffsetMagnitude;
-      scales[4] = 1.0 / m_ExpectedOffsetMagnitude;
-      scales[5] = 1.0 / m_ExpectedOffsetMagnitude;
-      }
-    else
-      {
-      std::cerr
-        << "ERROR: Only 2 and 3 dimensional images are supported."
-        << std::endl;
-      }
-    regRigid->SetTransformParametersScales( scales );
-
-    if( m_CurrentMatrixTransform.IsNotNull() )
-      {
-      regRigid->GetTypedTransform()->SetCenter(
-        m_CurrentMatrixTransform->GetCenter() );
-      regRigid->GetTypedTransform()->SetMatrix(
-        m_CurrentMatrixTransform->GetMatrix() );
-      regRigid->GetTypedTransform()->SetOffset(
-        m_CurrentMatrixTransform->GetOffset() );
-      regRigid->SetInitialTransformParameters(
-        regRigid->GetTypedTransform()->GetParameters() );
-      regRigid->SetInitialTransformFixedParameters(
-        regRigid->GetTypedTransform()->GetFixedParameters() );
-      }
-
-    regRigid->Update();
-
-    m_RigidTransform = RigidTransformType::New();
-    m_RigidTransform->SetFixedParameters(
-      regRigid->GetTypedTransform()->GetFixedParameters() );
-    // must call GetAffineTransform here because the typed transform
-    // is a versor and has only 6 parameters (in this code the type
-    // RigidTransform is a 12 parameter transform)
-    m_RigidTransform->SetParametersByValue(
-      regRigid->GetAffineTransform()->GetParameters() );
-    m_CurrentMatrixTransform = regRigid->GetAffineTransform();
-    m_CurrentBSplineTransform = 0;
-
-    m_FinalMetricValue = regRigid->GetFinalMetricValue();
-    m_RigidMetricValue = m_FinalMetricValue;
-
-    m_CompletedStage = RIGID_STAGE;
-    m_CompletedResampling = false;
     }
 
   if( m_EnableAffineRegistration )
     {
-    this->AffineRegND<ImageDimension>();
+    // The moving image is not resampled; the affine levels start from
+    //   m_CurrentMatrixTransform
+    this->GetPyramidSchedule( m_AffinePyramidShrinkFactors,
+      m_AffinePyramidMaxIterations, m_AffineMaxIterations, levelFactors,
+      levelIterations );
+    for( unsigned int level = 0; level < levelFactors.size(); ++level )
+      {
+      if( this->GetReportProgress() && levelFactors.size() > 1 )
+        {
+        std::cout << "  Level " << level + 1 << " of "
+          << levelFactors.size() << ", shrink factor = "
+          << levelFactors[level] << std::endl;
+        }
+      typename TImage::ConstPointer fixedLevelImage =
+        this->GetPyramidImage( m_FixedImage, levelFactors[level] );
+      typename TImage::ConstPointer movingLevelImage =
+        this->GetPyramidImage( m_CurrentMovingImage, levelFactors[level] );
+      this->AffineRegND<ImageDimension>( fixedLevelImage, movingLevelImage,
+        levelIterations[level], level == 0 );
+      }
     }
 
   if( m_EnableBSplineRegistration )
@@ -872,77 +1268,26 @@ ImageToImageRegistrationHelper<TImage>
       {
       m_CurrentMovingImage = this->ResampleImage();
       m_CompletedResampling = true;
+      this->ReleaseStalePyramidImages();
       }
 
-    typename BSplineRegistrationMethodType::Pointer regBspline =
-      BSplineRegistrationMethodType::New();
-    if( m_EnableAffineRegistration || !m_UseEvolutionaryOptimization )
-      {
-      regBspline->SetUseEvolutionaryOptimization( false );
-      }
-    regBspline->SetRandomNumberSeed( m_RandomNumberSeed );
-    regBspline->SetReportProgress( m_ReportProgress );
-    regBspline->SetFixedImage( m_FixedImage );
-    regBspline->SetMovingImage( m_CurrentMovingImage );
-    regBspline->SetNumberOfSamples( (unsigned int)(
-        m_BSplineSamplingRatio * fixedImageNumPixels) );
-    if( m_UseRegionOfInterest )
-      {
-      regBspline->SetRegionOfInterest( m_RegionOfInterestPoint1,
-        m_RegionOfInterestPoint2 );
-      }
-    regBspline->SetSampleFromOverlap( m_SampleFromOverlap );
-    regBspline->SetMinimizeMemory( m_MinimizeMemory );
-    regBspline->SetMaxIterations( m_BSplineMaxIterations );
-    regBspline->SetExpectedDeformationMagnitude( m_ExpectedDeformationMagnitude );
-    regBspline->SetTargetError( m_BSplineTargetError );
-    if( m_UseFixedImageMaskObject )
-      {
-      if( m_FixedImageMaskObject.IsNotNull() )
-        {
-        regBspline->SetFixedImageMaskObject( m_FixedImageMaskObject );
-        }
-      }
-    if( m_UseMovingImageMaskObject )
+    this->GetPyramidSchedule( m_BSplinePyramidShrinkFactors,
+      m_BSplinePyramidMaxIterations, m_BSplineMaxIterations, levelFactors,
+      levelIterations );
+    for( unsigned int level = 0; level < levelFactors.size(); ++level )
       {
-      if( m_MovingImageMaskObject.IsNotNull() )
+      if( this->GetReportProgress() && levelFactors.size() > 1 )
         {
-        regBspline->SetMovingImageMaskObject( m_MovingImageMaskObject );
+        std::cout << "  Level " << level + 1 << " of "
+          << levelFactors.size() << ", shrink factor = "
+          << levelFactors[level] << std::endl;
         }
-      }
-    if( m_SampleIntensityPortion > 0 )
-      {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
-      regBspline->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion
-        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
-      }
-    regBspline->SetMetricMethodEnum( m_BSplineMetricMethodEnum );
-    regBspline->SetInterpolationMethodEnum(
-      m_BSplineInterpolationMethodEnum );
-    regBspline->SetNumberOfControlPoints( (int)(fixedImageSize[0] /
-      m_BSplineControlPointPixelSpacing) );
-
-    regBspline->Update();
-
-    m_BSplineTransform = regBspline->GetBSplineTransform();
-    m_CurrentBSplineTransform = m_BSplineTransform;
-
-    m_FinalMetricValue = regBspline->GetFinalMetricValue();
-    m_BSplineMetricValue = m_FinalMetricValue;
-
-    m_CompletedStage = BSPLINE_STAGE;
-    m_CompletedResampling = false;
-
-    if( this->GetReportProgress() )
-      {
-      std::cout << "BSpline results stored" << std::endl;
+      typename TImage::ConstPointer fixedLevelImage =
+        this->GetPyramidImage( m_FixedImage, levelFactors[level] );
+      typename TImage::ConstPointer movingLevelImage =
+        this->GetPyramidImage( m_CurrentMovingImage, levelFactors[level] );
+      this->BSplineReg( fixedLevelImage, movingLevelImage,
+        levelIterations[level], level == 0 );
       }
     }
   // this->SaveImage("c:/result.mha",m_CurrentMovingImage);
@@ -1596,7 +1941,8 @@ ImageToImageRegistrationHelper<TImage>
 ::PrintSelfHelper( std::ostream & os, Indent indent,
                    const std::string & basename,
                    MetricMethodEnumType metric,
-                   InterpolationMethodEnumType interpolation ) const
+                   InterpolationMethodEnumType interpolation,
+                   OptimizationBackendEnumType backend ) const
 {
   switch( metric )
     {
@@ -1642,6 +1988,40 @@ ImageToImageRegistrationHelper<TImage>
         << " Interpolation Method = UNKNOWN" << std::endl;
       break;
     }
+
+  switch( backend )
+    {
+    case OptimizedRegistrationMethodType::ITKV3_BACKEND:
+      os << indent << basename
+        << " Optimization Backend = ITKV3_BACKEND" << std::endl;
+      break;
+    case OptimizedRegistrationMethodType::ITKV4_BACKEND:
+      os << indent << basename
+        << " Optimization Backend = ITKV4_BACKEND" << std::endl;
+      break;
+    default:
+      os << indent << basename
+        << " Optimization Backend = UNKNOWN" << std::endl;
+      break;
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::PrintPyramidSchedule( std::ostream & os, Indent indent,
+  const std::string & name, const PyramidScheduleType & schedule ) const
+{
+  os << indent << name << " =";
+  if( schedule.empty() )
+    {
+    os << " NONE";
+    }
+  for( unsigned int level = 0; level < schedule.size(); ++level )
+    {
+    os << " " << schedule[level];
+    }
+  os << std::endl;
 }
 
 template <class TImage>
@@ -1725,6 +2105,11 @@ ImageToImageRegistrationHelper<TImage>
   os << indent << std::endl;
   os << indent << "Report Progress = " << m_ReportProgress << std::endl;
   os << indent << std::endl;
+  os << indent << "Use Evolutionary Optimization = "
+    << m_UseEvolutionaryOptimization << std::endl;
+  os << indent << "Number Of Evolutionary Starts = "
+    << m_NumberOfEvolutionaryStarts << std::endl;
+  os << indent << std::endl;
   if( m_CurrentMovingImage.IsNotNull() )
     {
     os << indent << "Current Moving Image = " << m_CurrentMovingImage
@@ -1848,8 +2233,13 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "Rigid Max Iterations = " << m_RigidMaxIterations
     << std::endl;
+  PrintPyramidSchedule( os, indent, "Rigid Pyramid Shrink Factors",
+    m_RigidPyramidShrinkFactors );
+  PrintPyramidSchedule( os, indent, "Rigid Pyramid Max Iterations",
+    m_RigidPyramidMaxIterations );
   PrintSelfHelper( os, indent, "Rigid", m_RigidMetricMethodEnum,
-                   m_RigidInterpolationMethodEnum );
+                   m_RigidInterpolationMethodEnum,
+                   m_RigidOptimizationBackendEnum );
   os << indent << std::endl;
   if( m_RigidTransform.IsNotNull() )
     {
@@ -1866,8 +2256,12 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "Affine Max Iterations = " << m_AffineMaxIterations
     << std::endl;
+  PrintPyramidSchedule( os, indent, "Affine Pyramid Shrink Factors",
+    m_AffinePyramidShrinkFactors );
+  PrintPyramidSchedule( os, indent, "Affine Pyramid Max Iterations",
+    m_AffinePyramidMaxIterations );
   PrintSelfHelper( os, indent, "Affine", m_AffineMetricMethodEnum,
-    m_AffineInterpolationMethodEnum );
+    m_AffineInterpolationMethodEnum, m_AffineOptimizationBackendEnum );
   os << indent << std::endl;
   if( m_AffineTransform.IsNotNull() )
     {
@@ -1887,8 +2281,12 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "BSpline Control Point Pixel Spacing = "
     << m_BSplineControlPointPixelSpacing << std::endl;
+  PrintPyramidSchedule( os, indent, "BSpline Pyramid Shrink Factors",
+    m_BSplinePyramidShrinkFactors );
+  PrintPyramidSchedule( os, indent, "BSpline Pyramid Max Iterations",
+    m_BSplinePyramidMaxIterations );
   PrintSelfHelper( os, indent, "BSpline", m_BSplineMetricMethodEnum,
-    m_BSplineInterpolationMethodEnum );
+    m_BSplineInterpolationMethodEnum, m_BSplineOptimizationBackendEnum );
   os << indent << std::endl;
   if( m_BSplineTransform.IsNotNull() )
     {
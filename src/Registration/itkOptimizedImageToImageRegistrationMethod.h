@@ -22,6 +22,8 @@
 
 #include "itkImageToImageRegistrationMethod.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -74,6 +76,9 @@ public:
                                      BSPLINE_INTERPOLATION,
                                      SINC_INTERPOLATION };
 
+  enum OptimizationBackendEnumType { ITKV3_BACKEND,
+                                     ITKV4_BACKEND };
+
   //
   // Methods from Superclass
   //
@@ -97,6 +102,8 @@ public:
   itkSetMacro( SampleFromOverlap, bool );
   itkGetConstMacro( SampleFromOverlap, bool );
 
+  /** Compute the Mattes mutual information derivatives without storing
+   *   the PDF derivatives.  BSpline weights are cached either way. */
   itkSetMacro( MinimizeMemory, bool );
   itkGetConstMacro( MinimizeMemory, bool );
 
@@ -106,6 +113,17 @@ public:
   itkSetMacro( UseEvolutionaryOptimization, bool );
   itkGetConstMacro( UseEvolutionaryOptimization, bool );
 
+  /** Number of independent evolutionary chains run by Optimize() when
+   * evolutionary optimization is used.  The chains differ by seed and
+   * initial search radius, and run on separate work units.  After each
+   * round the worse half is pruned; the best chain is refined by the
+   * gradient optimizer.  One, the default, runs a single chain.  The
+   * Observer is attached to the optimizer of every chain, so it may be
+   * invoked by several work units at once.  ITKV4_BACKEND only supports
+   * a single start. */
+  itkSetMacro( NumberOfEvolutionaryStarts, unsigned int );
+  itkGetConstMacro( NumberOfEvolutionaryStarts, unsigned int );
+
   itkSetMacro( NumberOfSamples, unsigned int );
   itkGetConstMacro( NumberOfSamples, unsigned int );
 
@@ -129,6 +147,16 @@ public:
   itkSetMacro( InterpolationMethodEnum, InterpolationMethodEnumType );
   itkGetConstMacro( InterpolationMethodEnum, InterpolationMethodEnumType );
 
+  /** ITKV3_BACKEND, the default, optimizes an ITKv3 metric with a
+   * OnePlusOneEvolutionaryOptimizer and then a FRPROptimizer, using the
+   * Optimize() of the registration method.  ITKV4_BACKEND optimizes a
+   * threaded ITKv4 metric, evaluated at a sparse set of NumberOfSamples
+   * fixed image points, with the ITKv4 evolutionary optimizer and then a
+   * conjugate gradient line search optimizer.  ITKV4_BACKEND does not
+   * support BSpline transforms. */
+  itkSetMacro( OptimizationBackendEnum, OptimizationBackendEnumType );
+  itkGetConstMacro( OptimizationBackendEnum, OptimizationBackendEnumType );
+
   itkGetMacro( FinalMetricValue, double );
 protected:
 
@@ -144,6 +172,25 @@ protected:
 
   virtual void Optimize( MetricType * metric, InterpolatorType * interpolator );
 
+  /** Optimize with the ITKv4 metrics and optimizers */
+  virtual void OptimizeV4( InterpolatorType * interpolator );
+
+  /** A metric on the fixed and moving images, using the fixed image
+   * samples of the last GenerateData(), with its random sampling
+   * seeded by seed ( zero for a random seed ). */
+  typename MetricType::Pointer CreateMetric( int seed );
+
+  /** An interpolator on the moving image */
+  typename InterpolatorType::Pointer CreateInterpolator( void ) const;
+
+  typedef typename MetricType::FixedImageIndexContainer
+    FixedImageIndexContainer;
+
+  /** Regularly sample the fixed image pixels that are within the region
+   * of interest, the overlap, the intensity threshold and the mask.  If
+   * fewer than NumberOfSamples are found, NumberOfSamples is reduced. */
+  void GetFixedImageSampleIndexes( FixedImageIndexContainer & indexList );
+
   virtual void PrintSelf( std::ostream & os, Indent indent ) const override;
 
 private:
@@ -153,6 +200,43 @@ private:
   // Purposely not implemented
   void operator =( const Self & );
 
+  bool IsFixedImageSample( const typename ImageType::IndexType & index,
+    PixelType value );
+
+  struct EvolutionaryChainType
+    {
+    TransformParametersType Position;
+    double                  Value;
+    double                  Radius;
+    int                     Seed;
+    bool                    Converged;
+    };
+
+  struct EvolutionaryThreadStruct
+    {
+    Self                                * Method;
+    std::vector< EvolutionaryChainType > * Chains;
+    std::vector< unsigned int >           ActiveChains;
+    unsigned int                          Iterations;
+    int                                   MetricSeed;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    EvolutionaryThreaderCallback( void * arg );
+
+  /** Reduce seed modulo the largest int, to a nonzero int seed. */
+  static int ReduceSeed( unsigned int seed );
+
+  /** Continue a chain for at most iterations, on its own metric,
+   * interpolator and transform. */
+  void RunEvolutionaryChain( EvolutionaryChainType & chain,
+    unsigned int iterations, int metricSeed );
+
+  /** Run NumberOfEvolutionaryStarts chains from the initial transform
+   * parameters; return the position and value of the best. */
+  void MultiStartEvolutionaryOptimize( TransformParametersType & position,
+    double & value );
+
   TransformParametersType m_InitialTransformParameters;
   TransformParametersType m_InitialTransformFixedParameters;
 
@@ -168,6 +252,8 @@ private:
 
   bool m_UseEvolutionaryOptimization;
 
+  unsigned int m_NumberOfEvolutionaryStarts;
+
   unsigned int m_NumberOfSamples;
 
   bool      m_UseFixedImageSamplesIntensityThreshold;
@@ -183,6 +269,11 @@ private:
 
   InterpolationMethodEnumType m_InterpolationMethodEnum;
 
+  OptimizationBackendEnumType m_OptimizationBackendEnum;
+
+  bool                     m_UseFixedImageSampleIndexes;
+  FixedImageIndexContainer m_FixedImageSampleIndexes;
+
   double m_FinalMetricValue;
 };
 
@@ -24,6 +24,10 @@
 #include "itkNormalizedCorrelationImageToImageMetric.h"
 #include "itkMeanSquaresImageToImageMetric.h"
 
+#include "itkMattesMutualInformationImageToImageMetricv4.h"
+#include "itkCorrelationImageToImageMetricv4.h"
+#include "itkMeanSquaresImageToImageMetricv4.h"
+
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkLinearInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
@@ -37,15 +41,23 @@
 #include "itkSingleValuedNonLinearOptimizer.h"
 #include "itkOnePlusOneEvolutionaryOptimizer.h"
 #include "itkNormalVariateGenerator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
 
 #include "itkRegularStepGradientDescentOptimizer.h"
 #include "itkFRPROptimizer.h"
+
+#include "itkObjectToObjectOptimizerBase.h"
+#include "itkOnePlusOneEvolutionaryOptimizerv4.h"
+#include "itkConjugateGradientLineSearchOptimizerv4.h"
+#include "itkRegistrationParameterScalesFromPhysicalShift.h"
 #include "itkImageMaskSpatialObject.h"
 
 #include "itkImage.h"
 #include <itkConstantBoundaryCondition.h>
 
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
 namespace itk
@@ -65,6 +77,8 @@ public:
 
   typedef SingleValuedNonLinearOptimizer OptimizerType;
 
+  typedef ObjectToObjectOptimizerBaseTemplate< double > OptimizerV4Type;
+
   itkSetMacro(DontShowParameters, bool);
   itkSetMacro(UpdateInterval, int);
 
@@ -81,22 +95,38 @@ public:
       }
 
     const OptimizerType * opt = dynamic_cast<const OptimizerType *>(object);
+    const OptimizerV4Type * optV4 =
+      dynamic_cast<const OptimizerV4Type *>(object);
+    if( opt == NULL && optV4 == NULL )
+      {
+      return;
+      }
 
     if( ++m_Iteration % m_UpdateInterval == 0 )
       {
       RealTimeClock::TimeStampType t = m_Clock->GetTimeInSeconds();
+      OptimizerType::ParametersType position;
+      double value;
+      if( opt != NULL )
+        {
+        position = opt->GetCurrentPosition();
+        value = opt->GetValue( position );
+        }
+      else
+        {
+        position = optV4->GetCurrentPosition();
+        value = optV4->GetCurrentMetricValue();
+        }
       if( !m_DontShowParameters )
         {
         std::cout << "   " << m_Iteration << " : "
-                  << opt->GetCurrentPosition() << " = "
-                  << opt->GetValue( opt->GetCurrentPosition() )
+                  << position << " = " << value
                   << "   (" << (t - m_LastTime) / m_UpdateInterval << "s)"
                   << std::endl;
         }
       else
         {
-        std::cout << "   " << m_Iteration << " : "
-                  << opt->GetValue( opt->GetCurrentPosition() )
+        std::cout << "   " << m_Iteration << " : " << value
                   << "   (" << (t - m_LastTime) / m_UpdateInterval << "s)"
                   << std::endl;
         }
@@ -156,6 +186,7 @@ OptimizedImageToImageRegistrationMethod<TImage>
   m_MinimizeMemory = false;
 
   m_UseEvolutionaryOptimization = true;
+  m_NumberOfEvolutionaryStarts = 1;
 
   // The following NumberOfSamples value is a good default for rigid
   //   registration.  Other derived registration methods should use
@@ -173,6 +204,10 @@ OptimizedImageToImageRegistrationMethod<TImage>
   m_MetricMethodEnum = MATTES_MI_METRIC;
   m_InterpolationMethodEnum = LINEAR_INTERPOLATION;
 
+  m_OptimizationBackendEnum = ITKV3_BACKEND;
+
+  m_UseFixedImageSampleIndexes = false;
+
   m_FinalMetricValue = 0;
 
 }
@@ -207,6 +242,69 @@ OptimizedImageToImageRegistrationMethod<TImage>
   this->GetTransform()->SetParametersByValue(
     this->GetInitialTransformParameters() );
 
+  typename InterpolatorType::Pointer interpolator =
+    this->CreateInterpolator();
+
+  if( m_OptimizationBackendEnum == ITKV4_BACKEND )
+    {
+    if( m_UseEvolutionaryOptimization && m_NumberOfEvolutionaryStarts > 1 )
+      {
+      itkExceptionMacro( << "The ITKv4 optimization backend does not support "
+        << "more than one evolutionary start." );
+      }
+
+    try
+      {
+      this->OptimizeV4( interpolator );
+      }
+    catch( itk::ExceptionObject& exception )
+      {
+      std::cerr << "Optimization threw an exception." << std::endl;
+      std::cerr << exception << std::endl ;
+      }
+
+    if( this->GetReportProgress() )
+      {
+      std::cout << "UPDATE END" << std::endl;
+      }
+    return;
+    }
+
+  m_UseFixedImageSampleIndexes = false;
+  m_FixedImageSampleIndexes.clear();
+  if( this->GetUseRegionOfInterest() ||
+      this->GetSampleFromOverlap() ||
+      this->GetUseFixedImageSamplesIntensityThreshold() ||
+      this->GetUseFixedImageMaskObject() )
+    {
+    this->GetFixedImageSampleIndexes( m_FixedImageSampleIndexes );
+    m_UseFixedImageSampleIndexes = true;
+    }
+
+  typename MetricType::Pointer metric = this->CreateMetric(
+    m_RandomNumberSeed );
+
+  try
+    {
+    this->Optimize(metric, interpolator);
+    }
+  catch( itk::ExceptionObject& exception )
+    {
+    std::cerr << "Optimization threw an exception." << std::endl;
+    std::cerr << exception << std::endl ;
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "UPDATE END" << std::endl;
+    }
+}
+
+template <class TImage>
+typename OptimizedImageToImageRegistrationMethod<TImage>::MetricType::Pointer
+OptimizedImageToImageRegistrationMethod<TImage>
+::CreateMetric( int seed )
+{
   typename MetricType::Pointer metric;
 
   switch( this->GetMetricMethodEnum() )
@@ -224,7 +322,6 @@ OptimizedImageToImageRegistrationMethod<TImage>
         if( m_MinimizeMemory )
           {
           typedMetric->SetUseExplicitPDFDerivatives( false );
-          typedMetric->SetUseCachingOfBSplineWeights( false );
           }
         metric = typedMetric;
         }
@@ -236,9 +333,18 @@ OptimizedImageToImageRegistrationMethod<TImage>
       metric = MeanSquaresImageToImageMetric<TImage, TImage>::New();
       break;
     }
-  if( m_RandomNumberSeed != 0 )
+
+  // Without the cache, the BSpline weights of every sample are recomputed
+  //   at every evaluation of the metric.  The cache grows with the number
+  //   of samples, not with the number of parameters as the explicit PDF
+  //   derivatives do, so it is kept even when minimizing memory.
+  if( m_TransformMethodEnum == BSPLINE_TRANSFORM )
+    {
+    metric->SetUseCachingOfBSplineWeights( true );
+    }
+  if( seed != 0 )
     {
-    metric->ReinitializeSeed( m_RandomNumberSeed );
+    metric->ReinitializeSeed( seed );
     }
   else
     {
@@ -253,150 +359,9 @@ OptimizedImageToImageRegistrationMethod<TImage>
 
   metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
 
-  if( this->GetUseRegionOfInterest() ||
-      this->GetSampleFromOverlap() ||
-      this->GetUseFixedImageSamplesIntensityThreshold() ||
-      this->GetUseFixedImageMaskObject() )
+  if( m_UseFixedImageSampleIndexes )
     {
-    if( this->GetReportProgress() )
-      {
-      std::cout << "Creating fixed image samples" << std::endl;
-      }
-
-    itk::ImageRegionConstIteratorWithIndex<ImageType> iter( fixedImage,
-      fixedImage->GetLargestPossibleRegion() );
-    typename ImageType::IndexType index;
-    typename ImageType::IndexType movingIndex;
-    typename MetricType::InputPointType fixedPoint;
-    typename MetricType::InputPointType movingPoint;
-
-    iter.GoToBegin();
-    int count = 0;
-    for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
-      {
-      index = iter.GetIndex();
-      fixedImage->TransformIndexToPhysicalPoint(index, fixedPoint);
-      if( this->GetSampleFromOverlap() )
-        {
-        movingPoint = this->GetTransform()->TransformPoint( fixedPoint );
-        if( !movingImage->TransformPhysicalPointToIndex( movingPoint,
-          movingIndex ) )
-          {
-          continue;
-          }
-        }
-      if( this->GetUseFixedImageSamplesIntensityThreshold() )
-        {
-        if( iter.Get() < this->m_FixedImageSamplesIntensityThreshold )
-          {
-          continue;
-          }
-        }
-      if( this->GetUseFixedImageMaskObject() )
-        {
-        double val;
-        if( this->GetFixedImageMaskObject()->ValueAtInWorldSpace( fixedPoint, val ) )
-          {
-          if( val == 0 )
-            {
-            continue;
-            }
-          }
-        }
-      if( this->GetUseRegionOfInterest() )
-        {
-        bool isInside = true;
-        for( unsigned int i = 0; i < ImageDimension; i++ )
-          {
-          if( !( (fixedPoint[i] >= this->GetRegionOfInterestPoint1()[i] &&
-                  fixedPoint[i] <= this->GetRegionOfInterestPoint2()[i])
-                 || (fixedPoint[i] >= this->GetRegionOfInterestPoint2()[i] &&
-                     fixedPoint[i] <= this->GetRegionOfInterestPoint1()[i]) ) )
-            {
-            isInside = false;
-            break;
-            }
-          }
-        if( !isInside )
-          {
-          continue;
-          }
-        }
-
-      ++count;
-      }
-    double samplingRate = (double)(m_NumberOfSamples + 2) / (double)count;
-    if( this->GetReportProgress() )
-      {
-      std::cout << "...Second pass, sampling rate = " << samplingRate
-        << std::endl;
-      }
-
-    if( samplingRate > 1 )
-      {
-      samplingRate = 1;
-      itkWarningMacro(
-         << "Adjusting the number of samples due to restrictive criteria.");
-      this->SetNumberOfSamples( count );
-      metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
-      }
-    double step = 0;
-    typename MetricType::FixedImageIndexContainer indexList;
-    indexList.clear();
-    for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
-      {
-      index = iter.GetIndex();
-      fixedImage->TransformIndexToPhysicalPoint(index, fixedPoint);
-      if( this->GetSampleFromOverlap() )
-        {
-        movingPoint = this->GetTransform()->TransformPoint( fixedPoint );
-        if( !movingImage->TransformPhysicalPointToIndex( movingPoint,
-          movingIndex ) )
-          {
-          continue;
-          }
-        }
-      if( this->GetUseFixedImageSamplesIntensityThreshold() )
-        {
-        if( iter.Get() < this->m_FixedImageSamplesIntensityThreshold )
-          {
-          continue;
-          }
-        }
-      if( this->GetUseFixedImageMaskObject() )
-        {
-        double val;
-        if( this->GetFixedImageMaskObject()->ValueAtInWorldSpace( fixedPoint, val ) )
-          {
-          if( val == 0 )
-            {
-            continue;
-            }
-          }
-        }
-      step = step + samplingRate;
-      if( step > 1 )
-        {
-        indexList.push_back( index );
-        while( step > 1 )
-          {
-          step -= 1;
-          }
-
-        if( indexList.size() == m_NumberOfSamples )
-          {
-          break;
-          }
-        }
-      }
-    if( indexList.size() != m_NumberOfSamples )
-      {
-      itkWarningMacro(<< "Full set of samples not collected. Collected "
-                      << indexList.size() << " of " << m_NumberOfSamples );
-      this->SetNumberOfSamples( indexList.size() );
-      metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
-      }
-    metric->SetFixedImageIndexes( indexList );
+    metric->SetFixedImageIndexes( m_FixedImageSampleIndexes );
     }
 
   if( this->GetUseMovingImageMaskObject() )
@@ -408,6 +373,15 @@ OptimizedImageToImageRegistrationMethod<TImage>
       }
     }
 
+  return metric;
+}
+
+template <class TImage>
+typename OptimizedImageToImageRegistrationMethod<TImage>
+::InterpolatorType::Pointer
+OptimizedImageToImageRegistrationMethod<TImage>
+::CreateInterpolator( void ) const
+{
   typename InterpolatorType::Pointer interpolator;
 
   switch( this->GetInterpolationMethodEnum() )
@@ -430,19 +404,132 @@ OptimizedImageToImageRegistrationMethod<TImage>
     }
   interpolator->SetInputImage( this->GetMovingImage() );
 
-  try
+  return interpolator;
+}
+
+template <class TImage>
+bool
+OptimizedImageToImageRegistrationMethod<TImage>
+::IsFixedImageSample( const typename ImageType::IndexType & index,
+  PixelType value )
+{
+  typename ImageType::ConstPointer fixedImage = this->GetFixedImage();
+  typename ImageType::ConstPointer movingImage = this->GetMovingImage();
+
+  typename ImageType::IndexType movingIndex;
+  typename MetricType::InputPointType fixedPoint;
+  typename MetricType::InputPointType movingPoint;
+
+  fixedImage->TransformIndexToPhysicalPoint(index, fixedPoint);
+  if( this->GetSampleFromOverlap() )
     {
-    this->Optimize(metric, interpolator);
+    movingPoint = this->GetTransform()->TransformPoint( fixedPoint );
+    if( !movingImage->TransformPhysicalPointToIndex( movingPoint,
+      movingIndex ) )
+      {
+      return false;
+      }
     }
-  catch( itk::ExceptionObject& exception )
+  if( this->GetUseFixedImageSamplesIntensityThreshold() )
     {
-    std::cerr << "Optimization threw an exception." << std::endl;
-    std::cerr << exception << std::endl ;
+    if( value < this->m_FixedImageSamplesIntensityThreshold )
+      {
+      return false;
+      }
+    }
+  if( this->GetUseFixedImageMaskObject() )
+    {
+    double val;
+    if( this->GetFixedImageMaskObject()->ValueAtInWorldSpace( fixedPoint, val ) )
+      {
+      if( val == 0 )
+        {
+        return false;
+        }
+      }
+    }
+  if( this->GetUseRegionOfInterest() )
+    {
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      if( !( (fixedPoint[i] >= this->GetRegionOfInterestPoint1()[i] &&
+              fixedPoint[i] <= this->GetRegionOfInterestPoint2()[i])
+             || (fixedPoint[i] >= this->GetRegionOfInterestPoint2()[i] &&
+                 fixedPoint[i] <= this->GetRegionOfInterestPoint1()[i]) ) )
+        {
+        return false;
+        }
+      }
     }
 
+  return true;
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::GetFixedImageSampleIndexes( FixedImageIndexContainer & indexList )
+{
   if( this->GetReportProgress() )
     {
-    std::cout << "UPDATE END" << std::endl;
+    std::cout << "Creating fixed image samples" << std::endl;
+    }
+
+  typename ImageType::ConstPointer fixedImage = this->GetFixedImage();
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> iter( fixedImage,
+    fixedImage->GetLargestPossibleRegion() );
+
+  int count = 0;
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( this->IsFixedImageSample( iter.GetIndex(), iter.Get() ) )
+      {
+      ++count;
+      }
+    }
+  double samplingRate = (double)(m_NumberOfSamples + 2) / (double)count;
+  if( this->GetReportProgress() )
+    {
+    std::cout << "...Second pass, sampling rate = " << samplingRate
+      << std::endl;
+    }
+
+  if( samplingRate > 1 )
+    {
+    samplingRate = 1;
+    itkWarningMacro(
+       << "Adjusting the number of samples due to restrictive criteria.");
+    this->SetNumberOfSamples( count );
+    }
+  double step = 0;
+  indexList.clear();
+  for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
+    {
+    if( !this->IsFixedImageSample( iter.GetIndex(), iter.Get() ) )
+      {
+      continue;
+      }
+    step = step + samplingRate;
+    if( step > 1 )
+      {
+      indexList.push_back( iter.GetIndex() );
+      while( step > 1 )
+        {
+        step -= 1;
+        }
+
+      if( indexList.size() == m_NumberOfSamples )
+        {
+        break;
+        }
+      }
+    }
+  if( indexList.size() != m_NumberOfSamples )
+    {
+    itkWarningMacro(<< "Full set of samples not collected. Collected "
+                    << indexList.size() << " of " << m_NumberOfSamples );
+    this->SetNumberOfSamples( indexList.size() );
     }
 }
 
@@ -453,7 +540,27 @@ OptimizedImageToImageRegistrationMethod<TImage>
 {
   typedef ImageRegistrationMethod<TImage, TImage> RegType;
 
-  if( m_UseEvolutionaryOptimization )
+  if( m_UseEvolutionaryOptimization && m_NumberOfEvolutionaryStarts > 1 )
+    {
+    if( this->GetReportProgress() )
+      {
+      std::cout << "MULTI-START EVOLUTIONARY START" << std::endl;
+      }
+
+    TransformParametersType position;
+    double value;
+    this->MultiStartEvolutionaryOptimize( position, value );
+
+    this->GetTransform()->SetParametersByValue( position );
+    m_FinalMetricValue = value;
+    this->SetLastTransformParameters( position );
+
+    if( this->GetReportProgress() )
+      {
+      std::cout << "MULTI-START EVOLUTIONARY END" << std::endl;
+      }
+    }
+  else if( m_UseEvolutionaryOptimization )
     {
     if( this->GetReportProgress() )
       {
@@ -647,6 +754,441 @@ OptimizedImageToImageRegistrationMethod<TImage>
     }
 }
 
+template <class TImage>
+int
+OptimizedImageToImageRegistrationMethod<TImage>
+::ReduceSeed( unsigned int seed )
+{
+  const unsigned int reducedSeed = seed
+    % static_cast< unsigned int >( NumericTraits< int >::max() );
+  if( reducedSeed == 0 )
+    {
+    return 1;
+    }
+  return static_cast< int >( reducedSeed );
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::MultiStartEvolutionaryOptimize( TransformParametersType & position,
+  double & value )
+{
+  const unsigned int numberOfChains = m_NumberOfEvolutionaryStarts;
+
+  // Every chain samples the metric with the same seed, so that the
+  //   values of the chains can be compared.  Seeds are combined unsigned
+  //   and then reduced, so that large seeds cannot overflow.
+  unsigned int baseSeed = static_cast< unsigned int >( m_RandomNumberSeed );
+  if( baseSeed == 0 )
+    {
+    baseSeed = Statistics::MersenneTwisterRandomVariateGenerator
+      ::GetInstance()->GetIntegerVariate();
+    }
+  const int metricSeed = Self::ReduceSeed( baseSeed );
+
+  // Later chains search more widely
+  std::vector< EvolutionaryChainType > chains( numberOfChains );
+  for( unsigned int k = 0; k < numberOfChains; ++k )
+    {
+    chains[k].Position = this->GetInitialTransformParameters();
+    chains[k].Value = NumericTraits< double >::max();
+    chains[k].Radius = 0.1 * ( k + 1 );
+    chains[k].Seed = Self::ReduceSeed( baseSeed + 7919u * ( k + 1 ) );
+    chains[k].Converged = false;
+    }
+
+  // The surviving chain gets the iterations of a single chain
+  unsigned int numberOfRounds = 1;
+  for( unsigned int n = numberOfChains; n > 1; n = ( n + 1 ) / 2 )
+    {
+    ++numberOfRounds;
+    }
+
+  EvolutionaryThreadStruct str;
+  str.Method = this;
+  str.Chains = &chains;
+  str.Iterations = std::max( this->GetMaxIterations() / numberOfRounds, 1u );
+  str.MetricSeed = metricSeed;
+  for( unsigned int k = 0; k < numberOfChains; ++k )
+    {
+    str.ActiveChains.push_back( k );
+    }
+
+  for( unsigned int round = 0; round < numberOfRounds; ++round )
+    {
+    unsigned int numberOfWorkUnits = std::min(
+      static_cast< unsigned int >( str.ActiveChains.size() ),
+      this->GetRegistrationNumberOfWorkUnits() );
+    this->GetMultiThreader()->SetNumberOfWorkUnits(
+      std::max( numberOfWorkUnits, 1u ) );
+    this->GetMultiThreader()->SetSingleMethod(
+      this->EvolutionaryThreaderCallback, &str );
+    this->GetMultiThreader()->SingleMethodExecute();
+
+    // Order the chains from best to worst
+    for( unsigned int i = 1; i < str.ActiveChains.size(); ++i )
+      {
+      unsigned int chain = str.ActiveChains[i];
+      unsigned int j = i;
+      while( j > 0
+        && chains[str.ActiveChains[j - 1]].Value > chains[chain].Value )
+        {
+        str.ActiveChains[j] = str.ActiveChains[j - 1];
+        --j;
+        }
+      str.ActiveChains[j] = chain;
+      }
+
+    if( this->GetReportProgress() )
+      {
+      std::cout << "   Round " << round << " : "
+        << str.ActiveChains.size() << " chains, best = "
+        << chains[str.ActiveChains[0]].Value << std::endl;
+      }
+
+    // Prune the worse half
+    str.ActiveChains.resize( ( str.ActiveChains.size() + 1 ) / 2 );
+
+    bool converged = true;
+    for( unsigned int i = 0; i < str.ActiveChains.size(); ++i )
+      {
+      converged = converged && chains[str.ActiveChains[i]].Converged;
+      }
+    if( converged )
+      {
+      break;
+      }
+    }
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits(
+    this->GetRegistrationNumberOfWorkUnits() );
+
+  position = chains[str.ActiveChains[0]].Position;
+  value = chains[str.ActiveChains[0]].Value;
+}
+
+template <class TImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+OptimizedImageToImageRegistrationMethod<TImage>
+::EvolutionaryThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  EvolutionaryThreadStruct * str = ( EvolutionaryThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  for( unsigned int i = threadId; i < str->ActiveChains.size();
+    i += threadCount )
+    {
+    str->Method->RunEvolutionaryChain(
+      ( *( str->Chains ) )[str->ActiveChains[i]], str->Iterations,
+      str->MetricSeed );
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::RunEvolutionaryChain( EvolutionaryChainType & chain,
+  unsigned int iterations, int metricSeed )
+{
+  if( chain.Converged )
+    {
+    return;
+    }
+
+  // The images are shared; the metric, interpolator and transform are
+  //   not thread safe and belong to the chain
+  typename MetricType::Pointer metric = this->CreateMetric( metricSeed );
+  metric->SetNumberOfWorkUnits( 1 );
+  typename InterpolatorType::Pointer interpolator =
+    this->CreateInterpolator();
+  typename TransformType::Pointer transform = this->GetTransform()->Clone();
+
+  typedef OnePlusOneEvolutionaryOptimizer EvoOptimizerType;
+  EvoOptimizerType::Pointer evoOpt = EvoOptimizerType::New();
+
+  Statistics::NormalVariateGenerator::Pointer generator =
+    Statistics::NormalVariateGenerator::New();
+  generator->Initialize( chain.Seed );
+  evoOpt->SetNormalVariateGenerator( generator );
+  evoOpt->SetEpsilon( this->GetTargetError() );
+  evoOpt->Initialize( chain.Radius );
+  evoOpt->SetCatchGetValueException( true );
+  evoOpt->SetMetricWorstPossibleValue( 100 );
+  evoOpt->SetScales( this->GetTransformParametersScales() );
+  evoOpt->SetMaximumIteration( iterations );
+
+  if( this->GetObserver() )
+    {
+    evoOpt->AddObserver( IterationEvent(), this->GetObserver() );
+    }
+
+  typedef ImageRegistrationMethod<TImage, TImage> RegType;
+  typename RegType::Pointer reg = RegType::New();
+  reg->SetFixedImage( this->GetFixedImage() );
+  reg->SetMovingImage( this->GetMovingImage() );
+  reg->SetFixedImageRegion( this->GetFixedImage()
+                            ->GetLargestPossibleRegion() );
+  reg->SetTransform( transform );
+  reg->SetInitialTransformParameters( chain.Position );
+  reg->SetMetric( metric );
+  reg->SetInterpolator( interpolator );
+  reg->SetOptimizer( evoOpt );
+
+  try
+    {
+    reg->Update();
+    }
+  catch( ... )
+    {
+    // Continue using best values
+    }
+
+  if( reg->GetLastTransformParameters().size() == chain.Position.size() )
+    {
+    chain.Position = reg->GetLastTransformParameters();
+    }
+
+  try
+    {
+    chain.Value = evoOpt->GetValue( chain.Position );
+    }
+  catch( ... )
+    {
+    chain.Value = NumericTraits< double >::max();
+    }
+
+  // The optimizer starts from A( i, i ) = radius / scales[i], so the
+  //   radius to continue from is the norm of A over the norm of 1/scales
+  const TransformParametersScalesType & scales =
+    this->GetTransformParametersScales();
+  double inverseScalesNorm = 0;
+  for( unsigned int i = 0; i < scales.size(); ++i )
+    {
+    inverseScalesNorm += 1.0 / ( scales[i] * scales[i] );
+    }
+  chain.Radius = evoOpt->GetFrobeniusNorm() / std::sqrt( inverseScalesNorm );
+  chain.Converged = ( evoOpt->GetFrobeniusNorm() <= this->GetTargetError() );
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::OptimizeV4( InterpolatorType * interpolator )
+{
+  typedef ImageToImageMetricv4<TImage, TImage> MetricV4Type;
+
+  typename MetricV4Type::Pointer metric;
+
+  switch( this->GetMetricMethodEnum() )
+    {
+    case MATTES_MI_METRIC:
+        {
+        typedef MattesMutualInformationImageToImageMetricv4<TImage, TImage>
+          TypedMetricType;
+
+        typename TypedMetricType::Pointer typedMetric = TypedMetricType::New();
+
+        typedMetric->SetNumberOfHistogramBins( 100 );
+        metric = typedMetric;
+        }
+      break;
+    case NORMALIZED_CORRELATION_METRIC:
+      metric = CorrelationImageToImageMetricv4<TImage, TImage>::New();
+      break;
+    case MEAN_SQUARED_ERROR_METRIC:
+      metric = MeanSquaresImageToImageMetricv4<TImage, TImage>::New();
+      break;
+    }
+
+  typename ImageType::ConstPointer fixedImage = this->GetFixedImage();
+  typename ImageType::ConstPointer movingImage = this->GetMovingImage();
+
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetMovingTransform( this->GetTransform() );
+  metric->SetMovingInterpolator( interpolator );
+
+  // The metric is only evaluated at the samples, so image gradients are
+  //   computed there rather than filtered over the whole images
+  metric->SetUseFixedImageGradientFilter( false );
+  metric->SetUseMovingImageGradientFilter( false );
+
+  FixedImageIndexContainer indexList;
+  this->GetFixedImageSampleIndexes( indexList );
+
+  typedef typename MetricV4Type::FixedSampledPointSetType PointSetType;
+  typename PointSetType::Pointer pointSet = PointSetType::New();
+  pointSet->Initialize();
+  typename PointSetType::PointType fixedPoint;
+  for( unsigned int i = 0; i < indexList.size(); ++i )
+    {
+    fixedImage->TransformIndexToPhysicalPoint( indexList[i], fixedPoint );
+    pointSet->SetPoint( i, fixedPoint );
+    }
+  metric->SetFixedSampledPointSet( pointSet );
+  metric->SetUseSampledPointSet( true );
+
+  if( this->GetUseMovingImageMaskObject() )
+    {
+    if( this->GetMovingImageMaskObject() )
+      {
+      metric->SetMovingImageMask( this->GetMovingImageMaskObject() );
+      }
+    }
+
+  metric->Initialize();
+
+  typedef ImageRegistrationViewer ViewerCommandType;
+
+  if( m_UseEvolutionaryOptimization )
+    {
+    if( this->GetReportProgress() )
+      {
+      std::cout << "EVOLUTIONARY START" << std::endl;
+      }
+
+    typedef OnePlusOneEvolutionaryOptimizerv4<double> EvoOptimizerType;
+    typename EvoOptimizerType::Pointer evoOpt = EvoOptimizerType::New();
+
+    Statistics::NormalVariateGenerator::Pointer generator =
+      Statistics::NormalVariateGenerator::New();
+    if( m_RandomNumberSeed != 0 )
+      {
+      generator->Initialize( m_RandomNumberSeed );
+      }
+    evoOpt->SetNormalVariateGenerator( generator );
+    evoOpt->SetEpsilon( this->GetTargetError() );
+    evoOpt->Initialize( 0.1 );
+    evoOpt->SetCatchGetValueException( true );
+    evoOpt->SetMetricWorstPossibleValue( 100 );
+    evoOpt->SetScales( this->GetTransformParametersScales() );
+    evoOpt->SetMaximumIteration( this->GetMaxIterations() );
+    evoOpt->SetMetric( metric );
+
+    if( this->GetObserver() )
+      {
+      evoOpt->AddObserver( IterationEvent(), this->GetObserver() );
+      }
+
+    if( this->GetReportProgress() )
+      {
+      typename ViewerCommandType::Pointer command = ViewerCommandType::New();
+      if( this->GetTransform()->GetNumberOfParameters() > 16 )
+        {
+        command->SetDontShowParameters( true );
+        }
+      evoOpt->AddObserver( IterationEvent(), command );
+      }
+
+    TransformParametersType initialParameters =
+      this->GetTransform()->GetParameters();
+    double initialValue = metric->GetValue();
+
+    try
+      {
+      evoOpt->StartOptimization();
+      }
+    catch( ... )
+      {
+      std::cout << "Exception caught in evolutionary registration."
+                << std::endl;
+      std::cout << "Continuing using best values..." << std::endl;
+      }
+
+    // Never start the gradient search from a worse position
+    if( metric->GetValue() > initialValue )
+      {
+      this->GetTransform()->SetParametersByValue( initialParameters );
+      }
+
+    if( this->GetReportProgress() )
+      {
+      std::cout << "EVOLUTIONARY END" << std::endl;
+      }
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "GRADIENT START" << std::endl;
+    }
+
+  TransformParametersType startParameters =
+    this->GetTransform()->GetParameters();
+
+  typedef ConjugateGradientLineSearchOptimizerv4Template<double>
+    GradOptimizerType;
+  typename GradOptimizerType::Pointer gradOpt = GradOptimizerType::New();
+
+  // The first step moves the samples by at most about one voxel
+  typedef RegistrationParameterScalesFromPhysicalShift<MetricV4Type>
+    ScalesEstimatorType;
+  typename ScalesEstimatorType::Pointer scalesEstimator =
+    ScalesEstimatorType::New();
+  scalesEstimator->SetMetric( metric );
+  scalesEstimator->SetTransformForward( true );
+
+  gradOpt->SetMetric( metric );
+  gradOpt->SetScales( this->GetTransformParametersScales() );
+  gradOpt->SetScalesEstimator( scalesEstimator );
+  gradOpt->SetDoEstimateScales( false );
+  gradOpt->SetDoEstimateLearningRateOnce( true );
+  gradOpt->SetNumberOfIterations( this->GetMaxIterations() );
+  gradOpt->SetMinimumConvergenceValue( this->GetTargetError() );
+  gradOpt->SetConvergenceWindowSize( 10 );
+  gradOpt->SetLowerLimit( 0 );
+  gradOpt->SetUpperLimit( 2 );
+  gradOpt->SetEpsilon( 0.2 );
+  gradOpt->SetMaximumLineSearchIterations( 10 );
+
+  if( this->GetReportProgress() )
+    {
+    typename ViewerCommandType::Pointer command = ViewerCommandType::New();
+    if( this->GetTransform()->GetNumberOfParameters() > 16 )
+      {
+      command->SetDontShowParameters( true );
+      }
+    gradOpt->AddObserver( IterationEvent(), command );
+    }
+  if( this->GetObserver() )
+    {
+    gradOpt->AddObserver( IterationEvent(), this->GetObserver() );
+    }
+
+  try
+    {
+    gradOpt->StartOptimization();
+    }
+  catch( itk::ExceptionObject & excep )
+    {
+    std::cout << "Exception caught during gradient registration."
+              << excep << std::endl;
+    std::cout << "Continuing using best values..." << std::endl;
+    if( this->GetTransform()->GetParameters().size()
+        != startParameters.size() )
+      {
+      std::cout << "  Invalid position, using initial parameters."
+        << std::endl;
+      this->GetTransform()->SetParametersByValue( startParameters );
+      }
+    }
+
+  m_FinalMetricValue = metric->GetValue();
+  this->SetLastTransformParameters( this->GetTransform()->GetParameters() );
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "GRADIENT END" << std::endl;
+    }
+}
+
 template <class TImage>
 void
 OptimizedImageToImageRegistrationMethod<TImage>
@@ -671,6 +1213,9 @@ OptimizedImageToImageRegistrationMethod<TImage>
   os << indent << "Use Evolutionary Optimization = " <<
     m_UseEvolutionaryOptimization << std::endl;
 
+  os << indent << "Number of Evolutionary Starts = " <<
+    m_NumberOfEvolutionaryStarts << std::endl;
+
   os << indent << "Sample From Overlap = " << m_SampleFromOverlap << std::endl;
 
   os << indent << "Minimize Memory = " << m_MinimizeMemory << std::endl;
@@ -718,6 +1263,16 @@ OptimizedImageToImageRegistrationMethod<TImage>
          << std::endl;
       break;
     }
+
+  switch( m_OptimizationBackendEnum )
+    {
+    case ITKV3_BACKEND:
+      os << indent << "Optimization backend = ITKv3" << std::endl;
+      break;
+    case ITKV4_BACKEND:
+      os << indent << "Optimization backend = ITKv4" << std::endl;
+      break;
+    }
 }
 
 };
@@ -28,6 +28,9 @@ limitations under the License.
 #include <itkCompensatedSummation.h>
 #include <itkGaussianDerivativeImageFunction.h>
 #include <itkImageToSpatialObjectMetric.h>
+#include <itkMultiThreaderBase.h>
+
+#include <vector>
 
 namespace itk
 {
@@ -49,6 +52,11 @@ namespace tube
  * \tparam TTubeSpatialObject Type of the tubes contained within the input
  * TMovingSpatialObject to use for the registration.
  *
+ * The tube points are gathered into a contiguous array by Initialize(),
+ * which must therefore be called again if the tubes change.  Value and
+ * derivative are evaluated in one pass over that array, split across
+ * NumberOfWorkUnits.
+ *
  * \warning ( Derivative )
  */
 
@@ -149,6 +157,11 @@ public:
   void SetFeatureWeights( FeatureWeightsType & featureWeights );
   itkGetConstReferenceMacro( FeatureWeights, FeatureWeightsType );
 
+  /** Set/Get the number of work units used to evaluate the metric.  Zero
+   * uses the global default number of threads. */
+  itkSetMacro( NumberOfWorkUnits, unsigned int );
+  itkGetConstMacro( NumberOfWorkUnits, unsigned int );
+
   TransformPointer GetTransform( void ) const
     {
     return dynamic_cast<TransformType*>( this->m_Transform.GetPointer() );
@@ -173,6 +186,9 @@ protected:
   virtual void ComputeCenterOfRotation( void );
   SizeValueType CountTubePoints( void );
 
+  /** Gather the tube points, in standard tube tree iteration order. */
+  void ComputeTubePoints( void );
+
   void GetDeltaAngles( const OutputPointType & x,
     const VnlVectorType & dx,
     const VectorType & offsets,
@@ -182,6 +198,51 @@ private:
   ImageToTubeRigidMetric( const Self& ); // purposely not implemented
   void operator=( const Self& ); // purposely not implemented
 
+  /** Tube point data used by the metric, cached by Initialize(). */
+  struct TubePointDataType
+    {
+    InputPointType                                Position;
+    typename TubePointType::CovariantVectorType   Normal1;
+    typename TubePointType::CovariantVectorType   Normal2;
+    ScalarType                                    Radius;
+    };
+
+  /** Sums accumulated by one work unit. */
+  struct PartialSumsType
+    {
+    CompensatedSummationType MatchMeasure;
+    CompensatedSummationType WeightSum;
+    CompensatedSummationType BiasV[TubeDimension * TubeDimension];
+    CompensatedSummationType DPosition[TubeDimension];
+    };
+
+  struct ValueAndDerivativeThreadStruct
+    {
+    const Self                     * Metric;
+    const TransformType            * Transform;
+    bool                             ComputeValue;
+    bool                             ComputeDerivative;
+    std::vector< PartialSumsType > * PartialSums;
+    std::vector< char >            * PointIsInside;
+    std::vector< OutputPointType > * TransformedPoints;
+    std::vector< VectorType >      * DTransformedPoints;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ValueAndDerivativeThreaderCallback( void * arg );
+
+  /** Accumulate the contribution of the tube points in
+   * [pointStart, pointEnd) into sums. */
+  void AccumulateTubePoints( const ValueAndDerivativeThreadStruct * str,
+    SizeValueType pointStart, SizeValueType pointEnd,
+    PartialSumsType & sums ) const;
+
+  /** Shared implementation of GetValue, GetDerivative and
+   * GetValueAndDerivative. */
+  void ComputeValueAndDerivative( const ParametersType & parameters,
+    bool computeValue, bool computeDerivative,
+    MeasureType & value, DerivativeType & derivative ) const;
+
   typename DerivativeImageFunctionType::Pointer m_DerivativeImageFunction;
 
   ScalarType m_Kappa;
@@ -216,6 +277,10 @@ private:
   typename TubeTreeType::ChildrenListType* GetTubes( void ) const;
 
   FeatureWeightsType m_FeatureWeights;
+
+  std::vector< TubePointDataType > m_TubePoints;
+
+  unsigned int m_NumberOfWorkUnits;
 }; // End class ImageToTubeRigidMetric
 
 } // End namespace tube
@@ -45,6 +45,8 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
 
   m_CenterOfRotation.Fill( 0.0 );
 
+  m_NumberOfWorkUnits = 0;
+
   m_DerivativeImageFunction = DerivativeImageFunctionType::New();
 
   typedef LinearInterpolateImageFunction< FixedImageType >
@@ -106,6 +108,7 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
       << "do not equal the number of tube points!" );
     }
   this->ComputeCenterOfRotation();
+  this->ComputeTubePoints();
 
   this->m_Interpolator->SetInputImage( this->m_FixedImage );
   this->m_DerivativeImageFunction->SetInputImage( this->m_FixedImage );
@@ -199,6 +202,44 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 }
 
 
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeTubePoints( void )
+{
+  m_TubePoints.clear();
+  m_TubePoints.reserve( m_FeatureWeights.GetSize() );
+
+  typename TubeTreeType::ChildrenListType * tubeList = this->GetTubes();
+  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
+  for( tubeIterator = tubeList->begin();
+       tubeIterator != tubeList->end();
+       ++tubeIterator )
+    {
+    TubeType* currentTube = dynamic_cast<TubeType*>(
+      ( *tubeIterator ).GetPointer() );
+
+    if( currentTube != NULL )
+      {
+      typename TubeType::TubePointListType::const_iterator pointIterator;
+      for( pointIterator = currentTube->GetPoints().begin();
+           pointIterator != currentTube->GetPoints().end();
+           ++pointIterator )
+        {
+        TubePointDataType tubePoint;
+        tubePoint.Position = pointIterator->GetPositionInObjectSpace();
+        tubePoint.Normal1 = pointIterator->GetNormal1InObjectSpace();
+        tubePoint.Normal2 = pointIterator->GetNormal2InObjectSpace();
+        tubePoint.Radius = pointIterator->GetRadiusInObjectSpace();
+        m_TubePoints.push_back( tubePoint );
+        }
+      }
+    }
+  delete tubeList;
+}
+
+
 template< class TFixedImage, class TMovingSpatialObject,
           class TTubeSpatialObject >
 typename ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject,
@@ -227,72 +268,14 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   itkDebugMacro( << "**** Get Value ****" );
   itkDebugMacro( << "Parameters = " << parameters );
 
-  CompensatedSummationType matchMeasure;
-  CompensatedSummationType weightSum;
+  MeasureType value;
+  DerivativeType derivative;
+  this->ComputeValueAndDerivative( parameters, true, false, value,
+    derivative );
 
-  // Create a copy of the transform to keep true const correctness (
-  // thread-safe )
-  // Set the parameters on the copy and uses the copy.
-  LightObject::Pointer anotherTransform = this->m_Transform->CreateAnother();
-  TransformType * transformCopy =
-    static_cast< TransformType * >( anotherTransform.GetPointer() );
-  transformCopy->SetFixedParameters( this->m_Transform->GetFixedParameters() );
-  transformCopy->SetParameters( parameters );
-
-  typename TubeTreeType::ChildrenListType::iterator tubeIterator;
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  SizeValueType weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
-    {
-    TubeType * currentTube =
-      dynamic_cast< TubeType * >( ( *tubeIterator ).GetPointer() );
-    if( currentTube != NULL )
-      {
-      typename TubeType::TubePointListType::iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
-        {
-        const InputPointType inputPoint = pointIterator->GetPositionInObjectSpace();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          weightSum += m_FeatureWeights[weightCount];
-          ScalarType scalingRadius = pointIterator->GetRadiusInObjectSpace();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
+  itkDebugMacro( << "matchMeasure = " << value );
 
-          const ScalarType scale = scalingRadius * m_Kappa;
-
-          matchMeasure += m_FeatureWeights[weightCount] * std::fabs(
-            this->ComputeLaplacianMagnitude(
-              pointIterator->GetNormal1InObjectSpace(),
-              scale,
-              currentPoint ) );
-          }
-        ++weightCount;
-        }
-      } // end is a tube
-    }
-
-  if( weightSum.GetSum() == NumericTraits< ScalarType >::Zero )
-    {
-    itkWarningMacro(
-      << "GetValue: All the transformed tube points are outside the image." );
-    matchMeasure = NumericTraits< ScalarType >::min();
-    }
-  else
-    {
-    const ScalarType normalizedMeasure =
-      static_cast< ScalarType >( matchMeasure.GetSum() / weightSum.GetSum() );
-    matchMeasure = normalizedMeasure;
-    }
-
-  itkDebugMacro( << "matchMeasure = " << matchMeasure.GetSum() );
-
-  delete tubeList;
-  return matchMeasure.GetSum();
+  return value;
 }
 
 
@@ -395,8 +378,36 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 ::GetDerivative( const ParametersType & parameters,
                  DerivativeType & derivative ) const
 {
-  derivative.SetSize( this->GetNumberOfParameters() );
+  itkDebugMacro( << "**** Get Derivative ****" );
+  itkDebugMacro( << "parameters = "<< parameters );
+
+  MeasureType value;
+  this->ComputeValueAndDerivative( parameters, false, true, value,
+    derivative );
+}
+
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::GetValueAndDerivative( const ParametersType & parameters,
+                         MeasureType & value,
+                         DerivativeType & derivative ) const
+{
+  this->ComputeValueAndDerivative( parameters, true, true, value,
+    derivative );
+}
+
 
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+void
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ComputeValueAndDerivative( const ParametersType & parameters,
+  bool computeValue, bool computeDerivative,
+  MeasureType & value, DerivativeType & derivative ) const
+{
   // Create a copy of the transform to keep true const correctness
   // ( thread-safe )
   // Set the parameters on the copy and uses the copy.
@@ -407,101 +418,106 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   transformCopy->SetFixedParameters( this->m_Transform->GetFixedParameters() );
   transformCopy->SetParameters( parameters );
 
-  itkDebugMacro( << "**** Get Derivative ****" );
-  itkDebugMacro( << "parameters = "<< parameters );
+  const SizeValueType numberOfPoints = m_TubePoints.size();
 
-  VnlMatrixType biasV( TubeDimension, TubeDimension,
-    NumericTraits< ScalarType >::Zero );
-  VnlMatrixType biasVI( TubeDimension, TubeDimension,
-    NumericTraits< ScalarType >::Zero );
-
-  SizeValueType weightCount = 0;
-
-  CompensatedSummationType dPosition[TubeDimension];
-
-  VnlMatrixType tM( TubeDimension, TubeDimension );
-  VnlVectorType v1T( TubeDimension );
-  VnlVectorType v2T( TubeDimension );
-
-  typedef std::vector< OutputPointType > TubePointsContainerType;
-  TubePointsContainerType transformedTubePoints;
-  transformedTubePoints.reserve( m_FeatureWeights.GetSize() );
-
-  typedef std::vector< VectorType >      dTubePointsContainerType;
-  dTubePointsContainerType dtransformedTubePoints;
-  dtransformedTubePoints.reserve( m_FeatureWeights.GetSize() );
+  unsigned int numberOfWorkUnits = m_NumberOfWorkUnits;
+  if( numberOfWorkUnits == 0 )
+    {
+    numberOfWorkUnits =
+      MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  if( numberOfWorkUnits > numberOfPoints )
+    {
+    numberOfWorkUnits = numberOfPoints;
+    }
+  if( numberOfWorkUnits < 1 )
+    {
+    numberOfWorkUnits = 1;
+    }
 
-  derivative.fill( 0.0 );
+  // The transformed points and their displacements are kept, indexed like
+  //   the tube points, for the angle pass that needs the summed bias.
+  std::vector< PartialSumsType > partialSums( numberOfWorkUnits );
+  std::vector< char > pointIsInside;
+  std::vector< OutputPointType > transformedTubePoints;
+  std::vector< VectorType > dtransformedTubePoints;
+  if( computeDerivative )
+    {
+    pointIsInside.resize( numberOfPoints, 0 );
+    transformedTubePoints.resize( numberOfPoints );
+    dtransformedTubePoints.resize( numberOfPoints );
+    }
 
-  typename TubeTreeType::ChildrenListType * tubeList = GetTubes();
-  typename TubeTreeType::ChildrenListType::const_iterator tubeIterator;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
+  ValueAndDerivativeThreadStruct str;
+  str.Metric = this;
+  str.Transform = transformCopy;
+  str.ComputeValue = computeValue;
+  str.ComputeDerivative = computeDerivative;
+  str.PartialSums = &partialSums;
+  str.PointIsInside = &pointIsInside;
+  str.TransformedPoints = &transformedTubePoints;
+  str.DTransformedPoints = &dtransformedTubePoints;
+
+  if( numberOfWorkUnits > 1 )
     {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
+    MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+    threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+    threader->SetSingleMethod( this->ValueAndDerivativeThreaderCallback,
+      &str );
+    threader->SingleMethodExecute();
+    }
+  else
+    {
+    this->AccumulateTubePoints( &str, 0, numberOfPoints, partialSums[0] );
+    }
 
-    if( currentTube != NULL )
+  // Partial sums are combined in work unit order so that the result only
+  //   depends on the number of work units.
+  CompensatedSummationType matchMeasure;
+  CompensatedSummationType weightSum;
+  CompensatedSummationType dPosition[TubeDimension];
+  VnlMatrixType biasV( TubeDimension, TubeDimension,
+    NumericTraits< ScalarType >::Zero );
+  for( unsigned int w = 0; w < numberOfWorkUnits; ++w )
+    {
+    matchMeasure += partialSums[w].MatchMeasure.GetSum();
+    weightSum += partialSums[w].WeightSum.GetSum();
+    for( unsigned int ii = 0; ii < TubeDimension; ++ii )
       {
-      typename TubeType::TubePointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
+      dPosition[ii] += partialSums[w].DPosition[ii].GetSum();
+      for( unsigned int jj = 0; jj < TubeDimension; ++jj )
         {
-        InputPointType inputPoint = pointIterator->GetPositionInObjectSpace();
-        OutputPointType currentPoint;
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          transformedTubePoints.push_back( currentPoint );
-
-          CovariantVectorType v1;
-          CovariantVectorType v2;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1[ii] = pointIterator->GetNormal1InObjectSpace()[ii];
-            v2[ii] = pointIterator->GetNormal2InObjectSpace()[ii];
-            }
-
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            v1T[ii] = transformCopy->TransformCovariantVector( v1 )[ii];
-            v2T[ii] = transformCopy->TransformCovariantVector( v2 )[ii];
-            }
-          tM = outer_product( v1T, v1T );
-          tM = tM + outer_product( v2T, v2T );
-          tM = m_FeatureWeights[weightCount] * tM;
-          biasV += tM;
-
-          v1 = transformCopy->TransformCovariantVector( v1 );
-          v2 = transformCopy->TransformCovariantVector( v2 );
-
-          ScalarType scalingRadius = pointIterator->GetRadiusInObjectSpace();
-          scalingRadius = std::max( scalingRadius, m_MinimumScalingRadius );
-
-          const ScalarType scale = scalingRadius * m_Kappa;
-
-          const ScalarType dXProj1
-            = this->ComputeThirdDerivatives( v1, scale, currentPoint );
-          const ScalarType dXProj2
-            = this->ComputeThirdDerivatives( v2, scale, currentPoint );
-
-          VectorType dtransformedTubePoint;
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dtransformedTubePoint[ii] =
-              ( dXProj1 * v1[ii] + dXProj2 * v2[ii] );
-            dPosition[ii] +=
-              m_FeatureWeights[weightCount] * ( dtransformedTubePoint[ii] );
-            }
-          dtransformedTubePoints.push_back( dtransformedTubePoint );
-          }
-        ++weightCount;
+        biasV( ii, jj ) +=
+          partialSums[w].BiasV[ii * TubeDimension + jj].GetSum();
         }
       }
     }
 
-  biasVI = vnl_matrix_inverse< ScalarType >( biasV ).inverse();
+  if( computeValue )
+    {
+    if( weightSum.GetSum() == NumericTraits< ScalarType >::Zero )
+      {
+      itkWarningMacro(
+        << "GetValue: All the transformed tube points are outside the "
+        << "image." );
+      value = NumericTraits< ScalarType >::min();
+      }
+    else
+      {
+      value = static_cast< MeasureType >(
+        matchMeasure.GetSum() / weightSum.GetSum() );
+      }
+    }
+
+  if( !computeDerivative )
+    {
+    return;
+    }
+
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.fill( 0.0 );
+
+  VnlMatrixType biasVI = vnl_matrix_inverse< ScalarType >( biasV ).inverse();
 
   VnlVectorType tV( TubeDimension );
   for( unsigned int ii = 0; ii < TubeDimension; ++ii )
@@ -511,63 +527,31 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
 
   tV *= biasVI;
 
+  VectorType offsets;
   for( unsigned int ii = 0; ii < TubeDimension; ++ii )
     {
-    dPosition[ii] = tV[ii];
+    offsets[ii] = tV[ii];
     }
 
   CompensatedSummationType dAngle[TubeDimension];
-  VectorType offsets;
-  for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+  VnlVectorType dXT( TubeDimension );
+  for( SizeValueType pointNum = 0; pointNum < numberOfPoints; ++pointNum )
     {
-    offsets[ii] = dPosition[ii].GetSum();
-    }
-  typename TubePointsContainerType::const_iterator transformedTubePointsIt =
-    transformedTubePoints.begin();
-  typename dTubePointsContainerType::const_iterator
-    dtransformedTubePointsIt = dtransformedTubePoints.begin();
-  weightCount = 0;
-  for( tubeIterator = tubeList->begin();
-       tubeIterator != tubeList->end();
-       ++tubeIterator )
-    {
-    TubeType* currentTube = dynamic_cast<TubeType*>(
-      ( *tubeIterator ).GetPointer() );
-
-    if( currentTube != NULL )
+    if( pointIsInside[pointNum] )
       {
-      typename TubeType::TubePointListType::const_iterator pointIterator;
-      for( pointIterator = currentTube->GetPoints().begin();
-           pointIterator != currentTube->GetPoints().end();
-           ++pointIterator )
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
         {
-        InputPointType inputPoint = pointIterator->GetPositionInObjectSpace();
-        OutputPointType currentPoint;
-        //! \todo this checking is not necessary, but we have to make sure
-        //have
-        //the corresponding weight -- should cache the result and use it
-        //here.
-        if( this->IsInside( inputPoint, currentPoint, transformCopy ) )
-          {
-          VnlVectorType dXT( TubeDimension );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dXT[ii] = ( *dtransformedTubePointsIt )[ii];
-            }
-
-          dXT = dXT * biasVI;
-
-          ScalarType angleDelta[TubeDimension];
-          this->GetDeltaAngles( *transformedTubePointsIt, dXT, offsets,
-            angleDelta );
-          for( unsigned int ii = 0; ii < TubeDimension; ++ii )
-            {
-            dAngle[ii] += m_FeatureWeights[weightCount] * angleDelta[ii];
-            }
-          ++dtransformedTubePointsIt;
-          ++transformedTubePointsIt;
-          }
-        ++weightCount;
+        dXT[ii] = dtransformedTubePoints[pointNum][ii];
+        }
+
+      dXT = dXT * biasVI;
+
+      ScalarType angleDelta[TubeDimension];
+      this->GetDeltaAngles( transformedTubePoints[pointNum], dXT, offsets,
+        angleDelta );
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dAngle[ii] += m_FeatureWeights[pointNum] * angleDelta[ii];
         }
       }
     }
@@ -575,11 +559,35 @@ ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
   derivative[0] = dAngle[0].GetSum();
   derivative[1] = dAngle[1].GetSum();
   derivative[2] = dAngle[2].GetSum();
-  derivative[3] = dPosition[0].GetSum();
-  derivative[4] = dPosition[1].GetSum();
-  derivative[5] = dPosition[2].GetSum();
+  derivative[3] = tV[0];
+  derivative[4] = tV[1];
+  derivative[5] = tV[2];
+}
 
-  delete tubeList;
+
+template< class TFixedImage, class TMovingSpatialObject,
+          class TTubeSpatialObject >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
+::ValueAndDerivativeThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ValueAndDerivativeThreadStruct * str =
+    ( ValueAndDerivativeThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  const SizeValueType numberOfPoints = str->Metric->m_TubePoints.size();
+  const SizeValueType pointStart = numberOfPoints * threadId / threadCount;
+  const SizeValueType pointEnd =
+    numberOfPoints * ( threadId + 1 ) / threadCount;
+  str->Metric->AccumulateTubePoints( str, pointStart, pointEnd,
+    ( *str->PartialSums )[threadId] );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 
@@ -587,12 +595,73 @@ template< class TFixedImage, class TMovingSpatialObject,
           class TTubeSpatialObject >
 void
 ImageToTubeRigidMetric< TFixedImage, TMovingSpatialObject, TTubeSpatialObject >
-::GetValueAndDerivative( const ParametersType & parameters,
-                         MeasureType & value,
-                         DerivativeType & derivative ) const
+::AccumulateTubePoints( const ValueAndDerivativeThreadStruct * str,
+  SizeValueType pointStart, SizeValueType pointEnd,
+  PartialSumsType & sums ) const
 {
-  value = this->GetValue( parameters );
-  this->GetDerivative( parameters, derivative );
+  const TransformType * transform = str->Transform;
+
+  for( SizeValueType pointNum = pointStart; pointNum < pointEnd; ++pointNum )
+    {
+    const TubePointDataType & tubePoint = m_TubePoints[pointNum];
+    OutputPointType currentPoint;
+    if( !this->IsInside( tubePoint.Position, currentPoint, transform ) )
+      {
+      continue;
+      }
+
+    const ScalarType weight = m_FeatureWeights[pointNum];
+    const ScalarType scalingRadius =
+      std::max( tubePoint.Radius, m_MinimumScalingRadius );
+    const ScalarType scale = scalingRadius * m_Kappa;
+
+    sums.WeightSum += weight;
+    if( str->ComputeValue )
+      {
+      sums.MatchMeasure += weight * std::fabs(
+        this->ComputeLaplacianMagnitude( tubePoint.Normal1, scale,
+          currentPoint ) );
+      }
+
+    if( str->ComputeDerivative )
+      {
+      ( *str->PointIsInside )[pointNum] = 1;
+      ( *str->TransformedPoints )[pointNum] = currentPoint;
+
+      CovariantVectorType v1;
+      CovariantVectorType v2;
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        v1[ii] = tubePoint.Normal1[ii];
+        v2[ii] = tubePoint.Normal2[ii];
+        }
+      v1 = transform->TransformCovariantVector( v1 );
+      v2 = transform->TransformCovariantVector( v2 );
+
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        for( unsigned int jj = 0; jj < TubeDimension; ++jj )
+          {
+          sums.BiasV[ii * TubeDimension + jj] +=
+            weight * ( v1[ii] * v1[jj] + v2[ii] * v2[jj] );
+          }
+        }
+
+      const ScalarType dXProj1
+        = this->ComputeThirdDerivatives( v1, scale, currentPoint );
+      const ScalarType dXProj2
+        = this->ComputeThirdDerivatives( v2, scale, currentPoint );
+
+      VectorType & dtransformedTubePoint =
+        ( *str->DTransformedPoints )[pointNum];
+      for( unsigned int ii = 0; ii < TubeDimension; ++ii )
+        {
+        dtransformedTubePoint[ii] =
+          ( dXProj1 * v1[ii] + dXProj2 * v2[ii] );
+        sums.DPosition[ii] += weight * dtransformedTubePoint[ii];
+        }
+      }
+    }
 }
 
 
@@ -28,6 +28,7 @@ set( TubeTK_Segmentation_H_Files
   Segmentation/itktubeRidgeExtractor.h
   Segmentation/itktubeSegmentTubeUsingMinimalPathFilter.h
   Segmentation/itktubeTubeExtractor.h
+  Segmentation/itktubeTubeExtractorProfile.h
   Segmentation/itktubeRidgeSeedFilter.h
   Segmentation/itktubeComputeTrainingMaskFilter.h)
 
@@ -28,6 +28,7 @@ limitations under the License.
 
 #include <itkImage.h>
 #include <itkListSample.h>
+#include <itkMultiThreaderBase.h>
 
 #include <vector>
 
@@ -72,6 +73,8 @@ public:
                                                FeatureVectorType;
   typedef typename FeatureVectorGeneratorType::FeatureImageType
                                                FeatureImageType;
+  typedef typename FeatureVectorGeneratorType::RegionType
+                                               RegionType;
 
   typedef typename LabelMapType::PixelType     LabelMapPixelType;
 
@@ -182,6 +185,22 @@ protected:
 
   virtual void ApplyPDFs( void );
 
+  /** Compute the weighted class probabilities of the blocks handled by
+   *   one work unit. */
+  void ThreadedComputeProbabilities( const std::vector< RegionType > & blocks,
+    ThreadIdType threadId, ThreadIdType threadCount );
+
+  /** Set labelImage to 128 where classNum is the most likely class and to
+   *   0 elsewhere, over the blocks handled by one work unit. */
+  void ThreadedLabelMostLikelyClass( const std::vector< RegionType > & blocks,
+    unsigned int classNum, LabelMapType * labelImage, ThreadIdType threadId,
+    ThreadIdType threadCount );
+
+  /** Assign the most likely class to the output label map over the blocks
+   *   handled by one work unit. */
+  void ThreadedForceClassification( const std::vector< RegionType > & blocks,
+    ThreadIdType threadId, ThreadIdType threadCount );
+
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
   typedef std::vector< typename ProbabilityImageType::Pointer >
@@ -216,6 +235,25 @@ private:
   PDFSegmenterBase( const Self & );      // Purposely not implemented
   void operator = ( const Self & );      // Purposely not implemented
 
+  /** Work shared by the ApplyPDFs threader callbacks.  Blocks are dealt
+   *   out round-robin by work unit id. */
+  struct ApplyPDFsThreadStruct
+    {
+    Self                            * Segmenter;
+    const std::vector< RegionType > * Blocks;
+    unsigned int                      ClassNum;
+    LabelMapType                    * LabelImage;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ComputeProbabilitiesThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    LabelMostLikelyClassThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ForceClassificationThreaderCallback( void * arg );
+
   VectorDoubleType    m_PDFWeightList;
 
   unsigned int        m_ErodeDilateRadius;
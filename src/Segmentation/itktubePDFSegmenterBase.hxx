@@ -42,9 +42,12 @@ limitations under the License.
 #include <itkTimeProbesCollectorBase.h>
 #include <itkVotingBinaryIterativeHoleFillingImageFilter.h>
 #include <itkImageDuplicator.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
 
 #include <vnl/vnl_matrix.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace itk
@@ -290,54 +293,71 @@ PDFSegmenterBase< TImage, TLabelMap >
 
   typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
     ConstLabelMapIteratorType;
-  ConstLabelMapIteratorType itInLabelMap( m_InputLabelMap,
-    m_InputLabelMap->GetLargestPossibleRegion() );
-  itInLabelMap.GoToBegin();
+
+  // Features are computed a block of slices at a time
+  std::vector< RegionType > blocks =
+    FeatureVectorGeneratorType::SplitRegionIntoBlocks(
+      m_InputLabelMap->GetLargestPossibleRegion(), 1 << 16 );
+  std::vector< FeatureValueType > featureBlock;
 
   ListVectorType v;
   v.resize( numFeatures + ImageDimension );
-  FeatureVectorType fv;
   typename LabelMapType::IndexType indx;
   bool found = false;
-  int prevVal = itInLabelMap.Get() + 1;
+  int prevVal = 0;
   int prevC = 0;
-  while( !itInLabelMap.IsAtEnd() )
+  for( size_t b = 0; b < blocks.size(); ++b )
     {
-    int val = itInLabelMap.Get();
-    indx = itInLabelMap.GetIndex();
-    fv = this->m_FeatureVectorGenerator->GetFeatureVector( indx );
-    for( unsigned int i = 0; i < numFeatures; i++ )
-      {
-      v[i] = fv[i];
-      }
-    for( unsigned int i = 0; i < ImageDimension; i++ )
+    const SizeValueType numVoxels = blocks[b].GetNumberOfPixels();
+    featureBlock.resize( numFeatures * numVoxels );
+    this->m_FeatureVectorGenerator->FillFeatureBlock( blocks[b],
+      featureBlock.data() );
+
+    ConstLabelMapIteratorType itInLabelMap( m_InputLabelMap, blocks[b] );
+    itInLabelMap.GoToBegin();
+    if( b == 0 )
       {
-      v[numFeatures+i] = indx[i];
+      prevVal = itInLabelMap.Get() + 1;
       }
-    if( val != prevVal )
+    SizeValueType voxel = 0;
+    while( !itInLabelMap.IsAtEnd() )
       {
-      found = false;
-      prevVal = val;
-      for( unsigned int c = 0; c < numClasses; c++ )
+      int val = itInLabelMap.Get();
+      indx = itInLabelMap.GetIndex();
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        v[i] = featureBlock[ i * numVoxels + voxel ];
+        }
+      for( unsigned int i = 0; i < ImageDimension; i++ )
         {
-        if( val == m_ObjectIdList[c] )
+        v[numFeatures+i] = indx[i];
+        }
+      if( val != prevVal )
+        {
+        found = false;
+        prevVal = val;
+        for( unsigned int c = 0; c < numClasses; c++ )
           {
-          found = true;
-          prevVal = val;
-          prevC = c;
-          break;
+          if( val == m_ObjectIdList[c] )
+            {
+            found = true;
+            prevVal = val;
+            prevC = c;
+            break;
+            }
           }
         }
+      if( found )
+        {
+        m_InClassList[prevC].push_back( v );
+        }
+      else if( !found && val != m_VoidId )
+        {
+        m_OutClassList.push_back( v );
+        }
+      ++voxel;
+      ++itInLabelMap;
       }
-    if( found )
-      {
-      m_InClassList[prevC].push_back( v );
-      }
-    else if( !found && val != m_VoidId )
-      {
-      m_OutClassList.push_back( v );
-      }
-    ++itInLabelMap;
     }
 }
 
@@ -429,10 +449,6 @@ PDFSegmenterBase< TImage, TLabelMap >
   //
   m_ProbabilityImageVector.resize( numClasses );
 
-  typedef itk::ImageRegionIterator<ProbabilityImageType>
-    ProbabilityImageIteratorType;
-  std::vector< ProbabilityImageIteratorType * > probIt( numClasses );
-
   for( unsigned int c = 0; c < numClasses; c++ )
     {
     m_ProbabilityImageVector[c] = ProbabilityImageType::New();
@@ -441,11 +457,6 @@ PDFSegmenterBase< TImage, TLabelMap >
     m_ProbabilityImageVector[c]->CopyInformation( m_FeatureVectorGenerator->
       GetInput( 0 ) );
     m_ProbabilityImageVector[c]->Allocate();
-
-    probIt[c] = new ProbabilityImageIteratorType(
-      m_ProbabilityImageVector[c],
-      m_ProbabilityImageVector[c]->GetLargestPossibleRegion() );
-    probIt[c]->GoToBegin();
     }
 
   if( m_InputLabelMap.IsNull() )
@@ -459,34 +470,28 @@ PDFSegmenterBase< TImage, TLabelMap >
     m_ForceClassification = true;
     }
 
-  typedef itk::ImageRegionConstIteratorWithIndex< LabelMapType >
-    ConstLabelMapIteratorType;
-  ConstLabelMapIteratorType itInLabelMap( m_InputLabelMap,
-    m_InputLabelMap->GetLargestPossibleRegion() );
-  itInLabelMap.GoToBegin();
-
-  FeatureVectorType fv;
-  typename LabelMapType::IndexType indx;
-  while( !itInLabelMap.IsAtEnd() )
-    {
-    indx = itInLabelMap.GetIndex();
-    fv = m_FeatureVectorGenerator->GetFeatureVector( indx );
-
-    ProbabilityVectorType probV = this->GetProbabilityVector( fv );
-    for( unsigned int c=0; c<numClasses; ++c )
-      {
-      probIt[c]->Set( m_PDFWeightList[c] * probV[c] );
-
-      ++( *( probIt[c] ) );
-      }
-
-    ++itInLabelMap;
-    }
-
-  for( unsigned int c = 0; c < numClasses; ++c )
-    {
-    delete probIt[c];
-    }
+  // Features are computed a block of slices at a time.  Blocks are dealt
+  //   out to the work units, each of which keeps its own feature buffer.
+  const ThreadIdType numWorkUnits = this->GetNumberOfWorkUnits();
+  SizeValueType maxVoxelsPerBlock = m_InputLabelMap->
+    GetLargestPossibleRegion().GetNumberOfPixels() / ( 4 * numWorkUnits );
+  maxVoxelsPerBlock = std::max( std::min( maxVoxelsPerBlock,
+    static_cast< SizeValueType >( 1 << 16 ) ),
+    static_cast< SizeValueType >( 1 ) );
+  std::vector< RegionType > blocks =
+    FeatureVectorGeneratorType::SplitRegionIntoBlocks(
+      m_InputLabelMap->GetLargestPossibleRegion(), maxVoxelsPerBlock );
+
+  ApplyPDFsThreadStruct str;
+  str.Segmenter = this;
+  str.Blocks = &blocks;
+  str.ClassNum = 0;
+  str.LabelImage = nullptr;
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits( numWorkUnits );
+  this->GetMultiThreader()->SetSingleMethod(
+    this->ComputeProbabilitiesThreaderCallback, & str );
+  this->GetMultiThreader()->SingleMethodExecute();
 
   if( m_ProbabilityImageSmoothingStandardDeviation > 0 )
     {
@@ -521,7 +526,7 @@ PDFSegmenterBase< TImage, TLabelMap >
   //  Create label image
   //
 
-  typename LabelMapType::IndexType labelImageIndex;
+  typename LabelMapType::IndexType indx;
 
   typename LabelMapType::Pointer tmpLabelImage = LabelMapType::New();
   tmpLabelImage->SetRegions( m_InputLabelMap->GetLargestPossibleRegion() );
@@ -541,35 +546,12 @@ PDFSegmenterBase< TImage, TLabelMap >
       {
       // For this class, label all pixels for which it is the most
       // likely class.
-      itk::ImageRegionIteratorWithIndex<LabelMapType> labelIt(
-        tmpLabelImage, tmpLabelImage->GetLargestPossibleRegion() );
-      labelIt.GoToBegin();
-      while( !labelIt.IsAtEnd() )
-        {
-        labelImageIndex = labelIt.GetIndex();
-        bool maxPC = true;
-        double maxP = m_ProbabilityImageVector[c]->GetPixel(
-          labelImageIndex );
-        for( unsigned int oc = 0; oc < numClasses; oc++ )
-          {
-          if( oc != c &&
-              m_ProbabilityImageVector[oc]->GetPixel( labelImageIndex )
-              > maxP )
-            {
-            maxPC = false;
-            break;
-            }
-          }
-        if( maxPC )
-          {
-          labelIt.Set( 128 );
-          }
-        else
-          {
-          labelIt.Set( 0 );
-          }
-        ++labelIt;
-        }
+      str.ClassNum = c;
+      str.LabelImage = tmpLabelImage;
+      this->GetMultiThreader()->SetNumberOfWorkUnits( numWorkUnits );
+      this->GetMultiThreader()->SetSingleMethod(
+        this->LabelMostLikelyClassThreaderCallback, & str );
+      this->GetMultiThreader()->SingleMethodExecute();
 
       typedef itk::ConnectedThresholdImageFilter<LabelMapType,
         LabelMapType> ConnectedFilterType;
@@ -842,23 +824,144 @@ PDFSegmenterBase< TImage, TLabelMap >
   else
     {
     // Merge with input mask
-    typedef itk::ImageRegionIteratorWithIndex< LabelMapType >
-      LabelMapIteratorType;
-    LabelMapIteratorType itOutLM( m_OutputLabelMap,
-      m_OutputLabelMap->GetLargestPossibleRegion() );
-    itOutLM.GoToBegin();
+    this->GetMultiThreader()->SetNumberOfWorkUnits( numWorkUnits );
+    this->GetMultiThreader()->SetSingleMethod(
+      this->ForceClassificationThreaderCallback, & str );
+    this->GetMultiThreader()->SingleMethodExecute();
+    }
+
+  std::cout << "done" << std::endl;
+  m_ClassProbabilityImagesUpToDate = true;
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterBase< TImage, TLabelMap >
+::ThreadedComputeProbabilities( const std::vector< RegionType > & blocks,
+  ThreadIdType threadId, ThreadIdType threadCount )
+{
+  const unsigned int numClasses = m_ObjectIdList.size();
+
+  const unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  typedef itk::ImageRegionIterator< ProbabilityImageType >
+    ProbabilityImageIteratorType;
+
+  std::vector< FeatureValueType > featureBlock;
+  FeatureVectorType fv( numFeatures );
+  for( size_t b = threadId; b < blocks.size(); b += threadCount )
+    {
+    const SizeValueType numVoxels = blocks[b].GetNumberOfPixels();
+    featureBlock.resize( numFeatures * numVoxels );
+    m_FeatureVectorGenerator->FillFeatureBlock( blocks[b],
+      featureBlock.data() );
+
+    std::vector< ProbabilityImageIteratorType > probIt;
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probIt.push_back( ProbabilityImageIteratorType(
+        m_ProbabilityImageVector[c], blocks[b] ) );
+      }
+
+    for( SizeValueType voxel = 0; voxel < numVoxels; ++voxel )
+      {
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        fv[i] = featureBlock[ i * numVoxels + voxel ];
+        }
 
+      ProbabilityVectorType probV = this->GetProbabilityVector( fv );
+      for( unsigned int c = 0; c < numClasses; ++c )
+        {
+        probIt[c].Set( m_PDFWeightList[c] * probV[c] );
+        ++probIt[c];
+        }
+      }
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterBase< TImage, TLabelMap >
+::ThreadedLabelMostLikelyClass( const std::vector< RegionType > & blocks,
+  unsigned int classNum, LabelMapType * labelImage, ThreadIdType threadId,
+  ThreadIdType threadCount )
+{
+  const unsigned int numClasses = m_ObjectIdList.size();
+
+  typedef itk::ImageRegionConstIterator< ProbabilityImageType >
+    ProbabilityImageIteratorType;
+
+  for( size_t b = threadId; b < blocks.size(); b += threadCount )
+    {
+    std::vector< ProbabilityImageIteratorType > probIt;
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probIt.push_back( ProbabilityImageIteratorType(
+        m_ProbabilityImageVector[c], blocks[b] ) );
+      }
+
+    itk::ImageRegionIterator< LabelMapType > labelIt( labelImage,
+      blocks[b] );
+    while( !labelIt.IsAtEnd() )
+      {
+      bool maxPC = true;
+      double maxP = probIt[classNum].Get();
+      for( unsigned int oc = 0; oc < numClasses; oc++ )
+        {
+        if( oc != classNum && probIt[oc].Get() > maxP )
+          {
+          maxPC = false;
+          break;
+          }
+        }
+      if( maxPC )
+        {
+        labelIt.Set( 128 );
+        }
+      else
+        {
+        labelIt.Set( 0 );
+        }
+      ++labelIt;
+      for( unsigned int c = 0; c < numClasses; ++c )
+        {
+        ++probIt[c];
+        }
+      }
+    }
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterBase< TImage, TLabelMap >
+::ThreadedForceClassification( const std::vector< RegionType > & blocks,
+  ThreadIdType threadId, ThreadIdType threadCount )
+{
+  const unsigned int numClasses = m_ObjectIdList.size();
+
+  typedef itk::ImageRegionConstIterator< ProbabilityImageType >
+    ProbabilityImageIteratorType;
+
+  for( size_t b = threadId; b < blocks.size(); b += threadCount )
+    {
+    std::vector< ProbabilityImageIteratorType > probIt;
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      probIt.push_back( ProbabilityImageIteratorType(
+        m_ProbabilityImageVector[c], blocks[b] ) );
+      }
+
+    itk::ImageRegionIterator< LabelMapType > itOutLM( m_OutputLabelMap,
+      blocks[b] );
     while( !itOutLM.IsAtEnd() )
       {
-      //itOutLM.Set( itOutLM.Get() );
-      labelImageIndex = itOutLM.GetIndex();
       unsigned int maxPC = 0;
-      double maxP = m_ProbabilityImageVector[0]->GetPixel(
-        labelImageIndex );
+      double maxP = probIt[0].Get();
       for( unsigned int c = 1; c < numClasses; c++ )
         {
-        double p = m_ProbabilityImageVector[c]->GetPixel(
-          labelImageIndex );
+        double p = probIt[c].Get();
         if( p > maxP )
           {
           maxP = p;
@@ -891,11 +994,69 @@ PDFSegmenterBase< TImage, TLabelMap >
           }
         }
       ++itOutLM;
+      for( unsigned int c = 0; c < numClasses; ++c )
+        {
+        ++probIt[c];
+        }
       }
     }
+}
 
-  std::cout << "done" << std::endl;
-  m_ClassProbabilityImagesUpToDate = true;
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+PDFSegmenterBase< TImage, TLabelMap >
+::ComputeProbabilitiesThreaderCallback( void * arg )
+{
+  int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ApplyPDFsThreadStruct * str = ( ApplyPDFsThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  str->Segmenter->ThreadedComputeProbabilities( *( str->Blocks ), threadId,
+    threadCount );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+PDFSegmenterBase< TImage, TLabelMap >
+::LabelMostLikelyClassThreaderCallback( void * arg )
+{
+  int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ApplyPDFsThreadStruct * str = ( ApplyPDFsThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  str->Segmenter->ThreadedLabelMostLikelyClass( *( str->Blocks ),
+    str->ClassNum, str->LabelImage, threadId, threadCount );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template< class TImage, class TLabelMap >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+PDFSegmenterBase< TImage, TLabelMap >
+::ForceClassificationThreaderCallback( void * arg )
+{
+  int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ApplyPDFsThreadStruct * str = ( ApplyPDFsThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  str->Segmenter->ThreadedForceClassification( *( str->Blocks ), threadId,
+    threadCount );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 template< class TImage, class TLabelMap >
@@ -29,6 +29,7 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkListSample.h>
 
+#include <unordered_map>
 #include <vector>
 
 namespace itk
@@ -102,6 +103,12 @@ public:
   typedef Image< LabelMapPixelType, PARZEN_MAX_NUMBER_OF_FEATURES >
     LabeledFeatureSpaceType;
 
+  /** Sparse PDFs map the raster offset of a histogram bin ( first feature
+   *   fastest ) to its density.  Bins that are not stored are zero. */
+  typedef unsigned long long                     SparsePDFKeyType;
+  typedef std::unordered_map< SparsePDFKeyType, PDFPixelType >
+    SparsePDFType;
+
   //
   // Methods
   //
@@ -115,6 +122,31 @@ public:
 
   void SetClassPDFImage( unsigned int classNum, PDFImageType * classPDF );
 
+  /** Store the class PDFs as hashed bins rather than as dense images.
+   *   Only the non-empty bins are kept, so this also lifts the
+   *   PARZEN_MAX_NUMBER_OF_FEATURES limit on the number of features.
+   *   The sparse Parzen window is a sampled Gaussian truncated at three
+   *   standard deviations rather than the recursive Gaussian used for
+   *   the dense images, so the two agree only to within a few percent
+   *   of the peak density.  Setting a dense class PDF image switches
+   *   back to dense PDFs. */
+  itkSetMacro( UseSparsePDFs, bool );
+  itkGetMacro( UseSparsePDFs, bool );
+  itkBooleanMacro( UseSparsePDFs );
+
+  /** Sparse bins whose density falls below this fraction of the peak
+   *   density are dropped after each blurring pass. */
+  itkSetMacro( SparsePDFPruneThreshold, double );
+  itkGetMacro( SparsePDFPruneThreshold, double );
+
+  const SparsePDFType & GetClassSparsePDF( unsigned int classNum ) const;
+
+  void SetClassSparsePDF( unsigned int classNum,
+    const SparsePDFType & classPDF );
+
+  /** Key of the bin holding a feature vector, clamped to the histogram */
+  SparsePDFKeyType GetSparsePDFKey( const FeatureVectorType & fv ) const;
+
   const VectorUIntType & GetNumberOfBinsPerFeature( void ) const;
   void             SetNumberOfBinsPerFeature( const VectorUIntType & nBin );
   const VectorDoubleType & GetBinMin( void ) const;
@@ -146,6 +178,10 @@ protected:
 
   virtual void GeneratePDFs( void ) override;
 
+  /** Build the sparse class PDFs from the in-class samples, using the
+   *   bin layout computed by GeneratePDFs */
+  void GenerateSparsePDFs( void );
+
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
 private:
@@ -170,6 +206,10 @@ private:
   VectorDoubleType                m_HistogramBinSize;
   VectorUIntType                  m_HistogramNumberOfBin;
 
+  bool                            m_UseSparsePDFs;
+  double                          m_SparsePDFPruneThreshold;
+  std::vector< SparsePDFType >    m_InClassSparsePDF;
+
   double                          m_OutlierRejectPortion;
 
   double                          m_HistogramSmoothingStandardDeviation;
@@ -40,12 +40,16 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
 #include <itkJoinImageFilter.h>
 #include <itkTimeProbesCollectorBase.h>
 #include <itkVotingBinaryIterativeHoleFillingImageFilter.h>
 
 #include <vnl/vnl_matrix.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <limits>
 
 namespace itk
@@ -64,6 +68,10 @@ PDFSegmenterParzen< TImage, TLabelMap >
   m_HistogramBinSize.clear();
   m_HistogramNumberOfBin.clear();
 
+  m_UseSparsePDFs = false;
+  m_SparsePDFPruneThreshold = 1e-6;
+  m_InClassSparsePDF.clear();
+
   m_HistogramSmoothingStandardDeviation = 4;
 
   m_OutlierRejectPortion = 0.001;
@@ -100,11 +108,72 @@ PDFSegmenterParzen< TImage, TLabelMap >
     m_InClassHistogram.resize( this->m_ObjectIdList.size() );
     }
   m_InClassHistogram[classNum] = classPDF;
+  m_UseSparsePDFs = false;
+  m_InClassSparsePDF.clear();
+  this->m_SampleUpToDate = false;
+  this->m_PDFsUpToDate = true;
+  this->m_ClassProbabilityImagesUpToDate = false;
+}
+
+template< class TImage, class TLabelMap >
+const typename PDFSegmenterParzen< TImage, TLabelMap >::SparsePDFType &
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetClassSparsePDF( unsigned int classNum ) const
+{
+  if( classNum >= m_InClassSparsePDF.size() )
+    {
+    itkExceptionMacro( << "Sparse PDF for class " << classNum
+      << " does not exist." );
+    }
+  return m_InClassSparsePDF[classNum];
+}
+
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::SetClassSparsePDF( unsigned int classNum,
+  const SparsePDFType & classPDF )
+{
+  if( this->m_ObjectIdList.size() != m_InClassSparsePDF.size() )
+    {
+    m_InClassSparsePDF.resize( this->m_ObjectIdList.size() );
+    }
+  m_InClassSparsePDF[classNum] = classPDF;
+  m_UseSparsePDFs = true;
   this->m_SampleUpToDate = false;
   this->m_PDFsUpToDate = true;
   this->m_ClassProbabilityImagesUpToDate = false;
 }
 
+template< class TImage, class TLabelMap >
+typename PDFSegmenterParzen< TImage, TLabelMap >::SparsePDFKeyType
+PDFSegmenterParzen< TImage, TLabelMap >
+::GetSparsePDFKey( const FeatureVectorType & fv ) const
+{
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  SparsePDFKeyType key = 0;
+  SparsePDFKeyType stride = 1;
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    int binN = static_cast< int >( ( fv[i] - m_HistogramBinMin[i] )
+      / m_HistogramBinSize[i] );
+    if( binN < 0 )
+      {
+      binN = 0;
+      }
+    else if( static_cast< unsigned int >( binN )
+      >= m_HistogramNumberOfBin[i] )
+      {
+      binN = m_HistogramNumberOfBin[i] - 1;
+      }
+    key += binN * stride;
+    stride *= m_HistogramNumberOfBin[i];
+    }
+  return key;
+}
+
 template< class TImage, class TLabelMap >
 const typename PDFSegmenterParzen< TImage, TLabelMap >::VectorUIntType &
 PDFSegmenterParzen< TImage, TLabelMap >
@@ -423,6 +492,13 @@ PDFSegmenterParzen< TImage, TLabelMap >
       }
     }
 
+  if( m_UseSparsePDFs )
+    {
+    this->GenerateSparsePDFs();
+    return;
+    }
+  m_InClassSparsePDF.clear();
+
   //
   //  Create joint histograms
   //
@@ -539,6 +615,142 @@ PDFSegmenterParzen< TImage, TLabelMap >
     }
 }
 
+template< class TImage, class TLabelMap >
+void
+PDFSegmenterParzen< TImage, TLabelMap >
+::GenerateSparsePDFs( void )
+{
+  unsigned int numClasses = this->m_ObjectIdList.size();
+  unsigned int numFeatures = this->m_FeatureVectorGenerator->
+    GetNumberOfFeatures();
+
+  std::vector< SparsePDFKeyType > stride( numFeatures );
+  SparsePDFKeyType numberOfBins = 1;
+  for( unsigned int i = 0; i < numFeatures; i++ )
+    {
+    stride[i] = numberOfBins;
+    if( numberOfBins > std::numeric_limits< SparsePDFKeyType >::max()
+      / m_HistogramNumberOfBin[i] )
+      {
+      itkExceptionMacro( << "Too many histogram bins to index a sparse PDF."
+        );
+      }
+    numberOfBins *= m_HistogramNumberOfBin[i];
+    }
+
+  // Parzen window in units of bins, as used for the dense histograms,
+  //   truncated at three standard deviations
+  std::vector< double > kernel;
+  if( m_HistogramSmoothingStandardDeviation > 0 )
+    {
+    const double sigma = m_HistogramSmoothingStandardDeviation;
+    const int kernelRadius = static_cast< int >( std::ceil( 3 * sigma ) );
+    kernel.resize( kernelRadius + 1 );
+    double kernelTotal = 0;
+    for( int k = 0; k <= kernelRadius; ++k )
+      {
+      kernel[k] = std::exp( -0.5 * k * k / ( sigma * sigma ) );
+      kernelTotal += ( k == 0 ) ? kernel[k] : 2 * kernel[k];
+      }
+    for( int k = 0; k <= kernelRadius; ++k )
+      {
+      kernel[k] /= kernelTotal;
+      }
+    }
+  const int kernelRadius = static_cast< int >( kernel.size() ) - 1;
+
+  m_InClassHistogram.clear();
+  m_InClassSparsePDF.resize( numClasses );
+
+  FeatureVectorType fv( numFeatures );
+  for( unsigned int c = 0; c < numClasses; c++ )
+    {
+    SparsePDFType & pdf = m_InClassSparsePDF[c];
+    pdf.clear();
+
+    typename ListSampleType::const_iterator
+      inClassListIt( this->m_InClassList[c].begin() );
+    typename ListSampleType::const_iterator
+      inClassListItEnd( this->m_InClassList[c].end() );
+    while( inClassListIt != inClassListItEnd )
+      {
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        fv[i] = ( *inClassListIt )[i];
+        }
+      pdf[ this->GetSparsePDFKey( fv ) ] += 1;
+      ++inClassListIt;
+      }
+
+    for( unsigned int dir = 0; kernelRadius > 0 && dir < numFeatures;
+      ++dir )
+      {
+      const long long dirNumberOfBins = m_HistogramNumberOfBin[dir];
+      SparsePDFType blurredPDF;
+      blurredPDF.reserve( pdf.size() * ( 2 * kernelRadius + 1 ) );
+      typename SparsePDFType::const_iterator pdfIt = pdf.begin();
+      while( pdfIt != pdf.end() )
+        {
+        const long long bin = ( pdfIt->first / stride[dir] )
+          % dirNumberOfBins;
+        for( int k = -kernelRadius; k <= kernelRadius; ++k )
+          {
+          if( bin + k < 0 || bin + k >= dirNumberOfBins )
+            {
+            continue;
+            }
+          SparsePDFKeyType key = pdfIt->first;
+          if( k < 0 )
+            {
+            key -= static_cast< SparsePDFKeyType >( -k ) * stride[dir];
+            }
+          else
+            {
+            key += static_cast< SparsePDFKeyType >( k ) * stride[dir];
+            }
+          blurredPDF[ key ] += pdfIt->second * kernel[ std::abs( k ) ];
+          }
+        ++pdfIt;
+        }
+
+      // Drop the far tails so the support does not grow with every pass
+      PDFPixelType maxP = 0;
+      for( pdfIt = blurredPDF.begin(); pdfIt != blurredPDF.end(); ++pdfIt )
+        {
+        maxP = std::max( maxP, pdfIt->second );
+        }
+      const double minP = maxP * m_SparsePDFPruneThreshold;
+      typename SparsePDFType::iterator blurredIt = blurredPDF.begin();
+      while( blurredIt != blurredPDF.end() )
+        {
+        if( blurredIt->second < minP )
+          {
+          blurredIt = blurredPDF.erase( blurredIt );
+          }
+        else
+          {
+          ++blurredIt;
+          }
+        }
+      pdf.swap( blurredPDF );
+      }
+
+    double total = 0;
+    typename SparsePDFType::iterator pdfIt = pdf.begin();
+    for( ; pdfIt != pdf.end(); ++pdfIt )
+      {
+      total += pdfIt->second;
+      }
+    if( total > 0 )
+      {
+      for( pdfIt = pdf.begin(); pdfIt != pdf.end(); ++pdfIt )
+        {
+        pdfIt->second = static_cast< PDFPixelType >( pdfIt->second / total );
+        }
+      }
+    }
+}
+
 template< class TImage, class TLabelMap >
 void
 PDFSegmenterParzen< TImage, TLabelMap >
@@ -546,6 +758,12 @@ PDFSegmenterParzen< TImage, TLabelMap >
 {
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
+  if( m_UseSparsePDFs && numFeatures > PARZEN_MAX_NUMBER_OF_FEATURES )
+    {
+    // Too many features for a dense labeled feature space
+    m_LabeledFeatureSpace = nullptr;
+    return;
+    }
   m_LabeledFeatureSpace = LabeledFeatureSpaceType::New();
   typename LabeledFeatureSpaceType::RegionType region;
   typename LabeledFeatureSpaceType::SpacingType spacing;
@@ -569,17 +787,53 @@ PDFSegmenterParzen< TImage, TLabelMap >
     size[i] = 1;
     }
   region.SetSize( size );
-  m_LabeledFeatureSpace->CopyInformation( m_InClassHistogram[0] );
+  if( !m_UseSparsePDFs )
+    {
+    m_LabeledFeatureSpace->CopyInformation( m_InClassHistogram[0] );
+    }
   m_LabeledFeatureSpace->SetOrigin( origin );
   m_LabeledFeatureSpace->SetRegions( region );
   m_LabeledFeatureSpace->SetSpacing( spacing );
   m_LabeledFeatureSpace->Allocate();
 
+  unsigned int numClasses = this->m_ObjectIdList.size();
+
+  if( m_UseSparsePDFs )
+    {
+    itk::ImageRegionIteratorWithIndex< LabeledFeatureSpaceType > fsIter(
+      m_LabeledFeatureSpace, region );
+    while( !fsIter.IsAtEnd() )
+      {
+      typename LabeledFeatureSpaceType::IndexType indx = fsIter.GetIndex();
+      SparsePDFKeyType key = 0;
+      SparsePDFKeyType stride = 1;
+      for( unsigned int i = 0; i < numFeatures; i++ )
+        {
+        key += indx[i] * stride;
+        stride *= m_HistogramNumberOfBin[i];
+        }
+
+      double maxP = 0;
+      ObjectIdType maxPC = this->m_VoidId;
+      for( unsigned int c = 0; c < numClasses; c++ )
+        {
+        typename SparsePDFType::const_iterator pdfIt =
+          m_InClassSparsePDF[c].find( key );
+        if( pdfIt != m_InClassSparsePDF[c].end() && pdfIt->second > maxP )
+          {
+          maxP = pdfIt->second;
+          maxPC = this->m_ObjectIdList[ c ];
+          }
+        }
+      fsIter.Set( maxPC );
+      ++fsIter;
+      }
+    return;
+    }
+
   itk::ImageRegionIterator< LabeledFeatureSpaceType > fsIter(
     m_LabeledFeatureSpace, region );
 
-  unsigned int numClasses = this->m_ObjectIdList.size();
-
   typedef itk::ImageRegionIterator< HistogramImageType >
     PDFIteratorType;
   std::vector< PDFIteratorType * > pdfIter( numClasses );
@@ -631,6 +885,24 @@ typename PDFSegmenterParzen< TImage, TLabelMap >::ProbabilityVectorType
 PDFSegmenterParzen< TImage, TLabelMap >
 ::GetProbabilityVector( const FeatureVectorType & fv ) const
 {
+  if( m_UseSparsePDFs )
+    {
+    const SparsePDFKeyType key = this->GetSparsePDFKey( fv );
+
+    unsigned int numClasses = this->m_ObjectIdList.size();
+    ProbabilityVectorType prob( numClasses, 0 );
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      typename SparsePDFType::const_iterator pdfIt =
+        m_InClassSparsePDF[c].find( key );
+      if( pdfIt != m_InClassSparsePDF[c].end() )
+        {
+        prob[c] = pdfIt->second;
+        }
+      }
+    return prob;
+    }
+
   unsigned int numFeatures = this->m_FeatureVectorGenerator->
     GetNumberOfFeatures();
   typename HistogramImageType::IndexType binIndex;
@@ -708,6 +980,12 @@ PDFSegmenterParzen< TImage, TLabelMap >
   os << indent << "Outlier reject portion = "
     << m_OutlierRejectPortion << std::endl;
 
+  os << indent << "UseSparsePDFs = " << m_UseSparsePDFs << std::endl;
+  os << indent << "SparsePDFPruneThreshold = "
+    << m_SparsePDFPruneThreshold << std::endl;
+  os << indent << "InClassSparsePDF size = "
+    << m_InClassSparsePDF.size() << std::endl;
+
   if( m_LabeledFeatureSpace.IsNotNull() )
     {
     os << indent << "LabeledFeatureSpace = " << m_LabeledFeatureSpace
@@ -30,10 +30,12 @@ limitations under the License.
 #define __itktubeRadiusExtractor3_h
 
 #include "itktubeBlurImageFunction.h"
+#include "itktubeTubeExtractorProfile.h"
 
 #include <itkTubeSpatialObject.h>
 
 #include <itkMath.h>
+#include <itkMultiThreaderBase.h>
 
 #include <vector>
 
@@ -152,6 +154,9 @@ public:
   double GetRadiusTolerance()
     { return this->GetRadiusToleranceInIndexSpace() * m_Spacing; }
 
+  itkSetMacro( RadiusCorrectionFunction, RadiusCorrectionFunctionType );
+  itkGetMacro( RadiusCorrectionFunction, RadiusCorrectionFunctionType );
+
   /** Set ThreshMedialness */
   itkSetMacro( MinMedialness, double );
   itkGetMacro( MinMedialness, double );
@@ -186,6 +191,13 @@ public:
   itkGetMacro( KernelExtent, double );
   itkSetMacro( KernelExtent, double );
 
+  /** Number of work units used by ExtractRadii.  The kernel optima of
+   *   the windows along a tube are computed concurrently and then
+   *   recorded in the serial order, so the radii do not depend on this
+   *   value.  Default 1; 0 uses the global default. */
+  itkSetMacro( NumberOfWorkUnits, unsigned int );
+  itkGetMacro( NumberOfWorkUnits, unsigned int );
+
   /** Calculate Radii */
   bool ExtractRadii( TubeType * tube, bool verbose=false );
 
@@ -195,6 +207,13 @@ public:
 
   double GetKernelMedialness( double r );
 
+  /** Counts of the kernels generated since the last reset, including
+   *   those generated by the work units of ExtractRadii. */
+  const TubeExtractorProfile & GetProfile( void ) const
+    { return m_Profile; }
+  void ResetProfile( void )
+    { m_Profile.Reset(); }
+
 protected:
 
   RadiusExtractor3( void );
@@ -202,6 +221,11 @@ protected:
 
   void GenerateKernel( void );
 
+  /** Bin the voxel xI, at physical point p, by its normal distance to the
+   *   kernel point with the smallest tangent distance. */
+  void AddVoxelToKernel( const IndexType & xI, const PointType & p,
+    double maxKernelR, double maxKernelDist, unsigned int kernelSize );
+
   void SetKernelTubePoints( const std::vector< TubePointType > & tubePoints );
   std::vector< TubePointType > & GetKernelTubePoints( void )
    { return m_KernelTube->GetPoints(); };
@@ -212,6 +236,11 @@ protected:
   double GetKernelBranchness( double r );
 
   bool UpdateKernelOptimalRadius( void );
+
+  /** Apply the radius correction function to the kernel optimal radius.
+   *   Called by UpdateKernelOptimalRadius, also when the optimum was not
+   *   updated and the previous radius is kept. */
+  void ApplyRadiusCorrectionFunction( void );
   itkGetMacro( KernelOptimalRadius, double );
   itkGetMacro( KernelOptimalRadiusMedialness, double );
   itkGetMacro( KernelOptimalRadiusBranchness, double );
@@ -225,11 +254,31 @@ protected:
   void RecordOptimaAtTubePoints( unsigned int tubePointNum,
     TubeType * tube );
 
+  /** Compute the optimal radius and medialness of each window on its
+   *   own extractor.  A NaN radius marks a window whose optimum was not
+   *   updated by UpdateKernelOptimalRadius. */
+  void ComputeWindowOptimaInParallel( TubeType * tube,
+    const std::vector< int > & windows, unsigned int numberOfWorkUnits,
+    std::vector< double > & windowRadius,
+    std::vector< double > & windowMedialness );
+
 private:
 
   RadiusExtractor3( const Self& );
   void operator=( const Self& );
 
+  struct ExtractRadiiThreadStruct
+    {
+    std::vector< Pointer >     Extractors;
+    TubeType                 * Tube;
+    const std::vector< int > * Windows;
+    std::vector< double >    * WindowRadius;
+    std::vector< double >    * WindowMedialness;
+    };
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    ExtractRadiiThreaderCallback( void * arg );
+
   typename InputImageType::Pointer        m_InputImage;
   double                                  m_Spacing;
   double                                  m_DataMin;
@@ -257,10 +306,20 @@ private:
   std::vector< double >                   m_KernelCount;
   std::vector< double >                   m_KernelValue;
 
+  std::vector< PointType >                m_KernelPointPosition;
+  std::vector< VectorType >               m_KernelPointTangent;
+  std::vector< VectorType >               m_KernelPointNormal1;
+  std::vector< VectorType >               m_KernelPointNormal2;
+  std::vector< unsigned char >            m_KernelVisited;
+
   double                                  m_KernelOptimalRadius;
   double                                  m_KernelOptimalRadiusMedialness;
   double                                  m_KernelOptimalRadiusBranchness;
 
+  unsigned int                            m_NumberOfWorkUnits;
+
+  TubeExtractorProfile                    m_Profile;
+
   void ( * m_StatusCallBack )( const char *, const char *, int );
   bool ( * m_IdleCallBack )( void );
 
@@ -38,10 +38,15 @@ limitations under the License.
 #include "tubeSplineApproximation1D.h"
 
 #include <itkMinimumMaximumImageFilter.h>
+#include <itkMultiThreaderBase.h>
 
 
 #include <vnl/vnl_math.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace itk
 {
 
@@ -86,6 +91,8 @@ RadiusExtractor3<TInputImage>
   m_KernelOptimalRadiusMedialness = 0;
   m_KernelOptimalRadiusBranchness = 0;
 
+  m_NumberOfWorkUnits = 1;
+
   m_IdleCallBack = NULL;
   m_StatusCallBack = NULL;
 }
@@ -227,6 +234,7 @@ void
 RadiusExtractor3<TInputImage>
 ::GenerateKernel( void )
 {
+  m_Profile.Increment( TubeExtractorProfile::RADIUS_KERNELS );
 
   IndexType minXI;
   IndexType maxXI;
@@ -234,37 +242,62 @@ RadiusExtractor3<TInputImage>
   double maxKernelR = this->GetRadiusMaxInIndexSpace();
   double maxKernelDist = this->GetKernelExtent() * maxKernelR;
 
-  typename std::vector< TubePointType >::iterator pntIter;
-  pntIter = m_KernelTube->GetPoints().begin();
-  IndexType kernelPointI;
-  m_InputImage->TransformPhysicalPointToIndex( 
-    m_KernelTube->GetPoints()[0].GetPositionInObjectSpace(), kernelPointI );
-  for( unsigned int i = 0; i < ImageDimension; ++i )
-    {
-    minXI[i] = static_cast< int >( kernelPointI[i] - (maxKernelDist + 0.5) );
-    maxXI[i] = static_cast< int >( kernelPointI[i] + (maxKernelDist + 0.5) );
-    }
-  ++pntIter;
+  // Cache the kernel frame.  The voxel search below relies on it being
+  //   orthonormal, so that is checked as well.
+  unsigned int numPoints = m_KernelTube->GetPoints().size();
+  m_KernelPointPosition.resize( numPoints );
+  m_KernelPointTangent.resize( numPoints );
+  m_KernelPointNormal1.resize( numPoints );
+  m_KernelPointNormal2.resize( numPoints );
+  std::vector< IndexType > kernelPointI( numPoints );
+  bool frameIsOrthonormal = true;
   int tempI;
-  while( pntIter != m_KernelTube->GetPoints().end() )
+  for( unsigned int k = 0; k < numPoints; ++k )
     {
-    IndexType kernelPoint;
-    m_InputImage->TransformPhysicalPointToIndex(
-      pntIter->GetPositionInObjectSpace(), kernelPoint );
+    const TubePointType & pnt = m_KernelTube->GetPoints()[k];
+    m_KernelPointPosition[k] = pnt.GetPositionInObjectSpace();
     for( unsigned int i = 0; i < ImageDimension; ++i )
       {
-      tempI = static_cast< int >( kernelPoint[i] - (maxKernelDist + 0.5) );
-      if( tempI < minXI[i] )
+      m_KernelPointTangent[k][i] = pnt.GetTangentInObjectSpace()[i];
+      m_KernelPointNormal1[k][i] = pnt.GetNormal1InObjectSpace()[i];
+      m_KernelPointNormal2[k][i] = 0;
+      if( ImageDimension == 3 )
+        {
+        m_KernelPointNormal2[k][i] = pnt.GetNormal2InObjectSpace()[i];
+        }
+      }
+    const VectorType & t = m_KernelPointTangent[k];
+    const VectorType & n1 = m_KernelPointNormal1[k];
+    const VectorType & n2 = m_KernelPointNormal2[k];
+    if( std::fabs( t.GetNorm() - 1 ) > 0.01
+      || std::fabs( n1.GetNorm() - 1 ) > 0.01
+      || std::fabs( t * n1 ) > 0.01 )
+      {
+      frameIsOrthonormal = false;
+      }
+    if( ImageDimension == 3 && ( std::fabs( n2.GetNorm() - 1 ) > 0.01
+      || std::fabs( t * n2 ) > 0.01 || std::fabs( n1 * n2 ) > 0.01 ) )
+      {
+      frameIsOrthonormal = false;
+      }
+
+    m_InputImage->TransformPhysicalPointToIndex( m_KernelPointPosition[k],
+      kernelPointI[k] );
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      tempI = static_cast< int >( kernelPointI[k][i]
+        - (maxKernelDist + 0.5) );
+      if( k == 0 || tempI < minXI[i] )
         {
         minXI[i] = tempI;
         }
-      tempI = static_cast< int >( kernelPoint[i] + (maxKernelDist + 0.5) );
-      if( tempI > maxXI[i] )
+      tempI = static_cast< int >( kernelPointI[k][i]
+        + (maxKernelDist + 0.5) );
+      if( k == 0 || tempI > maxXI[i] )
         {
         maxXI[i] = tempI;
         }
       }
-    ++pntIter;
     }
   unsigned int kernelSize = static_cast<unsigned int>( maxKernelDist*3 );
   m_KernelValue.resize( kernelSize );
@@ -272,91 +305,109 @@ RadiusExtractor3<TInputImage>
   m_KernelCount.resize( kernelSize );
   std::fill( m_KernelCount.begin(), m_KernelCount.end(), 0 );
 
-  IndexType xI = minXI;
-  bool done = false;
-  while( !done )
+  PointType p;
+  if( !frameIsOrthonormal )
     {
-    if( m_InputImage->GetLargestPossibleRegion().IsInside( xI ) )
+    // A degenerate frame can pair a voxel with a kernel point that is
+    //   far away, so every voxel of the bounding box is visited.
+    IndexType xI = minXI;
+    bool done = false;
+    while( !done )
       {
-      double val = ( m_InputImage->GetPixel( xI ) - m_DataMin )
-        / ( m_DataMax - m_DataMin );
-      if( val < 0 )
+      m_InputImage->TransformIndexToPhysicalPoint( xI, p );
+      this->AddVoxelToKernel( xI, p, maxKernelR, maxKernelDist,
+        kernelSize );
+      unsigned int d = 0;
+      while( d < ImageDimension && ++xI[d] > maxXI[d] )
         {
-        val = 0;
+        xI[d] = minXI[d];
+        ++d;
         }
-      else if( val > 1 )
+      if( d >= ImageDimension )
         {
-        val = 1;
+        done = true;
         }
-      PointType p;
-      m_InputImage->TransformIndexToPhysicalPoint( xI, p );
+      }
+    }
+  else
+    {
+    // A voxel is binned only if its tangent distance is below maxKernelR
+    //   and its normal distance is below maxKernelDist for its nearest
+    //   kernel point.  For an orthonormal frame those two distances add
+    //   up, in quadrature, to the distance to the kernel point, so only
+    //   the balls around the kernel points are visited instead of their
+    //   whole bounding box.  A voxel inside several balls is visited from
+    //   the first one, as recorded in a bitmap over the bounding box.
+    double ballR = ( std::sqrt( maxKernelR * maxKernelR
+      + maxKernelDist * maxKernelDist ) + 1 ) * m_Spacing;
+    double ballRSquared = ballR * ballR;
+    double minSpacing = m_InputImage->GetSpacing()[0];
+    for( unsigned int i = 1; i < ImageDimension; ++i )
+      {
+      minSpacing = std::min( minSpacing,
+        static_cast< double >( m_InputImage->GetSpacing()[i] ) );
+      }
+    int ballHalfWidth = static_cast< int >( std::ceil( ballR
+      / minSpacing ) );
 
-      unsigned int pntCount = 0;
-      pntIter = m_KernelTube->GetPoints().begin();
+    // Voxels already binned, over the bounding box of the balls
+    SizeValueType visitedStride[ImageDimension];
+    SizeValueType visitedSize = 1;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      visitedStride[i] = visitedSize;
+      visitedSize *= maxXI[i] - minXI[i] + 1;
+      }
+    m_KernelVisited.assign( visitedSize, 0 );
 
-      double pntTangentDistI = 0;
-      double minTangentDistI = maxKernelR;
-      double minNormalDist = -1;
-      while( pntIter != m_KernelTube->GetPoints().end() )
+    for( unsigned int k = 0; k < numPoints; ++k )
+      {
+      IndexType ballMinXI;
+      IndexType ballMaxXI;
+      bool empty = false;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        ballMinXI[i] = std::max( minXI[i], kernelPointI[k][i]
+          - ballHalfWidth );
+        ballMaxXI[i] = std::min( maxXI[i], kernelPointI[k][i]
+          + ballHalfWidth );
+        if( ballMinXI[i] > ballMaxXI[i] )
+          {
+          empty = true;
+          }
+        }
+      IndexType xI = ballMinXI;
+      bool done = empty;
+      while( !done )
         {
-        VectorType pDiff = p - pntIter->GetPositionInObjectSpace();
-        double d1 = 0;
+        SizeValueType visitedOffset = 0;
         for( unsigned int i = 0; i < ImageDimension; ++i )
           {
-          double tf = pDiff[i] * pntIter->GetTangentInObjectSpace()[i];
-          d1 += tf * tf;
+          visitedOffset += ( xI[i] - minXI[i] ) * visitedStride[i];
           }
-        pntTangentDistI = std::sqrt( d1 ) / m_Spacing;
-        if( pntTangentDistI < minTangentDistI )
+        if( !m_KernelVisited[visitedOffset] )
           {
-          minTangentDistI = pntTangentDistI;
-          d1 = 0;
-          for( unsigned int i = 0; i < ImageDimension; ++i )
+          m_InputImage->TransformIndexToPhysicalPoint( xI, p );
+          if( p.SquaredEuclideanDistanceTo( m_KernelPointPosition[k] )
+            <= ballRSquared )
             {
-            double tf = pDiff[i] * pntIter->GetNormal1InObjectSpace()[i];
-            d1 += tf * tf;
-            }
-          minNormalDist = d1;
-          if( ImageDimension == 3 )
-            {
-            double d2 = 0;
-            for( unsigned int i = 0; i < ImageDimension; ++i )
-              {
-              double tf = pDiff[i] * pntIter->GetNormal2InObjectSpace()[i];
-              d2 += tf * tf;
-              }
-            minNormalDist += d2;
+            m_KernelVisited[visitedOffset] = 1;
+            this->AddVoxelToKernel( xI, p, maxKernelR, maxKernelDist,
+              kernelSize );
             }
           }
-        ++pntIter;
-        ++pntCount;
-        }
-      if( minNormalDist != -1 )
-        {
-        double distI = std::sqrt( minNormalDist ) / m_Spacing;
-        double count = (distI / maxKernelDist) * kernelSize;
-        // std::cout << distI << " : " << count << " : " << val << std::endl;
-        if( count < 0 )
+        unsigned int d = 0;
+        while( d < ImageDimension && ++xI[d] > ballMaxXI[d] )
           {
-          count = 0;
+          xI[d] = ballMinXI[d];
+          ++d;
           }
-        if( count < kernelSize )
+        if( d >= ImageDimension )
           {
-          m_KernelValue[ count ] += val;
-          m_KernelCount[ count ]++;
+          done = true;
           }
         }
       }
-    unsigned int d = 0;
-    while( d < ImageDimension && ++xI[d] > maxXI[d] )
-      {
-      xI[d] = minXI[d];
-      ++d;
-      }
-    if( d >= ImageDimension )
-      {
-      done = true;
-      }
     }
   for(unsigned int i=0; i<kernelSize; ++i )
     {
@@ -369,6 +420,79 @@ RadiusExtractor3<TInputImage>
   //std::cout << std::endl;
 }
 
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::AddVoxelToKernel( const IndexType & xI, const PointType & p,
+  double maxKernelR, double maxKernelDist, unsigned int kernelSize )
+{
+  if( !m_InputImage->GetLargestPossibleRegion().IsInside( xI ) )
+    {
+    return;
+    }
+
+  double val = ( m_InputImage->GetPixel( xI ) - m_DataMin )
+    / ( m_DataMax - m_DataMin );
+  if( val < 0 )
+    {
+    val = 0;
+    }
+  else if( val > 1 )
+    {
+    val = 1;
+    }
+
+  double pntTangentDistI = 0;
+  double minTangentDistI = maxKernelR;
+  double minNormalDist = -1;
+  for( unsigned int k = 0; k < m_KernelPointPosition.size(); ++k )
+    {
+    VectorType pDiff = p - m_KernelPointPosition[k];
+    double d1 = 0;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      double tf = pDiff[i] * m_KernelPointTangent[k][i];
+      d1 += tf * tf;
+      }
+    pntTangentDistI = std::sqrt( d1 ) / m_Spacing;
+    if( pntTangentDistI < minTangentDistI )
+      {
+      minTangentDistI = pntTangentDistI;
+      d1 = 0;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        double tf = pDiff[i] * m_KernelPointNormal1[k][i];
+        d1 += tf * tf;
+        }
+      minNormalDist = d1;
+      if( ImageDimension == 3 )
+        {
+        double d2 = 0;
+        for( unsigned int i = 0; i < ImageDimension; ++i )
+          {
+          double tf = pDiff[i] * m_KernelPointNormal2[k][i];
+          d2 += tf * tf;
+          }
+        minNormalDist += d2;
+        }
+      }
+    }
+  if( minNormalDist != -1 )
+    {
+    double distI = std::sqrt( minNormalDist ) / m_Spacing;
+    double count = (distI / maxKernelDist) * kernelSize;
+    if( count < 0 )
+      {
+      count = 0;
+      }
+    if( count < kernelSize )
+      {
+      m_KernelValue[ count ] += val;
+      m_KernelCount[ count ]++;
+      }
+    }
+}
+
 template< class TInputImage >
 void
 RadiusExtractor3<TInputImage>
@@ -531,6 +655,18 @@ RadiusExtractor3<TInputImage>
     }
   //std::cout << "   " << thresh << " : " << m_KernelOptimalRadius << std::endl;
 
+  this->ApplyRadiusCorrectionFunction();
+
+  m_KernelOptimalRadiusMedialness = thresh;
+
+  return true;
+}
+
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::ApplyRadiusCorrectionFunction( void )
+{
   switch( m_RadiusCorrectionFunction )
     {
     default:
@@ -555,10 +691,6 @@ RadiusExtractor3<TInputImage>
       break;
       }
     };
-
-  m_KernelOptimalRadiusMedialness = thresh;
-
-  return true;
 }
 
 template< class TInputImage >
@@ -611,33 +743,74 @@ RadiusExtractor3<TInputImage>
       std::to_string( ( *pntIter ).GetId() ) );
     }
 
-  double rStart0 = this->GetRadiusStart();
-  double rStart = rStart0;
+  // Kernel windows, in the order in which they are recorded
+  std::vector< int > windows;
   for( int p = static_cast< int >( pntCount );
     p < static_cast< int >( tube->GetPoints().size() );
     p += this->GetKernelStep() )
     {
-    this->SetRadiusStart( rStart );
-    this->GenerateKernelTubePoints( p, tube );
-    this->GenerateKernel();
-    this->UpdateKernelOptimalRadius();
-    this->RecordOptimaAtTubePoints( p, tube );
-    rStart = this->GetKernelOptimalRadius() * m_Spacing;
-    if( verbose )
-      {
-      std::cout << p << " : r = " << rStart << std::endl;
-      }
+    windows.push_back( p );
     }
-
-  rStart = rStart0;
+  size_t numForwardWindows = windows.size();
   for( int p = static_cast< int >( pntCount )
     - this->GetKernelPointStep(); p >= 0;
     p -= this->GetKernelStep() )
     {
+    windows.push_back( p );
+    }
+
+  unsigned int numberOfWorkUnits = m_NumberOfWorkUnits;
+  if( numberOfWorkUnits == 0 )
+    {
+    numberOfWorkUnits =
+      MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  if( numberOfWorkUnits > windows.size() )
+    {
+    numberOfWorkUnits = windows.size();
+    }
+
+  // The optimum of a window does not depend on the other windows, only
+  //   the recording does, so the optima can be computed concurrently.
+  std::vector< double > windowRadius;
+  std::vector< double > windowMedialness;
+  if( numberOfWorkUnits > 1 )
+    {
+    this->ComputeWindowOptimaInParallel( tube, windows, numberOfWorkUnits,
+      windowRadius, windowMedialness );
+    }
+
+  double rStart0 = this->GetRadiusStart();
+  double rStart = rStart0;
+  for( size_t w = 0; w < windows.size(); ++w )
+    {
+    if( w == numForwardWindows )
+      {
+      rStart = rStart0;
+      }
+    int p = windows[w];
     this->SetRadiusStart( rStart );
-    this->GenerateKernelTubePoints( p, tube );
-    this->GenerateKernel();
-    this->UpdateKernelOptimalRadius();
+    if( numberOfWorkUnits > 1 )
+      {
+      // NaN marks a window whose optimum was not updated; as in the
+      //   serial loop, it keeps the previous optimum, to which the radius
+      //   correction function is applied again.
+      if( !std::isnan( windowRadius[w] ) )
+        {
+        m_KernelOptimalRadius = windowRadius[w];
+        }
+      else
+        {
+        this->ApplyRadiusCorrectionFunction();
+        }
+      m_KernelOptimalRadiusMedialness = windowMedialness[w];
+      }
+    else
+      {
+      this->GenerateKernelTubePoints( p, tube );
+      this->GenerateKernel();
+      this->UpdateKernelOptimalRadius();
+      }
     this->RecordOptimaAtTubePoints( p, tube );
     rStart = this->GetKernelOptimalRadius() * m_Spacing;
     if( verbose )
@@ -661,6 +834,91 @@ RadiusExtractor3<TInputImage>
   return true;
 }
 
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::ComputeWindowOptimaInParallel( TubeType * tube,
+  const std::vector< int > & windows, unsigned int numberOfWorkUnits,
+  std::vector< double > & windowRadius,
+  std::vector< double > & windowMedialness )
+{
+  windowRadius.resize( windows.size() );
+  windowMedialness.resize( windows.size() );
+
+  ExtractRadiiThreadStruct str;
+  str.Extractors.resize( numberOfWorkUnits );
+  for( unsigned int w = 0; w < numberOfWorkUnits; ++w )
+    {
+    // Copied directly so that the data range is not recomputed
+    Pointer radiusOp = Self::New();
+    radiusOp->m_InputImage = m_InputImage;
+    radiusOp->m_Spacing = m_Spacing;
+    radiusOp->m_DataMin = m_DataMin;
+    radiusOp->m_DataMax = m_DataMax;
+    radiusOp->m_RadiusStartInIndexSpace = m_RadiusStartInIndexSpace;
+    radiusOp->m_RadiusMinInIndexSpace = m_RadiusMinInIndexSpace;
+    radiusOp->m_RadiusMaxInIndexSpace = m_RadiusMaxInIndexSpace;
+    radiusOp->m_RadiusStepInIndexSpace = m_RadiusStepInIndexSpace;
+    radiusOp->m_RadiusToleranceInIndexSpace = m_RadiusToleranceInIndexSpace;
+    radiusOp->m_RadiusCorrectionScale = m_RadiusCorrectionScale;
+    radiusOp->m_RadiusCorrectionFunction = m_RadiusCorrectionFunction;
+    radiusOp->m_MinMedialness = m_MinMedialness;
+    radiusOp->m_MinMedialnessStart = m_MinMedialnessStart;
+    radiusOp->SetNumKernelPoints( m_NumKernelPoints );
+    radiusOp->m_KernelPointStep = m_KernelPointStep;
+    radiusOp->m_KernelStep = m_KernelStep;
+    radiusOp->m_KernelExtent = m_KernelExtent;
+    str.Extractors[w] = radiusOp;
+    }
+  str.Tube = tube;
+  str.Windows = &windows;
+  str.WindowRadius = &windowRadius;
+  str.WindowMedialness = &windowMedialness;
+
+  typename MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+  threader->SetSingleMethod( this->ExtractRadiiThreaderCallback, &str );
+  threader->SingleMethodExecute();
+
+  for( unsigned int w = 0; w < numberOfWorkUnits; ++w )
+    {
+    m_Profile.Merge( str.Extractors[w]->m_Profile );
+    }
+}
+
+template< class TInputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+RadiusExtractor3<TInputImage>
+::ExtractRadiiThreaderCallback( void * arg )
+{
+  unsigned int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+  unsigned int threadCount = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->NumberOfWorkUnits;
+
+  ExtractRadiiThreadStruct * str = ( ExtractRadiiThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  // Contiguous runs of windows keep each worker on one part of the tube
+  Self * radiusOp = str->Extractors[threadId];
+  const size_t numWindows = str->Windows->size();
+  const size_t windowStart = numWindows * threadId / threadCount;
+  const size_t windowEnd = numWindows * ( threadId + 1 ) / threadCount;
+  for( size_t w = windowStart; w < windowEnd; ++w )
+    {
+    radiusOp->GenerateKernelTubePoints( ( *str->Windows )[w], str->Tube );
+    radiusOp->GenerateKernel();
+    radiusOp->m_KernelOptimalRadius =
+      std::numeric_limits< double >::quiet_NaN();
+    radiusOp->UpdateKernelOptimalRadius();
+    ( *str->WindowRadius )[w] = radiusOp->m_KernelOptimalRadius;
+    ( *str->WindowMedialness )[w] =
+      radiusOp->m_KernelOptimalRadiusMedialness;
+    }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
 template< class TInputImage >
 void
 RadiusExtractor3<TInputImage>
@@ -839,6 +1097,11 @@ RadiusExtractor3<TInputImage>
   os << indent << "KernelOptimalRadiusBranchness = "
     << m_KernelOptimalRadiusBranchness
     << std::endl;
+  os << indent << "NumberOfWorkUnits = " << m_NumberOfWorkUnits
+    << std::endl;
+  os << indent << "RadiusKernels = "
+    << m_Profile.GetCounter( TubeExtractorProfile::RADIUS_KERNELS )
+    << std::endl;
 
   os << indent << "IdleCallBack = " << m_IdleCallBack << std::endl;
   os << indent << "StatusCallBack = " << m_StatusCallBack << std::endl;
@@ -31,6 +31,7 @@ limitations under the License.
 
 #include "itktubeBlurImageFunction.h"
 #include "itktubeRadiusExtractor3.h"
+#include "itktubeTubeExtractorProfile.h"
 #include "tubeBrentOptimizer1D.h"
 #include "tubeSplineApproximation1D.h"
 #include "tubeSplineND.h"
@@ -40,6 +41,7 @@ limitations under the License.
 
 #include <cmath>
 #include <list>
+#include <vector>
 
 namespace itk
 {
@@ -214,6 +216,29 @@ public:
   /** Get Extract Bound Maximum */
   itkGetMacro( ExtractBoundMaxInIndexSpace, IndexType );
 
+  /** Intensities sampled by the data spline are read from copies of the
+   *  input image blurred by a recursive Gaussian, rather than convolved
+   *  at every sample.  Each scale has its own copy, filled one tile at a
+   *  time as tiles are first visited, so the tiles of the user scale
+   *  survive the per-seed scale changes of DynamicScale.  The recursive
+   *  Gaussian is not truncated at ScaleKernelExtent, so measures differ
+   *  slightly from the default path.  Memory grows with the number of
+   *  tiles visited at each cached scale, up to one float image per
+   *  scale; every RidgeExtractor, including each work unit of a
+   *  TubeExtractor, holds its own cache. */
+  void SetUseBlurredImageCache( bool useBlurredImageCache );
+  itkGetMacro( UseBlurredImageCache, bool );
+
+  /** Edge length, in voxels, of the tiles of the blurred image cache.
+   *  0 blurs the whole image on first use. */
+  void SetBlurredImageCacheTileSize( unsigned int tileSize );
+  itkGetMacro( BlurredImageCacheTileSize, unsigned int );
+
+  /** Number of scales kept by the blurred image cache.  The least
+   *  recently used scale is dropped when a new scale is needed. */
+  void SetBlurredImageCacheMaximumNumberOfScales( unsigned int numScales );
+  itkGetMacro( BlurredImageCacheMaximumNumberOfScales, unsigned int );
+
   /** Get the data spline */
   ::tube::SplineND * GetDataSpline( void );
 
@@ -337,6 +362,11 @@ public:
   unsigned int      GetFailureCodeCount( FailureCodeEnum code ) const;
   void              ResetFailureCodeCounts( void );
 
+  /** Counts of blur evaluations, blur cache tiles, spline cell refills,
+   *   ridge steps and mask writes since the last reset. */
+  TubeExtractorProfile GetProfile( void ) const;
+  void                 ResetProfile( void );
+
   /** Set the idle callback */
   void   IdleCallBack( bool ( *idleCallBack )( void ) );
 
@@ -355,6 +385,29 @@ protected:
   bool  TraverseOneWay( PointType & newX, VectorType & newT,
     MatrixType & newN, int dir, bool verbose=false );
 
+  /** Blurred intensity at x from the tile cache */
+  double BlurredIntensityInIndexSpace( const IndexType & x );
+
+  /** Blurred tiles of the input image at one scale */
+  struct BlurredImageCacheScaleType
+    {
+    double                                 Scale;
+    std::vector< std::vector< float > >    Tiles;
+    unsigned long                          LastUse;
+    };
+
+  /** Cache entry of the current scale, created if needed */
+  BlurredImageCacheScaleType & GetBlurredImageCacheScale( size_t numTiles );
+
+  /** Region of the cache tile containing x */
+  typename InputImageType::RegionType GetBlurredImageTileRegion(
+    const IndexType & x ) const;
+
+  /** Blur the cache tile with the given region */
+  void ComputeBlurredImageTile(
+    const typename InputImageType::RegionType & tileRegion,
+    std::vector< float > & tile );
+
 private:
 
   RidgeExtractor( const Self& );
@@ -366,6 +419,15 @@ private:
 
   typename TubeMaskImageType::Pointer                     m_TubeMaskImage;
 
+  typedef Image< float, TInputImage::ImageDimension >     BlurredImageType;
+
+  bool                                               m_UseBlurredImageCache;
+  unsigned int                                  m_BlurredImageCacheTileSize;
+  unsigned int                     m_BlurredImageCacheMaximumNumberOfScales;
+  std::vector< BlurredImageCacheScaleType >          m_BlurredImageCache;
+  size_t                                     m_BlurredImageCacheCurrentScale;
+  unsigned long                                      m_BlurredImageCacheClock;
+
   bool                                               m_DynamicScale;
   double                                             m_DynamicScaleUsed;
   bool                                               m_DynamicStepSize;
@@ -393,6 +455,9 @@ private:
   FailureCodeEnum                                    m_CurrentFailureCode;
   IntVectorType                                      m_FailureCodeCount;
 
+  TubeExtractorProfile                               m_Profile;
+  unsigned long                            m_SplineCellRefillsAtProfileReset;
+
   double                                             m_MinRidgeness;
   double                                             m_MinRidgenessStart;
   double                                             m_MinRoundness;
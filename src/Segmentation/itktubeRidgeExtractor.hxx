@@ -32,7 +32,10 @@ limitations under the License.
 #include "tubeMessage.h"
 #include "tubeMatrixMath.h"
 #include "itktubeRidgeExtractor.h"
+#include "itktubeSmoothingRecursiveGaussianImageFilter.h"
 
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
 #include <itkMinimumMaximumImageFilter.h>
 #include <itkNeighborhoodIterator.h>
@@ -91,6 +94,12 @@ RidgeExtractor<TInputImage>
   m_DataFunc->SetScale( 3 ); // 1.5
   m_DataFunc->SetExtent( 1.5 ); // 3
 
+  m_UseBlurredImageCache = false;
+  m_BlurredImageCacheTileSize = 32;
+  m_BlurredImageCacheMaximumNumberOfScales = 4;
+  m_BlurredImageCacheCurrentScale = 0;
+  m_BlurredImageCacheClock = 0;
+
   m_Spacing = 1;
 
   m_DataMin = 0;
@@ -155,6 +164,8 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.set_size( this->GetNumberOfFailureCodes() );
   m_FailureCodeCount.fill( 0 );
 
+  m_SplineCellRefillsAtProfileReset = 0;
+
   m_Tube = nullptr;
 }
 
@@ -256,6 +267,8 @@ RidgeExtractor<TInputImage>
     m_TubeMaskImage->FillBuffer( 0 );
 
     } // end Image == NULL
+
+  m_BlurredImageCache.clear();
 }
 
 /**
@@ -337,6 +350,53 @@ RidgeExtractor<TInputImage>
   return m_DataFunc->GetExtent();
 }
 
+/**
+ * Use the blurred image cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetUseBlurredImageCache( bool useBlurredImageCache )
+{
+  if( m_UseBlurredImageCache != useBlurredImageCache )
+    {
+    m_UseBlurredImageCache = useBlurredImageCache;
+    m_DataSpline->SetNewData( true );
+    m_BlurredImageCache.clear();
+    }
+}
+
+/**
+ * Set the blurred image cache tile size */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetBlurredImageCacheTileSize( unsigned int tileSize )
+{
+  if( m_BlurredImageCacheTileSize != tileSize )
+    {
+    m_BlurredImageCacheTileSize = tileSize;
+    m_BlurredImageCache.clear();
+    }
+}
+
+/**
+ * Set the number of scales kept by the blurred image cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetBlurredImageCacheMaximumNumberOfScales( unsigned int numScales )
+{
+  if( numScales < 1 )
+    {
+    numScales = 1;
+    }
+  if( m_BlurredImageCacheMaximumNumberOfScales != numScales )
+    {
+    m_BlurredImageCacheMaximumNumberOfScales = numScales;
+    m_BlurredImageCache.clear();
+    }
+}
+
 /**
  * Get the data spline */
 template< class TInputImage >
@@ -405,7 +465,17 @@ double
 RidgeExtractor<TInputImage>
 ::IntensityInIndexSpace( const IndexType & x )
 {
-  double tf = ( m_DataFunc->EvaluateAtIndex( x )-m_DataMin ) / m_DataRange;
+  m_Profile.Increment( TubeExtractorProfile::BLUR_EVALUATIONS );
+
+  double tf;
+  if( m_UseBlurredImageCache )
+    {
+    tf = ( this->BlurredIntensityInIndexSpace( x )-m_DataMin ) / m_DataRange;
+    }
+  else
+    {
+    tf = ( m_DataFunc->EvaluateAtIndex( x )-m_DataMin ) / m_DataRange;
+    }
 
   if( tf<0 )
     {
@@ -419,6 +489,200 @@ RidgeExtractor<TInputImage>
   return tf;
 }
 
+/**
+ * Return the blurred intensity from the tile cache */
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::BlurredIntensityInIndexSpace( const IndexType & x )
+{
+  typedef typename InputImageType::RegionType RegionType;
+
+  const RegionType & region = m_InputImage->GetLargestPossibleRegion();
+
+  IndexType xc = x;
+  size_t tileNum = 0;
+  size_t tileStride = 1;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    const IndexValueType minX = region.GetIndex()[i];
+    const IndexValueType maxX = minX + region.GetSize()[i] - 1;
+    if( xc[i] < minX )
+      {
+      xc[i] = minX;
+      }
+    else if( xc[i] > maxX )
+      {
+      xc[i] = maxX;
+      }
+    if( m_BlurredImageCacheTileSize > 0 )
+      {
+      const size_t numTiles = ( region.GetSize()[i]
+        + m_BlurredImageCacheTileSize - 1 ) / m_BlurredImageCacheTileSize;
+      tileNum += tileStride * ( ( xc[i] - minX )
+        / m_BlurredImageCacheTileSize );
+      tileStride *= numTiles;
+      }
+    }
+
+  BlurredImageCacheScaleType & cacheScale =
+    this->GetBlurredImageCacheScale( tileStride );
+
+  const RegionType tileRegion = this->GetBlurredImageTileRegion( xc );
+  std::vector< float > & tile = cacheScale.Tiles[tileNum];
+  if( tile.empty() )
+    {
+    this->ComputeBlurredImageTile( tileRegion, tile );
+    }
+
+  size_t offset = 0;
+  size_t offsetStride = 1;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    offset += offsetStride * ( xc[i] - tileRegion.GetIndex()[i] );
+    offsetStride *= tileRegion.GetSize()[i];
+    }
+  return tile[offset];
+}
+
+/**
+ * Return the cache entry of the current scale */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::BlurredImageCacheScaleType &
+RidgeExtractor<TInputImage>
+::GetBlurredImageCacheScale( size_t numTiles )
+{
+  const double scale = this->GetScale();
+  ++m_BlurredImageCacheClock;
+
+  if( m_BlurredImageCacheCurrentScale >= m_BlurredImageCache.size()
+    || m_BlurredImageCache[m_BlurredImageCacheCurrentScale].Scale != scale )
+    {
+    size_t found = m_BlurredImageCache.size();
+    for( size_t s=0; s<m_BlurredImageCache.size(); ++s )
+      {
+      if( m_BlurredImageCache[s].Scale == scale )
+        {
+        found = s;
+        break;
+        }
+      }
+    if( found == m_BlurredImageCache.size() )
+      {
+      if( m_BlurredImageCache.size()
+        < m_BlurredImageCacheMaximumNumberOfScales )
+        {
+        m_BlurredImageCache.resize( found + 1 );
+        }
+      else
+        {
+        found = 0;
+        for( size_t s=1; s<m_BlurredImageCache.size(); ++s )
+          {
+          if( m_BlurredImageCache[s].LastUse
+            < m_BlurredImageCache[found].LastUse )
+            {
+            found = s;
+            }
+          }
+        }
+      m_BlurredImageCache[found].Scale = scale;
+      m_BlurredImageCache[found].Tiles.clear();
+      m_BlurredImageCache[found].Tiles.resize( numTiles );
+      }
+    m_BlurredImageCacheCurrentScale = found;
+    }
+
+  BlurredImageCacheScaleType & cacheScale =
+    m_BlurredImageCache[m_BlurredImageCacheCurrentScale];
+  cacheScale.LastUse = m_BlurredImageCacheClock;
+  return cacheScale;
+}
+
+/**
+ * Region of the cache tile that contains x */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::InputImageType::RegionType
+RidgeExtractor<TInputImage>
+::GetBlurredImageTileRegion( const IndexType & x ) const
+{
+  typedef typename InputImageType::RegionType RegionType;
+
+  const RegionType & region = m_InputImage->GetLargestPossibleRegion();
+  if( m_BlurredImageCacheTileSize == 0 )
+    {
+    return region;
+    }
+
+  typename RegionType::IndexType tileMin;
+  typename RegionType::SizeType tileSize;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    const IndexValueType minX = region.GetIndex()[i];
+    const IndexValueType maxX = minX + region.GetSize()[i] - 1;
+    tileMin[i] = minX + ( ( x[i] - minX ) / m_BlurredImageCacheTileSize )
+      * m_BlurredImageCacheTileSize;
+    tileSize[i] = std::min( static_cast< IndexValueType >(
+      m_BlurredImageCacheTileSize ), maxX - tileMin[i] + 1 );
+    }
+  return RegionType( tileMin, tileSize );
+}
+
+/**
+ * Blur one tile of the cache */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ComputeBlurredImageTile(
+  const typename InputImageType::RegionType & tileRegion,
+  std::vector< float > & tile )
+{
+  m_Profile.Increment( TubeExtractorProfile::BLUR_CACHE_TILES );
+
+  typedef typename InputImageType::RegionType RegionType;
+
+  const RegionType & region = m_InputImage->GetLargestPossibleRegion();
+  const double scale = this->GetScale();
+
+  // Pad by four standard deviations so that the recursive filter's
+  //   boundary handling does not reach the tile
+  RegionType paddedRegion = tileRegion;
+  typename RegionType::SizeType pad;
+  for( unsigned int i=0; i<ImageDimension; ++i )
+    {
+    pad[i] = static_cast< SizeValueType >( std::ceil( 4 * scale
+      / m_InputImage->GetSpacing()[i] ) ) + 1;
+    }
+  paddedRegion.PadByRadius( pad );
+  paddedRegion.Crop( region );
+
+  typedef ExtractImageFilter< InputImageType, InputImageType >
+    ExtractFilterType;
+  typename ExtractFilterType::Pointer extractFilter =
+    ExtractFilterType::New();
+  extractFilter->SetInput( m_InputImage );
+  extractFilter->SetExtractionRegion( paddedRegion );
+  extractFilter->SetDirectionCollapseToSubmatrix();
+
+  typedef SmoothingRecursiveGaussianImageFilter< InputImageType,
+    BlurredImageType > BlurFilterType;
+  typename BlurFilterType::Pointer blurFilter = BlurFilterType::New();
+  blurFilter->SetInput( extractFilter->GetOutput() );
+  blurFilter->SetSigma( scale );
+  blurFilter->Update();
+
+  tile.resize( tileRegion.GetNumberOfPixels() );
+  ImageRegionConstIterator< BlurredImageType > itBlur(
+    blurFilter->GetOutput(), tileRegion );
+  typename std::vector< float >::iterator itTile = tile.begin();
+  while( !itBlur.IsAtEnd() )
+    {
+    *itTile = itBlur.Get();
+    ++itBlur;
+    ++itTile;
+    }
+}
+
 /**
  * Ridgeness
  */
@@ -478,9 +742,34 @@ RidgeExtractor<TInputImage>
     std::cout << "  XH = " << m_XH << std::endl;
     }
 
-  ::tube::ComputeRidgeness<double>( m_XH, m_XD, prevTangent,
-    m_XRidgeness, m_XRoundness, m_XCurvature, m_XLevelness, m_XHEVect,
-    m_XHEVal );
+  Matrix< double, ImageDimension, ImageDimension > h;
+  Vector< double, ImageDimension > d;
+  Vector< double, ImageDimension > t;
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    d[i] = m_XD[i];
+    for( unsigned int j=0; j<ImageDimension; j++ )
+      {
+      h( i, j ) = m_XH( i, j );
+      }
+    if( !prevTangent.empty() )
+      {
+      t[i] = prevTangent[i];
+      }
+    }
+  Matrix< double, ImageDimension, ImageDimension > hEVect;
+  Vector< double, ImageDimension > hEVal;
+  ::tube::ComputeRidgeness< double, ImageDimension >( h, d,
+    prevTangent.empty() ? NULL : &t, m_XRidgeness, m_XRoundness,
+    m_XCurvature, m_XLevelness, hEVect, hEVal );
+  for( unsigned int i=0; i<ImageDimension; i++ )
+    {
+    m_XHEVal[i] = hEVal[i];
+    for( unsigned int j=0; j<ImageDimension; j++ )
+      {
+      m_XHEVect( i, j ) = hEVect( i, j );
+      }
+    }
 
   intensity = m_XVal;
   roundness = m_XRoundness;
@@ -622,6 +911,14 @@ RidgeExtractor<TInputImage>
     << m_ExtractBoundMinInIndexSpace << std::endl;
   os << indent << "ExtractBoundMaxInIndexSpace = "
     << m_ExtractBoundMaxInIndexSpace << std::endl;
+  os << indent << "UseBlurredImageCache = " << m_UseBlurredImageCache
+    << std::endl;
+  os << indent << "BlurredImageCacheTileSize = "
+    << m_BlurredImageCacheTileSize << std::endl;
+  os << indent << "BlurredImageCacheMaximumNumberOfScales = "
+    << m_BlurredImageCacheMaximumNumberOfScales << std::endl;
+  os << indent << "RidgeSteps = "
+    << m_Profile.GetCounter( TubeExtractorProfile::RIDGE_STEPS ) << std::endl;
   os << indent << "DataSpline1D = " << m_DataSpline1D << std::endl;
   os << indent << "DataSplineOpt = " << m_DataSplineOpt << std::endl;
   os << indent << "DataSpline = " << m_DataSpline << std::endl;
@@ -765,6 +1062,7 @@ RidgeExtractor<TInputImage>
     {
     m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
       + ( tubePointCount/10000.0 ) ) );
+    m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
     if( dir == 1 )
       {
       if( this->GetDebug() )
@@ -925,6 +1223,7 @@ RidgeExtractor<TInputImage>
       pSearchDir = lSearchDir;
       }
 
+    m_Profile.Increment( TubeExtractorProfile::RIDGE_STEPS );
     double currentStepX = m_StepX * stepFactor;
     if( m_DynamicStepSize )
       {
@@ -1206,6 +1505,7 @@ RidgeExtractor<TInputImage>
       {
       m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
         + ( tubePointCount/10000.0 ) ) );
+      m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
       }
 
     /** Show the satus every 50 points */
@@ -1466,6 +1766,28 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.fill( 0 );
 }
 
+template< class TInputImage >
+TubeExtractorProfile
+RidgeExtractor<TInputImage>
+::GetProfile( void ) const
+{
+  // The spline counts its refills for its whole lifetime
+  TubeExtractorProfile profile = m_Profile;
+  profile.SetCounter( TubeExtractorProfile::SPLINE_CELL_REFILLS,
+    m_DataSpline->GetNumberOfCellRefills()
+      - m_SplineCellRefillsAtProfileReset );
+  return profile;
+}
+
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ResetProfile( void )
+{
+  m_Profile.Reset();
+  m_SplineCellRefillsAtProfileReset = m_DataSpline->GetNumberOfCellRefills();
+}
+
 
 /**
  * Compute the local ridge
@@ -1969,6 +2291,7 @@ RidgeExtractor<TInputImage>
     if( inside )
       {
       drawMask->SetPixel( indx, zero );
+      m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
       r = ((*pnt).GetRadiusInObjectSpace() / m_Spacing);
       rI = (int)(r + 0.5);
       if( rI >= 1 )
@@ -2003,6 +2326,7 @@ RidgeExtractor<TInputImage>
             if( dist <= rr )
               {
               it.SetPixel( i, zero );
+              m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
               }
             }
           }
@@ -2019,6 +2343,7 @@ RidgeExtractor<TInputImage>
             if( dist <= rr )
               {
               it.SetPixel( i, zero, inside );
+              m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
               }
             }
           }
@@ -2094,6 +2419,7 @@ RidgeExtractor<TInputImage>
       {
       drawMask->SetPixel( indx, ( PixelType )( tubeId +
           ( tubePointCount/10000.0 ) ) );
+      m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
       r = (( *pnt ).GetRadiusInObjectSpace() / m_Spacing);
       rI = (int)( r + 0.5);
       if( r >= 1 )
@@ -2130,6 +2456,7 @@ RidgeExtractor<TInputImage>
               {
               it.SetPixel( i, ( PixelType )( tubeId +
                   ( tubePointCount/10000.0 ) ), inside );
+              m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
               }
             }
           }
@@ -2147,6 +2474,7 @@ RidgeExtractor<TInputImage>
               {
               it.SetPixel( i, ( PixelType )( tubeId +
                   ( tubePointCount/10000.0 ) ), inside );
+              m_Profile.Increment( TubeExtractorProfile::MASK_WRITES );
               }
             }
           }
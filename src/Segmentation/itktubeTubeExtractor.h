@@ -31,9 +31,11 @@ limitations under the License.
 
 #include "itktubeRadiusExtractor3.h"
 #include "itktubeRidgeExtractor.h"
+#include "itktubeTubeExtractorProfile.h"
 
 #include "itkGroupSpatialObject.h"
 
+#include <itkMultiThreaderBase.h>
 #include <itkObject.h>
 
 namespace itk
@@ -189,6 +191,12 @@ public:
    * Get the radius extractor */
   RadiusExtractorType * GetRadiusExtractor( void );
 
+  /** Compute ridge measures from a blurred copy of the input image
+   *   instead of convolving at every sample.  See
+   *   RidgeExtractor::SetUseBlurredImageCache. */
+  void SetUseBlurredImageCache( bool useBlurredImageCache );
+  bool GetUseBlurredImageCache( void );
+
   /** Set final ridge scale and radius values to the values specified rather
    *   than optimize. */
   itkSetMacro( OptimizeRadius, bool );
@@ -247,9 +255,28 @@ public:
   void SetSeedsInObjectSpaceList( const PointListType & oList );
   void SetSeedRadiiInObjectSpaceList( const RadiusListType & rList );
 
+  /** Number of seeds from the seed list ( or stride seed mask ) that are
+   *   traced concurrently.  Each work unit owns a ridge and radius
+   *   extractor and a private copy of the tube mask, so memory grows by
+   *   one mask image per work unit.  Traced tubes are merged in seed
+   *   order; a tube that crosses a tube accepted earlier in the same batch
+   *   is re-traced serially, so results do not depend on thread timing.
+   *   Seeds taken from a probability seed mask are always processed
+   *   serially.  0 uses the global default number of threads.  Default
+   *   is 1. */
+  itkSetMacro( NumberOfWorkUnits, unsigned int );
+  itkGetMacro( NumberOfWorkUnits, unsigned int );
+
   /** Process seed list or seed mask */
   void ProcessSeeds( bool verbose = false );
 
+  /** Timers, counters and seed records of the extractions since the
+   *   last reset, including those of the ridge and radius extractors and
+   *   of the work units.  ProcessSeeds resets the profile when it
+   *   starts. */
+  TubeExtractorProfile GetProfile( void ) const;
+  void                 ResetProfile( void );
+
 
   /***********/
   /***********/
@@ -334,6 +361,49 @@ private:
   TubeExtractor( const Self& );
   void operator=( const Self& );
 
+  /** Set the radii of a tube from the seed radius mask */
+  void ApplySeedRadiusMask( TubeType * tube, double defaultR ) const;
+
+  /** Callbacks and bookkeeping for a tube that has been traced and is to
+   *   be added to the mask and tube group */
+  void AcceptTube( TubeType * tube, bool verbose );
+
+  /** True if a centerline point of the tube lies on a claimed voxel */
+  bool TubeCrossesMask( const TubeType * tube,
+    const TubeMaskImageType * mask ) const;
+
+  /** Copy the ridge traversal marks that a work unit left around a tube
+   *   in its private mask into the master mask */
+  void CopyTraversalMarks( const TubeType * tube,
+    const TubeMaskImageType * workerMask );
+
+  /** Trace the seed list in batches of NumberOfWorkUnits seeds.  Failure
+   *   codes counted by the workers for the traces that are kept are added
+   *   to failureCodeCounts; re-traced seeds are counted by the ridge
+   *   extractor. */
+  bool ProcessSeedListInParallel( unsigned int numberOfWorkUnits,
+    bool verbose, std::vector< unsigned int > & failureCodeCounts );
+
+  struct TraceSeedsThreadStruct
+    {
+    Self                                                 * Extractor;
+    std::vector< typename RidgeExtractorType::Pointer >  * RidgeOps;
+    std::vector< typename RadiusExtractorType::Pointer > * RadiusOps;
+    std::vector< typename TubeType::Pointer >            * Tubes;
+    std::vector< char >                                  * MaskIsStale;
+    std::vector< char >                                  * TraversalMarked;
+    std::vector< TubeExtractorProfile >                  * Profiles;
+    size_t                                                 BatchStart;
+    size_t                                                 BatchSize;
+    bool                                                   UseRadiiList;
+    };
+
+  void ThreadedTraceSeed( TraceSeedsThreadStruct * str,
+    ThreadIdType threadId );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+    TraceSeedsThreaderCallback( void * arg );
+
   typename TubeGroupType::Pointer     m_TubeGroup;
 
   vnl_vector<double>                  m_TubeColor;
@@ -351,7 +421,9 @@ private:
 
   bool                                     m_OptimizeRadius;
 
+  unsigned int                             m_NumberOfWorkUnits;
 
+  TubeExtractorProfile                     m_Profile;
 
 }; // End class TubeExtractor
 
@@ -33,8 +33,12 @@ limitations under the License.
 
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
-#include <itkMinimumMaximumImageCalculator.h>
+#include <itkImageRegionIterator.h>
 #include <itkImageDuplicator.h>
+#include <itkNeighborhoodIterator.h>
+
+#include <algorithm>
+#include <queue>
 
 namespace itk
 {
@@ -54,6 +58,8 @@ TubeExtractor<TInputImage>
 
   m_OptimizeRadius = true;
 
+  m_NumberOfWorkUnits = 1;
+
   m_IdleCallBack = nullptr;
   m_StatusCallBack = nullptr;
   m_NewTubeCallBack = nullptr;
@@ -348,6 +354,34 @@ TubeExtractor<TInputImage>
   return this->m_RadiusExtractor.GetPointer();
 }
 
+/**
+ * Use a blurred copy of the input image for ridge measures */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::SetUseBlurredImageCache( bool useBlurredImageCache )
+{
+  if( this->m_RidgeExtractor.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  this->m_RidgeExtractor->SetUseBlurredImageCache( useBlurredImageCache );
+}
+
+template< class TInputImage >
+bool
+TubeExtractor<TInputImage>
+::GetUseBlurredImageCache( void )
+{
+  if( this->m_RidgeExtractor.IsNull() )
+    {
+    throw( "Input data must be set first in TubeExtractor" );
+    }
+
+  return this->m_RidgeExtractor->GetUseBlurredImageCache();
+}
+
 /**
  * Extract the tube given the position of the first point
  * and the tube ID */
@@ -404,6 +438,10 @@ TubeExtractor<TInputImage>
       << std::endl;
     }
 
+  TubeExtractorProfile::ScopedTimer extractTimer( m_Profile,
+    TubeExtractorProfile::EXTRACT_TUBE );
+  TubeExtractorProfile::ScopedSeedRecord seedRecord( m_Profile, tubeID );
+
   if( this->m_RidgeExtractor->GetTubeMaskImage()->GetPixel( xi ) != 0 )
     {
     if( verbose || this->GetDebug() )
@@ -419,8 +457,12 @@ TubeExtractor<TInputImage>
     std::cout << "No overlapping tube" << std::endl;
     }
 
-  typename TubeType::Pointer tube = this->m_RidgeExtractor->ExtractRidge( x,
-    tubeID, verbose );
+  typename TubeType::Pointer tube;
+    {
+    TubeExtractorProfile::ScopedTimer ridgeTimer( m_Profile,
+      TubeExtractorProfile::EXTRACT_RIDGE );
+    tube = this->m_RidgeExtractor->ExtractRidge( x, tubeID, verbose );
+    }
 
   if( tube.IsNull() )
     {
@@ -446,6 +488,8 @@ TubeExtractor<TInputImage>
 
   if( m_OptimizeRadius )
     {
+    TubeExtractorProfile::ScopedTimer radiiTimer( m_Profile,
+      TubeExtractorProfile::EXTRACT_RADII );
     if( !this->m_RadiusExtractor->ExtractRadii( tube, verbose ) )
       {
       return nullptr;
@@ -453,35 +497,56 @@ TubeExtractor<TInputImage>
     }
   else
     {
-    if( m_SeedRadiusMask )
+    this->ApplySeedRadiusMask( tube,
+      this->m_RadiusExtractor->GetRadiusStart() );
+    }
+
+  this->AcceptTube( tube, verbose );
+  seedRecord.SetNumberOfPoints( tube->GetPoints().size() );
+
+  tube->Register();
+  return tube;
+}
+
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::ApplySeedRadiusMask( TubeType * tube, double defaultR ) const
+{
+  if( !m_SeedRadiusMask )
+    {
+    return;
+    }
+
+  typename std::vector< TubePointType >::iterator pntIter;
+  pntIter = tube->GetPoints().begin();
+  typename std::vector< TubePointType >::iterator pntIterEnd;
+  pntIterEnd = tube->GetPoints().end();
+  while( pntIter != pntIterEnd )
+    {
+    PointType pnt = pntIter->GetPositionInObjectSpace();
+    IndexType indx;
+    if( m_SeedRadiusMask->TransformPhysicalPointToIndex( pnt, indx ) )
       {
-      double defaultR = this->m_RadiusExtractor->GetRadiusStart();
-      typename std::vector< TubePointType >::iterator pntIter;
-      pntIter = tube->GetPoints().begin();
-      typename std::vector< TubePointType >::iterator pntIterEnd;
-      pntIterEnd = tube->GetPoints().end();
-      while( pntIter != pntIterEnd )
+      double r = m_SeedRadiusMask->GetPixel(indx);
+      if( r != 0 )
         {
-        PointType pnt = pntIter->GetPositionInObjectSpace();
-        IndexType indx;
-        if( m_SeedRadiusMask->TransformPhysicalPointToIndex( pnt, indx ) )
-          {
-          double r = m_SeedRadiusMask->GetPixel(indx);
-          if( r != 0 )
-            {
-            pntIter->SetRadiusInObjectSpace(r);
-            }
-          else
-            {
-            pntIter->SetRadiusInObjectSpace(defaultR);
-            }
-          }
-        ++pntIter;
+        pntIter->SetRadiusInObjectSpace(r);
+        }
+      else
+        {
+        pntIter->SetRadiusInObjectSpace(defaultR);
         }
       }
+    ++pntIter;
     }
+}
 
-
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::AcceptTube( TubeType * tube, bool verbose )
+{
   if( this->m_NewTubeCallBack != NULL )
     {
     this->m_NewTubeCallBack( tube );
@@ -499,9 +564,87 @@ TubeExtractor<TInputImage>
     std::cout << "Adding tube to group." << std::endl;
     }
   this->AddTube( tube );
+  m_Profile.Increment( TubeExtractorProfile::TUBES );
+}
 
-  tube->Register();
-  return tube;
+template< class TInputImage >
+bool
+TubeExtractor<TInputImage>
+::TubeCrossesMask( const TubeType * tube,
+  const TubeMaskImageType * mask ) const
+{
+  typename std::vector< TubePointType >::const_iterator pntIter;
+  for( pntIter = tube->GetPoints().begin();
+    pntIter != tube->GetPoints().end(); ++pntIter )
+    {
+    IndexType indx;
+    if( mask->TransformPhysicalPointToIndex(
+      pntIter->GetPositionInObjectSpace(), indx )
+      && mask->GetPixel( indx ) != 0 )
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::CopyTraversalMarks( const TubeType * tube,
+  const TubeMaskImageType * workerMask )
+{
+  if( tube->GetPoints().empty() )
+    {
+    return;
+    }
+
+  TubeMaskImageType * mask = m_RidgeExtractor->GetTubeMaskImage();
+
+  // Traversal only marks the voxels of the ridge points
+  typename TubeMaskImageType::RegionType region =
+    mask->GetLargestPossibleRegion();
+  IndexType minIndx;
+  IndexType maxIndx;
+  minIndx.Fill( NumericTraits< IndexValueType >::max() );
+  maxIndx.Fill( NumericTraits< IndexValueType >::NonpositiveMin() );
+  typename std::vector< TubePointType >::const_iterator pntIter;
+  for( pntIter = tube->GetPoints().begin();
+    pntIter != tube->GetPoints().end(); ++pntIter )
+    {
+    IndexType indx;
+    mask->TransformPhysicalPointToIndex(
+      pntIter->GetPositionInObjectSpace(), indx );
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      minIndx[i] = std::min( minIndx[i], indx[i] - 1 );
+      maxIndx[i] = std::max( maxIndx[i], indx[i] + 1 );
+      }
+    }
+  typename TubeMaskImageType::RegionType markRegion;
+  markRegion.SetIndex( minIndx );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    markRegion.SetSize( i, std::max( maxIndx[i] - minIndx[i] + 1,
+      IndexValueType( 0 ) ) );
+    }
+  if( !markRegion.Crop( region ) )
+    {
+    return;
+    }
+
+  ImageRegionConstIterator< TubeMaskImageType > workerIt( workerMask,
+    markRegion );
+  ImageRegionIterator< TubeMaskImageType > maskIt( mask, markRegion );
+  while( !maskIt.IsAtEnd() )
+    {
+    if( maskIt.Get() == 0 && workerIt.Get() != 0 )
+      {
+      maskIt.Set( workerIt.Get() );
+      }
+    ++maskIt;
+    ++workerIt;
+    }
 }
 
 template< class TInputImage >
@@ -555,6 +698,9 @@ TubeExtractor<TInputImage>
 ::ProcessSeeds( bool verbose )
 {
   this->GetRidgeExtractor()->ResetFailureCodeCounts();
+  this->ResetProfile();
+  TubeExtractorProfile::ScopedTimer processTimer( m_Profile,
+    TubeExtractorProfile::PROCESS_SEEDS );
   double defaultR = this->GetRadiusInObjectSpace();
 
   if( this->m_SeedMask.IsNotNull() )
@@ -567,8 +713,49 @@ TubeExtractor<TInputImage>
       duplicator->Update();
       typename TubeMaskImageType::Pointer tmpSeedMask = duplicator->GetOutput();
       
-      typedef itk::MinimumMaximumImageCalculator<TubeMaskImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer maxCalc = MinMaxCalcType::New();
+      // Seeds are scheduled from a max-heap built once over the seed mask.
+      //   Entries are (value, buffer offset) and ties are broken by the
+      //   lowest offset so that the order matches a raster-order maximum
+      //   search.  Voxels zeroed by DeleteTube or by the neighborhood
+      //   clearing below are detected lazily when they reach the top of
+      //   the heap and are re-queued with their current value.  This
+      //   assumes that clearing a voxel never raises its priority, which
+      //   holds for non-negative seed probabilities.
+      //
+      // Only positive voxels are queued at first.  Otherwise the default,
+      //   very negative, minimum probability would put every background
+      //   voxel of the mask in the heap.  Voxels with a non-positive value
+      //   are queued only once no positive seed remains, which keeps the
+      //   order of the seeds unchanged.
+      typedef typename TubeMaskImageType::PixelType     SeedPixelType;
+      typedef std::pair< SeedPixelType, OffsetValueType > SeedEntryType;
+      struct SeedEntryCompare
+        {
+        bool operator()( const SeedEntryType & a,
+          const SeedEntryType & b ) const
+          {
+          return ( a.first < b.first )
+            || ( a.first == b.first && a.second > b.second );
+          }
+        };
+      const SeedPixelType * seedBuffer = tmpSeedMask->GetBufferPointer();
+      const OffsetValueType seedBufferSize =
+        tmpSeedMask->GetBufferedRegion().GetNumberOfPixels();
+      bool nonPositiveQueued = ( m_SeedExtractionMinimumProbability > 0 );
+      std::vector< SeedEntryType > seedEntries;
+      for( OffsetValueType offset = 0; offset < seedBufferSize; ++offset )
+        {
+        if( seedBuffer[offset] >= m_SeedExtractionMinimumProbability
+          && seedBuffer[offset] > 0 )
+          {
+          seedEntries.push_back( SeedEntryType( seedBuffer[offset],
+            offset ) );
+          }
+        }
+      std::priority_queue< SeedEntryType, std::vector< SeedEntryType >,
+        SeedEntryCompare > seedQueue( SeedEntryCompare(), seedEntries );
+      seedEntries.clear();
+
       unsigned int count = 0;
       double successRatio = 1;
       double maxValue = m_SeedExtractionMinimumProbability;
@@ -578,10 +765,45 @@ TubeExtractor<TInputImage>
              && maxValue >= m_SeedExtractionMinimumProbability )
         {
         std::cout << "Count = " << count << std::endl;
-        maxCalc->SetImage( tmpSeedMask );
-        maxCalc->ComputeMaximum();
-        maxValue = maxCalc->GetMaximum();
-        typename ImageType::IndexType maxIndx = maxCalc->GetIndexOfMaximum();
+        maxValue = m_SeedExtractionMinimumProbability - 1;
+        typename ImageType::IndexType maxIndx;
+        maxIndx.Fill( 0 );
+        while( true )
+          {
+          while( !seedQueue.empty() )
+            {
+            SeedEntryType top = seedQueue.top();
+            SeedPixelType currentValue = seedBuffer[top.second];
+            if( currentValue == top.first )
+              {
+              maxValue = currentValue;
+              maxIndx = tmpSeedMask->ComputeIndex( top.second );
+              break;
+              }
+            seedQueue.pop();
+            if( currentValue >= m_SeedExtractionMinimumProbability
+              && ( currentValue > 0 || nonPositiveQueued ) )
+              {
+              seedQueue.push( SeedEntryType( currentValue, top.second ) );
+              }
+            }
+          if( maxValue >= m_SeedExtractionMinimumProbability
+            || nonPositiveQueued )
+            {
+            break;
+            }
+          nonPositiveQueued = true;
+          for( OffsetValueType offset = 0; offset < seedBufferSize;
+            ++offset )
+            {
+            if( seedBuffer[offset] >= m_SeedExtractionMinimumProbability
+              && !( seedBuffer[offset] > 0 ) )
+              {
+              seedQueue.push( SeedEntryType( seedBuffer[offset],
+                offset ) );
+              }
+            }
+          }
         if( maxValue >= m_SeedExtractionMinimumProbability )
           {
           if( this->m_SeedRadiusMask )
@@ -666,7 +888,30 @@ TubeExtractor<TInputImage>
       }
     }
 
-  if( m_SeedsInObjectSpaceList.size() > 0 )
+  unsigned int numberOfWorkUnits = m_NumberOfWorkUnits;
+  if( numberOfWorkUnits == 0 )
+    {
+    numberOfWorkUnits =
+      MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  if( numberOfWorkUnits > m_SeedsInObjectSpaceList.size() )
+    {
+    numberOfWorkUnits = m_SeedsInObjectSpaceList.size();
+    }
+
+  std::vector< unsigned int > failureCodeCounts(
+    this->GetRidgeExtractor()->GetNumberOfFailureCodes(), 0 );
+
+  if( numberOfWorkUnits > 1 )
+    {
+    if( !this->ProcessSeedListInParallel( numberOfWorkUnits, verbose,
+      failureCodeCounts ) )
+      {
+      std::cout << "*** No Ridges found! ***" << std::endl;
+      return;
+      }
+    }
+  else if( m_SeedsInObjectSpaceList.size() > 0 )
     {
     typename std::vector< PointType >::iterator seedIter =
       this->m_SeedsInObjectSpaceList.begin();
@@ -729,10 +974,363 @@ TubeExtractor<TInputImage>
         typename RidgeExtractorType::FailureCodeEnum( code ) ) << " : "
       << this->m_RidgeExtractor->GetFailureCodeCount(
         typename RidgeExtractorType::FailureCodeEnum( code ) )
+        + failureCodeCounts[code]
       << std::endl;
     }
 }
 
+template< class TInputImage >
+TubeExtractorProfile
+TubeExtractor<TInputImage>
+::GetProfile( void ) const
+{
+  TubeExtractorProfile profile = m_Profile;
+  profile.Merge( m_RidgeExtractor->GetProfile() );
+  profile.Merge( m_RadiusExtractor->GetProfile() );
+  profile.SortSeedRecords();
+  return profile;
+}
+
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::ResetProfile( void )
+{
+  m_Profile.Reset();
+  m_RidgeExtractor->ResetProfile();
+  m_RadiusExtractor->ResetProfile();
+}
+
+template< class TInputImage >
+bool
+TubeExtractor<TInputImage>
+::ProcessSeedListInParallel( unsigned int numberOfWorkUnits, bool verbose,
+  std::vector< unsigned int > & failureCodeCounts )
+{
+  bool useRadiiList = false;
+  if( m_SeedRadiiInObjectSpaceList.size() == m_SeedsInObjectSpaceList.size() )
+    {
+    useRadiiList = true;
+    }
+
+  // Each work unit traces against its own extractors and its own copy of
+  //   the tube mask.  The copies are refreshed from the master mask at the
+  //   start of a batch, so every seed of a batch sees the mask as it was
+  //   when the batch began.
+  std::vector< typename RidgeExtractorType::Pointer > ridgeOps(
+    numberOfWorkUnits );
+  std::vector< typename RadiusExtractorType::Pointer > radiusOps(
+    numberOfWorkUnits );
+  std::vector< typename TubeType::Pointer > tubes( numberOfWorkUnits );
+  std::vector< char > maskIsStale( numberOfWorkUnits, true );
+  std::vector< char > traversalMarked( numberOfWorkUnits, false );
+  std::vector< TubeExtractorProfile > profiles( numberOfWorkUnits );
+  for( unsigned int w = 0; w < numberOfWorkUnits; ++w )
+    {
+    typename RadiusExtractorType::Pointer radiusOp =
+      RadiusExtractorType::New();
+    radiusOp->SetInputImage( const_cast< ImageType * >(
+      m_RadiusExtractor->GetInputImage() ) );
+    radiusOp->SetDataMin( m_RadiusExtractor->GetDataMin() );
+    radiusOp->SetDataMax( m_RadiusExtractor->GetDataMax() );
+    radiusOp->SetRadiusStartInIndexSpace(
+      m_RadiusExtractor->GetRadiusStartInIndexSpace() );
+    radiusOp->SetRadiusMinInIndexSpace(
+      m_RadiusExtractor->GetRadiusMinInIndexSpace() );
+    radiusOp->SetRadiusMaxInIndexSpace(
+      m_RadiusExtractor->GetRadiusMaxInIndexSpace() );
+    radiusOp->SetRadiusStepInIndexSpace(
+      m_RadiusExtractor->GetRadiusStepInIndexSpace() );
+    radiusOp->SetRadiusToleranceInIndexSpace(
+      m_RadiusExtractor->GetRadiusToleranceInIndexSpace() );
+    radiusOp->SetMinMedialness( m_RadiusExtractor->GetMinMedialness() );
+    radiusOp->SetMinMedialnessStart(
+      m_RadiusExtractor->GetMinMedialnessStart() );
+    radiusOp->SetNumKernelPoints( m_RadiusExtractor->GetNumKernelPoints() );
+    radiusOp->SetKernelPointStep( m_RadiusExtractor->GetKernelPointStep() );
+    radiusOp->SetKernelStep( m_RadiusExtractor->GetKernelStep() );
+    radiusOp->SetKernelExtent( m_RadiusExtractor->GetKernelExtent() );
+    radiusOp->SetRadiusCorrectionFunction(
+      m_RadiusExtractor->GetRadiusCorrectionFunction() );
+
+    typename RidgeExtractorType::Pointer ridgeOp = RidgeExtractorType::New();
+    ridgeOp->SetInputImage( m_RidgeExtractor->GetInputImage() );
+    ridgeOp->SetRadiusExtractor( radiusOp );
+    ridgeOp->SetDataMin( m_RidgeExtractor->GetDataMin() );
+    ridgeOp->SetDataMax( m_RidgeExtractor->GetDataMax() );
+    ridgeOp->SetStepX( m_RidgeExtractor->GetStepX() );
+    ridgeOp->SetMaxTangentChange( m_RidgeExtractor->GetMaxTangentChange() );
+    ridgeOp->SetMaxXChange( m_RidgeExtractor->GetMaxXChange() );
+    ridgeOp->SetMinRidgeness( m_RidgeExtractor->GetMinRidgeness() );
+    ridgeOp->SetMinRidgenessStart(
+      m_RidgeExtractor->GetMinRidgenessStart() );
+    ridgeOp->SetMinRoundness( m_RidgeExtractor->GetMinRoundness() );
+    ridgeOp->SetMinRoundnessStart(
+      m_RidgeExtractor->GetMinRoundnessStart() );
+    ridgeOp->SetMinCurvature( m_RidgeExtractor->GetMinCurvature() );
+    ridgeOp->SetMinCurvatureStart(
+      m_RidgeExtractor->GetMinCurvatureStart() );
+    ridgeOp->SetMinLevelness( m_RidgeExtractor->GetMinLevelness() );
+    ridgeOp->SetMinLevelnessStart(
+      m_RidgeExtractor->GetMinLevelnessStart() );
+    ridgeOp->SetExtractBoundMinInIndexSpace(
+      m_RidgeExtractor->GetExtractBoundMinInIndexSpace() );
+    ridgeOp->SetExtractBoundMaxInIndexSpace(
+      m_RidgeExtractor->GetExtractBoundMaxInIndexSpace() );
+    ridgeOp->SetScale( m_RidgeExtractor->GetScale() );
+    ridgeOp->SetScaleKernelExtent(
+      m_RidgeExtractor->GetScaleKernelExtent() );
+    ridgeOp->SetDynamicScale( m_RidgeExtractor->GetDynamicScale() );
+    ridgeOp->SetDynamicStepSize( m_RidgeExtractor->GetDynamicStepSize() );
+    ridgeOp->SetMaxRecoveryAttempts(
+      m_RidgeExtractor->GetMaxRecoveryAttempts() );
+    ridgeOp->SetUseBlurredImageCache(
+      m_RidgeExtractor->GetUseBlurredImageCache() );
+    ridgeOp->SetBlurredImageCacheTileSize(
+      m_RidgeExtractor->GetBlurredImageCacheTileSize() );
+    ridgeOp->SetBlurredImageCacheMaximumNumberOfScales(
+      m_RidgeExtractor->GetBlurredImageCacheMaximumNumberOfScales() );
+
+    typedef itk::ImageDuplicator< TubeMaskImageType > DuplicatorType;
+    typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
+    duplicator->SetInputImage( m_RidgeExtractor->GetTubeMaskImage() );
+    duplicator->Update();
+    ridgeOp->SetTubeMaskImage( duplicator->GetOutput() );
+    maskIsStale[w] = false;
+
+    ridgeOps[w] = ridgeOp;
+    radiusOps[w] = radiusOp;
+    }
+
+  TraceSeedsThreadStruct str;
+  str.Extractor = this;
+  str.RidgeOps = &ridgeOps;
+  str.RadiusOps = &radiusOps;
+  str.Tubes = &tubes;
+  str.MaskIsStale = &maskIsStale;
+  str.TraversalMarked = &traversalMarked;
+  str.Profiles = &profiles;
+  str.UseRadiiList = useRadiiList;
+
+  typename MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+  threader->SetSingleMethod( this->TraceSeedsThreaderCallback, &str );
+
+  const size_t numSeeds = m_SeedsInObjectSpaceList.size();
+  bool foundOneTube = false;
+  for( size_t batchStart = 0; batchStart < numSeeds;
+    batchStart += numberOfWorkUnits )
+    {
+    if( this->m_AbortProcess != NULL && this->m_AbortProcess() )
+      {
+      if( this->m_StatusCallBack )
+        {
+        this->m_StatusCallBack( "Extract: Ridge", "Aborted", 0 );
+        }
+      break;
+      }
+
+    str.BatchStart = batchStart;
+    str.BatchSize = std::min( static_cast< size_t >( numberOfWorkUnits ),
+      numSeeds - batchStart );
+    threader->SingleMethodExecute();
+
+    // Merge in seed order.  A worker's result stands for the serial trace
+    //   while no tube has changed the master mask earlier in the batch.
+    //   After that, a seed is traced again against the master mask if it
+    //   now lies on a claimed voxel, if its tube crosses a claimed voxel,
+    //   or if its trace left marks in the mask.  A trace that failed
+    //   without marking the mask is kept as a failure, since ridge
+    //   traversal only stops sooner on a mask with more claims.  The
+    //   failure codes of a worker are counted only when its result is
+    //   kept, and a re-trace is counted by the ridge extractor.
+    bool maskChanged = false;
+    for( size_t s = 0; s < str.BatchSize; ++s )
+      {
+      const size_t seedNum = batchStart + s;
+      unsigned int count = seedNum + 1;
+      PointType x = m_SeedsInObjectSpaceList[seedNum];
+
+      std::cout << "Extracting from index point " << x
+        << " (" << (count/(double)numSeeds)*100 << "%)" << std::endl;
+      if( useRadiiList )
+        {
+        this->SetRadiusInObjectSpace( m_SeedRadiiInObjectSpaceList[seedNum] );
+        std::cout << "   Radius = " << m_SeedRadiiInObjectSpaceList[seedNum]
+          << std::endl;
+        }
+
+      typename TubeType::Pointer xTube = tubes[s];
+      tubes[s] = nullptr;
+      const bool marked = ( traversalMarked[s] != 0 );
+      const TubeMaskImageType * mask = m_RidgeExtractor->GetTubeMaskImage();
+      IndexType xi;
+      if( maskChanged
+        && ( ( mask->TransformPhysicalPointToIndex( x, xi )
+               && mask->GetPixel( xi ) != 0 )
+             || marked
+             || ( xTube.IsNotNull()
+                  && this->TubeCrossesMask( xTube, mask ) ) ) )
+        {
+        xTube = this->ExtractTubeInObjectSpace( x, count, verbose );
+        }
+      else
+        {
+        for( unsigned int code = 0; code < failureCodeCounts.size();
+          ++code )
+          {
+          failureCodeCounts[code] += ridgeOps[s]->GetFailureCodeCount(
+            typename RidgeExtractorType::FailureCodeEnum( code ) );
+          }
+        if( marked )
+          {
+          // The radii could not be estimated, but the serial loop leaves
+          //   the traversal marks of the ridge in the mask
+          this->CopyTraversalMarks( xTube,
+            ridgeOps[s]->GetTubeMaskImage() );
+          xTube = nullptr;
+          maskChanged = true;
+          }
+        else if( xTube.IsNotNull() )
+          {
+          this->AcceptTube( xTube, verbose );
+          }
+        }
+
+      if( xTube.IsNotNull() )
+        {
+        maskChanged = true;
+        foundOneTube = true;
+        std::cout << "   Ridge size = " << xTube->GetNumberOfPoints()
+          << std::endl;
+        }
+      else
+        {
+        std::cout << "   Ridge not found" << std::endl;
+        }
+      }
+
+    if( maskChanged )
+      {
+      std::fill( maskIsStale.begin(), maskIsStale.end(), true );
+      }
+    }
+
+  for( unsigned int w = 0; w < numberOfWorkUnits; ++w )
+    {
+    m_Profile.Merge( profiles[w] );
+    m_Profile.Merge( ridgeOps[w]->GetProfile() );
+    m_Profile.Merge( radiusOps[w]->GetProfile() );
+    }
+
+  return foundOneTube;
+}
+
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::ThreadedTraceSeed( TraceSeedsThreadStruct * str, ThreadIdType threadId )
+{
+  if( threadId >= str->BatchSize )
+    {
+    return;
+    }
+
+  RidgeExtractorType * ridgeOp = ( *str->RidgeOps )[threadId];
+  RadiusExtractorType * radiusOp = ( *str->RadiusOps )[threadId];
+  TubeMaskImageType * mask = ridgeOp->GetTubeMaskImage();
+  TubeExtractorProfile & profile = ( *str->Profiles )[threadId];
+
+  // Failure codes are counted per seed so that the merge can drop the
+  //   counts of a seed that is traced again
+  ridgeOp->ResetFailureCodeCounts();
+  ( *str->TraversalMarked )[threadId] = false;
+
+  // The master mask is not modified while the work units run
+  if( ( *str->MaskIsStale )[threadId] )
+    {
+    const TubeMaskImageType * masterMask =
+      m_RidgeExtractor->GetTubeMaskImage();
+    std::copy( masterMask->GetBufferPointer(),
+      masterMask->GetBufferPointer()
+        + masterMask->GetBufferedRegion().GetNumberOfPixels(),
+      mask->GetBufferPointer() );
+    ( *str->MaskIsStale )[threadId] = false;
+    }
+
+  const size_t seedNum = str->BatchStart + threadId;
+  const PointType & x = m_SeedsInObjectSpaceList[seedNum];
+  if( str->UseRadiiList )
+    {
+    ridgeOp->SetScale( m_SeedRadiiInObjectSpaceList[seedNum] );
+    radiusOp->SetRadiusStart( m_SeedRadiiInObjectSpaceList[seedNum] );
+    }
+
+  IndexType xi;
+  if( !mask->TransformPhysicalPointToIndex( x, xi ) )
+    {
+    return;
+    }
+
+  TubeExtractorProfile::ScopedTimer extractTimer( profile,
+    TubeExtractorProfile::EXTRACT_TUBE );
+  TubeExtractorProfile::ScopedSeedRecord seedRecord( profile, seedNum + 1 );
+
+  if( mask->GetPixel( xi ) != 0 )
+    {
+    return;
+    }
+
+  // Ridge traversal marks the private mask, which must be refreshed
+  //   before this work unit's next seed
+  ( *str->MaskIsStale )[threadId] = true;
+  typename TubeType::Pointer tube;
+    {
+    TubeExtractorProfile::ScopedTimer ridgeTimer( profile,
+      TubeExtractorProfile::EXTRACT_RIDGE );
+    tube = ridgeOp->ExtractRidge( x, seedNum + 1, false );
+    }
+  if( tube.IsNull() )
+    {
+    return;
+    }
+
+  if( m_OptimizeRadius )
+    {
+    TubeExtractorProfile::ScopedTimer radiiTimer( profile,
+      TubeExtractorProfile::EXTRACT_RADII );
+    if( !radiusOp->ExtractRadii( tube, false ) )
+      {
+      ( *str->Tubes )[threadId] = tube;
+      ( *str->TraversalMarked )[threadId] = true;
+      return;
+      }
+    }
+  else
+    {
+    this->ApplySeedRadiusMask( tube, radiusOp->GetRadiusStart() );
+    }
+
+  seedRecord.SetNumberOfPoints( tube->GetPoints().size() );
+  ( *str->Tubes )[threadId] = tube;
+}
+
+template< class TInputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+TubeExtractor<TInputImage>
+::TraceSeedsThreaderCallback( void * arg )
+{
+  int threadId = ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )
+    ->WorkUnitID;
+
+  TraceSeedsThreadStruct * str = ( TraceSeedsThreadStruct * )(
+    ( ( MultiThreaderBase::WorkUnitInfo * )( arg ) )->UserData );
+
+  str->Extractor->ThreadedTraceSeed( str, threadId );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
 /**
  * Get list of extracted tubes */
 template< class TInputImage >
@@ -915,6 +1513,11 @@ void TubeExtractor<TInputImage>
   os << indent << "SeedMask = " << this->m_SeedMask << std::endl;
   os << indent << "SeedRadiusMask = " << this->m_SeedRadiusMask << std::endl;
   os << indent << "SeedMaskStride = " << this->m_SeedMaskStride << std::endl;
+  os << indent << "NumberOfWorkUnits = " << this->m_NumberOfWorkUnits
+    << std::endl;
+  os << indent << "SeedTraces = "
+    << this->m_Profile.GetCounter( TubeExtractorProfile::SEED_TRACES )
+    << std::endl;
 
   os << indent << "TubeColor.r = " << this->m_TubeColor[0] << std::endl;
   os << indent << "TubeColor.g = " << this->m_TubeColor[1] << std::endl;
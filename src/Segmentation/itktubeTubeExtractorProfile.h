@@ -0,0 +1,326 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeTubeExtractorProfile_h
+#define __itktubeTubeExtractorProfile_h
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/**
+ * Timers and counters collected while extracting tubes.
+ *
+ * Timers are hierarchical: the name of a timer is the path of the timers
+ * that enclose it.  Counters count the units of work that dominate the
+ * cost of an extraction.  A record is also kept for every traced seed.
+ * Timers of work units that run concurrently are summed, so in a
+ * parallel extraction a nested timer can exceed the one enclosing it.
+ *
+ * A profile is not locked.  Each extractor owns one, and the work units
+ * of a parallel extraction own their extractors, so a profile is only
+ * ever updated by one thread; the profiles of the work units are merged
+ * serially once they have finished.
+ *
+ * \sa TubeExtractor
+ */
+class TubeExtractorProfile
+{
+public:
+
+  typedef enum { PROCESS_SEEDS, EXTRACT_TUBE, EXTRACT_RIDGE, EXTRACT_RADII,
+    NUMBER_OF_TIMERS }                          TimerEnum;
+
+  typedef enum { SEED_TRACES, TUBES, BLUR_EVALUATIONS, BLUR_CACHE_TILES,
+    SPLINE_CELL_REFILLS, RIDGE_STEPS, RADIUS_KERNELS, MASK_WRITES,
+    NUMBER_OF_COUNTERS }                        CounterEnum;
+
+  typedef unsigned long long                    CounterType;
+
+  /** Time spent tracing one seed.  A seed that is traced again when
+   *   merging a parallel batch has one record per trace. */
+  struct SeedRecordType
+    {
+    unsigned int SeedNumber;
+    double       Seconds;
+    unsigned int NumberOfPoints;
+    };
+
+  typedef std::vector< SeedRecordType >         SeedRecordListType;
+
+  /** Adds the time from construction to destruction to a timer */
+  class ScopedTimer
+    {
+    public:
+      ScopedTimer( TubeExtractorProfile & profile, TimerEnum timer )
+        : m_Profile( profile ), m_Timer( timer ),
+          m_Start( std::chrono::steady_clock::now() )
+        {
+        }
+
+      ~ScopedTimer( void )
+        {
+        m_Profile.AddTime( m_Timer, this->GetSeconds() );
+        }
+
+      double GetSeconds( void ) const
+        {
+        return std::chrono::duration< double >(
+          std::chrono::steady_clock::now() - m_Start ).count();
+        }
+
+    private:
+      ScopedTimer( const ScopedTimer & );
+      void operator=( const ScopedTimer & );
+
+      TubeExtractorProfile                  & m_Profile;
+      TimerEnum                               m_Timer;
+      std::chrono::steady_clock::time_point   m_Start;
+    };
+
+  /** Adds a seed record, and counts a seed trace, on destruction.  The
+   *   number of points is zero unless set, as for a failed trace. */
+  class ScopedSeedRecord
+    {
+    public:
+      ScopedSeedRecord( TubeExtractorProfile & profile,
+        unsigned int seedNumber )
+        : m_Profile( profile ), m_Start( std::chrono::steady_clock::now() )
+        {
+        m_Record.SeedNumber = seedNumber;
+        m_Record.Seconds = 0;
+        m_Record.NumberOfPoints = 0;
+        }
+
+      ~ScopedSeedRecord( void )
+        {
+        m_Record.Seconds = std::chrono::duration< double >(
+          std::chrono::steady_clock::now() - m_Start ).count();
+        m_Profile.AddSeedRecord( m_Record );
+        m_Profile.Increment( SEED_TRACES );
+        }
+
+      void SetNumberOfPoints( unsigned int numberOfPoints )
+        {
+        m_Record.NumberOfPoints = numberOfPoints;
+        }
+
+    private:
+      ScopedSeedRecord( const ScopedSeedRecord & );
+      void operator=( const ScopedSeedRecord & );
+
+      TubeExtractorProfile                  & m_Profile;
+      SeedRecordType                          m_Record;
+      std::chrono::steady_clock::time_point   m_Start;
+    };
+
+  TubeExtractorProfile( void )
+    {
+    this->Reset();
+    }
+
+  void Reset( void )
+    {
+    for( unsigned int i = 0; i < NUMBER_OF_TIMERS; ++i )
+      {
+      m_TimerSeconds[i] = 0;
+      m_TimerCount[i] = 0;
+      }
+    for( unsigned int i = 0; i < NUMBER_OF_COUNTERS; ++i )
+      {
+      m_Counter[i] = 0;
+      }
+    m_SeedRecords.clear();
+    }
+
+  void AddTime( TimerEnum timer, double seconds )
+    {
+    m_TimerSeconds[timer] += seconds;
+    ++m_TimerCount[timer];
+    }
+
+  void Increment( CounterEnum counter, CounterType count = 1 )
+    {
+    m_Counter[counter] += count;
+    }
+
+  void SetCounter( CounterEnum counter, CounterType count )
+    {
+    m_Counter[counter] = count;
+    }
+
+  CounterType GetCounter( CounterEnum counter ) const
+    {
+    return m_Counter[counter];
+    }
+
+  double GetTimerSeconds( TimerEnum timer ) const
+    {
+    return m_TimerSeconds[timer];
+    }
+
+  CounterType GetTimerCount( TimerEnum timer ) const
+    {
+    return m_TimerCount[timer];
+    }
+
+  void AddSeedRecord( const SeedRecordType & record )
+    {
+    m_SeedRecords.push_back( record );
+    }
+
+  const SeedRecordListType & GetSeedRecords( void ) const
+    {
+    return m_SeedRecords;
+    }
+
+  /** Add the timers, counters and seed records of another profile */
+  void Merge( const TubeExtractorProfile & profile )
+    {
+    for( unsigned int i = 0; i < NUMBER_OF_TIMERS; ++i )
+      {
+      m_TimerSeconds[i] += profile.m_TimerSeconds[i];
+      m_TimerCount[i] += profile.m_TimerCount[i];
+      }
+    for( unsigned int i = 0; i < NUMBER_OF_COUNTERS; ++i )
+      {
+      m_Counter[i] += profile.m_Counter[i];
+      }
+    m_SeedRecords.insert( m_SeedRecords.end(),
+      profile.m_SeedRecords.begin(), profile.m_SeedRecords.end() );
+    }
+
+  /** Order the seed records by seed number, keeping the order of the
+   *   traces of a seed */
+  void SortSeedRecords( void )
+    {
+    std::stable_sort( m_SeedRecords.begin(), m_SeedRecords.end(),
+      SeedRecordCompare() );
+    }
+
+  static const char * GetTimerName( TimerEnum timer )
+    {
+    switch( timer )
+      {
+      case PROCESS_SEEDS:
+        return "ProcessSeeds";
+      case EXTRACT_TUBE:
+        return "ProcessSeeds/ExtractTube";
+      case EXTRACT_RIDGE:
+        return "ProcessSeeds/ExtractTube/ExtractRidge";
+      case EXTRACT_RADII:
+        return "ProcessSeeds/ExtractTube/ExtractRadii";
+      default:
+        return "Unknown";
+      }
+    }
+
+  static const char * GetCounterName( CounterEnum counter )
+    {
+    switch( counter )
+      {
+      case SEED_TRACES:
+        return "SeedTraces";
+      case TUBES:
+        return "Tubes";
+      case BLUR_EVALUATIONS:
+        return "BlurEvaluations";
+      case BLUR_CACHE_TILES:
+        return "BlurCacheTiles";
+      case SPLINE_CELL_REFILLS:
+        return "SplineCellRefills";
+      case RIDGE_STEPS:
+        return "RidgeSteps";
+      case RADIUS_KERNELS:
+        return "RadiusKernels";
+      case MASK_WRITES:
+        return "MaskWrites";
+      default:
+        return "Unknown";
+      }
+    }
+
+  /** Write the profile as a JSON object */
+  void WriteJSON( std::ostream & os ) const
+    {
+    os << "{" << std::endl;
+    os << "  \"Timers\": [" << std::endl;
+    for( unsigned int i = 0; i < NUMBER_OF_TIMERS; ++i )
+      {
+      os << "    { \"Name\": \"" << GetTimerName( TimerEnum( i ) )
+        << "\", \"Seconds\": " << m_TimerSeconds[i]
+        << ", \"Calls\": " << m_TimerCount[i] << " }"
+        << ( i + 1 < NUMBER_OF_TIMERS ? "," : "" ) << std::endl;
+      }
+    os << "  ]," << std::endl;
+    os << "  \"Counters\": {" << std::endl;
+    for( unsigned int i = 0; i < NUMBER_OF_COUNTERS; ++i )
+      {
+      os << "    \"" << GetCounterName( CounterEnum( i ) ) << "\": "
+        << m_Counter[i] << ( i + 1 < NUMBER_OF_COUNTERS ? "," : "" )
+        << std::endl;
+      }
+    os << "  }," << std::endl;
+    os << "  \"Seeds\": [" << std::endl;
+    for( size_t i = 0; i < m_SeedRecords.size(); ++i )
+      {
+      const SeedRecordType & record = m_SeedRecords[i];
+      os << "    { \"Seed\": " << record.SeedNumber
+        << ", \"Seconds\": " << record.Seconds
+        << ", \"Points\": " << record.NumberOfPoints << " }"
+        << ( i + 1 < m_SeedRecords.size() ? "," : "" ) << std::endl;
+      }
+    os << "  ]" << std::endl;
+    os << "}" << std::endl;
+    }
+
+private:
+
+  struct SeedRecordCompare
+    {
+    bool operator()( const SeedRecordType & a,
+      const SeedRecordType & b ) const
+      {
+      return a.SeedNumber < b.SeedNumber;
+      }
+    };
+
+  double               m_TimerSeconds[NUMBER_OF_TIMERS];
+  CounterType          m_TimerCount[NUMBER_OF_TIMERS];
+  CounterType          m_Counter[NUMBER_OF_COUNTERS];
+  SeedRecordListType   m_SeedRecords;
+
+}; // End class TubeExtractorProfile
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined( __itktubeTubeExtractorProfile_h )
@@ -0,0 +1,665 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeBlurImageFunction.h"
+#include "itktubeFeatureVectorGenerator.h"
+#include "itktubePDFSegmenterParzen.h"
+#include "itktubeRadiusExtractor3.h"
+#include "itktubeRidgeExtractor.h"
+#include "tubeSegmentTubes.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMath.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+#include <itkMultiThreaderBase.h>
+#include <itkTimeProbe.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+/**
+ *  Times the main stages of the tube segmentation pipeline on a
+ *  synthetic vessel phantom generated in-process, so no data has to be
+ *  downloaded.  Each benchmark is run for a number of repetitions and
+ *  its timings are written to a JSON file:
+ *
+ *    TubeTKBenchmarks <output.json> [volumeSize] [repetitions] [filter]
+ *
+ *  Only the benchmarks whose name contains filter are run.
+ */
+
+enum { Dimension = 3 };
+
+typedef itk::Image< float, Dimension >              ImageType;
+typedef itk::Image< unsigned char, Dimension >      LabelMapType;
+typedef itk::TubeSpatialObject< Dimension >         TubeType;
+typedef TubeType::TubePointType                     TubePointType;
+typedef ImageType::PointType                        PointType;
+
+/** Vessel phantom: an intensity image, a training label map and the true
+ *  centerlines of its tubes. */
+struct PhantomType
+{
+  ImageType::Pointer                 Image;
+  LabelMapType::Pointer              LabelMap;
+  std::vector< TubeType::Pointer >   Tubes;
+};
+
+/** Timings of one benchmark. */
+struct BenchmarkResultType
+{
+  std::string   Name;
+  unsigned int  Repetitions;
+  double        Items;
+  double        MeanSeconds;
+  double        MinimumSeconds;
+  double        MaximumSeconds;
+  double        StandardDeviationSeconds;
+  double        Checksum;
+};
+
+static BenchmarkResultType MakeResult( const std::string & name,
+  const itk::TimeProbe & probe, double items, double checksum )
+{
+  BenchmarkResultType result;
+  result.Name = name;
+  result.Repetitions = probe.GetNumberOfStops();
+  result.Items = items;
+  result.MeanSeconds = probe.GetMean();
+  result.MinimumSeconds = probe.GetMinimum();
+  result.MaximumSeconds = probe.GetMaximum();
+  result.StandardDeviationSeconds = probe.GetStandardDeviation();
+  result.Checksum = checksum;
+
+  std::cout << name << " : " << result.MeanSeconds << " s ( "
+    << result.Repetitions << " repetitions )" << std::endl;
+
+  return result;
+}
+
+/** Squared distance from x to a straight centerline along axis, through
+ *  center. */
+static double LineDistanceSquared( const PointType & x,
+  const PointType & center, unsigned int axis )
+{
+  double dist2 = 0;
+  for( unsigned int i = 0; i < Dimension; ++i )
+    {
+    if( i != axis )
+      {
+      dist2 += ( x[i] - center[i] ) * ( x[i] - center[i] );
+      }
+    }
+  return dist2;
+}
+
+/** Squared distance from x to a ring centerline lying in the z plane. */
+static double RingDistanceSquared( const PointType & x,
+  const PointType & center, double ringRadius )
+{
+  double dx = x[0] - center[0];
+  double dy = x[1] - center[1];
+  double dz = x[2] - center[2];
+  double dr = std::sqrt( dx * dx + dy * dy ) - ringRadius;
+  return dr * dr + dz * dz;
+}
+
+static TubeType::Pointer MakeLineTube( const PointType & center,
+  unsigned int axis, double radius, unsigned int volumeSize, int tubeId )
+{
+  TubeType::Pointer tube = TubeType::New();
+  tube->SetId( tubeId );
+  const int border = static_cast< int >( 2 * radius + 2 );
+  for( int t = border; t < static_cast< int >( volumeSize ) - border; ++t )
+    {
+    PointType pnt = center;
+    pnt[axis] = t;
+    TubePointType tubePoint;
+    tubePoint.SetPositionInObjectSpace( pnt );
+    tubePoint.SetRadiusInObjectSpace( radius );
+    tube->GetPoints().push_back( tubePoint );
+    }
+  tube->Update();
+  return tube;
+}
+
+static TubeType::Pointer MakeRingTube( const PointType & center,
+  double ringRadius, double radius, int tubeId )
+{
+  TubeType::Pointer tube = TubeType::New();
+  tube->SetId( tubeId );
+  const unsigned int numPoints = static_cast< unsigned int >(
+    2 * itk::Math::pi * ringRadius );
+  for( unsigned int t = 0; t < numPoints; ++t )
+    {
+    double theta = 2 * itk::Math::pi * t / numPoints;
+    PointType pnt = center;
+    pnt[0] += ringRadius * std::cos( theta );
+    pnt[1] += ringRadius * std::sin( theta );
+    TubePointType tubePoint;
+    tubePoint.SetPositionInObjectSpace( pnt );
+    tubePoint.SetRadiusInObjectSpace( radius );
+    tube->GetPoints().push_back( tubePoint );
+    }
+  tube->Update();
+  return tube;
+}
+
+/** Two straight tubes and a ring, with Gaussian profiles and a small
+ *  deterministic noise pattern. */
+static PhantomType MakePhantom( unsigned int volumeSize )
+{
+  PhantomType phantom;
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( volumeSize );
+  region.SetSize( size );
+
+  phantom.Image = ImageType::New();
+  phantom.Image->SetRegions( region );
+  phantom.Image->Allocate();
+
+  phantom.LabelMap = LabelMapType::New();
+  phantom.LabelMap->SetRegions( region );
+  phantom.LabelMap->Allocate();
+
+  const double quarter = volumeSize / 4.0;
+
+  PointType lineCenter0;
+  lineCenter0[0] = quarter;
+  lineCenter0[1] = quarter;
+  lineCenter0[2] = 0;
+  const double lineRadius0 = 2;
+
+  PointType lineCenter1;
+  lineCenter1[0] = 0;
+  lineCenter1[1] = 3 * quarter;
+  lineCenter1[2] = 2 * quarter;
+  const double lineRadius1 = 3;
+
+  PointType ringCenter;
+  ringCenter[0] = 2 * quarter;
+  ringCenter[1] = 2 * quarter;
+  ringCenter[2] = quarter;
+  const double ringRadius = quarter;
+  const double ringTubeRadius = 2;
+
+  itk::ImageRegionIteratorWithIndex< ImageType > itImage( phantom.Image,
+    region );
+  itk::ImageRegionIteratorWithIndex< LabelMapType > itLabel(
+    phantom.LabelMap, region );
+  PointType pnt;
+  while( !itImage.IsAtEnd() )
+    {
+    ImageType::IndexType indx = itImage.GetIndex();
+    phantom.Image->TransformIndexToPhysicalPoint( indx, pnt );
+
+    double d0 = LineDistanceSquared( pnt, lineCenter0, 2 )
+      / ( lineRadius0 * lineRadius0 );
+    double d1 = LineDistanceSquared( pnt, lineCenter1, 0 )
+      / ( lineRadius1 * lineRadius1 );
+    double d2 = RingDistanceSquared( pnt, ringCenter, ringRadius )
+      / ( ringTubeRadius * ringTubeRadius );
+    double dMin = std::min( d0, std::min( d1, d2 ) );
+
+    double noise = ( ( indx[0] * 7 + indx[1] * 13 + indx[2] * 29 ) % 17 )
+      / 17.0;
+    itImage.Set( 100 * std::exp( -dMin / 2 ) + 10 * noise );
+
+    unsigned char label = 0;
+    if( dMin < 1 )
+      {
+      label = 255;
+      }
+    else if( dMin > 9 && ( indx[0] + indx[1] + indx[2] ) % 4 == 0 )
+      {
+      label = 127;
+      }
+    itLabel.Set( label );
+
+    ++itImage;
+    ++itLabel;
+    }
+
+  phantom.Tubes.push_back( MakeLineTube( lineCenter0, 2, lineRadius0,
+    volumeSize, 1 ) );
+  phantom.Tubes.push_back( MakeLineTube( lineCenter1, 0, lineRadius1,
+    volumeSize, 2 ) );
+  phantom.Tubes.push_back( MakeRingTube( ringCenter, ringRadius,
+    ringTubeRadius, 3 ) );
+
+  return phantom;
+}
+
+/** Sample positions, in index space, scattered around the centerlines. */
+static std::vector< itk::ContinuousIndex< double, Dimension > >
+MakeSamples( const PhantomType & phantom, unsigned int numberOfSamples )
+{
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer rndGen
+    = itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  rndGen->Initialize( 1 );
+
+  std::vector< itk::ContinuousIndex< double, Dimension > > samples;
+  samples.reserve( numberOfSamples );
+  while( samples.size() < numberOfSamples )
+    {
+    const TubeType * tube = phantom.Tubes[ samples.size()
+      % phantom.Tubes.size() ];
+    const TubeType::TubePointListType & points = tube->GetPoints();
+    const TubePointType & tubePoint = points[ rndGen->GetIntegerVariate(
+      points.size() - 1 ) ];
+    PointType pnt = tubePoint.GetPositionInObjectSpace();
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      pnt[i] += rndGen->GetNormalVariate( 0,
+        tubePoint.GetRadiusInObjectSpace() );
+      }
+    itk::ContinuousIndex< double, Dimension > cIndx;
+    if( phantom.Image->TransformPhysicalPointToContinuousIndex( pnt,
+      cIndx ) )
+      {
+      samples.push_back( cIndx );
+      }
+    }
+  return samples;
+}
+
+static BenchmarkResultType BenchmarkBlurImageFunction(
+  const PhantomType & phantom, unsigned int repetitions )
+{
+  typedef itk::tube::BlurImageFunction< ImageType > BlurFunctionType;
+  BlurFunctionType::Pointer blurFunction = BlurFunctionType::New();
+  blurFunction->SetInputImage( phantom.Image );
+  blurFunction->SetScale( 2 );
+
+  std::vector< itk::ContinuousIndex< double, Dimension > > samples =
+    MakeSamples( phantom, 20000 );
+
+  itk::TimeProbe probe;
+  double checksum = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    checksum = 0;
+    probe.Start();
+    for( unsigned int s = 0; s < samples.size(); ++s )
+      {
+      checksum += blurFunction->EvaluateAtContinuousIndex( samples[s] );
+      }
+    probe.Stop();
+    }
+
+  return MakeResult( "BlurImageFunction", probe, samples.size(), checksum );
+}
+
+static BenchmarkResultType BenchmarkSplineNDValueJet(
+  const PhantomType & phantom, unsigned int repetitions )
+{
+  typedef itk::tube::RidgeExtractor< ImageType > RidgeOpType;
+  RidgeOpType::Pointer ridgeOp = RidgeOpType::New();
+  ridgeOp->SetInputImage( phantom.Image );
+  ridgeOp->SetScale( 2 );
+
+  std::vector< itk::ContinuousIndex< double, Dimension > > samples =
+    MakeSamples( phantom, 5000 );
+
+  ::tube::SplineND::VectorType x( Dimension );
+  ::tube::SplineND::VectorType d( Dimension );
+  ::tube::SplineND::MatrixType h( Dimension, Dimension );
+
+  itk::TimeProbe probe;
+  double checksum = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    checksum = 0;
+    probe.Start();
+    for( unsigned int s = 0; s < samples.size(); ++s )
+      {
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        x[i] = samples[s][i];
+        }
+      checksum += ridgeOp->GetDataSpline()->ValueJet( x, d, h );
+      }
+    probe.Stop();
+    }
+
+  return MakeResult( "SplineND::ValueJet", probe, samples.size(),
+    checksum );
+}
+
+static BenchmarkResultType BenchmarkRidgeExtractorTraverse(
+  const PhantomType & phantom, unsigned int repetitions )
+{
+  typedef itk::tube::RidgeExtractor< ImageType > RidgeOpType;
+
+  itk::TimeProbe probe;
+  double numPoints = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    // The tube mask records extracted tubes, so each repetition needs
+    //   a fresh extractor.
+    RidgeOpType::Pointer ridgeOp = RidgeOpType::New();
+    ridgeOp->SetInputImage( phantom.Image );
+    ridgeOp->SetScale( 2 );
+    ridgeOp->SetDynamicScale( false );
+
+    numPoints = 0;
+    probe.Start();
+    for( unsigned int t = 0; t < phantom.Tubes.size(); ++t )
+      {
+      const TubeType::TubePointListType & points =
+        phantom.Tubes[t]->GetPoints();
+      TubeType::Pointer tube = ridgeOp->ExtractRidge(
+        points[ points.size() / 2 ].GetPositionInObjectSpace(), t + 1 );
+      if( tube.IsNotNull() )
+        {
+        numPoints += tube->GetPoints().size();
+        }
+      }
+    probe.Stop();
+    }
+
+  return MakeResult( "RidgeExtractor::Traverse", probe, numPoints,
+    numPoints );
+}
+
+static BenchmarkResultType BenchmarkRadiusExtractor3ExtractRadii(
+  const PhantomType & phantom, unsigned int repetitions )
+{
+  typedef itk::tube::RadiusExtractor3< ImageType > RadiusOpType;
+  RadiusOpType::Pointer radiusOp = RadiusOpType::New();
+  radiusOp->SetInputImage( phantom.Image );
+  radiusOp->SetRadiusStart( 2 );
+
+  itk::TimeProbe probe;
+  double numPoints = 0;
+  double checksum = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    std::vector< TubeType::Pointer > tubes;
+    for( unsigned int t = 0; t < phantom.Tubes.size(); ++t )
+      {
+      TubeType::Pointer tube = TubeType::New();
+      tube->SetPoints( phantom.Tubes[t]->GetPoints() );
+      tubes.push_back( tube );
+      }
+
+    numPoints = 0;
+    checksum = 0;
+    probe.Start();
+    for( unsigned int t = 0; t < tubes.size(); ++t )
+      {
+      radiusOp->ExtractRadii( tubes[t] );
+      numPoints += tubes[t]->GetPoints().size();
+      }
+    probe.Stop();
+
+    for( unsigned int t = 0; t < tubes.size(); ++t )
+      {
+      for( unsigned int p = 0; p < tubes[t]->GetPoints().size(); ++p )
+        {
+        checksum += tubes[t]->GetPoints()[p].GetRadiusInObjectSpace();
+        }
+      }
+    }
+
+  return MakeResult( "RadiusExtractor3::ExtractRadii", probe, numPoints,
+    checksum );
+}
+
+static void BenchmarkPDFSegmenterParzen( const PhantomType & phantom,
+  unsigned int repetitions, std::vector< BenchmarkResultType > & results )
+{
+  typedef itk::tube::PDFSegmenterParzen< ImageType, LabelMapType >
+    PDFSegmenterType;
+  typedef itk::tube::FeatureVectorGenerator< ImageType >
+    FeatureVectorGeneratorType;
+
+  FeatureVectorGeneratorType::Pointer fvGen =
+    FeatureVectorGeneratorType::New();
+  fvGen->SetInput( phantom.Image );
+
+  itk::TimeProbe trainProbe;
+  itk::TimeProbe classifyProbe;
+  double checksum = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    PDFSegmenterType::Pointer pdfSegmenter = PDFSegmenterType::New();
+    pdfSegmenter->SetFeatureVectorGenerator( fvGen );
+    pdfSegmenter->SetInputLabelMap( phantom.LabelMap );
+    pdfSegmenter->SetObjectId( 255 );
+    pdfSegmenter->AddObjectId( 127 );
+    pdfSegmenter->SetVoidId( 0 );
+    pdfSegmenter->SetErodeDilateRadius( 0 );
+
+    trainProbe.Start();
+    pdfSegmenter->Update();
+    trainProbe.Stop();
+
+    classifyProbe.Start();
+    pdfSegmenter->ClassifyImages();
+    classifyProbe.Stop();
+
+    checksum = 0;
+    itk::ImageRegionConstIterator< LabelMapType > itLabel(
+      pdfSegmenter->GetOutputLabelMap(),
+      pdfSegmenter->GetOutputLabelMap()->GetLargestPossibleRegion() );
+    while( !itLabel.IsAtEnd() )
+      {
+      checksum += ( itLabel.Get() == 255 );
+      ++itLabel;
+      }
+    }
+
+  const double numVoxels =
+    phantom.Image->GetLargestPossibleRegion().GetNumberOfPixels();
+  results.push_back( MakeResult( "PDFSegmenterParzen::Train", trainProbe,
+    numVoxels, checksum ) );
+  results.push_back( MakeResult( "PDFSegmenterParzen::Classify",
+    classifyProbe, numVoxels, checksum ) );
+}
+
+static BenchmarkResultType BenchmarkSegmentTubes(
+  const PhantomType & phantom, unsigned int repetitions )
+{
+  typedef ::tube::SegmentTubes< ImageType > SegmentTubesFilterType;
+
+  SegmentTubesFilterType::PointListType seeds;
+  SegmentTubesFilterType::RadiusListType seedRadii;
+  for( unsigned int t = 0; t < phantom.Tubes.size(); ++t )
+    {
+    const TubeType::TubePointListType & points =
+      phantom.Tubes[t]->GetPoints();
+    for( unsigned int p = points.size() / 4; p < points.size();
+      p += points.size() / 2 )
+      {
+      seeds.push_back( points[p].GetPositionInObjectSpace() );
+      seedRadii.push_back( points[p].GetRadiusInObjectSpace() );
+      }
+    }
+
+  itk::TimeProbe probe;
+  double numTubes = 0;
+  for( unsigned int rep = 0; rep < repetitions; ++rep )
+    {
+    SegmentTubesFilterType::Pointer segmentTubesFilter =
+      SegmentTubesFilterType::New();
+    segmentTubesFilter->SetInput( phantom.Image );
+    segmentTubesFilter->SetRadiusInObjectSpace( 2 );
+    segmentTubesFilter->SetSeedsInObjectSpaceList( seeds );
+    segmentTubesFilter->SetSeedRadiiInObjectSpaceList( seedRadii );
+
+    probe.Start();
+    segmentTubesFilter->ProcessSeeds();
+    probe.Stop();
+
+    numTubes = segmentTubesFilter->GetTubeGroup()->GetNumberOfChildren();
+    }
+
+  return MakeResult( "SegmentTubes", probe, seeds.size(), numTubes );
+}
+
+static bool IsSelected( const std::string & name,
+  const std::string & nameFilter )
+{
+  return name.find( nameFilter ) != std::string::npos;
+}
+
+static void WriteResults( std::ostream & os, unsigned int volumeSize,
+  unsigned int repetitions,
+  const std::vector< BenchmarkResultType > & results )
+{
+  os << std::setprecision( 9 );
+  os << "{" << std::endl;
+  os << "  \"suite\": \"TubeTKBenchmarks\"," << std::endl;
+  os << "  \"volumeSize\": " << volumeSize << "," << std::endl;
+  os << "  \"repetitions\": " << repetitions << "," << std::endl;
+  os << "  \"numberOfThreads\": "
+    << itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() << ","
+    << std::endl;
+  os << "  \"benchmarks\": [" << std::endl;
+  for( unsigned int i = 0; i < results.size(); ++i )
+    {
+    const BenchmarkResultType & result = results[i];
+    double itemsPerSecond = 0;
+    if( result.MeanSeconds > 0 )
+      {
+      itemsPerSecond = result.Items / result.MeanSeconds;
+      }
+    os << "    {" << std::endl;
+    os << "      \"name\": \"" << result.Name << "\"," << std::endl;
+    os << "      \"repetitions\": " << result.Repetitions << "," << std::endl;
+    os << "      \"items\": " << result.Items << "," << std::endl;
+    os << "      \"meanSeconds\": " << result.MeanSeconds << "," << std::endl;
+    os << "      \"minimumSeconds\": " << result.MinimumSeconds << ","
+      << std::endl;
+    os << "      \"maximumSeconds\": " << result.MaximumSeconds << ","
+      << std::endl;
+    os << "      \"standardDeviationSeconds\": "
+      << result.StandardDeviationSeconds << "," << std::endl;
+    os << "      \"itemsPerSecond\": " << itemsPerSecond << "," << std::endl;
+    os << "      \"checksum\": " << result.Checksum << std::endl;
+    os << "    }";
+    if( i + 1 < results.size() )
+      {
+      os << ",";
+      }
+    os << std::endl;
+    }
+  os << "  ]" << std::endl;
+  os << "}" << std::endl;
+}
+
+int main( int argc, char * argv[] )
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Missing Parameters: "
+              << argv[0]
+              << " Output_JSON "
+              << "[Volume_Size] [Repetitions] [Name_Filter]"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned int volumeSize = 96;
+  if( argc > 2 )
+    {
+    volumeSize = std::atoi( argv[2] );
+    }
+  unsigned int repetitions = 3;
+  if( argc > 3 )
+    {
+    repetitions = std::atoi( argv[3] );
+    }
+  std::string nameFilter;
+  if( argc > 4 )
+    {
+    nameFilter = argv[4];
+    }
+  if( volumeSize < 32 || repetitions < 1 )
+    {
+    std::cerr << "Volume size must be at least 32 and repetitions at"
+      << " least 1." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::ofstream resultsFile( argv[1] );
+  if( !resultsFile.is_open() )
+    {
+    std::cerr << "Unable to open: " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  PhantomType phantom = MakePhantom( volumeSize );
+
+  std::vector< BenchmarkResultType > results;
+  try
+    {
+    if( IsSelected( "BlurImageFunction", nameFilter ) )
+      {
+      results.push_back( BenchmarkBlurImageFunction( phantom,
+        repetitions ) );
+      }
+    if( IsSelected( "SplineND::ValueJet", nameFilter ) )
+      {
+      results.push_back( BenchmarkSplineNDValueJet( phantom,
+        repetitions ) );
+      }
+    if( IsSelected( "RidgeExtractor::Traverse", nameFilter ) )
+      {
+      results.push_back( BenchmarkRidgeExtractorTraverse( phantom,
+        repetitions ) );
+      }
+    if( IsSelected( "RadiusExtractor3::ExtractRadii", nameFilter ) )
+      {
+      results.push_back( BenchmarkRadiusExtractor3ExtractRadii( phantom,
+        repetitions ) );
+      }
+    if( IsSelected( "PDFSegmenterParzen", nameFilter ) )
+      {
+      BenchmarkPDFSegmenterParzen( phantom, repetitions, results );
+      }
+    if( IsSelected( "SegmentTubes", nameFilter ) )
+      {
+      results.push_back( BenchmarkSegmentTubes( phantom, repetitions ) );
+      }
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << "Exception caught while running benchmarks." << std::endl;
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  WriteResults( resultsFile, volumeSize, repetitions, results );
+  resultsFile.close();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeCVTImageFilter.h"
+
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <cmath>
+
+/** Exposes the centroid grid search of CVTImageFilter. */
+template< class TImage >
+class CVTClosestCentroidFilter
+  : public itk::tube::CVTImageFilter< TImage >
+{
+public:
+  typedef CVTClosestCentroidFilter                  Self;
+  typedef itk::tube::CVTImageFilter< TImage >       Superclass;
+  typedef itk::SmartPointer< Self >                 Pointer;
+
+  typedef typename Superclass::ContinuousIndexType  ContinuousIndexType;
+  typedef typename Superclass::PointArrayType       PointArrayType;
+
+  itkNewMacro( Self );
+
+  void BuildGrid( const PointArrayType & centroids )
+    {
+    this->BuildCentroidGrid( centroids );
+    }
+
+  unsigned int FindClosest( const ContinuousIndexType & x,
+    const PointArrayType & centroids ) const
+    {
+    return this->FindClosestCentroid( x, centroids );
+    }
+
+protected:
+  CVTClosestCentroidFilter( void ) {}
+};
+
+/** Index of the centroid closest to x; ties go to the lowest index. */
+template< class TPointArray, class TPoint >
+unsigned int BruteForceClosest( const TPoint & x,
+  const TPointArray & centroids, unsigned int dimension )
+{
+  unsigned int nearest = 0;
+  double distMin = 0;
+  for( unsigned int jc = 0; jc < centroids.size(); jc++ )
+    {
+    double dist = 0;
+    for( unsigned int i = 0; i < dimension; i++ )
+      {
+      dist += ( x[i] - centroids[jc][i] ) * ( x[i] - centroids[jc][i] );
+      }
+    if( jc == 0 || dist < distMin )
+      {
+      distMin = dist;
+      nearest = jc;
+      }
+    }
+  return nearest;
+}
+
+template< unsigned int VDimension >
+int Test( void )
+{
+  typedef itk::Image< float, VDimension >             ImageType;
+  typedef CVTClosestCentroidFilter< ImageType >       FilterType;
+  typedef typename FilterType::ContinuousIndexType    PointType;
+  typedef typename FilterType::PointArrayType         PointArrayType;
+
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer rndGen
+    = itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  rndGen->Initialize( 1 );
+
+  typename FilterType::Pointer filter = FilterType::New();
+
+  int returnStatus = EXIT_SUCCESS;
+
+  const unsigned int numberOfCentroidSets = 50;
+  const unsigned int numberOfPoints = 500;
+  for( unsigned int set = 0; set < numberOfCentroidSets; set++ )
+    {
+    // Vary the number of centroids from a single one to a few hundred.
+    //   Every other set uses whole-number coordinates, as the filter's
+    //   samples do, and repeats some centroids, so that equal distances
+    //   occur and the tie-breaking is checked.
+    const unsigned int numberOfCentroids = 1 + ( set * 37 ) % 300;
+    const bool wholeNumbers = ( set % 2 == 1 );
+    const double extent = 10 + set;
+    PointArrayType centroids( numberOfCentroids );
+    for( unsigned int jc = 0; jc < numberOfCentroids; jc++ )
+      {
+      if( wholeNumbers && jc > 0 && jc % 5 == 0 )
+        {
+        centroids[jc] = centroids[rndGen->GetIntegerVariate( jc - 1 )];
+        continue;
+        }
+      for( unsigned int i = 0; i < VDimension; i++ )
+        {
+        double v = rndGen->GetUniformVariate( 0, extent );
+        centroids[jc][i] = wholeNumbers ? std::floor( v ) : v;
+        }
+      }
+    filter->BuildGrid( centroids );
+
+    // Points also fall outside the bounding box of the centroids
+    for( unsigned int js = 0; js < numberOfPoints; js++ )
+      {
+      PointType x;
+      for( unsigned int i = 0; i < VDimension; i++ )
+        {
+        double v = rndGen->GetUniformVariate( -0.25 * extent,
+          1.25 * extent );
+        x[i] = wholeNumbers ? std::floor( v ) : v;
+        }
+      unsigned int gridNearest = filter->FindClosest( x, centroids );
+      unsigned int bruteNearest = BruteForceClosest( x, centroids,
+        VDimension );
+      if( gridNearest != bruteNearest )
+        {
+        std::cout << "FAILURE: dimension " << VDimension << ", set " << set
+          << " : closest centroid to " << x << " is " << bruteNearest
+          << " " << centroids[bruteNearest] << ", grid found "
+          << gridNearest << " " << centroids[gridNearest] << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+    }
+
+  return returnStatus;
+}
+
+int itktubeCVTImageFilterClosestCentroidTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  if( Test<2>() == EXIT_FAILURE ||
+      Test<3>() == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
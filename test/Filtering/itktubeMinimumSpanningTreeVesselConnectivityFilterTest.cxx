@@ -0,0 +1,416 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeMinimumSpanningTreeVesselConnectivityFilter.h"
+#include "tubeTubeMathFilters.h"
+
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+
+enum { Dimension = 3 };
+
+typedef itk::TubeSpatialObject< Dimension >     TubeType;
+typedef itk::GroupSpatialObject< Dimension >    TubeGroupType;
+typedef TubeType::TubePointType                 TubePointType;
+typedef TubeType::TubePointListType             TubePointListType;
+typedef TubeType::PointType                     PositionType;
+typedef PositionType::VectorType                PositionVectorType;
+
+/** Edge of the brute-force tube graph. */
+struct BruteForceEdgeType
+{
+  double weight;
+  int    sourceTube;
+  int    sourcePointId;
+  int    targetTube;
+  int    targetPointId;
+
+  bool operator>( const BruteForceEdgeType & rhs ) const
+    {
+    return weight > rhs.weight;
+    }
+};
+
+typedef std::map< int, BruteForceEdgeType >     BruteForceEdgeListType;
+
+/** Candidate root tube; same ordering as the filter. */
+struct BruteForceRootType
+{
+  int    tubeId;
+  size_t outDegree;
+  double tubeLength;
+
+  bool operator<( const BruteForceRootType & rhs ) const
+    {
+    if( outDegree != rhs.outDegree )
+      {
+      return outDegree < rhs.outDegree;
+      }
+    return tubeLength < rhs.tubeLength;
+    }
+};
+
+static void AddTube( TubeGroupType * group, std::vector< TubeType::Pointer >
+  & tubes, const std::vector< PositionType > & points, double radius )
+{
+  TubeType::Pointer tube = TubeType::New();
+  tube->SetId( static_cast< int >( tubes.size() ) );
+  for( unsigned int p = 0; p < points.size(); ++p )
+    {
+    TubePointType tubePoint;
+    tubePoint.SetPositionInObjectSpace( points[p] );
+    tubePoint.SetRadiusInObjectSpace( radius );
+    tube->GetPoints().push_back( tubePoint );
+    }
+  tube->Update();
+  group->AddChild( tube );
+  tubes.push_back( tube );
+}
+
+static PositionType MakePosition( double x, double y, double z )
+{
+  PositionType pos;
+  pos[0] = x;
+  pos[1] = y;
+  pos[2] = z;
+  return pos;
+}
+
+/** Compare every source point with both ends of every other tube, as the
+ *  filter did before its end points were indexed. */
+static void ComputeBruteForceGraph(
+  const std::vector< TubeType::Pointer > & tubes, double maxDistanceRatio,
+  double maxAngleError, std::vector< BruteForceEdgeListType > & graph )
+{
+  graph.assign( tubes.size(), BruteForceEdgeListType() );
+  for( unsigned int s = 0; s < tubes.size(); ++s )
+    {
+    const TubePointListType & sourcePoints = tubes[s]->GetPoints();
+    for( unsigned int sp = 0; sp < sourcePoints.size(); ++sp )
+      {
+      const PositionType sourcePos
+        = sourcePoints[sp].GetPositionInObjectSpace();
+      const double maxDist = maxDistanceRatio
+        * sourcePoints[sp].GetRadiusInObjectSpace();
+      for( unsigned int t = 0; t < tubes.size(); ++t )
+        {
+        const TubePointListType & targetPoints = tubes[t]->GetPoints();
+        if( t == s || targetPoints.size() <= 1 )
+          {
+          continue;
+          }
+        bool found = false;
+        double bestDist = 0;
+        double bestAngle = 0;
+        int bestPointId = 0;
+        const int endPointIds[] = { 0, ( int ) targetPoints.size() - 1 };
+        for( unsigned int i = 0; i < 2; ++i )
+          {
+          const int pointId = endPointIds[i];
+          const int nextPointId = ( pointId == 0 ) ? 1 : pointId - 1;
+          const PositionType endPos
+            = targetPoints[pointId].GetPositionInObjectSpace();
+          PositionVectorType toEnd = endPos.GetVectorFromOrigin()
+            - sourcePos.GetVectorFromOrigin();
+          const double dist = toEnd.GetNorm();
+          if( dist > maxDist )
+            {
+            continue;
+            }
+          PositionVectorType toNext = targetPoints[nextPointId]
+            .GetPositionInObjectSpace().GetVectorFromOrigin()
+            - endPos.GetVectorFromOrigin();
+          toEnd.Normalize();
+          toNext.Normalize();
+          double angle = std::acos( toEnd * toNext );
+          angle *= 180.0 / itk::Math::pi;
+          if( angle > maxAngleError )
+            {
+            continue;
+            }
+          // The closer end wins, then the smaller angle, then the first end
+          if( !found || dist < bestDist
+            || ( dist == bestDist && angle < bestAngle ) )
+            {
+            found = true;
+            bestDist = dist;
+            bestAngle = angle;
+            bestPointId = pointId;
+            }
+          }
+        if( !found )
+          {
+          continue;
+          }
+        // The first source point with the lowest weight keeps the edge
+        BruteForceEdgeListType::iterator itEdge = graph[s].find( t );
+        if( itEdge == graph[s].end() || bestDist < itEdge->second.weight )
+          {
+          BruteForceEdgeType e;
+          e.weight = bestDist;
+          e.sourceTube = s;
+          e.sourcePointId = sp;
+          e.targetTube = t;
+          e.targetPointId = bestPointId;
+          graph[s][t] = e;
+          }
+        }
+      }
+    }
+}
+
+/** Grow a tree from each root in turn, as the filter does. */
+static void ComputeBruteForceTree(
+  const std::vector< TubeType::Pointer > & tubes,
+  const std::vector< BruteForceEdgeListType > & graph,
+  std::vector< int > & parent, std::vector< int > & parentPoint,
+  std::vector< bool > & reversed )
+{
+  const unsigned int numberOfTubes = tubes.size();
+  parent.assign( numberOfTubes, -1 );
+  parentPoint.assign( numberOfTubes, -1 );
+  reversed.assign( numberOfTubes, false );
+  std::vector< bool > visited( numberOfTubes, false );
+
+  std::priority_queue< BruteForceRootType > roots;
+  for( unsigned int t = 0; t < numberOfTubes; ++t )
+    {
+    BruteForceRootType root;
+    root.tubeId = t;
+    root.outDegree = graph[t].size();
+    TubeType::Pointer tube = tubes[t];
+    ::tube::TubeMathFilters< Dimension > tubeMath;
+    tubeMath.SetInputTube( tube );
+    root.tubeLength = tubeMath.ComputeTubeLength();
+    roots.push( root );
+    }
+
+  while( !roots.empty() )
+    {
+    const int rootId = roots.top().tubeId;
+    roots.pop();
+    if( visited[rootId] )
+      {
+      continue;
+      }
+
+    std::priority_queue< BruteForceEdgeType,
+      std::vector< BruteForceEdgeType >,
+      std::greater< BruteForceEdgeType > > edges;
+    int tubeId = rootId;
+    while( true )
+      {
+      visited[tubeId] = true;
+      for( BruteForceEdgeListType::const_iterator itEdge
+        = graph[tubeId].begin(); itEdge != graph[tubeId].end(); ++itEdge )
+        {
+        if( !visited[itEdge->first] )
+          {
+          edges.push( itEdge->second );
+          }
+        }
+      while( !edges.empty() && visited[edges.top().targetTube] )
+        {
+        edges.pop();
+        }
+      if( edges.empty() )
+        {
+        break;
+        }
+      BruteForceEdgeType e = edges.top();
+      edges.pop();
+      tubeId = e.targetTube;
+      parent[tubeId] = e.sourceTube;
+      parentPoint[tubeId] = e.sourcePointId;
+      if( reversed[e.sourceTube] )
+        {
+        parentPoint[tubeId] = ( int ) tubes[e.sourceTube]
+          ->GetNumberOfPoints() - e.sourcePointId - 1;
+        }
+      reversed[tubeId] = ( e.targetPointId > 0 );
+      }
+    }
+}
+
+int itktubeMinimumSpanningTreeVesselConnectivityFilterTest(
+  int itkNotUsed( argc ), char * itkNotUsed( argv )[] )
+{
+  const double maxDistanceRatio = 2.5;
+  const double maxAngleError = 120.0;
+
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer rndGen
+    = itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  rndGen->Initialize( 1 );
+
+  TubeGroupType::Pointer group = TubeGroupType::New();
+  std::vector< TubeType::Pointer > tubes;
+
+  // Random curved tubes, close enough to form a few trees
+  for( unsigned int t = 0; t < 40; ++t )
+    {
+    std::vector< PositionType > points;
+    PositionType pos;
+    PositionVectorType dir;
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      pos[i] = rndGen->GetUniformVariate( 0, 25 );
+      dir[i] = rndGen->GetNormalVariate( 0, 1 );
+      }
+    const unsigned int numberOfPoints = 4 + rndGen->GetIntegerVariate( 8 );
+    for( unsigned int p = 0; p < numberOfPoints; ++p )
+      {
+      points.push_back( pos );
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        dir[i] += rndGen->GetNormalVariate( 0, 0.3 );
+        }
+      dir.Normalize();
+      pos += dir * rndGen->GetUniformVariate( 0.8, 1.6 );
+      }
+    AddTube( group, tubes, points, rndGen->GetUniformVariate( 0.8, 1.6 ) );
+    }
+
+  // Pairs of tubes, far from the others, whose edges rely on the tie
+  //   rules.  In each pair the first tube is the longer one, so it is the
+  //   root and the parent of the second.
+  std::vector< PositionType > sourcePoints;
+  for( int y = -15; y <= 0; ++y )
+    {
+    sourcePoints.push_back( MakePosition( 1000, y, 0 ) );
+    }
+  AddTube( group, tubes, sourcePoints, 1.5 );
+  // Both ends are 2 away; the last end has the smaller angle and wins
+  std::vector< PositionType > targetPoints;
+  targetPoints.push_back( MakePosition( 998, 0, 0 ) );
+  targetPoints.push_back( MakePosition( 998, 1, 0 ) );
+  targetPoints.push_back( MakePosition( 998, 3, 0 ) );
+  targetPoints.push_back( MakePosition( 1003, 3, 0 ) );
+  targetPoints.push_back( MakePosition( 1003, 0, 0 ) );
+  targetPoints.push_back( MakePosition( 1002, 0, 0 ) );
+  AddTube( group, tubes, targetPoints, 1.5 );
+
+  for( unsigned int p = 0; p < sourcePoints.size(); ++p )
+    {
+    sourcePoints[p][0] = 2000;
+    }
+  AddTube( group, tubes, sourcePoints, 1.5 );
+  // Both ends are 2 away at the same angle; the first end wins
+  targetPoints.clear();
+  targetPoints.push_back( MakePosition( 1998, 0, 0 ) );
+  targetPoints.push_back( MakePosition( 1998, 3, 0 ) );
+  targetPoints.push_back( MakePosition( 2002, 3, 0 ) );
+  targetPoints.push_back( MakePosition( 2002, 0, 0 ) );
+  AddTube( group, tubes, targetPoints, 1.5 );
+
+  // Two source points are equally close to the target; the first one wins
+  sourcePoints.clear();
+  sourcePoints.push_back( MakePosition( 2999, 0, 0 ) );
+  for( int y = 0; y >= -15; --y )
+    {
+    sourcePoints.push_back( MakePosition( 3001, y, 0 ) );
+    }
+  AddTube( group, tubes, sourcePoints, 1.5 );
+  targetPoints.clear();
+  for( int y = 2; y <= 5; ++y )
+    {
+    targetPoints.push_back( MakePosition( 3000, y, 0 ) );
+    }
+  AddTube( group, tubes, targetPoints, 1.5 );
+
+  std::vector< BruteForceEdgeListType > graph;
+  ComputeBruteForceGraph( tubes, maxDistanceRatio, maxAngleError, graph );
+  std::vector< int > parent;
+  std::vector< int > parentPoint;
+  std::vector< bool > reversed;
+  ComputeBruteForceTree( tubes, graph, parent, parentPoint, reversed );
+
+  unsigned int numberOfRoots = 0;
+  for( unsigned int t = 0; t < tubes.size(); ++t )
+    {
+    numberOfRoots += ( parent[t] < 0 ) ? 1 : 0;
+    }
+  std::cout << "Number of tubes = " << tubes.size()
+    << ", number of roots = " << numberOfRoots << std::endl;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  // The edge search is split across work units; the result must not
+  //   depend on their number.
+  const unsigned int numberOfWorkUnits[] = { 1, 4 };
+  for( unsigned int w = 0; w < 2; ++w )
+    {
+    typedef itk::tube::MinimumSpanningTreeVesselConnectivityFilter<
+      Dimension > FilterType;
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( group );
+    filter->SetMaxTubeDistanceToRadiusRatio( maxDistanceRatio );
+    filter->SetMaxContinuityAngleError( maxAngleError );
+    filter->SetNumberOfWorkUnits( numberOfWorkUnits[w] );
+    filter->Update();
+
+    char tubeName[] = "Tube";
+    TubeGroupType::ChildrenListType * outputTubes
+      = filter->GetOutput()->GetChildren(
+      filter->GetOutput()->GetMaximumDepth(), tubeName );
+    if( outputTubes->size() != tubes.size() )
+      {
+      std::cout << "FAILURE: " << numberOfWorkUnits[w] << " work units : "
+        << outputTubes->size() << " output tubes != " << tubes.size()
+        << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+
+    for( TubeGroupType::ChildrenListType::iterator itTube
+      = outputTubes->begin(); itTube != outputTubes->end(); ++itTube )
+      {
+      TubeType * tube = dynamic_cast< TubeType * >( itTube->GetPointer() );
+      const int id = tube->GetId();
+      const bool isRoot = ( parent[id] < 0 );
+      const bool isReversed = ( tube->GetPoints().front()
+        .GetPositionInObjectSpace().EuclideanDistanceTo( tubes[id]
+        ->GetPoints().front().GetPositionInObjectSpace() ) > 0 );
+      if( tube->GetRoot() != isRoot || isReversed != reversed[id]
+        || ( !isRoot && ( tube->GetParentId() != parent[id]
+        || tube->GetParentPoint() != parentPoint[id] ) ) )
+        {
+        std::cout << "FAILURE: " << numberOfWorkUnits[w] << " work units : "
+          << "tube " << id << " : root = " << tube->GetRoot()
+          << ", parent = " << tube->GetParentId()
+          << ", parent point = " << tube->GetParentPoint()
+          << ", reversed = " << isReversed << " != brute force root = "
+          << isRoot << ", parent = " << parent[id]
+          << ", parent point = " << parentPoint[id]
+          << ", reversed = " << reversed[id] << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+
+    delete outputTubes;
+    }
+
+  return returnStatus;
+}
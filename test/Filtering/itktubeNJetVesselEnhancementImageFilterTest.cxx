@@ -0,0 +1,364 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeNJetVesselEnhancementImageFilter.h"
+#include "itktubeNJetImageFunction.h"
+#include "itktubeRecursiveGaussianDerivativeFilter.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkRegionOfInterestImageFilter.h>
+
+#include <algorithm>
+#include <cmath>
+
+/** A bright tube along z and a fainter one along x are enhanced at three
+ *  scales.
+ *
+ *  By default the filter evaluates NJetImageFunction at each voxel, so on
+ *  a crop around the tubes its output must match that evaluation at every
+ *  voxel, boundary included.
+ *
+ *  With recursive Gaussians, the jets converted by GaussianDerivativesToJet
+ *  must match the jets of NJetImageFunction at every sample of the
+ *  interior, to within the difference between the continuous kernel
+ *  normalization and the discrete kernel sums ( up to 4% of the largest
+ *  component at scale 1.5 ).  The ridgeness is not continuous in the jet,
+ *  so the vesselness is only checked on average, and for the number of
+ *  samples that differ by more than 5% of the maximum ( 3% of them with
+ *  exact Gaussians ).  Processing in slabs must match processing the whole
+ *  volume. */
+
+int itktubeNJetVesselEnhancementImageFilterTest( int, char *[] )
+{
+  enum { Dimension = 3 };
+
+  typedef itk::Image< float, Dimension >                      ImageType;
+  typedef itk::tube::NJetVesselEnhancementImageFilter< ImageType >
+    FilterType;
+  typedef itk::tube::NJetImageFunction< ImageType >           NJetType;
+  typedef itk::tube::RecursiveGaussianDerivativeFilter< ImageType,
+    ImageType >                                               DerivativeType;
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size[0] = 40;
+  size[1] = 40;
+  size[2] = 32;
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > itImage( image, region );
+  while( !itImage.IsAtEnd() )
+    {
+    ImageType::IndexType indx = itImage.GetIndex();
+    double dx = indx[0] - 20.0;
+    double dy = indx[1] - 18.0;
+    double dz = indx[2] - 12.0;
+    double dy2 = indx[1] - 26.0;
+    itImage.Set( 100 * std::exp( -( dx * dx + dy * dy ) / 8 )
+      + 50 * std::exp( -( dy2 * dy2 + dz * dz ) / 18 ) );
+    ++itImage;
+    }
+
+  int failures = 0;
+
+  // Per-voxel evaluation, on a crop to keep the test short
+  ImageType::RegionType cropRegion;
+  cropRegion.SetIndex( 0, 10 );
+  cropRegion.SetIndex( 1, 12 );
+  cropRegion.SetIndex( 2, 4 );
+  cropRegion.SetSize( 0, 20 );
+  cropRegion.SetSize( 1, 20 );
+  cropRegion.SetSize( 2, 16 );
+  typedef itk::RegionOfInterestImageFilter< ImageType, ImageType >
+    CropFilterType;
+  CropFilterType::Pointer cropFilter = CropFilterType::New();
+  cropFilter->SetInput( image );
+  cropFilter->SetRegionOfInterest( cropRegion );
+  cropFilter->Update();
+  ImageType::Pointer crop = cropFilter->GetOutput();
+
+  FilterType::Pointer njetFilter = FilterType::New();
+  njetFilter->SetInput( crop );
+  njetFilter->SetScaleMin( 1.5 );
+  njetFilter->SetScaleMax( 3.0 );
+  njetFilter->SetNumberOfScales( 3 );
+  njetFilter->SetNumberOfWorkUnits( 3 );
+  njetFilter->Update();
+
+  NJetType::Pointer cropNJet = NJetType::New();
+  cropNJet->SetInputImage( crop );
+
+  unsigned int njetFilterErrors = 0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > itCrop(
+    njetFilter->GetOutput(), crop->GetLargestPossibleRegion() );
+  while( !itCrop.IsAtEnd() )
+    {
+    NJetType::ContinuousIndexType cIndx;
+    for( unsigned int i = 0; i < Dimension; ++i )
+      {
+      cIndx[i] = itCrop.GetIndex()[i];
+      }
+    double expected = 0;
+    for( unsigned int s = 0; s < njetFilter->GetNumberOfScales(); ++s )
+      {
+      double intensity = 0;
+      double ridgeness = cropNJet->ComputeRidgenessAtContinuousIndex(
+        cIndx, njetFilter->GetScale( s ), intensity );
+      if( s == 0 || ridgeness * intensity > expected )
+        {
+        expected = ridgeness * intensity;
+        }
+      }
+    if( std::fabs( itCrop.Get() - expected )
+      > 1e-6 * ( std::fabs( expected ) + 1 ) )
+      {
+      ++njetFilterErrors;
+      }
+    ++itCrop;
+    }
+  std::cout << "Per-voxel filter errors = " << njetFilterErrors << std::endl;
+  if( njetFilterErrors > 0 )
+    {
+    std::cout << "Filter differs from NJetImageFunction." << std::endl;
+    ++failures;
+    }
+
+  // Recursive Gaussians
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( image );
+  filter->SetScaleMin( 1.5 );
+  filter->SetScaleMax( 3.0 );
+  filter->SetNumberOfScales( 3 );
+  filter->SetUseRecursiveGaussian( true );
+  filter->Update();
+
+  FilterType::Pointer slabFilter = FilterType::New();
+  slabFilter->SetInput( image );
+  slabFilter->SetScaleMin( 1.5 );
+  slabFilter->SetScaleMax( 3.0 );
+  slabFilter->SetNumberOfScales( 3 );
+  slabFilter->SetUseRecursiveGaussian( true );
+  slabFilter->SetSlabSize( 8 );
+  slabFilter->SetNumberOfWorkUnits( 3 );
+  slabFilter->Update();
+
+  NJetType::Pointer njet = NJetType::New();
+  njet->SetInputImage( image );
+
+  // Compare on a subsampled interior, away from the boundary handling
+  const int margin = 12;
+  ImageType::RegionType interior = region;
+  for( unsigned int i = 0; i < Dimension; ++i )
+    {
+    interior.SetIndex( i, margin );
+    interior.SetSize( i, size[i] - 2 * margin );
+    }
+
+  unsigned int jetErrors = 0;
+  for( unsigned int s = 0; s < filter->GetNumberOfScales(); ++s )
+    {
+    const double scale = filter->GetScale( s );
+
+    DerivativeType::Pointer derivative = DerivativeType::New();
+    derivative->SetInput( image );
+    DerivativeType::SigmasType sigmas;
+    sigmas.Fill( scale );
+    derivative->SetSigmas( sigmas );
+    ImageType::Pointer intensity;
+    std::vector< ImageType::Pointer > dx( Dimension );
+    std::vector< ImageType::Pointer > ddx( Dimension * ( Dimension + 1 )
+      / 2 );
+    derivative->GenerateNJet( intensity, dx, ddx );
+
+    std::vector< double > expectedV;
+    std::vector< NJetType::VectorType > expectedD;
+    std::vector< NJetType::MatrixType > expectedH;
+    std::vector< double > filterV;
+    std::vector< NJetType::VectorType > filterD;
+    std::vector< NJetType::MatrixType > filterH;
+    double maxV = 0;
+    double maxD = 0;
+    double maxH = 0;
+    itk::ImageRegionConstIteratorWithIndex< ImageType > itJet( image,
+      interior );
+    while( !itJet.IsAtEnd() )
+      {
+      ImageType::IndexType indx = itJet.GetIndex();
+      if( ( indx[0] + indx[1] + indx[2] ) % 3 == 0 )
+        {
+        NJetType::ContinuousIndexType cIndx;
+        for( unsigned int i = 0; i < Dimension; ++i )
+          {
+          cIndx[i] = indx[i];
+          }
+        NJetType::VectorType d;
+        NJetType::MatrixType h;
+        expectedV.push_back( njet->ComputeJetAtContinuousIndex( cIndx, d, h,
+          scale ) );
+        expectedD.push_back( d );
+        expectedH.push_back( h );
+
+        unsigned int count = 0;
+        for( unsigned int i = 0; i < Dimension; ++i )
+          {
+          d[i] = dx[i]->GetPixel( indx );
+          for( unsigned int j = i; j < Dimension; ++j )
+            {
+            h[i][j] = ddx[count]->GetPixel( indx );
+            h[j][i] = h[i][j];
+            ++count;
+            }
+          }
+        NJetType::GaussianDerivativesToJet( scale, d, h );
+        filterV.push_back( intensity->GetPixel( indx ) );
+        filterD.push_back( d );
+        filterH.push_back( h );
+
+        maxV = std::max( maxV, std::fabs( expectedV.back() ) );
+        for( unsigned int i = 0; i < Dimension; ++i )
+          {
+          maxD = std::max( maxD, std::fabs( expectedD.back()[i] ) );
+          for( unsigned int j = 0; j < Dimension; ++j )
+            {
+            maxH = std::max( maxH, std::fabs( expectedH.back()[i][j] ) );
+            }
+          }
+        }
+      ++itJet;
+      }
+
+    for( unsigned int k = 0; k < expectedV.size(); ++k )
+      {
+      bool error = ( std::fabs( filterV[k] - expectedV[k] ) > 0.01 * maxV );
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        error = error || ( std::fabs( filterD[k][i] - expectedD[k][i] )
+          > 0.08 * maxD );
+        for( unsigned int j = 0; j < Dimension; ++j )
+          {
+          error = error || ( std::fabs( filterH[k][i][j]
+            - expectedH[k][i][j] ) > 0.1 * maxH );
+          }
+        }
+      if( error )
+        {
+        ++jetErrors;
+        }
+      }
+    }
+  std::cout << "Jet errors = " << jetErrors << std::endl;
+  if( jetErrors > 0 )
+    {
+    std::cout << "Recursive jets differ from NJetImageFunction."
+      << std::endl;
+    ++failures;
+    }
+
+  double maxValue = 0;
+  itk::ImageRegionConstIteratorWithIndex< ImageType > itOut(
+    filter->GetOutput(), interior );
+  while( !itOut.IsAtEnd() )
+    {
+    maxValue = std::max( maxValue,
+      static_cast< double >( std::fabs( itOut.Get() ) ) );
+    ++itOut;
+    }
+  if( maxValue <= 0 )
+    {
+    std::cout << "Vessels were not enhanced." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned int numberOfSamples = 0;
+  double meanError = 0;
+  unsigned int njetErrors = 0;
+  unsigned int slabErrors = 0;
+  itOut.GoToBegin();
+  while( !itOut.IsAtEnd() )
+    {
+    ImageType::IndexType indx = itOut.GetIndex();
+    if( ( indx[0] + indx[1] + indx[2] ) % 3 == 0 )
+      {
+      ++numberOfSamples;
+
+      NJetType::ContinuousIndexType cIndx;
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        cIndx[i] = indx[i];
+        }
+      double expected = 0;
+      for( unsigned int s = 0; s < filter->GetNumberOfScales(); ++s )
+        {
+        double intensity = 0;
+        double ridgeness = njet->ComputeRidgenessAtContinuousIndex( cIndx,
+          filter->GetScale( s ), intensity );
+        if( s == 0 || ridgeness * intensity > expected )
+          {
+          expected = ridgeness * intensity;
+          }
+        }
+      const double error = std::fabs( itOut.Get() - expected );
+      meanError += error;
+      if( error > 0.05 * maxValue )
+        {
+        ++njetErrors;
+        }
+      if( std::fabs( itOut.Get()
+        - slabFilter->GetOutput()->GetPixel( indx ) ) > 1e-3 * maxValue )
+        {
+        ++slabErrors;
+        }
+      }
+    ++itOut;
+    }
+  meanError /= numberOfSamples;
+
+  std::cout << "Samples = " << numberOfSamples << std::endl;
+  std::cout << "Mean error = " << meanError / maxValue << std::endl;
+  std::cout << "NJet errors = " << njetErrors << std::endl;
+  std::cout << "Slab errors = " << slabErrors << std::endl;
+
+  if( meanError > 0.01 * maxValue || njetErrors > numberOfSamples / 20 )
+    {
+    std::cout << "Recursive filter differs from NJetImageFunction."
+      << std::endl;
+    ++failures;
+    }
+  if( slabErrors > numberOfSamples / 100 )
+    {
+    std::cout << "Slab processing differs from whole volume processing."
+      << std::endl;
+    ++failures;
+    }
+
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -32,6 +32,8 @@ limitations under the License.
 #include "itktubeGaussianDerivativeFilter.h"
 #include "itktubeFFTGaussianDerivativeIFFTFilter.h"
 #include "itktubeMinimumSpanningTreeVesselConnectivityFilter.h"
+#include "itktubeNJetVesselEnhancementImageFilter.h"
+#include "itktubeRecursiveGaussianDerivativeFilter.h"
 #include "itktubeRidgeFFTFilter.h"
 #include "itktubeReResampleImageFilter.h"
 #include "itktubeSheetnessMeasureImageFilter.h"
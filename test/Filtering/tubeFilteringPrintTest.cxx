@@ -30,6 +30,8 @@ limitations under the License.
 #include "itktubeExtractTubePointsSpatialObjectFilter.h"
 #include "itktubeFFTGaussianDerivativeIFFTFilter.h"
 #include "itktubeMinimumSpanningTreeVesselConnectivityFilter.h"
+#include "itktubeNJetVesselEnhancementImageFilter.h"
+#include "itktubeRecursiveGaussianDerivativeFilter.h"
 #include "itktubeRidgeFFTFilter.h"
 #include "itktubeReResampleImageFilter.h"
 #include "itktubeSheetnessMeasureImageFilter.h"
@@ -99,6 +101,18 @@ int tubeFilteringPrintTest( int itkNotUsed( argc ), char * itkNotUsed(
     VesselConnectivityFilterType::New();
   std::cout << "-------------mstvcf " << mstvcf << std::endl;
 
+  typedef itk::tube::NJetVesselEnhancementImageFilter< ImageType >
+    NJetVesselEnhancementImageFilterType;
+  NJetVesselEnhancementImageFilterType::Pointer njveif =
+    NJetVesselEnhancementImageFilterType::New();
+  std::cout << "-------------njveif " << njveif << std::endl;
+
+  typedef itk::tube::RecursiveGaussianDerivativeFilter< ImageType >
+    RecursiveGaussianDerivativeFilterType;
+  RecursiveGaussianDerivativeFilterType::Pointer rgdf =
+    RecursiveGaussianDerivativeFilterType::New();
+  std::cout << "-------------rgdf " << rgdf << std::endl;
+
   typedef itk::tube::RidgeFFTFilter< ImageType > RidgeFFTFilterType;
   RidgeFFTFilterType::Pointer rfif = RidgeFFTFilterType::New();
   std::cout << "-------------rfif " << rfif << std::endl;
@@ -25,13 +25,13 @@ limitations under the License.
 
 int itktubePDFSegmenterParzenIOTest( int argc, char * argv[] )
 {
-  if( argc != 8 )
+  if( argc != 8 && argc != 9 )
     {
     std::cout << "Missing arguments." << std::endl;
     std::cout << "Usage: " << std::endl;
     std::cout << argv[0]
       << " inputImage1 inputImage2 inputLabelMap outputLabelMap"
-      << " pdfFile outputLabelMap2 pdfFile2"
+      << " pdfFile outputLabelMap2 pdfFile2 [useSparsePDFs]"
       << std::endl;
     return EXIT_FAILURE;
     }
@@ -117,6 +117,10 @@ int itktubePDFSegmenterParzenIOTest( int argc, char * argv[] )
   filter->SetReclassifyObjectLabels( true );
   filter->SetReclassifyNotObjectLabels( true );
   filter->SetForceClassification( true );
+  if( argc > 8 )
+    {
+    filter->SetUseSparsePDFs( std::atoi( argv[8] ) != 0 );
+    }
   filter->Update();
   std::cout << "*** Filter 1 ***" << std::endl << filter << std::endl;
   filter->ClassifyImages();
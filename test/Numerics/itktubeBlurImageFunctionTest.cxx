@@ -26,6 +26,8 @@ limitations under the License.
 #include <itkImageFileWriter.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
+#include <cmath>
+
 int itktubeBlurImageFunctionTest( int argc, char * argv[] )
   {
   if( argc != 2 )
@@ -108,5 +110,87 @@ int itktubeBlurImageFunctionTest( int argc, char * argv[] )
   imWriter->SetInput( imOut );
   imWriter->Update();
 
+  // The separable kernel must match a direct sum over the kernel box
+  imOp->SetUseSphericalKernel( false );
+  double gfact = -0.5 / ( imOp->GetScale() * imOp->GetScale() );
+  int kernMax[3];
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    kernMax[i] = ( int )( ( imOp->GetScale() * imOp->GetExtent() )
+      / imOp->GetSpacing()[i] );
+    }
+  ImageType::IndexType imMin = imRegion.GetIndex();
+  ImageType::IndexType imMax;
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    imMax[i] = imMin[i] + imSize[i] - 1;
+    }
+  ImageType::Pointer imNoise = ImageType::New();
+  imNoise->SetRegions( imRegion );
+  imNoise->SetSpacing( imSpacing );
+  imNoise->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> itNoise( imNoise,
+    imRegion );
+  while( !itNoise.IsAtEnd() )
+    {
+    ImageType::IndexType indx = itNoise.GetIndex();
+    itNoise.Set( ( indx[0] * 7 + indx[1] * 13 + indx[2] * 29 ) % 17 );
+    ++itNoise;
+    }
+  imOp->SetInputImage( imNoise );
+  int numberOfErrors = 0;
+  for( unsigned int testNum = 0; testNum < 10; ++testNum )
+    {
+    ImageOpType::ContinuousIndexType cIndx;
+    cIndx[0] = imMin[0] + 0.37 + testNum * 1.9;
+    cIndx[1] = imMin[1] + 0.81 + testNum * 1.7;
+    cIndx[2] = imMin[2] + 0.13 + testNum * 0.9;
+    double res = 0;
+    double wTotal = 0;
+    ImageType::IndexType kernX;
+    for( int z = -kernMax[2]; z <= kernMax[2]; ++z )
+      {
+      kernX[2] = ( int )( cIndx[2] ) + z;
+      for( int y = -kernMax[1]; y <= kernMax[1]; ++y )
+        {
+        kernX[1] = ( int )( cIndx[1] ) + y;
+        for( int x = -kernMax[0]; x <= kernMax[0]; ++x )
+          {
+          kernX[0] = ( int )( cIndx[0] ) + x;
+          bool inside = true;
+          double dist = 0;
+          for( unsigned int i = 0; i < 3; ++i )
+            {
+            if( kernX[i] < imMin[i] || kernX[i] > imMax[i] )
+              {
+              inside = false;
+              break;
+              }
+            double d = ( kernX[i] - cIndx[i] ) * imOp->GetSpacing()[i];
+            dist += d * d;
+            }
+          if( inside )
+            {
+            double w = std::exp( gfact * dist );
+            res += imNoise->GetPixel( kernX ) * w;
+            wTotal += w;
+            }
+          }
+        }
+      }
+    double expected = res / wTotal;
+    double actual = imOp->EvaluateAtContinuousIndex( cIndx );
+    if( std::fabs( expected - actual ) > 1e-5 )
+      {
+      std::cout << "Separable kernel mismatch at " << cIndx
+        << " : expected " << expected << " got " << actual << std::endl;
+      ++numberOfErrors;
+      }
+    }
+  if( numberOfErrors > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
   }
@@ -0,0 +1,329 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeBasisFeatureVectorGenerator.h"
+#include "itktubeNJetFeatureVectorGenerator.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkTimeProbe.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ *  This test times the LDA enhancement performed by
+ *  EnhanceUsingDiscriminantAnalysis on a synthetic volume ( 32^3 by
+ *  default ) containing bright tubes.  Four paths are timed on the whole
+ *  volume: GetFeatureVectorValue for every voxel and feature, which
+ *  evaluates the input features once per output feature as the basis
+ *  images were formerly computed; GetFeatureVector for every voxel;
+ *  GetFeatureImage for every feature; and GetFeatureImages.  All must
+ *  produce the same features.  The throughputs, and the gain of each path
+ *  over the per-feature input evaluation, are written to the output file.
+ */
+
+typedef itk::Image< float, 3 > ImageType;
+
+static unsigned int CompareFeatureImages(
+  const std::vector< ImageType::Pointer > & referenceImages,
+  const std::vector< ImageType::Pointer > & images,
+  const std::string & name )
+{
+  unsigned int numberOfErrors = 0;
+  for( unsigned int i = 0; i < referenceImages.size(); ++i )
+    {
+    ImageType::RegionType region =
+      referenceImages[i]->GetLargestPossibleRegion();
+    itk::ImageRegionIteratorWithIndex< ImageType > itReference(
+      referenceImages[i], region );
+    double maxValue = 0;
+    while( !itReference.IsAtEnd() )
+      {
+      maxValue = std::max( maxValue,
+        static_cast< double >( std::fabs( itReference.Get() ) ) );
+      ++itReference;
+      }
+    const double tolerance = 1e-5 * std::max( maxValue, 1.0 );
+    itReference.GoToBegin();
+    while( !itReference.IsAtEnd() )
+      {
+      const double value = images[i]->GetPixel( itReference.GetIndex() );
+      if( std::fabs( value - itReference.Get() ) > tolerance )
+        {
+        if( numberOfErrors < 10 )
+          {
+          std::cerr << "Feature " << i << " differs at "
+            << itReference.GetIndex() << ": per-voxel = "
+            << itReference.Get() << ", " << name << " = " << value
+            << std::endl;
+          }
+        ++numberOfErrors;
+        }
+      ++itReference;
+      }
+    }
+  return numberOfErrors;
+}
+
+int itktubeNJetBasisFeatureVectorGeneratorPerformanceTest( int argc,
+  char * argv[] )
+{
+  if( argc < 2 )
+    {
+    std::cerr << "Missing Parameters: "
+              << argv[0]
+              << " Output_Results "
+              << "[Volume_Size]"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned int volumeSize = 32;
+  if( argc > 2 )
+    {
+    volumeSize = std::atoi( argv[2] );
+    }
+
+  enum { Dimension = 3 };
+
+  typedef itk::Image< unsigned char, Dimension >  LabelMapType;
+
+  typedef itk::tube::NJetFeatureVectorGenerator< ImageType >
+    NJetGeneratorType;
+  typedef itk::tube::BasisFeatureVectorGenerator< ImageType, LabelMapType >
+    BasisGeneratorType;
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( volumeSize );
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+
+  LabelMapType::Pointer labelMap = LabelMapType::New();
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+
+  // Tubes run along z; training labels are kept sparse so that Update()
+  //   does not dominate the timing.
+  const double tubeRadius = 3;
+  const double tubeSpacing = volumeSize / 4.0;
+  itk::ImageRegionIteratorWithIndex< ImageType > itImage( image, region );
+  itk::ImageRegionIteratorWithIndex< LabelMapType > itLabel( labelMap,
+    region );
+  while( !itImage.IsAtEnd() )
+    {
+    ImageType::IndexType indx = itImage.GetIndex();
+    double dx = std::fmod( indx[0] + tubeSpacing / 2, tubeSpacing )
+      - tubeSpacing / 2;
+    double dy = std::fmod( indx[1] + tubeSpacing / 2, tubeSpacing )
+      - tubeSpacing / 2;
+    double dist2 = dx * dx + dy * dy;
+    double noise = ( ( indx[0] * 7 + indx[1] * 13 + indx[2] * 29 ) % 17 )
+      / 17.0;
+    itImage.Set( 100 * std::exp( -dist2 / ( 2 * tubeRadius * tubeRadius ) )
+      + 10 * noise );
+
+    unsigned char label = 128;
+    if( indx[2] % 8 == 0 )
+      {
+      if( dist2 < tubeRadius * tubeRadius )
+        {
+        label = 255;
+        }
+      else if( ( indx[0] + indx[1] ) % 8 == 0 )
+        {
+        label = 0;
+        }
+      }
+    itLabel.Set( label );
+
+    ++itImage;
+    ++itLabel;
+    }
+
+  NJetGeneratorType::NJetScalesType scales;
+  scales.push_back( 1 );
+  scales.push_back( 3 );
+
+  NJetGeneratorType::Pointer njetGenerator = NJetGeneratorType::New();
+  njetGenerator->SetInput( image );
+  njetGenerator->SetZeroScales( scales );
+  njetGenerator->SetFirstScales( scales );
+  njetGenerator->SetSecondScales( scales );
+  njetGenerator->SetRidgeScales( scales );
+
+  BasisGeneratorType::Pointer basisGenerator = BasisGeneratorType::New();
+  basisGenerator->SetInput( image );
+  basisGenerator->SetInputFeatureVectorGenerator( njetGenerator );
+  basisGenerator->SetLabelMap( labelMap );
+  basisGenerator->SetObjectId( 255 );
+  basisGenerator->AddObjectId( 0 );
+  basisGenerator->SetNumberOfPCABasisToUseAsFeatures( 2 );
+  basisGenerator->SetNumberOfLDABasisToUseAsFeatures( 1 );
+
+  std::ofstream measuresFile;
+  measuresFile.open( argv[1] );
+  if( !measuresFile.is_open() )
+    {
+    std::cerr << "Unable to open: " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::TimeProbe updateProbe;
+  itk::TimeProbe perFeatureProbe;
+  itk::TimeProbe perVoxelProbe;
+  itk::TimeProbe featureImageProbe;
+  itk::TimeProbe featureImagesProbe;
+
+  unsigned int numberOfErrors = 0;
+
+  try
+    {
+    updateProbe.Start();
+    basisGenerator->SetUpdateWhitenStatisticsOnUpdate( true );
+    basisGenerator->Update();
+    basisGenerator->SetUpdateWhitenStatisticsOnUpdate( false );
+    updateProbe.Stop();
+
+    basisGenerator->SetLabelMap( nullptr );
+
+    const unsigned int numFeatures = basisGenerator->GetNumberOfFeatures();
+
+    std::vector< ImageType::Pointer > perFeatureImages( numFeatures );
+    std::vector< ImageType::Pointer > perVoxelImages( numFeatures );
+    for( unsigned int i = 0; i < numFeatures; ++i )
+      {
+      perFeatureImages[i] = ImageType::New();
+      perFeatureImages[i]->SetRegions( region );
+      perFeatureImages[i]->Allocate();
+      perVoxelImages[i] = ImageType::New();
+      perVoxelImages[i]->SetRegions( region );
+      perVoxelImages[i]->Allocate();
+      }
+
+    // Input features evaluated once per output feature
+    perFeatureProbe.Start();
+    for( unsigned int i = 0; i < numFeatures; ++i )
+      {
+      itk::ImageRegionIteratorWithIndex< ImageType > itFeature(
+        perFeatureImages[i], region );
+      while( !itFeature.IsAtEnd() )
+        {
+        itFeature.Set( basisGenerator->GetFeatureVectorValue(
+          itFeature.GetIndex(), i ) );
+        ++itFeature;
+        }
+      }
+    perFeatureProbe.Stop();
+
+    // Input features evaluated once per voxel
+    perVoxelProbe.Start();
+    itk::ImageRegionIteratorWithIndex< ImageType > itVoxel( image, region );
+    while( !itVoxel.IsAtEnd() )
+      {
+      BasisGeneratorType::FeatureVectorType v =
+        basisGenerator->GetFeatureVector( itVoxel.GetIndex() );
+      for( unsigned int i = 0; i < numFeatures; ++i )
+        {
+        perVoxelImages[i]->SetPixel( itVoxel.GetIndex(), v[i] );
+        }
+      ++itVoxel;
+      }
+    perVoxelProbe.Stop();
+
+    // Input feature blocks evaluated once per output feature
+    std::vector< ImageType::Pointer > featureImages( numFeatures );
+    featureImageProbe.Start();
+    for( unsigned int i = 0; i < numFeatures; ++i )
+      {
+      featureImages[i] = basisGenerator->GetFeatureImage( i );
+      }
+    featureImageProbe.Stop();
+
+    // Input feature blocks evaluated once, as used by
+    //   EnhanceUsingDiscriminantAnalysis
+    featureImagesProbe.Start();
+    BasisGeneratorType::FeatureImageListType allFeatureImages =
+      basisGenerator->GetFeatureImages();
+    featureImagesProbe.Stop();
+
+    // All paths must give the same features, up to float rounding
+    numberOfErrors += CompareFeatureImages( perVoxelImages,
+      perFeatureImages, "GetFeatureVectorValue" );
+    numberOfErrors += CompareFeatureImages( perVoxelImages,
+      featureImages, "GetFeatureImage" );
+    numberOfErrors += CompareFeatureImages( perVoxelImages,
+      allFeatureImages, "GetFeatureImages" );
+
+    const double numVoxelFeatures = static_cast< double >(
+      region.GetNumberOfPixels() ) * numFeatures;
+    const double perFeatureRate = numVoxelFeatures
+      / perFeatureProbe.GetTotal();
+    const double perVoxelRate = numVoxelFeatures
+      / perVoxelProbe.GetTotal();
+    const double featureImageRate = numVoxelFeatures
+      / featureImageProbe.GetTotal();
+    const double featureImagesRate = numVoxelFeatures
+      / featureImagesProbe.GetTotal();
+
+    measuresFile << "VolumeSize: " << volumeSize << std::endl;
+    measuresFile << "NumberOfInputFeatures: "
+      << njetGenerator->GetNumberOfFeatures() << std::endl;
+    measuresFile << "NumberOfBasisFeatures: " << numFeatures << std::endl;
+    measuresFile << "Update (s): " << updateProbe.GetTotal() << std::endl;
+    measuresFile << "GetFeatureVectorValue (voxel-features/s): "
+      << perFeatureRate << std::endl;
+    measuresFile << "GetFeatureVector (voxel-features/s): " << perVoxelRate
+      << " gain " << perVoxelRate / perFeatureRate << std::endl;
+    measuresFile << "GetFeatureImage (voxel-features/s): "
+      << featureImageRate << " gain " << featureImageRate / perFeatureRate
+      << std::endl;
+    measuresFile << "GetFeatureImages (voxel-features/s): "
+      << featureImagesRate << " gain "
+      << featureImagesRate / perFeatureRate << std::endl;
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << "Exception caught while timing basis generator."
+      << std::endl;
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  measuresFile.close();
+
+  if( numberOfErrors > 0 )
+    {
+    std::cerr << numberOfErrors << " features differ from the"
+      << " per-voxel features." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
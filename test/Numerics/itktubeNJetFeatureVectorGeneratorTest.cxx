@@ -23,6 +23,88 @@ limitations under the License.
 
 #include "itktubeNJetFeatureVectorGenerator.h"
 
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+/** Compare an NJet kernel, of the given per-axis derivative orders, over
+ *  its bounding box and over the sphere of radius extent * scale.
+ *  Returns the fraction of the absolute kernel weight that lies outside
+ *  the sphere.  sumDifference is set to the difference between the
+ *  kernel sums, each divided by its absolute weight. */
+template< unsigned int VDimension >
+double CompareKernelSupports( double scale, double extent,
+  const itk::Vector< double, VDimension > & spacing,
+  const itk::FixedArray< unsigned int, VDimension > & order,
+  double & sumDifference )
+{
+  int radius[VDimension];
+  int u[VDimension];
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    radius[i] = static_cast< int >( std::floor( scale * extent
+      / spacing[i] ) );
+    u[i] = -radius[i];
+    }
+  const double radiusSquared = ( scale * extent ) * ( scale * extent );
+
+  double boxSum = 0;
+  double boxTotal = 0;
+  double sphereSum = 0;
+  double sphereTotal = 0;
+  bool done = false;
+  while( !done )
+    {
+    double w = 1;
+    double distSquared = 0;
+    for( unsigned int i = 0; i < VDimension; ++i )
+      {
+      const double dist = u[i] * spacing[i];
+      const double g = std::exp( -dist * dist / ( 2 * scale * scale ) );
+      distSquared += dist * dist;
+      if( order[i] == 0 )
+        {
+        w *= g;
+        }
+      else if( order[i] == 1 )
+        {
+        w *= -dist * g;
+        }
+      else
+        {
+        w *= ( dist * dist / ( scale * scale ) - 1 ) * g;
+        }
+      }
+    boxSum += w;
+    boxTotal += std::fabs( w );
+    if( distSquared <= radiusSquared )
+      {
+      sphereSum += w;
+      sphereTotal += std::fabs( w );
+      }
+
+    unsigned int i = 0;
+    while( i < VDimension && ++u[i] > radius[i] )
+      {
+      u[i] = -radius[i];
+      ++i;
+      }
+    done = ( i == VDimension );
+    }
+
+  if( boxTotal == 0 || sphereTotal == 0 )
+    {
+    sumDifference = 0;
+    return 0;
+    }
+  sumDifference = boxSum / boxTotal - sphereSum / sphereTotal;
+  return 1 - sphereTotal / boxTotal;
+}
+
 int itktubeNJetFeatureVectorGeneratorTest( int argc, char * argv[] )
 {
   if( argc != 5 )
@@ -121,6 +203,197 @@ int itktubeNJetFeatureVectorGeneratorTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // Block evaluation must match per-voxel evaluation
+  ImageType::RegionType blockRegion = inputImage->GetLargestPossibleRegion();
+  ImageType::IndexType blockIndex = blockRegion.GetIndex();
+  ImageType::SizeType blockSize = blockRegion.GetSize();
+  for( unsigned int i = 0; i < Dimension; ++i )
+    {
+    blockIndex[i] += blockSize[i] / 3;
+    blockSize[i] = std::min( blockSize[i] / 3,
+      static_cast< ImageType::SizeValueType >( 8 ) );
+    }
+  blockRegion.SetIndex( blockIndex );
+  blockRegion.SetSize( blockSize );
+  const unsigned int numFeatures = filter->GetNumberOfFeatures();
+  const itk::SizeValueType numVoxels = blockRegion.GetNumberOfPixels();
+  std::vector< FilterType::FeatureValueType > block( numFeatures
+    * numVoxels );
+  filter->FillFeatureBlock( blockRegion, block.data() );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > blockIter(
+    inputImage, blockRegion );
+  itk::SizeValueType voxel = 0;
+  while( !blockIter.IsAtEnd() )
+    {
+    FilterType::FeatureVectorType fv = filter->GetFeatureVector(
+      blockIter.GetIndex() );
+    for( unsigned int f = 0; f < numFeatures; ++f )
+      {
+      if( std::fabs( fv[f] - block[ f * numVoxels + voxel ] ) > 1e-4 )
+        {
+        std::cout << "FillFeatureBlock mismatch at "
+          << blockIter.GetIndex() << " feature " << f << " : "
+          << fv[f] << " != " << block[ f * numVoxels + voxel ]
+          << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    ++voxel;
+    ++blockIter;
+    }
+
+  // Tiled evaluation filters with the NJet kernels over their bounding
+  //   box, while the per-voxel sums stop at the sphere of radius
+  //   Extent * scale.  Both divide by the absolute kernel weight over
+  //   their own support.  Writing the intensities around a voxel as
+  //   c + e, with c the middle and R the width of their range, a linear
+  //   feature then differs by at most f * R + | c * k |, where f is the
+  //   fraction of absolute kernel weight outside the sphere and k the
+  //   difference of the normalized kernel sums, which is zero for the
+  //   odd and non-negative kernels.  Magnitudes are bounded by the norm
+  //   of their component bounds.  Ridge measures are ratios of
+  //   eigenvalues and have no such bound, so they are only checked for
+  //   consistency between tiled point queries and tiled blocks.
+  FilterType::Pointer tiledFilter = FilterType::New();
+  tiledFilter->SetInput( inputImage );
+  tiledFilter->SetZeroScales( scales );
+  tiledFilter->SetFirstScales( scales );
+  tiledFilter->SetSecondScales( scales2 );
+  tiledFilter->SetRidgeScales( scales2 );
+  tiledFilter->SetUseTiledEvaluation( true );
+  tiledFilter->SetTileSize( 16 );
+  std::vector< FilterType::FeatureValueType > tiledBlock( numFeatures
+    * numVoxels );
+  tiledFilter->FillFeatureBlock( blockRegion, tiledBlock.data() );
+
+  typedef itk::tube::NJetImageFunction< ImageType > NJetFunctionType;
+  const double extent = NJetFunctionType::New()->GetExtent();
+  const ImageType::SpacingType spacing = inputImage->GetSpacing();
+  const ImageType::RegionType imageRegion =
+    inputImage->GetLargestPossibleRegion();
+
+  // Kernel comparisons of the components of each linear feature, and the
+  //   scale whose box holds its support.  Features are ordered as in
+  //   NJetFeatureVectorGenerator::GetFeatureVector.
+  typedef std::vector< std::pair< double, double > > ComponentListType;
+  std::vector< ComponentListType > featureComponents;
+  std::vector< double > featureScale;
+  itk::FixedArray< unsigned int, Dimension > order;
+  double sumDifference;
+  for( unsigned int s = 0; s < scales.size(); ++s )
+    {
+    order.Fill( 0 );
+    const double fraction = CompareKernelSupports< Dimension >( scales[s],
+      extent, spacing, order, sumDifference );
+    featureComponents.push_back( ComponentListType( 1,
+      std::make_pair( fraction, sumDifference ) ) );
+    featureScale.push_back( scales[s] );
+    }
+  for( unsigned int o = 1; o <= 2; ++o )
+    {
+    const FilterType::NJetScalesType & oScales = ( o == 1 ) ? scales
+      : scales2;
+    for( unsigned int s = 0; s < oScales.size(); ++s )
+      {
+      ComponentListType magnitudeComponents;
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        order.Fill( 0 );
+        order[i] = o;
+        const double fraction = CompareKernelSupports< Dimension >(
+          oScales[s], extent, spacing, order, sumDifference );
+        featureComponents.push_back( ComponentListType( 1,
+          std::make_pair( fraction, sumDifference ) ) );
+        featureScale.push_back( oScales[s] );
+        magnitudeComponents.push_back( std::make_pair( fraction,
+          sumDifference ) );
+        }
+      featureComponents.push_back( magnitudeComponents );
+      featureScale.push_back( oScales[s] );
+      }
+    }
+  const unsigned int numLinearFeatures = featureComponents.size();
+
+  blockIter.GoToBegin();
+  voxel = 0;
+  double maxRelativeError = 0;
+  unsigned int numberOfMismatches = 0;
+  while( !blockIter.IsAtEnd() )
+    {
+    FilterType::FeatureVectorType fv = tiledFilter->GetFeatureVector(
+      blockIter.GetIndex() );
+    for( unsigned int f = 0; f < numFeatures; ++f )
+      {
+      const double tiled = tiledBlock[ f * numVoxels + voxel ];
+      if( std::fabs( fv[f] - tiled ) > 1e-6 * ( 1 + std::fabs( tiled ) ) )
+        {
+        std::cout << "Tiled point query mismatch at "
+          << blockIter.GetIndex() << " feature " << f << " : "
+          << fv[f] << " != " << tiled << std::endl;
+        ++numberOfMismatches;
+        }
+      if( f >= numLinearFeatures )
+        {
+        continue;
+        }
+
+      ImageType::RegionType boxRegion;
+      boxRegion.SetIndex( blockIter.GetIndex() );
+      boxRegion.SetSize( 1 );
+      ImageType::SizeType boxRadius;
+      for( unsigned int i = 0; i < Dimension; ++i )
+        {
+        boxRadius[i] = static_cast< itk::SizeValueType >( std::floor(
+          featureScale[f] * extent / spacing[i] ) );
+        }
+      boxRegion.PadByRadius( boxRadius );
+      boxRegion.Crop( imageRegion );
+      double minV = itk::NumericTraits< double >::max();
+      double maxV = itk::NumericTraits< double >::NonpositiveMin();
+      itk::ImageRegionConstIterator< ImageType > boxIter( inputImage,
+        boxRegion );
+      while( !boxIter.IsAtEnd() )
+        {
+        minV = std::min( minV, static_cast< double >( boxIter.Get() ) );
+        maxV = std::max( maxV, static_cast< double >( boxIter.Get() ) );
+        ++boxIter;
+        }
+
+      const double expected = block[ f * numVoxels + voxel ];
+      const double range = maxV - minV;
+      const double middle = ( maxV + minV ) / 2;
+      double bound = 0;
+      for( unsigned int c = 0; c < featureComponents[f].size(); ++c )
+        {
+        const double componentBound = featureComponents[f][c].first * range
+          + std::fabs( middle * featureComponents[f][c].second );
+        bound += componentBound * componentBound;
+        }
+      bound = std::sqrt( bound );
+      const double error = std::fabs( tiled - expected );
+      if( range > 0 )
+        {
+        maxRelativeError = std::max( maxRelativeError, error / range );
+        }
+      if( error > bound + 1e-5 * ( std::fabs( expected ) + range ) )
+        {
+        std::cout << "Tiled evaluation mismatch at "
+          << blockIter.GetIndex() << " feature " << f << " : "
+          << expected << " != " << tiled << " ( bound " << bound << " )"
+          << std::endl;
+        ++numberOfMismatches;
+        }
+      }
+    ++voxel;
+    ++blockIter;
+    }
+  std::cout << "Largest tiled evaluation error of the linear features = "
+    << maxRelativeError << " of the local intensity range" << std::endl;
+  if( numberOfMismatches > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
   // All objects should be automatically destroyed at this point
   return EXIT_SUCCESS;
 }
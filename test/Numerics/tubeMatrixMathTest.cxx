@@ -114,6 +114,109 @@ int Test( void )
         returnStatus = EXIT_FAILURE;
         }
       }
+
+    // The fixed-size solver must agree with the vnl one
+    itk::Matrix<float, VDimension, VDimension> m2;
+    itk::Vector<float, VDimension> d2;
+    vnl_vector<float> d1( VDimension );
+    for( unsigned int r=0; r<VDimension; r++ )
+      {
+      d1[r] = rndGen->GetNormalVariate( 0.0, 1.0 );
+      d2[r] = d1[r];
+      for( unsigned int c=0; c<VDimension; c++ )
+        {
+        m2( r, c ) = m1( r, c );
+        }
+      }
+    itk::Matrix<float, VDimension, VDimension> eVects2;
+    itk::Vector<float, VDimension> eVals2;
+    tube::ComputeEigen( m2, eVects2, eVals2, true );
+    for( unsigned int d=0; d<VDimension; d++ )
+      {
+      if( std::fabs( eVals2[d] - eVals[d] ) > epsilon * 10 )
+        {
+        std::cout << count << " : ";
+        std::cout << "FAILURE: ComputeEigen fixed-size : "
+          << eVals2[d] << " != " << eVals[d] << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+
+    double ridgeness1 = 0;
+    double roundness1 = 0;
+    double curvature1 = 0;
+    double levelness1 = 0;
+    vnl_vector<float> prevTangent;
+    tube::ComputeRidgeness<float>( m1, d1, prevTangent, ridgeness1,
+      roundness1, curvature1, levelness1, eVects, eVals );
+    double ridgeness2 = 0;
+    double roundness2 = 0;
+    double curvature2 = 0;
+    double levelness2 = 0;
+    tube::ComputeRidgeness<float, VDimension>( m2, d2, NULL, ridgeness2,
+      roundness2, curvature2, levelness2, eVects2, eVals2 );
+    if( std::fabs( ridgeness1 - ridgeness2 ) > epsilon * 10
+      || std::fabs( roundness1 - roundness2 ) > epsilon * 10
+      || std::fabs( curvature1 - curvature2 ) > epsilon * 10
+      || std::fabs( levelness1 - levelness2 ) > epsilon * 10 )
+      {
+      std::cout << count << " : ";
+      std::cout << "FAILURE: ComputeRidgeness fixed-size : "
+        << ridgeness2 << ", " << roundness2 << ", " << curvature2 << ", "
+        << levelness2 << " != " << ridgeness1 << ", " << roundness1
+        << ", " << curvature1 << ", " << levelness1 << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+
+    // Same comparison with a previous tangent.  The tangent is taken near
+    // one of the eigenvectors, so that both versions pick the same column
+    // and the reordering is exercised for every column.
+    vnl_vector<float> prevTangent1( VDimension );
+    itk::Vector<float, VDimension> prevTangent2;
+    for( unsigned int r=0; r<VDimension; r++ )
+      {
+      prevTangent1[r] = eVects( r, count % VDimension )
+        + 0.1 * rndGen->GetNormalVariate( 0.0, 1.0 );
+      }
+    prevTangent1.normalize();
+    for( unsigned int r=0; r<VDimension; r++ )
+      {
+      prevTangent2[r] = prevTangent1[r];
+      }
+    tube::ComputeRidgeness<float>( m1, d1, prevTangent1, ridgeness1,
+      roundness1, curvature1, levelness1, eVects, eVals );
+    tube::ComputeRidgeness<float, VDimension>( m2, d2, &prevTangent2,
+      ridgeness2, roundness2, curvature2, levelness2, eVects2, eVals2 );
+    if( std::fabs( ridgeness1 - ridgeness2 ) > epsilon * 10
+      || std::fabs( roundness1 - roundness2 ) > epsilon * 10
+      || std::fabs( curvature1 - curvature2 ) > epsilon * 10
+      || std::fabs( levelness1 - levelness2 ) > epsilon * 10 )
+      {
+      std::cout << count << " : ";
+      std::cout << "FAILURE: ComputeRidgeness fixed-size with tangent : "
+        << ridgeness2 << ", " << roundness2 << ", " << curvature2 << ", "
+        << levelness2 << " != " << ridgeness1 << ", " << roundness1
+        << ", " << curvature1 << ", " << levelness1 << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    for( unsigned int c=0; c<VDimension; c++ )
+      {
+      // Eigenvectors are only defined up to their sign
+      double dProd = 0;
+      for( unsigned int r=0; r<VDimension; r++ )
+        {
+        dProd += eVects( r, c ) * eVects2( r, c );
+        }
+      if( std::fabs( eVals2[c] - eVals[c] ) > epsilon * 10
+        || std::fabs( std::fabs( dProd ) - 1 ) > epsilon * 10 )
+        {
+        std::cout << count << " : ";
+        std::cout << "FAILURE: ComputeRidgeness fixed-size with tangent : "
+          << "column " << c << " : " << eVals2[c] << " != " << eVals[c]
+          << " or dot product " << dProd << " != +/-1" << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
     }
 
   return returnStatus;
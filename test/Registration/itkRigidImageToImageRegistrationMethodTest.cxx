@@ -0,0 +1,191 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itkRigidImageToImageRegistrationMethod.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkMeanSquaresImageToImageMetric.h>
+
+/** A synthetic image is registered to its shifted copy with one and
+ *  with four evolutionary starts.  Measured by the mean squared
+ *  difference over the whole image, four starts must not end worse
+ *  than one. */
+
+typedef itk::Image< float, 3 >                        ImageType;
+typedef itk::RigidImageToImageRegistrationMethod< ImageType >
+  RegistrationMethodType;
+typedef RegistrationMethodType::AffineTransformType   AffineTransformType;
+
+static ImageType::Pointer CreateBlobImage(
+  const ImageType::PointType::VectorType & shift )
+{
+  ImageType::SizeType size;
+  size.Fill( 32 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( size );
+  image->Allocate();
+
+  // Three blobs, so that no rotation leaves the image unchanged
+  const double center[3][3] = { { 12, 14, 16 }, { 20, 18, 12 },
+    { 10, 22, 20 } };
+  const double sigma[3] = { 4, 3, 2.5 };
+  const double height[3] = { 100, 60, 80 };
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::PointType p;
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), p );
+    double value = 0;
+    for( unsigned int b = 0; b < 3; ++b )
+      {
+      double d2 = 0;
+      for( unsigned int i = 0; i < 3; ++i )
+        {
+        double x = p[i] - shift[i] - center[b][i];
+        d2 += x * x;
+        }
+      value += height[b] * std::exp( -d2 / ( 2 * sigma[b] * sigma[b] ) );
+      }
+    it.Set( value );
+    ++it;
+    }
+
+  return image;
+}
+
+static double MeanSquares( const ImageType * fixedImage,
+  const ImageType * movingImage, const AffineTransformType * transform )
+{
+  typedef itk::MeanSquaresImageToImageMetric< ImageType, ImageType >
+    MetricType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double >
+    InterpolatorType;
+
+  AffineTransformType::Pointer metricTransform = AffineTransformType::New();
+  metricTransform->SetFixedParameters( transform->GetFixedParameters() );
+  metricTransform->SetParameters( transform->GetParameters() );
+
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+  metric->SetTransform( metricTransform );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetUseAllPixels( true );
+  metric->Initialize();
+
+  return metric->GetValue( metricTransform->GetParameters() );
+}
+
+static AffineTransformType::Pointer Register( const ImageType * fixedImage,
+  const ImageType * movingImage, unsigned int numberOfStarts )
+{
+  RegistrationMethodType::Pointer reg = RegistrationMethodType::New();
+  reg->SetFixedImage( fixedImage );
+  reg->SetMovingImage( movingImage );
+  reg->SetMetricMethodEnum(
+    RegistrationMethodType::MEAN_SQUARED_ERROR_METRIC );
+  reg->SetNumberOfSamples( 8000 );
+  reg->SetRandomNumberSeed( 1 );
+  reg->SetNumberOfEvolutionaryStarts( numberOfStarts );
+
+  RegistrationMethodType::TransformParametersScalesType scales( 6 );
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    scales[i] = 1.0 / 0.1;
+    scales[i + 3] = 1.0 / 5.0;
+    }
+  reg->SetTransformParametersScales( scales );
+
+  ImageType::PointType center;
+  center.Fill( 15.5 );
+  reg->GetTypedTransform()->SetCenter( center );
+  reg->SetInitialTransformParameters(
+    reg->GetTypedTransform()->GetParameters() );
+  reg->SetInitialTransformFixedParameters(
+    reg->GetTypedTransform()->GetFixedParameters() );
+
+  reg->Update();
+
+  return reg->GetAffineTransform();
+}
+
+int itkRigidImageToImageRegistrationMethodTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  ImageType::PointType::VectorType noShift;
+  noShift.Fill( 0 );
+  ImageType::PointType::VectorType shift;
+  shift[0] = 3;
+  shift[1] = -2;
+  shift[2] = 1.5;
+
+  ImageType::Pointer fixedImage = CreateBlobImage( noShift );
+  ImageType::Pointer movingImage = CreateBlobImage( shift );
+
+  AffineTransformType::Pointer identity = AffineTransformType::New();
+  identity->SetIdentity();
+  double initialValue = MeanSquares( fixedImage, movingImage, identity );
+
+  AffineTransformType::Pointer oneStartTransform = Register( fixedImage,
+    movingImage, 1 );
+  double oneStartValue = MeanSquares( fixedImage, movingImage,
+    oneStartTransform );
+
+  AffineTransformType::Pointer fourStartsTransform = Register( fixedImage,
+    movingImage, 4 );
+  double fourStartsValue = MeanSquares( fixedImage, movingImage,
+    fourStartsTransform );
+
+  std::cout << "Initial mean squares = " << initialValue << std::endl;
+  std::cout << "One start mean squares = " << oneStartValue << std::endl;
+  std::cout << "  translation = " << oneStartTransform->GetTranslation()
+    << std::endl;
+  std::cout << "Four starts mean squares = " << fourStartsValue << std::endl;
+  std::cout << "  translation = " << fourStartsTransform->GetTranslation()
+    << std::endl;
+
+  int failures = 0;
+  if( !( oneStartValue < initialValue ) )
+    {
+    std::cout << "One start did not improve the alignment." << std::endl;
+    ++failures;
+    }
+  // The chains sample the metric differently from the single start, so
+  //   allow a small part of the initial misalignment
+  if( !( fourStartsValue <= oneStartValue + 0.01 * initialValue ) )
+    {
+    std::cout << "Four starts are worse than one." << std::endl;
+    ++failures;
+    }
+
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -25,15 +25,220 @@ limitations under the License.
 #include "itktubeSubSampleTubeTreeSpatialObjectFilter.h"
 
 #include <itkImageFileReader.h>
+#include <itkLinearInterpolateImageFunction.h>
 #include <itkSpatialObjectReader.h>
 
+#include <vnl/algo/vnl_matrix_inverse.h>
+
+#include <algorithm>
+#include <cmath>
+
 /**
  *  This test exercised the metric evaluation methods in the
  *  itktubeImageToTubeRigidMetric class. The distance between
  *  a 3D binary images ( 32x32x32 ) and a .tre image is computed and check with
  *  the reference for the metric.
+ *
+ *  The value and derivative at a displaced transform are also checked,
+ *  with one and with several work units, against a reference evaluation
+ *  that walks the tubes one point at a time as the metric originally did.
  */
 
+typedef double                                            FloatType;
+typedef itk::Image< FloatType, 3 >                        ImageType;
+typedef itk::TubeSpatialObject< 3 >                       TubeType;
+typedef itk::GroupSpatialObject< 3 >                      TubeNetType;
+typedef itk::tube::ImageToTubeRigidMetric< ImageType, TubeNetType,
+  TubeType >                                              MetricType;
+typedef MetricType::TransformType                         TransformType;
+typedef itk::LinearInterpolateImageFunction< ImageType >  InterpolatorType;
+typedef itk::CompensatedSummation< double >               SumType;
+typedef TransformType::OutputPointType                    OutputPointType;
+typedef TubeType::TubePointType::CovariantVectorType      NormalType;
+
+static double ReferenceLaplacianMagnitude(
+  const InterpolatorType * interpolator, const NormalType & normal,
+  double scale, double extent, const OutputPointType & x )
+{
+  const double scaleSquared = scale * scale;
+  SumType kernelSum;
+  unsigned int numberOfKernelPoints = 0;
+  for( double distance = -scale * extent; distance <= scale * extent;
+    ++distance )
+    {
+    OutputPointType point;
+    for( unsigned int ii = 0; ii < 3; ++ii )
+      {
+      point[ii] = x[ii] + distance * normal[ii];
+      }
+    if( interpolator->IsInsideBuffer( point ) )
+      {
+      const double distanceSquared = distance * distance;
+      kernelSum += ( -1.0 + ( distanceSquared / scaleSquared ) )
+        * std::exp( -0.5 * distanceSquared / scaleSquared );
+      ++numberOfKernelPoints;
+      }
+    }
+  const double error = kernelSum.GetSum() / numberOfKernelPoints;
+
+  SumType result;
+  for( double distance = -scale * extent; distance <= scale * extent;
+    ++distance )
+    {
+    OutputPointType point;
+    for( unsigned int ii = 0; ii < 3; ++ii )
+      {
+      point[ii] = x[ii] + distance * normal[ii];
+      }
+    if( interpolator->IsInsideBuffer( point ) )
+      {
+      const double distanceSquared = distance * distance;
+      const double kernelValue = ( -1.0 + ( distanceSquared / scaleSquared ) )
+        * std::exp( -0.5 * distanceSquared / scaleSquared ) - error;
+      result += interpolator->Evaluate( point ) * kernelValue;
+      }
+    }
+  return result.GetSum();
+}
+
+static double ReferenceThirdDerivative(
+  const InterpolatorType * interpolator, const NormalType & normal,
+  double scale, double extent, const OutputPointType & x )
+{
+  const double scaleSquared = scale * scale;
+  const double step = 0.1 * scale * extent;
+  SumType result;
+  SumType kernelSum;
+  for( double distance = -scale * extent; distance <= scale * extent;
+    distance += step )
+    {
+    const double kernelValue = 2.0 * distance
+      * std::exp( -0.5 * distance * distance / scaleSquared );
+    kernelSum += std::fabs( kernelValue );
+
+    OutputPointType point;
+    for( unsigned int ii = 0; ii < 3; ++ii )
+      {
+      point[ii] = x[ii] + distance * normal[ii];
+      }
+    if( interpolator->IsInsideBuffer( point ) )
+      {
+      result += interpolator->Evaluate( point ) * kernelValue;
+      }
+    }
+  return result.GetSum() / kernelSum.GetSum();
+}
+
+/** Value and derivative with unit feature weights, evaluated tube by
+ *  tube and point by point. */
+static void ReferenceValueAndDerivative( const MetricType * metric,
+  const ImageType * image, TubeNetType * tubeNet,
+  const MetricType::ParametersType & parameters,
+  double & value, MetricType::DerivativeType & derivative )
+{
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage( image );
+
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetFixedParameters(
+    metric->GetTransform()->GetFixedParameters() );
+  transform->SetParameters( parameters );
+  const TransformType::CenterType center = transform->GetCenter();
+
+  char childName[] = "Tube";
+  TubeNetType::ChildrenListType * tubeList = tubeNet->GetChildren(
+    tubeNet->GetMaximumDepth(), childName );
+
+  SumType matchMeasure;
+  SumType weightSum;
+  vnl_matrix< double > biasV( 3, 3, 0.0 );
+  SumType dPosition[3];
+  std::vector< OutputPointType > transformedPoints;
+  std::vector< vnl_vector< double > > dTransformedPoints;
+  TubeNetType::ChildrenListType::iterator tubeIterator;
+  for( tubeIterator = tubeList->begin(); tubeIterator != tubeList->end();
+    ++tubeIterator )
+    {
+    TubeType * tube = dynamic_cast< TubeType * >(
+      tubeIterator->GetPointer() );
+    if( tube == NULL )
+      {
+      continue;
+      }
+    for( unsigned int p = 0; p < tube->GetPoints().size(); ++p )
+      {
+      const TubeType::TubePointType & tubePoint = tube->GetPoints()[p];
+      const OutputPointType x = transform->TransformPoint(
+        tubePoint.GetPositionInObjectSpace() );
+      if( !interpolator->IsInsideBuffer( x ) )
+        {
+        continue;
+        }
+      const double scale = std::max( tubePoint.GetRadiusInObjectSpace(),
+        metric->GetMinimumScalingRadius() ) * metric->GetKappa();
+
+      weightSum += 1.0;
+      matchMeasure += std::fabs( ReferenceLaplacianMagnitude( interpolator,
+        tubePoint.GetNormal1InObjectSpace(), scale, metric->GetExtent(),
+        x ) );
+
+      const NormalType v1 = transform->TransformCovariantVector(
+        tubePoint.GetNormal1InObjectSpace() );
+      const NormalType v2 = transform->TransformCovariantVector(
+        tubePoint.GetNormal2InObjectSpace() );
+      biasV += outer_product( v1.GetVnlVector(), v1.GetVnlVector() );
+      biasV += outer_product( v2.GetVnlVector(), v2.GetVnlVector() );
+
+      const double dXProj1 = ReferenceThirdDerivative( interpolator, v1,
+        scale, metric->GetExtent(), x );
+      const double dXProj2 = ReferenceThirdDerivative( interpolator, v2,
+        scale, metric->GetExtent(), x );
+      vnl_vector< double > dX( 3 );
+      for( unsigned int ii = 0; ii < 3; ++ii )
+        {
+        dX[ii] = dXProj1 * v1[ii] + dXProj2 * v2[ii];
+        dPosition[ii] += dX[ii];
+        }
+      transformedPoints.push_back( x );
+      dTransformedPoints.push_back( dX );
+      }
+    }
+  delete tubeList;
+
+  value = matchMeasure.GetSum() / weightSum.GetSum();
+
+  const vnl_matrix< double > biasVI =
+    vnl_matrix_inverse< double >( biasV ).inverse();
+  vnl_vector< double > offsets( 3 );
+  for( unsigned int ii = 0; ii < 3; ++ii )
+    {
+    offsets[ii] = dPosition[ii].GetSum();
+    }
+  offsets *= biasVI;
+
+  SumType dAngle[3];
+  for( unsigned int p = 0; p < transformedPoints.size(); ++p )
+    {
+    const vnl_vector< double > dXT = dTransformedPoints[p] * biasVI;
+    vnl_vector< double > radius( 3 );
+    for( unsigned int ii = 0; ii < 3; ++ii )
+      {
+      radius[ii] = transformedPoints[p][ii] - offsets[ii] - center[ii];
+      }
+    radius.normalize();
+    dAngle[0] += dXT[1] * -radius[2] + dXT[2] *  radius[1];
+    dAngle[1] += dXT[0] *  radius[2] + dXT[2] * -radius[0];
+    dAngle[2] += dXT[0] * -radius[1] + dXT[1] *  radius[0];
+    }
+
+  derivative.SetSize( 6 );
+  for( unsigned int ii = 0; ii < 3; ++ii )
+    {
+    derivative[ii] = dAngle[ii].GetSum();
+    derivative[ii + 3] = offsets[ii];
+    }
+}
+
 int itktubeImageToTubeRigidMetricTest( int argc, char * argv[] )
 {
   if( argc < 4 )
@@ -47,20 +252,8 @@ int itktubeImageToTubeRigidMetricTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
-  typedef double            FloatType;
-  static const unsigned int ImageDimension = 3;
-  static const unsigned int TubeDimension = 3;
-
-  typedef itk::Image< FloatType, ImageDimension >         ImageType;
-  typedef itk::TubeSpatialObject< TubeDimension >         TubeType;
-  typedef itk::GroupSpatialObject< TubeDimension >        TubeNetType;
-
   typedef itk::ImageFileReader< ImageType >               ImageReaderType;
-  typedef itk::SpatialObjectReader< TubeDimension >       TubeNetReaderType;
-
-  typedef itk::tube::ImageToTubeRigidMetric< ImageType, TubeNetType,
-    TubeType >                                            MetricType;
-  typedef MetricType::TransformType                       TransformType;
+  typedef itk::SpatialObjectReader< 3 >                   TubeNetReaderType;
 
   // read image ( fixedImage )
   ImageReaderType::Pointer imageReader = ImageReaderType::New();
@@ -139,5 +332,56 @@ int itktubeImageToTubeRigidMetricTest( int argc, char * argv[] )
     return EXIT_FAILURE;
     }
 
+  // The separate and fused evaluations must match the reference
+  // evaluation, whatever the number of work units.
+  parameters[0] = 0.05;
+  parameters[4] = 0.5;
+  double referenceValue;
+  MetricType::DerivativeType referenceDerivative;
+  ReferenceValueAndDerivative( metric, imageReader->GetOutput(),
+    subSampleTubeNetFilter->GetOutput(), parameters, referenceValue,
+    referenceDerivative );
+
+  const double epsilonReference = 1e-6;
+  for( unsigned int numberOfWorkUnits = 1; numberOfWorkUnits <= 4;
+    numberOfWorkUnits += 3 )
+    {
+    metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+    MetricType::MeasureType separateValue = metric->GetValue( parameters );
+    MetricType::DerivativeType separateDerivative;
+    metric->GetDerivative( parameters, separateDerivative );
+    MetricType::MeasureType fusedValue;
+    MetricType::DerivativeType fusedDerivative;
+    metric->GetValueAndDerivative( parameters, fusedValue, fusedDerivative );
+
+    if( std::fabs( separateValue - referenceValue ) >
+        epsilonReference * ( 1 + std::fabs( referenceValue ) ) ||
+      std::fabs( fusedValue - referenceValue ) >
+        epsilonReference * ( 1 + std::fabs( referenceValue ) ) )
+      {
+      std::cerr << "Value with " << numberOfWorkUnits
+                << " work units differs from the reference: "
+                << separateValue << ", " << fusedValue
+                << " != " << referenceValue << std::endl;
+      return EXIT_FAILURE;
+      }
+    for( unsigned int ii = 0; ii < referenceDerivative.GetSize(); ++ii )
+      {
+      const double tolerance = epsilonReference
+        * ( 1 + std::fabs( referenceDerivative[ii] ) );
+      if( std::fabs( separateDerivative[ii] - referenceDerivative[ii] )
+          > tolerance ||
+        std::fabs( fusedDerivative[ii] - referenceDerivative[ii] )
+          > tolerance )
+        {
+        std::cerr << "Derivative with " << numberOfWorkUnits
+                  << " work units differs from the reference: "
+                  << separateDerivative << ", " << fusedDerivative
+                  << " != " << referenceDerivative << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
   return EXIT_SUCCESS;
 }
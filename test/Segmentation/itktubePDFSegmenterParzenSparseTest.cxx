@@ -0,0 +1,203 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubePDFSegmenterParzen.h"
+
+#include "itktubeFeatureVectorGenerator.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+#include <vector>
+
+// Builds the class PDFs once as dense images and once as sparse bins from
+//   the same training data and checks that the densities agree at every
+//   voxel of the image.  The sparse Parzen window is truncated at three
+//   standard deviations while the dense one is a recursive Gaussian, so
+//   the densities are compared relative to each class's peak density.
+int itktubePDFSegmenterParzenSparseTest( int argc, char * argv[] )
+{
+  if( argc != 4 )
+    {
+    std::cout << "Missing arguments." << std::endl;
+    std::cout << "Usage: " << std::endl;
+    std::cout << argv[0]
+      << " inputImage1 inputImage2 inputLabelMap"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  enum { Dimension = 2 };
+
+  typedef float                                  PixelType;
+  typedef itk::Image< PixelType, Dimension >     ImageType;
+  typedef itk::ImageFileReader< ImageType >      ReaderType;
+
+  typedef itk::tube::PDFSegmenterParzen< ImageType, ImageType >
+    FilterType;
+
+  typedef itk::tube::FeatureVectorGenerator< ImageType >
+    FeatureVectorGeneratorType;
+
+  ImageType::Pointer inputImage[3];
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( argv[i + 1] );
+    try
+      {
+      reader->Update();
+      }
+    catch( itk::ExceptionObject & e )
+      {
+      std::cout << "Exception caught during input read:" << std::endl << e
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    inputImage[i] = reader->GetOutput();
+    std::cout << "Read: " << argv[i + 1] << std::endl;
+    }
+
+  FeatureVectorGeneratorType::Pointer fvGen =
+    FeatureVectorGeneratorType::New();
+  fvGen->SetInput( inputImage[0] );
+  fvGen->AddInput( inputImage[1] );
+
+  FilterType::Pointer filter[2];
+  for( unsigned int f = 0; f < 2; ++f )
+    {
+    filter[f] = FilterType::New();
+    filter[f]->SetFeatureVectorGenerator( fvGen );
+    filter[f]->SetInputLabelMap( inputImage[2] );
+    filter[f]->SetObjectId( 255 );
+    filter[f]->AddObjectId( 127 );
+    filter[f]->SetVoidId( 0 );
+    filter[f]->SetErodeDilateRadius( 0 );
+    filter[f]->SetHoleFillIterations( 5 );
+    filter[f]->SetHistogramSmoothingStandardDeviation( 2 );
+    filter[f]->SetReclassifyObjectLabels( false );
+    filter[f]->SetReclassifyNotObjectLabels( false );
+    filter[f]->SetForceClassification( false );
+    filter[f]->SetUseSparsePDFs( f == 1 );
+    filter[f]->Update();
+    }
+  FilterType::Pointer denseFilter = filter[0];
+  FilterType::Pointer sparseFilter = filter[1];
+
+  const unsigned int numClasses = denseFilter->GetNumberOfObjectIds();
+
+  std::vector< double > peak( numClasses, 0 );
+  for( unsigned int c = 0; c < numClasses; ++c )
+    {
+    typedef FilterType::PDFImageType PDFImageType;
+    itk::ImageRegionConstIterator< PDFImageType > pdfIt(
+      denseFilter->GetClassPDFImage( c ),
+      denseFilter->GetClassPDFImage( c )->GetLargestPossibleRegion() );
+    for( pdfIt.GoToBegin(); !pdfIt.IsAtEnd(); ++pdfIt )
+      {
+      if( pdfIt.Get() > peak[c] )
+        {
+        peak[c] = pdfIt.Get();
+        }
+      }
+    if( peak[c] <= 0 )
+      {
+      std::cout << "Dense PDF of class " << c << " is empty." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  int error = EXIT_SUCCESS;
+
+  std::vector< double > maxDiff( numClasses, 0 );
+  std::vector< double > sumDiff( numClasses, 0 );
+  unsigned int count = 0;
+  itk::ImageRegionIteratorWithIndex< ImageType > it( inputImage[0],
+    inputImage[0]->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    FilterType::FeatureVectorType fv = fvGen->GetFeatureVector(
+      it.GetIndex() );
+    FilterType::ProbabilityVectorType denseProb =
+      denseFilter->GetProbabilityVector( fv );
+    FilterType::ProbabilityVectorType sparseProb =
+      sparseFilter->GetProbabilityVector( fv );
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      double diff = std::fabs( denseProb[c] - sparseProb[c] ) / peak[c];
+      if( diff > maxDiff[c] )
+        {
+        maxDiff[c] = diff;
+        }
+      sumDiff[c] += diff;
+      }
+    ++count;
+    }
+
+  for( unsigned int c = 0; c < numClasses; ++c )
+    {
+    double meanDiff = sumDiff[c] / count;
+    std::cout << "Class " << c << " : max difference = " << maxDiff[c]
+      << " : mean difference = " << meanDiff << " ( of peak density )"
+      << std::endl;
+    if( maxDiff[c] > 0.05 || meanDiff > 0.005 )
+      {
+      std::cout << "Sparse and dense PDFs of class " << c << " disagree."
+        << std::endl;
+      error = EXIT_FAILURE;
+      }
+    }
+
+  // Loading dense PDFs must switch a sparse segmenter back to dense PDFs
+  for( unsigned int c = 0; c < numClasses; ++c )
+    {
+    sparseFilter->SetClassPDFImage( c, denseFilter->GetClassPDFImage( c ) );
+    }
+  if( sparseFilter->GetUseSparsePDFs() )
+    {
+    std::cout << "SetClassPDFImage did not disable sparse PDFs."
+      << std::endl;
+    error = EXIT_FAILURE;
+    }
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    FilterType::FeatureVectorType fv = fvGen->GetFeatureVector(
+      it.GetIndex() );
+    FilterType::ProbabilityVectorType denseProb =
+      denseFilter->GetProbabilityVector( fv );
+    FilterType::ProbabilityVectorType loadedProb =
+      sparseFilter->GetProbabilityVector( fv );
+    for( unsigned int c = 0; c < numClasses; ++c )
+      {
+      if( denseProb[c] != loadedProb[c] )
+        {
+        std::cout << "Loaded dense PDF differs at " << it.GetIndex()
+          << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return error;
+}
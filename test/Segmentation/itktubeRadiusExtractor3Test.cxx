@@ -0,0 +1,171 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeRadiusExtractor3.h"
+
+#include <itkBinaryThresholdImageFilter.h>
+#include <itkImageFileReader.h>
+#include <itkMinimumMaximumImageCalculator.h>
+#include <itkSpatialObjectReader.h>
+
+/** Radii are estimated along the true centerlines with one and with
+ *  several work units; the results must be identical.  This is checked
+ *  on the input image and, with the radius correction for binary images,
+ *  on the input image thresholded at the middle of its range. */
+
+typedef itk::Image<float, 3>                         ImageType;
+typedef itk::tube::RadiusExtractor3<ImageType>       RadiusOpType;
+typedef itk::SpatialObject<>::ChildrenListType       ObjectListType;
+typedef itk::TubeSpatialObject<>                     TubeType;
+
+static int CompareSerialAndParallelRadii( ImageType * im,
+  RadiusOpType::RadiusCorrectionFunctionType correctionFunction,
+  ObjectListType * tubeList )
+{
+  RadiusOpType::Pointer serialOp = RadiusOpType::New();
+  serialOp->SetInputImage( im );
+  serialOp->SetRadiusStart( 1.0 );
+  serialOp->SetRadiusCorrectionFunction( correctionFunction );
+
+  RadiusOpType::Pointer parallelOp = RadiusOpType::New();
+  parallelOp->SetInputImage( im );
+  parallelOp->SetRadiusStart( 1.0 );
+  parallelOp->SetRadiusCorrectionFunction( correctionFunction );
+  parallelOp->SetNumberOfWorkUnits( 4 );
+
+  int failures = 0;
+  unsigned int numTubesTested = 0;
+  ObjectListType::iterator tubeIter = tubeList->begin();
+  while( tubeIter != tubeList->end() )
+    {
+    TubeType * tube = static_cast< TubeType * >( tubeIter->GetPointer() );
+
+    TubeType::Pointer serialTube = TubeType::New();
+    serialTube->SetPoints( tube->GetPoints() );
+    TubeType::Pointer parallelTube = TubeType::New();
+    parallelTube->SetPoints( tube->GetPoints() );
+
+    bool serialResult = serialOp->ExtractRadii( serialTube );
+    bool parallelResult = parallelOp->ExtractRadii( parallelTube );
+    if( serialResult != parallelResult )
+      {
+      std::cout << "ExtractRadii results differ for tube "
+        << tube->GetId() << std::endl;
+      ++failures;
+      }
+    else if( serialResult )
+      {
+      ++numTubesTested;
+      for( unsigned int i = 0; i < serialTube->GetPoints().size(); ++i )
+        {
+        if( serialTube->GetPoints()[i].GetRadiusInObjectSpace()
+          != parallelTube->GetPoints()[i].GetRadiusInObjectSpace() )
+          {
+          std::cout << "Radius differs at point " << i << " of tube "
+            << tube->GetId() << " : "
+            << serialTube->GetPoints()[i].GetRadiusInObjectSpace()
+            << " != "
+            << parallelTube->GetPoints()[i].GetRadiusInObjectSpace()
+            << std::endl;
+          ++failures;
+          break;
+          }
+        }
+      }
+    ++tubeIter;
+    }
+
+  std::cout << "Number of tubes tested = " << numTubesTested << std::endl;
+  if( numTubesTested == 0 )
+    {
+    ++failures;
+    }
+  if( serialOp->GetRadiusStart() != parallelOp->GetRadiusStart() )
+    {
+    std::cout << "Final radius start differs." << std::endl;
+    ++failures;
+    }
+
+  return failures;
+}
+
+int itktubeRadiusExtractor3Test( int argc, char * argv[] )
+{
+  if( argc != 3 )
+    {
+    std::cout
+      << "itktubeRadiusExtractor3Test <inputImage> <vessel.tre>"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::ImageFileReader< ImageType > ImageReaderType;
+  ImageReaderType::Pointer imReader = ImageReaderType::New();
+  imReader->SetFileName( argv[1] );
+  imReader->Update();
+  ImageType::Pointer im = imReader->GetOutput();
+
+  typedef itk::MinimumMaximumImageCalculator< ImageType > MinMaxType;
+  MinMaxType::Pointer minMax = MinMaxType::New();
+  minMax->SetImage( im );
+  minMax->Compute();
+
+  typedef itk::BinaryThresholdImageFilter< ImageType, ImageType >
+    ThresholdType;
+  ThresholdType::Pointer threshold = ThresholdType::New();
+  threshold->SetInput( im );
+  threshold->SetLowerThreshold( ( minMax->GetMinimum()
+    + minMax->GetMaximum() ) / 2 );
+  threshold->SetInsideValue( 1 );
+  threshold->SetOutsideValue( 0 );
+  threshold->Update();
+  ImageType::Pointer binaryIm = threshold->GetOutput();
+
+  typedef itk::SpatialObjectReader<>                   ReaderType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[2] );
+  reader->Update();
+
+  char tubeName[17];
+  std::strcpy( tubeName, "Tube" );
+  ObjectListType * tubeList = reader->GetGroup()->GetChildren( -1,
+    tubeName );
+
+  std::cout << "Input image:" << std::endl;
+  int failures = CompareSerialAndParallelRadii( im,
+    RadiusOpType::RADIUS_CORRECTION_NONE, tubeList );
+
+  std::cout << "Binary image:" << std::endl;
+  failures += CompareSerialAndParallelRadii( binaryIm,
+    RadiusOpType::RADIUS_CORRECTION_FOR_BINARY_IMAGE, tubeList );
+
+  delete tubeList;
+
+  std::cout << "Number of failures = " << failures << std::endl;
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -29,10 +29,11 @@ limitations under the License.
 
 int itktubeRidgeExtractorTest2( int argc, char * argv[] )
 {
-  if( argc != 3 )
+  if( argc != 3 && argc != 4 )
     {
     std::cout
       << "itktubeRidgeExtractorTest <inputImage> <vessel.tre>"
+      << " [useBlurredImageCache]"
       << std::endl;
     return EXIT_FAILURE;
     }
@@ -54,6 +55,10 @@ int itktubeRidgeExtractorTest2( int argc, char * argv[] )
   ridgeOp->SetInputImage( im );
   ridgeOp->SetStepX( 0.5 );
   ridgeOp->SetDynamicScale( true );
+  if( argc > 3 )
+    {
+    ridgeOp->SetUseBlurredImageCache( std::atoi( argv[3] ) != 0 );
+    }
   ridgeOp->ResetFailureCodeCounts();
 
   typedef itk::SpatialObjectReader<>                   ReaderType;
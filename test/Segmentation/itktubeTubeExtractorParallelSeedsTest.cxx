@@ -0,0 +1,299 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeTubeExtractor.h"
+
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkSpatialObjectReader.h>
+
+#include <cmath>
+#include <sstream>
+
+/** Seeds are taken from the true centerlines.  The list is processed with
+ *  several work units twice and the resulting masks must be identical.
+ *  The parallel run must extract as many tubes as a serial run and claim
+ *  the same voxels, up to the voxels of a tube that is kept although the
+ *  serial trace would have stopped next to a claimed voxel.  The profiles
+ *  of both runs must account for every seed and every accepted tube.
+ *  With the radius correction for binary images, the parallel run must
+ *  extract as many tubes as the serial run, with the same mean radius. */
+
+typedef itk::Image<float, 3>                          ImageType;
+typedef itk::tube::TubeExtractor<ImageType>           TubeOpType;
+
+static int CheckProfile( TubeOpType * tubeOp, size_t numberOfSeeds,
+  const std::string & name )
+{
+  typedef itk::tube::TubeExtractorProfile ProfileType;
+
+  ProfileType profile = tubeOp->GetProfile();
+  int failures = 0;
+  if( profile.GetCounter( ProfileType::SEED_TRACES ) < numberOfSeeds
+    || profile.GetSeedRecords().size()
+      != profile.GetCounter( ProfileType::SEED_TRACES ) )
+    {
+    std::cout << name << ": seed traces not recorded." << std::endl;
+    ++failures;
+    }
+  if( profile.GetCounter( ProfileType::TUBES )
+    != tubeOp->GetTubeGroup()->GetNumberOfChildren() )
+    {
+    std::cout << name << ": accepted tubes not counted." << std::endl;
+    ++failures;
+    }
+  if( profile.GetCounter( ProfileType::BLUR_EVALUATIONS ) == 0
+    || profile.GetCounter( ProfileType::RIDGE_STEPS ) == 0
+    || profile.GetCounter( ProfileType::RADIUS_KERNELS ) == 0
+    || profile.GetCounter( ProfileType::MASK_WRITES ) == 0 )
+    {
+    std::cout << name << ": work counters not updated." << std::endl;
+    ++failures;
+    }
+  if( profile.GetTimerCount( ProfileType::PROCESS_SEEDS ) != 1
+    || profile.GetTimerCount( ProfileType::EXTRACT_TUBE )
+      != profile.GetCounter( ProfileType::SEED_TRACES ) )
+    {
+    std::cout << name << ": timers not updated." << std::endl;
+    ++failures;
+    }
+
+  std::ostringstream json;
+  profile.WriteJSON( json );
+  if( json.str().find( "\"RidgeSteps\"" ) == std::string::npos )
+    {
+    std::cout << name << ": profile not written." << std::endl;
+    ++failures;
+    }
+  return failures;
+}
+
+static TubeOpType::Pointer RunTubeExtractor( ImageType * im,
+  const TubeOpType::PointListType & seeds, unsigned int numberOfWorkUnits,
+  TubeOpType::RadiusExtractorType::RadiusCorrectionFunctionType
+    correctionFunction =
+    TubeOpType::RadiusExtractorType::RADIUS_CORRECTION_NONE )
+{
+  TubeOpType::Pointer tubeOp = TubeOpType::New();
+  tubeOp->SetInputImage( im );
+  tubeOp->GetRadiusExtractor()->SetRadiusCorrectionFunction(
+    correctionFunction );
+  tubeOp->SetRadiusInObjectSpace( 1.0 );
+  tubeOp->SetBorderInIndexSpace( 5 );
+  tubeOp->SetNumberOfWorkUnits( numberOfWorkUnits );
+  tubeOp->SetSeedsInObjectSpaceList( seeds );
+  tubeOp->ProcessSeeds();
+  return tubeOp;
+}
+
+static double MeanRadius( TubeOpType * tubeOp )
+{
+  typedef itk::SpatialObject<>::ChildrenListType       ObjectListType;
+  typedef itk::TubeSpatialObject<>                     TubeType;
+
+  double sumRadius = 0;
+  unsigned int numberOfPoints = 0;
+  ObjectListType * tubeList = tubeOp->GetTubeGroup()->GetChildren();
+  ObjectListType::iterator tubeIter = tubeList->begin();
+  while( tubeIter != tubeList->end() )
+    {
+    TubeType * tube = static_cast< TubeType * >( tubeIter->GetPointer() );
+    for( unsigned int i = 0; i < tube->GetPoints().size(); ++i )
+      {
+      sumRadius += tube->GetPoints()[i].GetRadiusInObjectSpace();
+      ++numberOfPoints;
+      }
+    ++tubeIter;
+    }
+  delete tubeList;
+
+  if( numberOfPoints == 0 )
+    {
+    return 0;
+    }
+  return sumRadius / numberOfPoints;
+}
+
+int itktubeTubeExtractorParallelSeedsTest( int argc, char * argv[] )
+{
+  if( argc != 3 )
+    {
+    std::cout
+      << "itktubeTubeExtractorParallelSeedsTest <inputImage> <vessel.tre>"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::ImageFileReader< ImageType > ImageReaderType;
+  ImageReaderType::Pointer imReader = ImageReaderType::New();
+  imReader->SetFileName( argv[1] );
+  imReader->Update();
+  ImageType::Pointer im = imReader->GetOutput();
+
+  typedef itk::SpatialObjectReader<>                   ReaderType;
+  typedef itk::SpatialObject<>::ChildrenListType       ObjectListType;
+  typedef itk::TubeSpatialObject<>                     TubeType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[2] );
+  reader->Update();
+
+  char tubeName[17];
+  std::strcpy( tubeName, "Tube" );
+  ObjectListType * tubeList = reader->GetGroup()->GetChildren( -1,
+    tubeName );
+
+  const unsigned int maxNumberOfSeeds = 24;
+  TubeOpType::PointListType seeds;
+  ObjectListType::iterator tubeIter = tubeList->begin();
+  while( tubeIter != tubeList->end() && seeds.size() < maxNumberOfSeeds )
+    {
+    TubeType * tube = static_cast< TubeType * >( tubeIter->GetPointer() );
+    tube->Update();
+    for( unsigned int i = 0; i < tube->GetPoints().size()
+      && seeds.size() < maxNumberOfSeeds; i += 20 )
+      {
+      ImageType::PointType pnt =
+        tube->GetPoints()[i].GetPositionInWorldSpace();
+      ImageType::IndexType indx;
+      if( im->TransformPhysicalPointToIndex( pnt, indx ) )
+        {
+        seeds.push_back( pnt );
+        }
+      }
+    ++tubeIter;
+    }
+  delete tubeList;
+  std::cout << "Number of seeds = " << seeds.size() << std::endl;
+
+  TubeOpType::Pointer serialOp = RunTubeExtractor( im, seeds, 1 );
+  TubeOpType::Pointer parallelOp = RunTubeExtractor( im, seeds, 4 );
+  TubeOpType::Pointer parallelOp2 = RunTubeExtractor( im, seeds, 4 );
+
+  int failures = 0;
+
+  itk::ImageRegionConstIterator< TubeOpType::TubeMaskImageType > maskIt(
+    parallelOp->GetTubeMaskImage(),
+    parallelOp->GetTubeMaskImage()->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< TubeOpType::TubeMaskImageType > maskIt2(
+    parallelOp2->GetTubeMaskImage(),
+    parallelOp2->GetTubeMaskImage()->GetLargestPossibleRegion() );
+  unsigned int numberOfDifferences = 0;
+  while( !maskIt.IsAtEnd() )
+    {
+    if( maskIt.Get() != maskIt2.Get() )
+      {
+      ++numberOfDifferences;
+      }
+    ++maskIt;
+    ++maskIt2;
+    }
+  if( numberOfDifferences > 0 )
+    {
+    std::cout << "Parallel runs differ in " << numberOfDifferences
+      << " mask voxels." << std::endl;
+    ++failures;
+    }
+
+  unsigned int numSerial = serialOp->GetTubeGroup()->GetNumberOfChildren();
+  unsigned int numParallel =
+    parallelOp->GetTubeGroup()->GetNumberOfChildren();
+  std::cout << "Serial tubes = " << numSerial << std::endl;
+  std::cout << "Parallel tubes = " << numParallel << std::endl;
+  if( numParallel == 0 || numParallel
+    != parallelOp2->GetTubeGroup()->GetNumberOfChildren() )
+    {
+    std::cout << "Parallel tube counts are not repeatable." << std::endl;
+    ++failures;
+    }
+  if( numParallel != numSerial )
+    {
+    std::cout << "Parallel and serial tube counts differ." << std::endl;
+    ++failures;
+    }
+
+  itk::ImageRegionConstIterator< TubeOpType::TubeMaskImageType > serialIt(
+    serialOp->GetTubeMaskImage(),
+    serialOp->GetTubeMaskImage()->GetLargestPossibleRegion() );
+  unsigned int numberOfClaimed = 0;
+  unsigned int numberOfClaimDifferences = 0;
+  maskIt.GoToBegin();
+  while( !maskIt.IsAtEnd() )
+    {
+    if( serialIt.Get() != 0 )
+      {
+      ++numberOfClaimed;
+      }
+    if( ( serialIt.Get() != 0 ) != ( maskIt.Get() != 0 ) )
+      {
+      ++numberOfClaimDifferences;
+      }
+    ++serialIt;
+    ++maskIt;
+    }
+  std::cout << "Serial claimed voxels = " << numberOfClaimed << std::endl;
+  std::cout << "Claimed voxel differences = " << numberOfClaimDifferences
+    << std::endl;
+  if( numberOfClaimed == 0
+    || numberOfClaimDifferences * 100 > numberOfClaimed )
+    {
+    std::cout << "Parallel and serial masks differ." << std::endl;
+    ++failures;
+    }
+
+  failures += CheckProfile( serialOp, seeds.size(), "Serial" );
+  failures += CheckProfile( parallelOp, seeds.size(), "Parallel" );
+
+  TubeOpType::Pointer serialBinaryOp = RunTubeExtractor( im, seeds, 1,
+    TubeOpType::RadiusExtractorType::RADIUS_CORRECTION_FOR_BINARY_IMAGE );
+  TubeOpType::Pointer parallelBinaryOp = RunTubeExtractor( im, seeds, 4,
+    TubeOpType::RadiusExtractorType::RADIUS_CORRECTION_FOR_BINARY_IMAGE );
+  unsigned int numSerialBinary =
+    serialBinaryOp->GetTubeGroup()->GetNumberOfChildren();
+  unsigned int numParallelBinary =
+    parallelBinaryOp->GetTubeGroup()->GetNumberOfChildren();
+  double serialBinaryRadius = MeanRadius( serialBinaryOp );
+  double parallelBinaryRadius = MeanRadius( parallelBinaryOp );
+  std::cout << "Binary correction serial tubes = " << numSerialBinary
+    << ", mean radius = " << serialBinaryRadius << std::endl;
+  std::cout << "Binary correction parallel tubes = " << numParallelBinary
+    << ", mean radius = " << parallelBinaryRadius << std::endl;
+  if( numSerialBinary == 0 || numParallelBinary != numSerialBinary )
+    {
+    std::cout << "Binary correction tube counts differ." << std::endl;
+    ++failures;
+    }
+  if( std::fabs( parallelBinaryRadius - serialBinaryRadius )
+    > 0.05 * serialBinaryRadius )
+    {
+    std::cout << "Binary correction radii differ." << std::endl;
+    ++failures;
+    }
+
+  std::cout << "Number of failures = " << failures << std::endl;
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}